@@ -0,0 +1,199 @@
+// std.async
+// Asynchronous tasks are coroutines that suspend until a future is ready with 'yield await(future);'
+// Tasks are resumed by async_run that waits for fd readiness and timers without blocking other tasks
+
+int async_read_ready(int fd);
+int async_write_ready(int fd);
+int async_sleep(int milliseconds);
+int async_host_future();
+
+bool async_future_valid(int id);
+bool async_future_ready(int id);
+long async_future_result(int id);
+void async_future_release(int id);
+
+int async_poll(int timeout);
+int async_next_ready();
+bool async_has_pending();
+
+int async_fd_read(int fd, char[] buffer);
+int async_fd_write(int fd, char[] data);
+
+class future
+{
+	int id;
+}
+
+// Future that is ready when fd has data to read
+future read_ready(int fd){ future f; f.id = async_read_ready(fd); return f; }
+
+// Future that is ready when data can be written to fd
+future write_ready(int fd){ future f; f.id = async_write_ready(fd); return f; }
+
+// Future that is ready after a number of milliseconds
+future sleep(int milliseconds){ future f; f.id = async_sleep(milliseconds); return f; }
+
+// Future that is completed by the host application, future id should be passed to the host
+future host_future(){ future f; f.id = async_host_future(); return f; }
+
+bool future:ready(){ return async_future_ready(id); }
+
+// Ready fd events or a value that the host has completed the future with
+long future:result(){ return async_future_result(id); }
+
+void future:release(){ async_future_release(id); id = 0; }
+
+// Value to yield from a task to wait for a future
+int await(future f){ return f.id; }
+
+// Non-blocking fd access, returns the number of bytes transferred or -1
+int fd_read(int fd, char[] buffer){ return async_fd_read(fd, buffer); }
+int fd_write(int fd, char[] data){ return async_fd_write(fd, data); }
+
+class async_task
+{
+	int ref() run;
+
+	// Next task waiting for the same future
+	async_task ref next;
+}
+
+class async_scheduler
+{
+	async_task ref[] ready;
+	int head;
+	int count;
+
+	// Tasks waiting for a future, indexed by future id
+	async_task ref[] waiting;
+	int waitingCount;
+
+	void push(async_task ref task)
+	{
+		if(count == ready.size)
+		{
+			async_task ref[] next = new async_task ref[ready.size ? ready.size * 2 : 16];
+
+			for(int i = 0; i < count; i++)
+				next[i] = ready[(head + i) % ready.size];
+
+			ready = next;
+			head = 0;
+		}
+
+		ready[(head + count) % ready.size] = task;
+		count++;
+	}
+
+	async_task ref pop()
+	{
+		async_task ref task = ready[head];
+		ready[head] = nullptr;
+
+		head = (head + 1) % ready.size;
+		count--;
+
+		return task;
+	}
+
+	void wait(async_task ref task, int id)
+	{
+		if(id >= waiting.size)
+		{
+			async_task ref[] next = new async_task ref[id * 2 > 16 ? id * 2 : 16];
+
+			for(int i = 0; i < waiting.size; i++)
+				next[i] = waiting[i];
+
+			waiting = next;
+		}
+
+		task.next = waiting[id];
+		waiting[id] = task;
+
+		waitingCount++;
+	}
+
+	void wake(int id)
+	{
+		if(id >= waiting.size || !waiting[id])
+			return;
+
+		// Tasks waiting for a released future are never resumed
+		if(!async_future_valid(id))
+		{
+			for(async_task ref task = waiting[id]; task; task = task.next)
+				waitingCount--;
+
+			waiting[id] = nullptr;
+			return;
+		}
+
+		// Released future id might be reused
+		if(!async_future_ready(id))
+			return;
+
+		for(async_task ref task = waiting[id]; task; task = task.next)
+		{
+			push(task);
+			waitingCount--;
+		}
+
+		waiting[id] = nullptr;
+	}
+}
+
+async_scheduler async_tasks;
+
+// Schedule a coroutine as an asynchronous task
+void async_spawn(int ref() run)
+{
+	__assertCoroutine(run);
+
+	async_task ref task = new async_task;
+
+	task.run = run;
+
+	async_tasks.push(task);
+}
+
+// Returns the number of tasks that are not complete
+int async_task_count()
+{
+	return async_tasks.count + async_tasks.waitingCount;
+}
+
+// Run tasks until they are complete or until the remaining tasks wait for host futures
+void async_run()
+{
+	while(true)
+	{
+		while(async_tasks.count)
+		{
+			async_task ref task = async_tasks.pop();
+
+			int id = task.run();
+
+			if(isCoroutineReset(task.run))
+				continue;
+
+			// Plain yield lets other tasks run
+			if(id == 0 || async_future_ready(id))
+				async_tasks.push(task);
+			else
+				async_tasks.wait(task, id);
+		}
+
+		if(!async_tasks.waitingCount)
+			return;
+
+		// Host futures might be completed between the calls
+		int readyCount = async_poll(-1);
+
+		for(int id = async_next_ready(); id; id = async_next_ready())
+			async_tasks.wake(id);
+
+		if(!readyCount && !async_has_pending())
+			return;
+	}
+}
@@ -8,5 +8,18 @@ class NamespaceGC
 
 	double	MarkTime();
 	double	CollectTime();
+
+	// Allocation profiler records an allocation every 'sampleBytes' bytes (0 to disable)
+	void	SetAllocationProfiler(int sampleBytes);
+
+	long	LiveBytes(typeid type);
+	long	TotalBytes(typeid type);
+
+	// Collection telemetry, pause time is measured in milliseconds
+	int		CollectionCount();
+	double	LastPauseTime();
+
+	// Number of collections with a pause in [2^(bucket-1), 2^bucket) microsecond range
+	int		PauseHistogram(int bucket);
 }
 NamespaceGC GC;
@@ -0,0 +1,240 @@
+// std.task
+// Tasks are run by a cooperative scheduler on the thread that executes the program, they are interleaved and never run in parallel
+// Task function that is a coroutine is suspended when it yields and is resumed after the other pending tasks
+// parallel_map runs a function on worker contexts in separate threads
+
+bool is_coroutine(auto ref function);
+
+class task_state
+{
+	// Returns true when the task is complete
+	bool ref() resume;
+
+	bool done;
+	bool running;
+}
+
+// Queue of pending tasks, new tasks are taken from the back and suspended tasks are placed at the front
+class task_queue
+{
+	task_state ref[] data;
+	int head;
+	int count;
+
+	void grow()
+	{
+		task_state ref[] next = new task_state ref[data.size ? data.size * 2 : 16];
+
+		for(int i = 0; i < count; i++)
+			next[i] = data[(head + i) % data.size];
+
+		data = next;
+		head = 0;
+	}
+
+	void push_back(task_state ref state)
+	{
+		if(count == data.size)
+			grow();
+
+		data[(head + count) % data.size] = state;
+		count++;
+	}
+
+	void push_front(task_state ref state)
+	{
+		if(count == data.size)
+			grow();
+
+		head = (head + data.size - 1) % data.size;
+		data[head] = state;
+		count++;
+	}
+
+	task_state ref pop_back()
+	{
+		count--;
+
+		int pos = (head + count) % data.size;
+
+		task_state ref state = data[pos];
+		data[pos] = nullptr;
+
+		return state;
+	}
+
+}
+
+task_queue task_pending;
+
+// Run a single step of a pending task
+// Returns false if there are no pending tasks
+bool task_run_one()
+{
+	if(!task_pending.count)
+		return false;
+
+	task_state ref state = task_pending.pop_back();
+
+	state.running = true;
+
+	bool finished = state.resume();
+
+	state.running = false;
+
+	if(finished)
+		state.done = true;
+	else
+		task_pending.push_front(state);
+
+	return true;
+}
+
+// Run pending tasks until all of them are complete
+void task_run_all()
+{
+	while(task_run_one()){}
+}
+
+// Returns the number of tasks that are waiting to be run or resumed
+int task_pending_count()
+{
+	return task_pending.count;
+}
+
+void task_wait(task_state ref state)
+{
+	assert(!state.running, "task can't wait for itself");
+
+	while(!state.done)
+	{
+		// Target task is suspended somewhere up the call stack
+		assert(task_pending.count != 0, "task can't wait for a task that is waiting for it");
+
+		task_run_one();
+	}
+}
+
+class task<T>
+{
+	task_state ref state;
+
+	@if(T != void)
+	{
+		T ref result;
+	}
+}
+
+// Schedule a function to be run as a task
+auto schedule(@T ref() function)
+{
+	task<T> t;
+
+	t.state = new task_state;
+
+	@if(T != void)
+	{
+		T ref result = new T;
+		t.result = result;
+	}
+
+	if(is_coroutine(function))
+	{
+		t.state.resume = auto(){
+			@if(T != void)
+				*result = function();
+			else
+				function();
+
+			return bool(isCoroutineReset(function));
+		};
+	}
+	else
+	{
+		t.state.resume = auto(){
+			@if(T != void)
+				*result = function();
+			else
+				function();
+
+			return true;
+		};
+	}
+
+	task_pending.push_back(t.state);
+
+	return t;
+}
+
+bool task:done()
+{
+	return state.done;
+}
+
+// Wait for the task to complete by running pending tasks and get the task result
+auto task:join()
+{
+	task_wait(state);
+
+	@if(T != void)
+		return *result;
+}
+
+// Run 'body' for every index in [begin, end) range with tasks that handle 'grain' indices each, other pending tasks can run between them
+void task_for(int begin, int end, int grain, void ref(int) body)
+{
+	assert(grain > 0, "grain size must be positive");
+
+	if(begin >= end)
+		return;
+
+	auto tasks = new task<void>[(end - begin + grain - 1) / grain];
+
+	for(int i = 0; i < tasks.size; i++)
+	{
+		int from = begin + i * grain;
+		int to = from + grain < end ? from + grain : end;
+
+		tasks[i] = schedule(auto(){
+			for(int k = from; k < to; k++)
+				body(k);
+		});
+	}
+
+	for(i in tasks)
+		i.join();
+}
+
+void task_for(int begin, int end, void ref(int) body)
+{
+	task_for(begin, end, 1024, body);
+}
+
+// Run 'body' for every array element
+void task_for(generic arr, void ref(typeof(arr).target ref) body)
+{
+	task_for(0, arr.size, auto(int i){ body(&arr[i]); });
+}
+
+// Create an array of function results for every array element, each task receives a copy of the element
+auto task_map(generic arr, generic ref(typeof(arr).target) f)
+{
+	auto res = new typeof(f).return[arr.size];
+
+	task_for(0, arr.size, auto(int i){ res[i] = f(arr[i]); });
+
+	return res;
+}
+
+// Create an array of function results for every array element on 'workers' worker contexts, 0 selects the processor count
+// Worker contexts run on separate threads and each call receives a copy of the element, results are copied back
+// Function can't capture variables, global code isn't executed in worker contexts and global variables are in their initial state
+int[] parallel_map(int[] arr, int ref(int) f, int workers);
+long[] parallel_map(long[] arr, long ref(long) f, int workers);
+float[] parallel_map(float[] arr, float ref(float) f, int workers);
+double[] parallel_map(double[] arr, double ref(double) f, int workers);
+
+int[] parallel_map(int[] arr, int ref(int) f){ return parallel_map(arr, f, 0); }
+long[] parallel_map(long[] arr, long ref(long) f){ return parallel_map(arr, f, 0); }
+float[] parallel_map(float[] arr, float ref(float) f){ return parallel_map(arr, f, 0); }
+double[] parallel_map(double[] arr, double ref(double) f){ return parallel_map(arr, f, 0); }
@@ -31,6 +31,7 @@ LOCAL_SRC_FILES += NULLC/Linker.cpp
 LOCAL_SRC_FILES += NULLC/nullc.cpp
 LOCAL_SRC_FILES += NULLC/ParseGraph.cpp
 LOCAL_SRC_FILES += NULLC/ParseTree.cpp
+LOCAL_SRC_FILES += NULLC/Snapshot.cpp
 LOCAL_SRC_FILES += NULLC/stdafx.cpp
 LOCAL_SRC_FILES += NULLC/StdLib.cpp
 LOCAL_SRC_FILES += NULLC/StrAlgo.cpp
@@ -62,6 +63,7 @@ LOCAL_SRC_FILES += NULLC/includes/canvas.cpp
 LOCAL_SRC_FILES += NULLC/includes/vector.cpp
 
 # std
+LOCAL_SRC_FILES += NULLC/includes/async.cpp
 LOCAL_SRC_FILES += NULLC/includes/dynamic.cpp
 LOCAL_SRC_FILES += NULLC/includes/error.cpp
 LOCAL_SRC_FILES += NULLC/includes/file.cpp
@@ -71,6 +73,7 @@ LOCAL_SRC_FILES += NULLC/includes/math.cpp
 LOCAL_SRC_FILES += NULLC/includes/memory.cpp
 LOCAL_SRC_FILES += NULLC/includes/random.cpp
 LOCAL_SRC_FILES += NULLC/includes/string.cpp
+LOCAL_SRC_FILES += NULLC/includes/task.cpp
 LOCAL_SRC_FILES += NULLC/includes/time.cpp
 LOCAL_SRC_FILES += NULLC/includes/typeinfo.cpp
 
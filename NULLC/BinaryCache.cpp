@@ -1,7 +1,20 @@
 #include "BinaryCache.h"
 
+#include "Bytecode.h"
+#include "InstructionTreeRegVm.h"
 #include "Lexer.h"
 #include "StrAlgo.h"
+#include "Trace.h"
+
+#if defined(_WIN32)
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <pthread.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
 
 namespace BinaryCache
 {
@@ -11,6 +24,206 @@ namespace BinaryCache
 	unsigned int	lastReserved = 0;
 	char*			lastBytecode = NULL;
 	const unsigned int	lastHash = NULLC::GetStringHash("__last.nc");
+
+	char*		cacheDirectory = NULL;
+
+	unsigned	cacheHits = 0;
+	unsigned	cacheMisses = 0;
+
+	const unsigned	cacheMagic = 0x434d4e4e;
+
+
+	struct CacheHeader
+	{
+		unsigned	magic;
+		unsigned	version;
+		unsigned	pointerSize;
+		unsigned	optimizationLevel;
+
+		unsigned	pathHash;
+		unsigned	sourceHash;
+		unsigned	sourceSize;
+
+		unsigned	dependencyCount;
+		unsigned	lexemeCount;
+		unsigned	bytecodeSize;
+	};
+
+	struct CacheLexeme
+	{
+		unsigned	type;
+		unsigned	offset;
+		unsigned	length;
+
+		unsigned	line;
+		unsigned	column;
+	};
+
+	// Cached modules are only loaded by the compiler of the same version with the same bytecode layout
+	unsigned GetCompilerVersion()
+	{
+		unsigned version[] = {
+			NULLC_VERSION,
+			sizeof(void*),
+			sizeof(ByteCode),
+			sizeof(ExternTypeInfo),
+			sizeof(ExternMemberInfo),
+			sizeof(ExternConstantInfo),
+			sizeof(ExternVarInfo),
+			sizeof(ExternFuncInfo),
+			sizeof(ExternLocalInfo),
+			sizeof(ExternModuleInfo),
+			sizeof(ExternSourceInfo),
+			sizeof(RegVmCmd),
+			rviTypeid,
+			lex_with
+		};
+
+		return NULLC::GetStringHash((const char*)version, (const char*)version + sizeof(version));
+	}
+
+	const unsigned	packMagic = 0x504d4e4e;
+
+	// Has to be changed together with the bytecode format
+	const unsigned	packVersion = 2;
+
+	// Bytecode of each module starts at a page boundary, so that pages of unused modules are never touched
+	const unsigned	packAlignment = 4096;
+
+	struct PackHeader
+	{
+		unsigned	magic;
+		unsigned	version;
+		unsigned	pointerSize;
+		unsigned	alignment;
+
+		unsigned	moduleCount;
+		unsigned	nameSize;
+	};
+
+	struct PackEntry
+	{
+		unsigned	nameOffset;
+
+		unsigned	bytecodeOffset;
+		unsigned	bytecodeSize;
+	};
+
+	struct MappedPack
+	{
+		char		*data;
+		unsigned	size;
+	};
+
+	FastVector<MappedPack> packs;
+
+	// Module build threads create lexemes of imported modules while the cache is read by other threads
+#if defined(_WIN32)
+	struct LexemeLock
+	{
+		void Init(){ InitializeCriticalSection(&section); }
+		void Destroy(){ DeleteCriticalSection(&section); }
+
+		void Lock(){ EnterCriticalSection(&section); }
+		void Unlock(){ LeaveCriticalSection(&section); }
+
+		CRITICAL_SECTION section;
+	};
+#else
+	struct LexemeLock
+	{
+		void Init(){ pthread_mutex_init(&mutex, NULL); }
+		void Destroy(){ pthread_mutex_destroy(&mutex); }
+
+		void Lock(){ pthread_mutex_lock(&mutex); }
+		void Unlock(){ pthread_mutex_unlock(&mutex); }
+
+		pthread_mutex_t mutex;
+	};
+#endif
+
+	LexemeLock lexemeLock;
+
+	char* MapPackFile(const char *fileName, unsigned &size)
+	{
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+		if(file == INVALID_HANDLE_VALUE)
+			return NULL;
+
+		LARGE_INTEGER fileSize;
+
+		if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || fileSize.QuadPart > 0x7fffffff)
+		{
+			CloseHandle(file);
+			return NULL;
+		}
+
+		// Pages are copied on write, bytecode is patched when module functions are bound
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+
+		CloseHandle(file);
+
+		if(!mapping)
+			return NULL;
+
+		char *data = (char*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+
+		CloseHandle(mapping);
+
+		size = unsigned(fileSize.QuadPart);
+
+		return data;
+#else
+		int file = open(fileName, O_RDONLY);
+
+		if(file == -1)
+			return NULL;
+
+		struct stat info;
+
+		if(fstat(file, &info) != 0 || info.st_size == 0 || info.st_size > 0x7fffffff)
+		{
+			close(file);
+			return NULL;
+		}
+
+		// Pages are copied on write, bytecode is patched when module functions are bound
+		void *data = mmap(NULL, size_t(info.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+
+		close(file);
+
+		if(data == MAP_FAILED)
+			return NULL;
+
+		size = unsigned(info.st_size);
+
+		return (char*)data;
+#endif
+	}
+
+	void UnmapPackFile(char *data, unsigned size)
+	{
+#if defined(_WIN32)
+		(void)size;
+
+		UnmapViewOfFile(data);
+#else
+		munmap(data, size);
+#endif
+	}
+
+	void GetCachePath(char *buf, unsigned bufSize, const char *path)
+	{
+		char *pos = buf + NULLC::SafeSprintf(buf, bufSize, "%s", cacheDirectory);
+
+		// Module path is flattened into a file name
+		for(const char *curr = path; *curr && pos < buf + bufSize - 5; curr++)
+			*pos++ = *curr == '/' || *curr == '\\' || *curr == ':' ? '.' : *curr;
+
+		NULLC::SafeSprintf(pos, bufSize - unsigned(pos - buf), ".nbc");
+	}
 }
 
 void BinaryCache::ClearImportPaths()
@@ -68,10 +281,14 @@ void BinaryCache::Initialize()
 {
 	lastReserved = 0;
 	lastBytecode = NULL;
+
+	lexemeLock.Init();
 }
 
 void BinaryCache::Terminate()
 {
+	SetCacheDirectory(NULL);
+
 	ClearImportPaths();
 
 	importPaths.reset();
@@ -79,14 +296,22 @@ void BinaryCache::Terminate()
 	for(unsigned int i = 0; i < cache.size(); i++)
 	{
 		NULLC::dealloc((void*)cache[i].name);
-		delete[] cache[i].binary;
+		if(!cache[i].mapped)
+			delete[] cache[i].binary;
 		delete[] cache[i].lexemes;
 	}
 	cache.clear();
 	cache.reset();
 
+	for(unsigned i = 0; i < packs.size(); i++)
+		UnmapPackFile(packs[i].data, packs[i].size);
+	packs.clear();
+	packs.reset();
+
 	delete[] lastBytecode;
 	lastBytecode = NULL;
+
+	lexemeLock.Destroy();
 }
 
 void BinaryCache::PutBytecode(const char* path, const char* bytecode, Lexeme* lexStart, unsigned lexCount)
@@ -109,6 +334,7 @@ void BinaryCache::PutBytecode(const char* path, const char* bytecode, Lexeme* le
 	desc->name = strcpy((char*)NULLC::alloc(pathLen + 1), path);
 	desc->nameHash = hash;
 	desc->binary = bytecode;
+	desc->mapped = false;
 	if(lexStart)
 	{
 		desc->lexemes = new Lexeme[lexCount];
@@ -120,12 +346,16 @@ void BinaryCache::PutBytecode(const char* path, const char* bytecode, Lexeme* le
 	}
 }
 
-void BinaryCache::PutLexemes(const char* path, Lexeme* lexStart, unsigned lexCount)
+Lexeme* BinaryCache::PutLexemes(const char* path, Lexeme* lexStart, unsigned lexCount, unsigned& count)
 {
 	unsigned int hash = NULLC::GetStringHash(path);
 
+	count = lexCount;
+
 	if(hash == lastHash)
-		return;
+		return lexStart;
+
+	lexemeLock.Lock();
 
 	for(unsigned i = 0; i < cache.size(); i++)
 	{
@@ -133,17 +363,28 @@ void BinaryCache::PutLexemes(const char* path, Lexeme* lexStart, unsigned lexCou
 
 		if(hash == cache[i].nameHash)
 		{
-			assert(!cache[i].lexemes);
+			// Lexemes might have been created by another thread
+			if(!desc.lexemes)
+			{
+				desc.lexemes = new Lexeme[lexCount];
+				memcpy(desc.lexemes, lexStart, lexCount * sizeof(Lexeme));
+				desc.lexemeCount = lexCount;
+			}
 
-			desc.lexemes = new Lexeme[lexCount];
-			memcpy(desc.lexemes, lexStart, lexCount * sizeof(Lexeme));
-			desc.lexemeCount = lexCount;
+			count = desc.lexemeCount;
+			Lexeme *lexemes = desc.lexemes;
 
-			return;
+			lexemeLock.Unlock();
+
+			return lexemes;
 		}
 	}
 
+	lexemeLock.Unlock();
+
 	assert(!"module not found");
+
+	return lexStart;
 }
 
 const char* BinaryCache::GetBytecode(const char* path)
@@ -214,8 +455,14 @@ Lexeme* BinaryCache::GetLexems(const char* path, unsigned& count)
 	{
 		if(hash == cache[i].nameHash)
 		{
+			lexemeLock.Lock();
+
 			count = cache[i].lexemeCount;
-			return cache[i].lexemes;
+			Lexeme *lexemes = cache[i].lexemes;
+
+			lexemeLock.Unlock();
+
+			return lexemes;
 		}
 	}
 	return NULL;
@@ -269,7 +516,8 @@ void BinaryCache::RemoveBytecode(const char* path)
 		return;
 
 	NULLC::dealloc((void*)cache[i].name);
-	delete[] cache[i].binary;
+	if(!cache[i].mapped)
+		delete[] cache[i].binary;
 	delete[] cache[i].lexemes;
 
 	cache[i] = cache.back();
@@ -283,6 +531,474 @@ const char* BinaryCache::EnumerateModules(unsigned id)
 	return cache[id].name;
 }
 
+void BinaryCache::SetCacheDirectory(const char* path)
+{
+	NULLC::dealloc(cacheDirectory);
+	cacheDirectory = NULL;
+
+	if(path)
+	{
+		cacheDirectory = (char*)NULLC::alloc(int(strlen(path)) + 1);
+		strcpy(cacheDirectory, path);
+	}
+
+	cacheHits = 0;
+	cacheMisses = 0;
+}
+
+void BinaryCache::GetCacheStatistics(unsigned &hits, unsigned &misses)
+{
+	hits = cacheHits;
+	misses = cacheMisses;
+}
+
+bool BinaryCache::ReadCachedModule(const char* path, const char* code, unsigned codeSize, int optimizationLevel, CachedModule &module)
+{
+	module.bytecode = NULL;
+	module.lexemes = NULL;
+	module.lexemeCount = 0;
+	module.dependencyHashes = NULL;
+
+	if(!cacheDirectory)
+		return false;
+
+	TRACE_SCOPE("cache", "ReadCachedModule");
+	TRACE_LABEL(path);
+
+	const unsigned cachePathLength = 1024;
+	char cachePath[cachePathLength];
+
+	GetCachePath(cachePath, cachePathLength, path);
+
+	unsigned size = 0;
+	const char *data = NULLC::fileLoad(cachePath, &size);
+
+	if(!data)
+	{
+		cacheMisses++;
+		return false;
+	}
+
+	CacheHeader header;
+
+	bool valid = size >= sizeof(CacheHeader);
+
+	if(valid)
+	{
+		memcpy(&header, data, sizeof(CacheHeader));
+
+		valid = header.magic == cacheMagic && header.version == GetCompilerVersion() && header.pointerSize == sizeof(void*) && header.optimizationLevel == unsigned(optimizationLevel);
+	}
+
+	// Entry is shared by all versions of the module source
+	if(valid)
+		valid = header.pathHash == NULLC::GetStringHash(path) && header.sourceSize == codeSize && header.sourceHash == NULLC::GetStringHash(code, code + codeSize);
+
+	if(valid)
+		valid = (unsigned long long)sizeof(CacheHeader) + header.dependencyCount * sizeof(unsigned) + (unsigned long long)header.lexemeCount * sizeof(CacheLexeme) + header.bytecodeSize == size;
+
+	const char *bytecodeData = data + sizeof(CacheHeader) + header.dependencyCount * sizeof(unsigned) + header.lexemeCount * sizeof(CacheLexeme);
+
+	if(valid)
+		valid = header.bytecodeSize >= sizeof(ByteCode) && *(unsigned*)bytecodeData == header.bytecodeSize;
+
+	// Dependency hashes are matched to the modules listed in bytecode
+	if(valid)
+		valid = ((ByteCode*)bytecodeData)->dependsCount == header.dependencyCount;
+
+	// Lexemes refer to the module source stored in bytecode
+	if(valid && header.lexemeCount)
+	{
+		const ByteCode *moduleCode = (const ByteCode*)bytecodeData;
+
+		valid = moduleCode->offsetToSource <= header.bytecodeSize && moduleCode->sourceSize <= header.bytecodeSize - moduleCode->offsetToSource;
+
+		const char *lexemeData = data + sizeof(CacheHeader) + header.dependencyCount * sizeof(unsigned);
+
+		for(unsigned i = 0; i < header.lexemeCount && valid; i++)
+		{
+			CacheLexeme lexeme;
+			memcpy(&lexeme, lexemeData + i * sizeof(CacheLexeme), sizeof(CacheLexeme));
+
+			valid = lexeme.offset <= moduleCode->sourceSize && lexeme.length <= moduleCode->sourceSize - lexeme.offset;
+		}
+	}
+
+	if(!valid)
+	{
+		NULLC::fileFree(data);
+
+		cacheMisses++;
+		return false;
+	}
+
+	module.bytecode = new char[header.bytecodeSize];
+	memcpy(module.bytecode, bytecodeData, header.bytecodeSize);
+
+	module.dependencyHashes = new unsigned[header.dependencyCount + 1];
+	memcpy(module.dependencyHashes, data + sizeof(CacheHeader), header.dependencyCount * sizeof(unsigned));
+
+	if(header.lexemeCount)
+	{
+		const char *source = FindSource((ByteCode*)module.bytecode);
+
+		module.lexemes = new Lexeme[header.lexemeCount];
+		module.lexemeCount = header.lexemeCount;
+
+		const char *lexemeData = data + sizeof(CacheHeader) + header.dependencyCount * sizeof(unsigned);
+
+		for(unsigned i = 0; i < header.lexemeCount; i++)
+		{
+			CacheLexeme lexeme;
+			memcpy(&lexeme, lexemeData + i * sizeof(CacheLexeme), sizeof(CacheLexeme));
+
+			module.lexemes[i].type = LexemeType(lexeme.type);
+			module.lexemes[i].pos = source + lexeme.offset;
+			module.lexemes[i].length = lexeme.length;
+			module.lexemes[i].line = lexeme.line;
+			module.lexemes[i].column = lexeme.column;
+		}
+	}
+
+	NULLC::fileFree(data);
+
+	return true;
+}
+
+void BinaryCache::AcceptCachedModule(const char* path, CachedModule &module)
+{
+	PutBytecode(path, module.bytecode, module.lexemes, module.lexemeCount);
+
+	delete[] module.lexemes;
+	delete[] module.dependencyHashes;
+
+	module.bytecode = NULL;
+	module.lexemes = NULL;
+	module.lexemeCount = 0;
+	module.dependencyHashes = NULL;
+
+	cacheHits++;
+}
+
+void BinaryCache::RejectCachedModule(CachedModule &module)
+{
+	delete[] module.bytecode;
+	delete[] module.lexemes;
+	delete[] module.dependencyHashes;
+
+	module.bytecode = NULL;
+	module.lexemes = NULL;
+	module.lexemeCount = 0;
+	module.dependencyHashes = NULL;
+
+	cacheMisses++;
+}
+
+void BinaryCache::WriteCachedModule(const char* path, const char* code, unsigned codeSize, int optimizationLevel, const char* bytecode)
+{
+	if(!cacheDirectory)
+		return;
+
+	TRACE_SCOPE("cache", "WriteCachedModule");
+	TRACE_LABEL(path);
+
+	ByteCode *moduleCode = (ByteCode*)bytecode;
+
+	CacheHeader header;
+
+	header.magic = cacheMagic;
+	header.version = GetCompilerVersion();
+	header.pointerSize = sizeof(void*);
+	header.optimizationLevel = unsigned(optimizationLevel);
+
+	header.pathHash = NULLC::GetStringHash(path);
+	header.sourceHash = NULLC::GetStringHash(code, code + codeSize);
+	header.sourceSize = codeSize;
+
+	header.dependencyCount = moduleCode->dependsCount;
+	header.lexemeCount = 0;
+	header.bytecodeSize = moduleCode->size;
+
+	FastVector<unsigned> dependencyHashes;
+
+	char *symbols = FindSymbols(moduleCode);
+
+	ExternModuleInfo *moduleList = FindFirstModule(moduleCode);
+
+	for(unsigned i = 0; i < moduleCode->dependsCount; i++)
+	{
+		const char *dependency = FindBytecode(symbols + moduleList[i].nameOffset, false);
+
+		if(!dependency)
+			return;
+
+		dependencyHashes.push_back(GetSourceHash(dependency));
+	}
+
+	// Lexeme positions are stored relative to the module source in bytecode
+	FastVector<CacheLexeme> lexemes;
+
+	unsigned lexemeCount = 0;
+
+	if(Lexeme *lexemeStream = GetLexems(path, lexemeCount))
+	{
+		const char *source = FindSource(moduleCode);
+
+		for(unsigned i = 0; i < lexemeCount; i++)
+		{
+			Lexeme &lexeme = lexemeStream[i];
+
+			if(lexeme.pos < source || lexeme.pos > source + moduleCode->sourceSize)
+			{
+				lexemes.clear();
+				break;
+			}
+
+			CacheLexeme &target = *lexemes.push_back();
+
+			target.type = lexeme.type;
+			target.offset = unsigned(lexeme.pos - source);
+			target.length = lexeme.length;
+			target.line = lexeme.line;
+			target.column = lexeme.column;
+		}
+
+		header.lexemeCount = lexemes.size();
+	}
+
+	const unsigned cachePathLength = 1024;
+	char cachePath[cachePathLength];
+
+	GetCachePath(cachePath, cachePathLength, path);
+
+	// Entry is written to a temporary file and renamed, so that other processes never observe a partial entry
+	char tempPath[cachePathLength + 32];
+	NULLC::SafeSprintf(tempPath, cachePathLength + 32, "%s.%x%x.tmp", cachePath, NULLCTime::clockMicro(), unsigned(uintptr_t(&header) >> 4));
+
+	FILE *file = fopen(tempPath, "wb");
+
+	if(!file)
+		return;
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	if(written && dependencyHashes.size())
+		written = fwrite(dependencyHashes.data, sizeof(unsigned), dependencyHashes.size(), file) == dependencyHashes.size();
+
+	if(written && lexemes.size())
+		written = fwrite(lexemes.data, sizeof(CacheLexeme), lexemes.size(), file) == lexemes.size();
+
+	if(written)
+		written = fwrite(bytecode, 1, moduleCode->size, file) == moduleCode->size;
+
+	if(fclose(file) != 0)
+		written = false;
+
+	if(written && rename(tempPath, cachePath) != 0)
+	{
+		// Existing file is not replaced on some platforms
+		remove(cachePath);
+
+		written = rename(tempPath, cachePath) == 0;
+	}
+
+	if(!written)
+		remove(tempPath);
+}
+
+unsigned BinaryCache::GetSourceHash(const char* bytecode)
+{
+	ByteCode *code = (ByteCode*)bytecode;
+
+	const char *source = FindSource(code);
+
+	return NULLC::GetStringHash(source, source + code->sourceSize);
+}
+
+bool BinaryCache::SaveModulePack(const char* fileName, const char** paths, unsigned count, const char* &error)
+{
+	TRACE_SCOPE("cache", "SaveModulePack");
+
+	PackHeader header;
+
+	header.magic = packMagic;
+	header.version = packVersion;
+	header.pointerSize = sizeof(void*);
+	header.alignment = packAlignment;
+
+	header.moduleCount = count;
+	header.nameSize = 0;
+
+	for(unsigned i = 0; i < count; i++)
+	{
+		if(!GetBytecode(paths[i]))
+		{
+			error = "ERROR: module is not found in the binary cache";
+			return false;
+		}
+
+		header.nameSize += unsigned(strlen(paths[i])) + 1;
+	}
+
+	FastVector<PackEntry> entries;
+
+	unsigned nameOffset = 0;
+	unsigned bytecodeOffset = sizeof(PackHeader) + count * sizeof(PackEntry) + header.nameSize;
+
+	for(unsigned i = 0; i < count; i++)
+	{
+		ByteCode *code = (ByteCode*)GetBytecode(paths[i]);
+
+		PackEntry &entry = *entries.push_back();
+
+		entry.nameOffset = nameOffset;
+
+		entry.bytecodeOffset = (bytecodeOffset + packAlignment - 1) & ~(packAlignment - 1);
+		entry.bytecodeSize = code->size;
+
+		nameOffset += unsigned(strlen(paths[i])) + 1;
+		bytecodeOffset = entry.bytecodeOffset + entry.bytecodeSize;
+	}
+
+	FILE *file = fopen(fileName, "wb");
+
+	if(!file)
+	{
+		error = "ERROR: failed to create module pack file";
+		return false;
+	}
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	if(written && count)
+		written = fwrite(entries.data, sizeof(PackEntry), count, file) == count;
+
+	for(unsigned i = 0; i < count && written; i++)
+		written = fwrite(paths[i], 1, strlen(paths[i]) + 1, file) == strlen(paths[i]) + 1;
+
+	unsigned position = sizeof(PackHeader) + count * sizeof(PackEntry) + header.nameSize;
+
+	char padding[packAlignment];
+	memset(padding, 0, packAlignment);
+
+	for(unsigned i = 0; i < count && written; i++)
+	{
+		unsigned paddingSize = entries[i].bytecodeOffset - position;
+
+		if(paddingSize)
+			written = fwrite(padding, 1, paddingSize, file) == paddingSize;
+
+		if(written)
+			written = fwrite(GetBytecode(paths[i]), 1, entries[i].bytecodeSize, file) == entries[i].bytecodeSize;
+
+		position = entries[i].bytecodeOffset + entries[i].bytecodeSize;
+	}
+
+	if(fclose(file) != 0)
+		written = false;
+
+	if(!written)
+	{
+		remove(fileName);
+
+		error = "ERROR: failed to write module pack file";
+		return false;
+	}
+
+	return true;
+}
+
+bool BinaryCache::LoadModulePack(const char* fileName, const char* &error)
+{
+	TRACE_SCOPE("cache", "LoadModulePack");
+	TRACE_LABEL(fileName);
+
+	unsigned size = 0;
+	char *data = MapPackFile(fileName, size);
+
+	if(!data)
+	{
+		error = "ERROR: failed to open module pack file";
+		return false;
+	}
+
+	PackHeader header;
+
+	bool valid = size >= sizeof(PackHeader);
+
+	if(valid)
+	{
+		memcpy(&header, data, sizeof(PackHeader));
+
+		valid = header.magic == packMagic && header.version == packVersion && header.pointerSize == sizeof(void*);
+	}
+
+	// Bytecode is used in place and has to be aligned at least as much as it is when it is allocated
+	if(valid)
+		valid = header.alignment >= 16 && (header.alignment & (header.alignment - 1)) == 0;
+
+	if(valid)
+		valid = (unsigned long long)sizeof(PackHeader) + (unsigned long long)header.moduleCount * sizeof(PackEntry) + header.nameSize <= size;
+
+	const PackEntry *entries = (const PackEntry*)(data + sizeof(PackHeader));
+	const char *names = data + sizeof(PackHeader) + header.moduleCount * sizeof(PackEntry);
+
+	for(unsigned i = 0; i < header.moduleCount && valid; i++)
+	{
+		PackEntry entry;
+		memcpy(&entry, &entries[i], sizeof(PackEntry));
+
+		valid = entry.nameOffset < header.nameSize && memchr(names + entry.nameOffset, 0, header.nameSize - entry.nameOffset) != NULL;
+
+		if(valid)
+			valid = entry.bytecodeOffset % header.alignment == 0 && (unsigned long long)entry.bytecodeOffset + entry.bytecodeSize <= size;
+
+		if(valid)
+			valid = entry.bytecodeSize >= sizeof(ByteCode) && ((ByteCode*)(data + entry.bytecodeOffset))->size == entry.bytecodeSize;
+	}
+
+	if(!valid)
+	{
+		UnmapPackFile(data, size);
+
+		error = "ERROR: module pack file is damaged or was created by a different compiler";
+		return false;
+	}
+
+	unsigned loadedCount = 0;
+
+	for(unsigned i = 0; i < header.moduleCount; i++)
+	{
+		PackEntry entry;
+		memcpy(&entry, &entries[i], sizeof(PackEntry));
+
+		const char *name = names + entry.nameOffset;
+
+		// Modules that are already loaded take priority
+		if(GetBytecode(name) || NULLC::GetStringHash(name) == lastHash)
+			continue;
+
+		PutBytecode(name, data + entry.bytecodeOffset, NULL, 0);
+
+		cache.back().mapped = true;
+
+		loadedCount++;
+	}
+
+	if(loadedCount == 0)
+	{
+		UnmapPackFile(data, size);
+		return true;
+	}
+
+	MappedPack &pack = *packs.push_back();
+
+	pack.data = data;
+	pack.size = size;
+
+	return true;
+}
+
 void BinaryCache::LastBytecode(const char* bytecode)
 {
 	unsigned int size = *(unsigned int*)bytecode;
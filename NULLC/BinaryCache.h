@@ -9,7 +9,8 @@ namespace BinaryCache
 	void Terminate();
 
 	void		PutBytecode(const char* path, const char* bytecode, Lexeme* lexStart, unsigned lexCount);
-	void		PutLexemes(const char* path, Lexeme* lexStart, unsigned lexCount);
+	// Lexemes are stored only if the module doesn't have them yet, lexemes stored for the module are returned
+	Lexeme*		PutLexemes(const char* path, Lexeme* lexStart, unsigned lexCount, unsigned& count);
 
 	const char*	GetBytecode(const char* path);
 
@@ -32,6 +33,39 @@ namespace BinaryCache
 	bool		HasImportPath(const char* path);
 	const char*	EnumImportPath(unsigned pos);
 
+	// Persistent cache keeps bytecode of modules built from files in a directory between runs, it is disabled when the directory is not set
+	void		SetCacheDirectory(const char* path);
+	void		GetCacheStatistics(unsigned &hits, unsigned &misses);
+
+	struct	CachedModule
+	{
+		char		*bytecode;
+
+		Lexeme		*lexemes;
+		unsigned	lexemeCount;
+
+		// Source hashes of the modules in the bytecode dependency list at the time of compilation
+		unsigned	*dependencyHashes;
+	};
+
+	// Read bytecode that was built from the same module source with the same compiler and optimization level. Dependencies have to be validated by the caller
+	bool		ReadCachedModule(const char* path, const char* code, unsigned codeSize, int optimizationLevel, CachedModule &module);
+
+	// Module that was read is either placed into the binary cache or is rejected when its dependencies have changed
+	void		AcceptCachedModule(const char* path, CachedModule &module);
+	void		RejectCachedModule(CachedModule &module);
+
+	// Write bytecode of a module with its lexemes, dependencies of the module have to be in the cache
+	void		WriteCachedModule(const char* path, const char* code, unsigned codeSize, int optimizationLevel, const char* bytecode);
+
+	unsigned	GetSourceHash(const char* bytecode);
+
+	// Module pack is a single file with an index of modules and their bytecode placed at page boundaries
+	bool		SaveModulePack(const char* fileName, const char** paths, unsigned count, const char* &error);
+
+	// Pack is mapped into memory until termination and bytecode of modules that are not in the cache is used in place. Lexemes are created on first import
+	bool		LoadModulePack(const char* fileName, const char* &error);
+
 	struct	CodeDescriptor
 	{
 		const char		*name;
@@ -39,5 +73,8 @@ namespace BinaryCache
 		const char		*binary;
 		Lexeme			*lexemes;
 		unsigned		lexemeCount;
+
+		// Binary belongs to a mapped module pack
+		bool			mapped;
 	};
 }
@@ -170,6 +170,7 @@ struct ExternFuncInfo
 
 	// For generic functions
 	unsigned int	genericOffsetStart; // Position in the lexeme stream of the definition
+	unsigned int	genericOffsetModule; // Index of the module with the lexeme stream of the definition (0 for the current module)
 	unsigned int	genericOffset;
 	unsigned int	genericReturnType;
 
@@ -2225,6 +2225,51 @@ void GenCodeCmdCall(CodeGenRegVmContext &ctx, RegVmCmd cmd)
 	GetCodeCmdCallEpilogue(ctx, microcode, resultReg, resultType);
 }
 
+void BudgetWrap(CodeGenRegVmStateContext *vmState)
+{
+	CodeGenRegVmContext &ctx = *vmState->ctx;
+
+	vmState->callStackTop->instruction = vmState->callInstructionPos + 1;
+	vmState->callStackTop++;
+
+	vmState->jitCodeActive = false;
+
+	bool renewed = ctx.x86rvm->ExecBudget();
+
+	vmState->jitCodeActive = true;
+
+	if(!renewed)
+		longjmp(vmState->errorHandler, 1);
+
+	vmState->callStackTop--;
+}
+
+void GenCodeBudgetCheck(CodeGenRegVmContext &ctx)
+{
+	ctx.vmState->budgetWrap = BudgetWrap;
+
+#if defined(_M_X64)
+	EMIT_OP_RPTR_NUM(ctx.ctx, o_sub, sDWORD, rR13, nullcOffsetOf(ctx.vmState, budgetCounter), 1);
+	EMIT_OP_LABEL(ctx.ctx, o_jg, ctx.labelCount, false);
+
+	EMIT_OP_REG_REG(ctx.ctx, o_mov64, rArg1, rR13);
+	EMIT_OP_RPTR_NUM(ctx.ctx, o_mov, sDWORD, rArg1, nullcOffsetOf(ctx.vmState, callInstructionPos), ctx.currInstructionPos);
+	EMIT_REG_READ(ctx.ctx, rArg1);
+	EMIT_OP_RPTR(ctx.ctx, o_call, sQWORD, rArg1, nullcOffsetOf(ctx.vmState, budgetWrap));
+#else
+	EMIT_OP_RPTR_NUM(ctx.ctx, o_sub, sDWORD, uintptr_t(&ctx.vmState->budgetCounter), 1);
+	EMIT_OP_LABEL(ctx.ctx, o_jg, ctx.labelCount, false);
+
+	EMIT_OP_RPTR_NUM(ctx.ctx, o_mov, sDWORD, uintptr_t(&ctx.vmState->callInstructionPos), ctx.currInstructionPos);
+	EMIT_OP_NUM(ctx.ctx, o_push, uintptr_t(ctx.vmState));
+	EMIT_OP_ADDR(ctx.ctx, o_call, sDWORD, uintptr_t(&ctx.vmState->budgetWrap));
+	EMIT_OP_REG_NUM(ctx.ctx, o_add, rESP, 4);
+#endif
+
+	EMIT_LABEL(ctx.ctx, ctx.labelCount, false);
+	ctx.labelCount++;
+}
+
 void ErrorInvalidFunctionPointer(CodeGenRegVmStateContext *vmState)
 {
 	CodeGenRegVmContext &ctx = *vmState->ctx;
@@ -74,6 +74,9 @@ struct CodeGenRegVmStateContext
 		x86ShllWrap = NULL;
 		x86ShrlWrap = NULL;
 
+		budgetWrap = NULL;
+		budgetCounter = 0;
+
 		vsAsmStyle = false;
 
 		jitCodeActive = false;
@@ -135,6 +138,9 @@ struct CodeGenRegVmStateContext
 	long long (*x86ShllWrap)(long long lhs, long long rhs);
 	long long (*x86ShrlWrap)(long long lhs, long long rhs);
 
+	void (*budgetWrap)(CodeGenRegVmStateContext *vmState);
+	int budgetCounter;
+
 	bool vsAsmStyle;
 
 	bool jitCodeActive;
@@ -283,3 +289,5 @@ void GenCodeCmdBitNotl(CodeGenRegVmContext &ctx, RegVmCmd cmd);
 void GenCodeCmdLogNot(CodeGenRegVmContext &ctx, RegVmCmd cmd);
 void GenCodeCmdLogNotl(CodeGenRegVmContext &ctx, RegVmCmd cmd);
 void GenCodeCmdConvertPtr(CodeGenRegVmContext &ctx, RegVmCmd cmd);
+
+void GenCodeBudgetCheck(CodeGenRegVmContext &ctx);
@@ -8,6 +8,13 @@
 #include "Executor_Common.h"
 #include "StdLib.h"
 
+#if defined(_WIN32)
+	#include <windows.h>
+	#include <process.h>
+#else
+	#include <pthread.h>
+#endif
+
 const char *nullcBaseCode = "\
 void assert(int val);\r\n\
 void assert(int val, char[] message);\r\n\
@@ -178,8 +185,82 @@ void __init_array(@T[] arr)\r\n\
 }\r\n\
 void __closeUpvalue(void ref ref l, void ref v, int offset, int size);";
 
+namespace
+{
+	// Base module with bound functions can be kept after termination, later initializations in the same process register a copy of it
+	// Base module is built by nullcInit under the compiler lock
+	char *baseModuleBytecode = NULL;
+	Lexeme *baseModuleLexemes = NULL;
+	unsigned baseModuleLexemeCount = 0;
+	int baseModuleOptimizationLevel = 0;
+
+	// Lexemes have to point to the source in the bytecode copy they are used with
+	void RebaseLexemes(Lexeme *lexemes, unsigned count, const char *oldStart, const char *newStart)
+	{
+		for(unsigned i = 0; i < count; i++)
+			lexemes[i].pos = newStart + (lexemes[i].pos - oldStart);
+	}
+
+	void SaveBaseModule(int optimizationLevel)
+	{
+		const char *bytecode = BinaryCache::GetBytecode("$base$.nc");
+
+		unsigned lexemeCount = 0;
+		Lexeme *lexemes = BinaryCache::GetLexems("$base$.nc", lexemeCount);
+
+		delete[] baseModuleBytecode;
+		delete[] baseModuleLexemes;
+
+		unsigned size = ((ByteCode*)bytecode)->size;
+
+		baseModuleBytecode = new char[size];
+		memcpy(baseModuleBytecode, bytecode, size);
+
+		baseModuleLexemes = new Lexeme[lexemeCount];
+		memcpy(baseModuleLexemes, lexemes, lexemeCount * sizeof(Lexeme));
+
+		RebaseLexemes(baseModuleLexemes, lexemeCount, FindSource((ByteCode*)bytecode), FindSource((ByteCode*)baseModuleBytecode));
+
+		baseModuleLexemeCount = lexemeCount;
+		baseModuleOptimizationLevel = optimizationLevel;
+	}
+
+	void RestoreBaseModule()
+	{
+		unsigned size = ((ByteCode*)baseModuleBytecode)->size;
+
+		char *bytecode = new char[size];
+		memcpy(bytecode, baseModuleBytecode, size);
+
+		BinaryCache::PutBytecode("$base$.nc", bytecode, baseModuleLexemes, baseModuleLexemeCount);
+
+		unsigned lexemeCount = 0;
+		Lexeme *lexemes = BinaryCache::GetLexems("$base$.nc", lexemeCount);
+
+		RebaseLexemes(lexemes, lexemeCount, FindSource((ByteCode*)baseModuleBytecode), FindSource((ByteCode*)bytecode));
+	}
+}
+
+void ReleaseBaseModule()
+{
+	delete[] baseModuleBytecode;
+	baseModuleBytecode = NULL;
+
+	delete[] baseModuleLexemes;
+	baseModuleLexemes = NULL;
+
+	baseModuleLexemeCount = 0;
+	baseModuleOptimizationLevel = 0;
+}
+
 bool BuildBaseModule(Allocator *allocator, int optimizationLevel)
 {
+	if(baseModuleBytecode && baseModuleOptimizationLevel == optimizationLevel)
+	{
+		RestoreBaseModule();
+		return true;
+	}
+
 	const char *errorPos = NULL;
 	char errorBuf[256];
 
@@ -282,6 +363,8 @@ bool BuildBaseModule(Allocator *allocator, int optimizationLevel)
 #undef nullcBindModuleFunctionHelperNoMemAccess
 #endif
 
+	SaveBaseModule(optimizationLevel);
+
 	return true;
 }
 
@@ -411,13 +494,20 @@ ExprModule* AnalyzeModuleFromSource(CompilerContext &ctx)
 
 	ParseContext &parseCtx = ctx.parseCtx;
 
-	parseCtx.bytecodeBuilder = BuildModuleFromPath;
+	if(ctx.buildImports && ctx.importBuildThreads != 0)
+		BuildModuleImports(ctx);
+
+	parseCtx.bytecodeBuilder = ctx.buildImports ? BuildModuleFromPath : NULL;
 
 	parseCtx.errorBuf = ctx.errorBuf;
 	parseCtx.errorBufSize = ctx.errorBufSize;
 
+	unsigned memoryStart = ctx.allocator->requested();
+
 	ctx.synModule = Parse(parseCtx, ctx.code, ctx.moduleRoot);
 
+	ctx.statistics.Allocated("Parse", ctx.allocator->requested() - memoryStart);
+
 	ctx.statistics.Add(ctx.parseCtx.statistics);
 
 	ctx.statistics.Start(NULLCTime::clockMicro());
@@ -450,11 +540,10 @@ ExprModule* AnalyzeModuleFromSource(CompilerContext &ctx)
 		return NULL;
 	}
 
-	//printf("# Parse memory %dkb\n", ctx.allocator->requested() / 1024);
-
 	ExpressionContext &exprCtx = ctx.exprCtx;
 
 	exprCtx.memoryLimit = ctx.exprMemoryLimit;
+	exprCtx.cancellation = ctx.exprCancellation;
 
 	exprCtx.errorBuf = ctx.errorBuf;
 	exprCtx.errorBufSize = ctx.errorBufSize;
@@ -467,8 +556,12 @@ ExprModule* AnalyzeModuleFromSource(CompilerContext &ctx)
 		exprCtx.errorBufSize -= errorLength;
 	}
 
+	memoryStart = ctx.allocator->requested();
+
 	ctx.exprModule = Analyze(exprCtx, ctx.synModule, ctx.code, ctx.moduleRoot);
 
+	ctx.statistics.Allocated("Analyze", ctx.allocator->requested() - memoryStart);
+
 	ctx.statistics.Add(ctx.exprCtx.statistics);
 
 	ctx.statistics.Start(NULLCTime::clockMicro());
@@ -503,8 +596,6 @@ ExprModule* AnalyzeModuleFromSource(CompilerContext &ctx)
 		return NULL;
 	}
 
-	//printf("# Compile memory %dkb\n", ctx.allocator->requested() / 1024);
-
 	return ctx.exprModule;
 }
 
@@ -587,6 +678,8 @@ bool CompileModuleFromSource(CompilerContext &ctx)
 
 	ExpressionContext &exprCtx = ctx.exprCtx;
 
+	unsigned memoryStart = ctx.allocator->requested();
+
 	ctx.statistics.Start(NULLCTime::clockMicro());
 
 	ctx.vmModule = CompileVm(exprCtx, ctx.exprModule, ctx.code);
@@ -603,8 +696,6 @@ bool CompileModuleFromSource(CompilerContext &ctx)
 		return false;
 	}
 
-	//printf("# Instruction memory %dkb\n", pool.GetSize() / 1024);
-
 	ctx.statistics.Start(NULLCTime::clockMicro());
 
 	if(ctx.enableLogFiles)
@@ -659,6 +750,8 @@ bool CompileModuleFromSource(CompilerContext &ctx)
 
 	ctx.statistics.Finish("IrFinalization", NULLCTime::clockMicro());
 
+	ctx.statistics.Allocated("Ir", ctx.allocator->requested() - memoryStart);
+
 	ctx.statistics.Start(NULLCTime::clockMicro());
 
 	if(ctx.enableLogFiles)
@@ -686,6 +779,8 @@ bool CompileModuleFromSource(CompilerContext &ctx)
 
 	ctx.statistics.Finish("Logging", NULLCTime::clockMicro());
 
+	memoryStart = ctx.allocator->requested();
+
 	ctx.statistics.Start(NULLCTime::clockMicro());
 
 	ctx.regVmLoweredModule = RegVmLowerModule(exprCtx, ctx.vmModule);
@@ -714,6 +809,8 @@ bool CompileModuleFromSource(CompilerContext &ctx)
 
 	ctx.statistics.Finish("IrLowering", NULLCTime::clockMicro());
 
+	ctx.statistics.Allocated("Lowering", ctx.allocator->requested() - memoryStart);
+
 	ctx.statistics.Start(NULLCTime::clockMicro());
 
 	if(ctx.enableLogFiles)
@@ -1368,7 +1465,9 @@ unsigned GetBytecode(CompilerContext &ctx, char **bytecode)
 
 			if(ModuleData *moduleData = typeGenericClassProto->importModule)
 			{
-				target.definitionOffsetStart = unsigned(typeGenericClassProto->definition->begin - moduleData->lexStream);
+				Lexeme *start = typeGenericClassProto->definition ? typeGenericClassProto->definition->begin : typeGenericClassProto->delayedDefinition;
+
+				target.definitionOffsetStart = unsigned(start - moduleData->lexStream);
 				assert(target.definitionOffsetStart < moduleData->lexStreamSize);
 			}
 			else
@@ -1678,6 +1777,7 @@ unsigned GetBytecode(CompilerContext &ctx, char **bytecode)
 			funcInfo.stackSize = (unsigned)function->stackSize;
 
 			funcInfo.genericOffsetStart = ~0u;
+			funcInfo.genericOffsetModule = 0;
 			funcInfo.genericOffset = ~0u;
 			funcInfo.genericReturnType = 0;
 		}
@@ -1689,15 +1789,37 @@ unsigned GetBytecode(CompilerContext &ctx, char **bytecode)
 
 			funcInfo.retType = ExternFuncInfo::RETURN_VOID;
 
+			funcInfo.genericOffsetModule = 0;
+
+			Lexeme *start = function->declaration->source->begin;
+
 			if(ModuleData *moduleData = function->importModule)
 			{
-				funcInfo.genericOffsetStart = unsigned(function->declaration->source->begin - moduleData->lexStream);
+				funcInfo.genericOffsetStart = unsigned(start - moduleData->lexStream);
 				assert(funcInfo.genericOffsetStart < moduleData->lexStreamSize);
 			}
+			else if(start >= ctx.parseCtx.lexer.GetStreamStart() && start < ctx.parseCtx.lexer.GetStreamStart() + ctx.parseCtx.lexer.GetStreamSize())
+			{
+				funcInfo.genericOffsetStart = unsigned(start - ctx.parseCtx.lexer.GetStreamStart());
+			}
 			else
 			{
-				funcInfo.genericOffsetStart = unsigned(function->declaration->source->begin - ctx.parseCtx.lexer.GetStreamStart());
-				assert(funcInfo.genericOffsetStart < ctx.parseCtx.lexer.GetStreamSize());
+				// Generic member functions of generic type instances are defined in the module of the generic type
+				funcInfo.genericOffsetStart = ~0u;
+
+				for(unsigned i = 0; i < ctx.exprCtx.imports.size(); i++)
+				{
+					ModuleData *moduleData = ctx.exprCtx.imports[i];
+
+					if(start >= moduleData->lexStream && start < moduleData->lexStream + moduleData->lexStreamSize)
+					{
+						funcInfo.genericOffsetStart = unsigned(start - moduleData->lexStream);
+						funcInfo.genericOffsetModule = i + 1;
+						break;
+					}
+				}
+
+				assert(funcInfo.genericOffsetStart != ~0u);
 			}
 
 			funcInfo.genericOffset = ~0u;
@@ -2159,6 +2281,92 @@ const char* FindFileContentInImportPaths(InplaceStr moduleName, const char *modu
 	return fileContent;
 }
 
+const char* FindModuleFileContent(InplaceStr moduleName, const char *moduleRoot, bool addExtension, char *resultPathBuf, unsigned resultPathBufSize, char *nextModuleRootBuf, unsigned nextModuleRootBufSize, const char *&nextModuleRoot, unsigned &fileSize)
+{
+	nextModuleRoot = moduleRoot;
+
+	const char *fileContent = NULL;
+
+	if(moduleRoot)
+	{
+		fileContent = FindFileContentInImportPaths(moduleName, moduleRoot, addExtension, resultPathBuf, resultPathBufSize, fileSize);
+
+		if(fileContent)
+		{
+			if(const char *pos = moduleName.rfind('/'))
+			{
+				NULLC::SafeSprintf(nextModuleRootBuf, nextModuleRootBufSize, "%s/%.*s", moduleRoot, unsigned(pos - moduleName.begin), moduleName.begin);
+
+				nextModuleRoot = nextModuleRootBuf;
+			}
+		}
+	}
+
+	if(!fileContent)
+	{
+		fileContent = FindFileContentInImportPaths(moduleName, NULL, addExtension, resultPathBuf, resultPathBufSize, fileSize);
+
+		if(fileContent)
+		{
+			if(const char *pos = moduleName.rfind('/'))
+			{
+				NULLC::SafeSprintf(nextModuleRootBuf, nextModuleRootBufSize, "%.*s", unsigned(pos - moduleName.begin), moduleName.begin);
+
+				nextModuleRoot = nextModuleRootBuf;
+			}
+		}
+	}
+
+	return fileContent;
+}
+
+char* LoadModuleFromCache(Allocator *allocator, const char *modulePath, const char *code, unsigned codeSize, int optimizationLevel, ArrayView<InplaceStr> activeImports, CompilerStatistics *statistics)
+{
+	BinaryCache::CachedModule module;
+
+	if(!BinaryCache::ReadCachedModule(modulePath, code, codeSize, optimizationLevel, module))
+		return NULL;
+
+	TRACE_SCOPE("compiler", "LoadModuleFromCache");
+	TRACE_LABEL(modulePath);
+
+	ByteCode *bytecode = (ByteCode*)module.bytecode;
+
+	char *symbols = FindSymbols(bytecode);
+
+	ExternModuleInfo *moduleList = FindFirstModule(bytecode);
+
+	// Dependencies are loaded before the module and have to be built from the same sources as when the module was compiled
+	for(unsigned i = 0; i < bytecode->dependsCount; i++)
+	{
+		const char *dependencyName = symbols + moduleList[i].nameOffset;
+
+		const char *dependency = BinaryCache::FindBytecode(dependencyName, false);
+
+		if(!dependency)
+		{
+			const char *errorPos = NULL;
+			char errorBuf[256];
+			*errorBuf = 0;
+
+			dependency = BuildModuleFromPath(allocator, InplaceStr(dependencyName), NULL, false, &errorPos, errorBuf, 256, optimizationLevel, activeImports, statistics);
+		}
+
+		if(!dependency || BinaryCache::GetSourceHash(dependency) != module.dependencyHashes[i])
+		{
+			BinaryCache::RejectCachedModule(module);
+
+			return NULL;
+		}
+	}
+
+	char *result = module.bytecode;
+
+	BinaryCache::AcceptCachedModule(modulePath, module);
+
+	return result;
+}
+
 char* BuildModuleFromPath(Allocator *allocator, InplaceStr moduleName, const char *moduleRoot, bool addExtension, const char **errorPos, char *errorBuf, unsigned errorBufSize, int optimizationLevel, ArrayView<InplaceStr> activeImports, CompilerStatistics *statistics)
 {
 	if(statistics)
@@ -2191,56 +2399,492 @@ char* BuildModuleFromPath(Allocator *allocator, InplaceStr moduleName, const cha
 	char path[pathLength];
 
 	unsigned fileSize = 0;
-	const char *fileContent = NULL;
+	const char *fileContent = FindModuleFileContent(moduleName, moduleRoot, addExtension, path, pathLength, nextModuleRootBuf, nextModuleRootLength, nextModuleRoot, fileSize);
 
-	if(moduleRoot)
+	if(statistics)
+		statistics->Finish("Extra", NULLCTime::clockMicro());
+
+	if(!fileContent)
 	{
-		fileContent = FindFileContentInImportPaths(moduleName, moduleRoot, addExtension, path, pathLength, fileSize);
+		*errorPos = NULL;
 
-		if(fileContent)
+		if(errorBuf && errorBufSize)
+			NULLC::SafeSprintf(errorBuf, errorBufSize, "ERROR: module file '%.*s' could not be opened", moduleName.length(), moduleName.begin);
+
+		return NULL;
+	}
+
+	char *bytecode = LoadModuleFromCache(allocator, path, fileContent, fileSize, optimizationLevel, activeImports, statistics);
+
+	if(!bytecode)
+	{
+		bytecode = BuildModuleFromSource(allocator, path, nextModuleRoot, fileContent, fileSize, errorPos, errorBuf, errorBufSize, optimizationLevel, activeImports, statistics);
+
+		if(bytecode)
+			BinaryCache::WriteCachedModule(path, fileContent, fileSize, optimizationLevel, bytecode);
+	}
+
+	NULLC::fileFree(fileContent);
+
+	return bytecode;
+}
+
+namespace
+{
+	struct ModuleBuildTask
+	{
+		ModuleBuildTask(Allocator *allocator): dependencies(allocator)
 		{
-			if(const char *pos = moduleName.rfind('/'))
-			{
-				NULLC::SafeSprintf(nextModuleRootBuf, nextModuleRootLength, "%s/%.*s", moduleRoot, unsigned(pos - moduleName.begin), moduleName.begin);
+			path = NULL;
+			moduleRoot = NULL;
 
-				nextModuleRoot = nextModuleRootBuf;
-			}
+			code = NULL;
+			codeSize = 0;
+
+			started = false;
+			committed = false;
+
+			bytecode = NULL;
+
+			lexemes = NULL;
+			lexemeCount = 0;
+		}
+
+		const char *path;
+		const char *moduleRoot;
+
+		const char *code;
+		unsigned codeSize;
+
+		SmallArray<ModuleBuildTask*, 8> dependencies;
+
+		bool started;
+		bool committed;
+
+		// Results of a compilation that are committed to the binary cache by the importing thread
+		char *bytecode;
+
+		Lexeme *lexemes;
+		unsigned lexemeCount;
+	};
+
+#if defined(_WIN32)
+	struct ModuleBuildLock
+	{
+		void Init(){ InitializeCriticalSection(&section); }
+		void Destroy(){ DeleteCriticalSection(&section); }
+
+		void Lock(){ EnterCriticalSection(&section); }
+		void Unlock(){ LeaveCriticalSection(&section); }
+
+		CRITICAL_SECTION section;
+	};
+#else
+	struct ModuleBuildLock
+	{
+		void Init(){ pthread_mutex_init(&mutex, NULL); }
+		void Destroy(){ pthread_mutex_destroy(&mutex); }
+
+		void Lock(){ pthread_mutex_lock(&mutex); }
+		void Unlock(){ pthread_mutex_unlock(&mutex); }
+
+		pthread_mutex_t mutex;
+	};
+#endif
+
+	struct ModuleBuildQueue
+	{
+		ModuleBuildTask **tasks;
+		unsigned taskCount;
+
+		unsigned nextTask;
+
+		ModuleBuildLock lock;
+
+		int optimizationLevel;
+	};
+
+	const unsigned moduleBuildThreadStackSize = 8 * 1024 * 1024;
+}
+
+void BuildModuleTask(ModuleBuildTask &task, int optimizationLevel)
+{
+	// Tasks are running concurrently and can't share the compiler chunk cache
+	ChunkedStackPool<65532> pool;
+	GrowingAllocatorRef<ChunkedStackPool<65532>, 16384> allocator(pool);
+
+	char errorBuf[256];
+	*errorBuf = 0;
+
+	CompilerContext ctx(&allocator, optimizationLevel, ArrayView<InplaceStr>());
+
+	ctx.errorBuf = errorBuf;
+	ctx.errorBufSize = 256;
+
+	ctx.code = task.code;
+	ctx.moduleRoot = task.moduleRoot;
+
+	// All imports are committed to the binary cache before the task is started
+	ctx.buildImports = false;
+
+	// Errors are reported later when the module is compiled again by the parser
+	if(!CompileModuleFromSource(ctx))
+		return;
+
+	GetBytecode(ctx, &task.bytecode);
+
+	Lexer &lexer = ctx.parseCtx.lexer;
+
+	task.lexemeCount = lexer.GetStreamSize();
+	task.lexemes = new Lexeme[task.lexemeCount];
+
+	memcpy(task.lexemes, lexer.GetStreamStart(), task.lexemeCount * sizeof(Lexeme));
+
+	const char *newStart = FindSource((ByteCode*)task.bytecode);
+
+	// We have to fix lexeme positions to the code that is saved in bytecode
+	for(Lexeme *c = task.lexemes, *e = task.lexemes + task.lexemeCount; c != e; c++)
+	{
+		// Exit fix up if lexemes exited scope of the current file
+		if(c->pos < task.code || c->pos > (task.code + task.codeSize))
+			break;
+
+		c->pos = newStart + (c->pos - task.code);
+	}
+}
+
+void RunModuleBuildQueue(ModuleBuildQueue &queue)
+{
+	for(;;)
+	{
+		queue.lock.Lock();
+
+		ModuleBuildTask *task = queue.nextTask < queue.taskCount ? queue.tasks[queue.nextTask++] : NULL;
+
+		queue.lock.Unlock();
+
+		if(!task)
+			break;
+
+		BuildModuleTask(*task, queue.optimizationLevel);
+	}
+}
+
+#if defined(_WIN32)
+unsigned __stdcall RunModuleBuildQueueThread(void *queue)
+{
+	RunModuleBuildQueue(*(ModuleBuildQueue*)queue);
+
+	return 0;
+}
+#else
+void* RunModuleBuildQueueThread(void *queue)
+{
+	RunModuleBuildQueue(*(ModuleBuildQueue*)queue);
+
+	return NULL;
+}
+#endif
+
+void BuildModuleTasks(ArrayView<ModuleBuildTask*> tasks, unsigned threadCount, int optimizationLevel)
+{
+	TRACE_SCOPE("compiler", "BuildModuleTasks");
+
+	ModuleBuildQueue queue;
+
+	queue.tasks = tasks.data;
+	queue.taskCount = tasks.count;
+
+	queue.nextTask = 0;
+
+	queue.optimizationLevel = optimizationLevel;
+
+	unsigned workerCount = threadCount < tasks.count ? threadCount : tasks.count;
+
+#if defined(NULLC_TIME_TRACE)
+	// Trace context is shared by the whole compiler
+	workerCount = 1;
+#endif
+
+	queue.lock.Init();
+
+	if(workerCount <= 1)
+	{
+		RunModuleBuildQueue(queue);
+
+		queue.lock.Destroy();
+
+		return;
+	}
+
+	// Current thread is one of the workers
+	const unsigned maxThreads = 64;
+
+#if defined(_WIN32)
+	HANDLE threads[maxThreads];
+#else
+	pthread_t threads[maxThreads];
+#endif
+
+	unsigned threadsStarted = 0;
+
+	for(unsigned i = 1; i < workerCount && threadsStarted < maxThreads; i++)
+	{
+#if defined(_WIN32)
+		HANDLE thread = (HANDLE)_beginthreadex(NULL, moduleBuildThreadStackSize, RunModuleBuildQueueThread, &queue, 0, NULL);
+
+		if(!thread)
+			break;
+
+		threads[threadsStarted++] = thread;
+#else
+		pthread_attr_t attributes;
+		pthread_attr_init(&attributes);
+		pthread_attr_setstacksize(&attributes, moduleBuildThreadStackSize);
+
+		int result = pthread_create(&threads[threadsStarted], &attributes, RunModuleBuildQueueThread, &queue);
+
+		pthread_attr_destroy(&attributes);
+
+		if(result != 0)
+			break;
+
+		threadsStarted++;
+#endif
+	}
+
+	RunModuleBuildQueue(queue);
+
+	for(unsigned i = 0; i < threadsStarted; i++)
+	{
+#if defined(_WIN32)
+		WaitForSingleObject(threads[i], INFINITE);
+		CloseHandle(threads[i]);
+#else
+		pthread_join(threads[i], NULL);
+#endif
+	}
+
+	queue.lock.Destroy();
+}
+
+void PrepareModuleLexemes(Allocator *allocator, const char *moduleName)
+{
+	ByteCode *bytecode = (ByteCode*)BinaryCache::FindBytecode(moduleName, false);
+
+	if(!bytecode)
+		return;
+
+	char *symbols = FindSymbols(bytecode);
+
+	ExternModuleInfo *moduleList = FindFirstModule(bytecode);
+
+	// Lexeme streams are created on import when missing, creating them once here saves module build threads from lexing the same modules
+	for(unsigned i = 0; i <= bytecode->dependsCount; i++)
+	{
+		const char *name = i == bytecode->dependsCount ? moduleName : symbols + moduleList[i].nameOffset;
+
+		unsigned lexStreamSize = 0;
+
+		if(BinaryCache::FindLexems(name, false, lexStreamSize))
+			continue;
+
+		const char *source = BinaryCache::FindBytecode(name, false);
+
+		if(!source)
+			continue;
+
+		Lexer lexer(allocator);
+
+		lexer.Lexify(FindSource((ByteCode*)source));
+
+		unsigned lexemeCount = 0;
+		BinaryCache::PutLexemes(name, lexer.GetStreamStart(), lexer.GetStreamSize(), lexemeCount);
+	}
+}
+
+void DiscoverModuleImports(Allocator *allocator, SmallArray<ModuleBuildTask*, 32> &tasks, ModuleBuildTask *importer, const char *code, const char *moduleRoot)
+{
+	Lexer lexer(allocator);
+
+	lexer.Lexify(code);
+
+	Lexeme *curr = lexer.GetStreamStart();
+
+	// Imports can only be placed at the start of the module
+	while(curr->type == lex_import)
+	{
+		curr++;
+
+		IntrusiveList<SynIdentifier> parts;
+
+		while(curr->type == lex_string)
+		{
+			parts.push_back(new (allocator->alloc(sizeof(SynIdentifier))) SynIdentifier(curr, curr, InplaceStr(curr->pos, curr->length)));
+
+			curr++;
+
+			if(curr->type != lex_point)
+				break;
+
+			curr++;
+		}
+
+		// Malformed imports are left for the parser to report
+		if(parts.empty() || curr->type != lex_semicolon)
+			return;
+
+		curr++;
+
+		InplaceStr moduleName = GetModuleName(allocator, moduleRoot, parts);
+
+		if(!BinaryCache::FindBytecode(moduleName.begin, false))
+			moduleName = GetModuleName(allocator, NULL, parts);
+
+		if(BinaryCache::FindBytecode(moduleName.begin, false))
+		{
+			PrepareModuleLexemes(allocator, moduleName.begin);
+			continue;
 		}
+
+		const unsigned nextModuleRootLength = 1024;
+		char nextModuleRootBuf[nextModuleRootLength];
+
+		const char *nextModuleRoot = NULL;
+
+		const unsigned pathLength = 1024;
+		char path[pathLength];
+
+		unsigned fileSize = 0;
+		const char *fileContent = FindModuleFileContent(moduleName, moduleRoot, false, path, pathLength, nextModuleRootBuf, nextModuleRootLength, nextModuleRoot, fileSize);
+
+		// Missing modules are left for the parser to report
+		if(!fileContent)
+			continue;
+
+		ModuleBuildTask *dependency = NULL;
+
+		for(unsigned i = 0; i < tasks.size() && !dependency; i++)
+		{
+			if(strcmp(tasks[i]->path, path) == 0)
+				dependency = tasks[i];
+		}
+
+		if(dependency)
+		{
+			NULLC::fileFree(fileContent);
+		}
+		else
+		{
+			dependency = new (allocator->alloc(sizeof(ModuleBuildTask))) ModuleBuildTask(allocator);
+
+			dependency->path = strcpy((char*)allocator->alloc(unsigned(strlen(path)) + 1), path);
+			dependency->moduleRoot = nextModuleRoot ? strcpy((char*)allocator->alloc(unsigned(strlen(nextModuleRoot)) + 1), nextModuleRoot) : NULL;
+
+			dependency->code = fileContent;
+			dependency->codeSize = fileSize;
+
+			tasks.push_back(dependency);
+
+			DiscoverModuleImports(allocator, tasks, dependency, fileContent, dependency->moduleRoot);
+		}
+
+		if(importer)
+			importer->dependencies.push_back(dependency);
 	}
+}
 
-	if(!fileContent)
+void BuildModuleImports(CompilerContext &ctx)
+{
+	TRACE_SCOPE("compiler", "BuildModuleImports");
+
+	ChunkedStackPool<65532> pool(&compilerChunkCache);
+	GrowingAllocatorRef<ChunkedStackPool<65532>, 16384> allocator(pool);
+
+	SmallArray<ModuleBuildTask*, 32> tasks(&allocator);
+
+	DiscoverModuleImports(&allocator, tasks, NULL, ctx.code, ctx.moduleRoot);
+
+	SmallArray<ModuleBuildTask*, 32> ready(&allocator);
+
+	// Modules are built in waves, each wave contains modules with all dependencies already in the binary cache
+	for(;;)
 	{
-		fileContent = FindFileContentInImportPaths(moduleName, NULL, addExtension, path, pathLength, fileSize);
+		ready.clear();
 
-		if(fileContent)
+		bool progress = false;
+
+		for(unsigned i = 0; i < tasks.size(); i++)
 		{
-			if(const char *pos = moduleName.rfind('/'))
+			ModuleBuildTask *task = tasks[i];
+
+			if(task->started)
+				continue;
+
+			bool dependenciesReady = true;
+
+			for(unsigned k = 0; k < task->dependencies.size() && dependenciesReady; k++)
+				dependenciesReady = task->dependencies[k]->committed;
+
+			if(!dependenciesReady)
+				continue;
+
+			task->started = true;
+
+			if(LoadModuleFromCache(&allocator, task->path, task->code, task->codeSize, ctx.optimizationLevel, ArrayView<InplaceStr>(), &ctx.statistics))
 			{
-				NULLC::SafeSprintf(nextModuleRootBuf, nextModuleRootLength, "%.*s", unsigned(pos - moduleName.begin), moduleName.begin);
+				task->committed = true;
 
-				nextModuleRoot = nextModuleRootBuf;
+				progress = true;
+				continue;
 			}
+
+			ready.push_back(task);
 		}
-	}
 
-	if(statistics)
-		statistics->Finish("Extra", NULLCTime::clockMicro());
+		if(ready.empty())
+		{
+			if(progress)
+				continue;
 
-	if(!fileContent)
-	{
-		*errorPos = NULL;
+			break;
+		}
 
-		if(errorBuf && errorBufSize)
-			NULLC::SafeSprintf(errorBuf, errorBufSize, "ERROR: module file '%.*s' could not be opened", moduleName.length(), moduleName.begin);
+		BuildModuleTasks(ArrayView<ModuleBuildTask*>(ready), ctx.importBuildThreads, ctx.optimizationLevel);
 
-		return NULL;
+		// Modules that have failed to compile are skipped together with their dependants, parser will report the errors
+		for(unsigned i = 0; i < ready.size(); i++)
+		{
+			ModuleBuildTask *task = ready[i];
+
+			if(!task->bytecode)
+				continue;
+
+			BinaryCache::PutBytecode(task->path, task->bytecode, task->lexemes, task->lexemeCount);
+
+			delete[] task->lexemes;
+			task->lexemes = NULL;
+
+			BinaryCache::WriteCachedModule(task->path, task->code, task->codeSize, ctx.optimizationLevel, task->bytecode);
+
+			task->committed = true;
+		}
 	}
 
-	char *bytecode = BuildModuleFromSource(allocator, path, nextModuleRoot, fileContent, fileSize, errorPos, errorBuf, errorBufSize, optimizationLevel, activeImports, statistics);
+	for(unsigned i = 0; i < tasks.size(); i++)
+	{
+		ModuleBuildTask *task = tasks[i];
 
-	NULLC::fileFree(fileContent);
+		// Bytecode of a module is owned by the binary cache once committed
+		if(!task->committed)
+			delete[] task->bytecode;
 
-	return bytecode;
+		delete[] task->lexemes;
+
+		NULLC::fileFree(task->code);
+
+		task->~ModuleBuildTask();
+	}
 }
 
 bool AddModuleFunction(Allocator *allocator, const char* module, void (*ptrRaw)(), void *funcWrap, void (*ptrWrap)(void *func, char* retBuf, char* argBuf), const char* name, int index, const char **errorPos, char *errorBuf, unsigned errorBufSize, int optimizationLevel)
@@ -2313,6 +2957,13 @@ void OutputCompilerStatistics(CompilerStatistics &statistics, unsigned outerTota
 
 	outputCtx.Printf("%15s %6dms (%6dms)\n", "total", total / 1000, outerTotalMicros / 1000);
 
+	for(unsigned i = 0; i < statistics.memory.size(); i++)
+	{
+		CompilerStatistics::Counter &counter = statistics.memory[i];
+
+		outputCtx.Printf("%15s %6dkb\n", counter.outputName.begin, counter.total / 1024);
+	}
+
 	outputCtx.Flush();
 
 	OutputContext::FileClose(outputCtx.stream);
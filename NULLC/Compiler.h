@@ -33,6 +33,7 @@ struct CompilerContext
 
 		exprModule = 0;
 		exprMemoryLimit = 0;
+		exprCancellation = 0;
 
 		vmModule = 0;
 
@@ -41,6 +42,9 @@ struct CompilerContext
 		regVmLoweredModule = 0;
 
 		enableLogFiles = false;
+
+		buildImports = true;
+		importBuildThreads = 0;
 	}
 
 	Allocator *allocator;
@@ -61,6 +65,7 @@ struct CompilerContext
 	ExpressionContext exprCtx;
 	ExprModule *exprModule;
 	unsigned exprMemoryLimit;
+	NULLCCancellation *exprCancellation;
 
 	VmModule *vmModule;
 
@@ -72,12 +77,19 @@ struct CompilerContext
 
 	bool enableLogFiles;
 
+	// Missing imports are compiled when the parser reaches them, when disabled all imports have to be in the binary cache
+	bool buildImports;
+
+	// When set, missing imports are discovered up front and independent modules are compiled concurrently
+	unsigned importBuildThreads;
+
 	int optimizationLevel;
 
 	CompilerStatistics statistics;
 };
 
 bool BuildBaseModule(Allocator *allocator, int optimizationLevel);
+void ReleaseBaseModule();
 
 ExprModule* AnalyzeModuleFromSource(CompilerContext &ctx);
 
@@ -92,6 +104,8 @@ bool TranslateToC(CompilerContext &ctx, const char *fileName, const char *mainNa
 char* BuildModuleFromSource(Allocator *allocator, const char *modulePath, const char *moduleRoot, const char *code, unsigned codeSize, const char **errorPos, char *errorBuf, unsigned errorBufSize, int optimizationLevel, ArrayView<InplaceStr> activeImports, CompilerStatistics *statistics);
 char* BuildModuleFromPath(Allocator *allocator, InplaceStr moduleName, const char *moduleRoot, bool addExtension, const char **errorPos, char *errorBuf, unsigned errorBufSize, int optimizationLevel, ArrayView<InplaceStr> activeImports, CompilerStatistics *statistics);
 
+void BuildModuleImports(CompilerContext &ctx);
+
 bool AddModuleFunction(Allocator *allocator, const char* module, void (*ptrRaw)(), void *funcWrap, void (*ptrWrap)(void *func, char* retBuf, char* argBuf), const char* name, int index, const char **errorPos, char *errorBuf, unsigned errorBufSize, int optimizationLevel);
 
 void OutputCompilerStatistics(CompilerStatistics &statistics, unsigned outerTotalMicros);
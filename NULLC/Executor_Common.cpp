@@ -29,7 +29,7 @@ namespace
 
 namespace NULLC
 {
-	Linker *commonLinker = NULL;
+	NULLC_THREAD_LOCAL Linker *commonLinker = NULL;
 }
 
 void CommonSetLinker(Linker* linker)
@@ -40,8 +40,8 @@ void CommonSetLinker(Linker* linker)
 namespace GC
 {
 	// Range of memory that is not checked. Used to exclude pointers to stack from marking and GC
-	char	*unmanageableBase = NULL;
-	char	*unmanageableTop = NULL;
+	NULLC_THREAD_LOCAL char	*unmanageableBase = NULL;
+	NULLC_THREAD_LOCAL char	*unmanageableTop = NULL;
 }
 
 unsigned ConvertFromAutoRef(unsigned int target, unsigned int source)
@@ -275,7 +275,7 @@ void nullcPrintPointerMarkerInfo(markerType marker)
 	unsigned codeTypeCount = 0;
 	ExternTypeInfo *codeTypes = nullcDebugTypeInfo(&codeTypeCount);
 
-	if(marker & OBJECT_VISIBLE)
+	if((marker & OBJECT_VISIBLE) == GC::VisibleMark())
 		printf("visible");
 	else
 		printf("unmarked");
@@ -716,16 +716,40 @@ namespace GC
 	unsigned int	objectName = NULLC::GetStringHash("auto ref");
 	unsigned int	autoArrayName = NULLC::GetStringHash("auto[]");
 
-	FastVector<char*> rootsA, rootsB;
-	FastVector<char*> *curr = NULL, *next = NULL;
+	struct MarkState
+	{
+		MarkState(): curr(NULL), next(NULL), visibleMark(OBJECT_VISIBLE)
+		{
+		}
+
+		FastVector<char*> rootsA, rootsB;
+		FastVector<char*> *curr, *next;
+
+		HashMap<int> functionIDs;
+
+		markerType visibleMark;
+	};
+
+	// Marking state of the default heap, other heaps have their own so that contexts on different threads can collect at the same time
+	MarkState defaultMarkState;
+
+	NULLC_THREAD_LOCAL MarkState *markState = &defaultMarkState;
+
+	bool IsMarked(markerType marker)
+	{
+		return (marker & OBJECT_VISIBLE) == markState->visibleMark;
+	}
 
-	HashMap<int> functionIDs;
+	void SetMarked(markerType &marker)
+	{
+		marker = (marker & ~OBJECT_VISIBLE) | markState->visibleMark;
+	}
 
 	void PrintMarker(markerType marker)
 	{
 		GC_DEBUG_PRINT("\tMarker is 0x%2x [", unsigned(marker));
 
-		if(marker & OBJECT_VISIBLE)
+		if(IsMarked(marker))
 		{
 			GC_DEBUG_PRINT("visible");
 		}
@@ -776,9 +800,12 @@ namespace GC
 			// Get pointer to the start of memory block. Some pointers may point to the middle of memory blocks
 			unsigned int *basePtr = (unsigned int*)NULLC::GetBasePointer(target);
 
-			// If there is no base, this pointer points to memory that is not GCs memory
+			// If there is no base, this pointer points to memory that is not GCs memory, but it might be shared by the host
 			if(!basePtr)
+			{
+				NULLC::MarkHostRegion(target);
 				return;
+			}
 
 			GC_DEBUG_PRINT("\tPointer base is %p\n", basePtr);
 
@@ -787,11 +814,11 @@ namespace GC
 			PrintMarker(*marker);
 
 			// If block is unmarked
-			if((*marker & OBJECT_VISIBLE))
+			if(IsMarked(*marker))
 				return;
 
 			// Mark block as used
-			*marker |= OBJECT_VISIBLE;
+			SetMarked(*marker);
 
 			GC_DEBUG_PRINT("\tMarked as used\n");
 
@@ -803,7 +830,7 @@ namespace GC
 			{
 				GC_DEBUG_PRINT("\tPointer %p scheduled on next loop\n", target);
 
-				next->push_back((char*)basePtr);
+				markState->next->push_back((char*)basePtr);
 			}
 		}
 	}
@@ -1006,13 +1033,15 @@ void GC::MarkUsedBlocks()
 	char			*symbols = NULLC::commonLinker->exSymbols.data;
 	(void)symbols;
 
-	GC::functionIDs.init();
-	GC::functionIDs.clear();
+	GC::MarkState &state = *GC::markState;
+
+	state.functionIDs.init();
+	state.functionIDs.clear();
 
-	GC::curr = &GC::rootsA;
-	GC::next = &GC::rootsB;
-	GC::curr->clear();
-	GC::next->clear();
+	state.curr = &state.rootsA;
+	state.next = &state.rootsB;
+	state.curr->clear();
+	state.next->clear();
 
 	// To check every stack frame, we have to get it first. But we have multiple executors, so flow alternates depending on which executor we are running
 	void *unknownExec = NULL;
@@ -1083,7 +1112,7 @@ void GC::MarkUsedBlocks()
 			break;
 
 		// Find corresponding function
-		int *cachedFuncID = GC::functionIDs.find(address);
+		int *cachedFuncID = state.functionIDs.find(address);
 
 		int funcID = -1;
 		if(cachedFuncID)
@@ -1098,7 +1127,7 @@ void GC::MarkUsedBlocks()
 					funcID = i;
 			}
 
-			GC::functionIDs.insert(address, funcID);
+			state.functionIDs.insert(address, funcID);
 		}
 
 		// If we are not in global scope
@@ -1199,15 +1228,19 @@ void GC::MarkUsedBlocks()
 				GC::PrintMarker(*marker);
 
 				// If block is unmarked, mark it as used
-				if(!(*marker & OBJECT_VISIBLE))
+				if(!GC::IsMarked(*marker))
 				{
-					*marker |= OBJECT_VISIBLE;
+					GC::SetMarked(*marker);
 
 					GC_DEBUG_PRINT("\tMarked as used, checking content\n");
 
 					GC::CheckBasePointer((char*)basePtr);
 				}
 			}
+			else
+			{
+				NULLC::MarkHostRegion(ptr);
+			}
 		}
 		tempStackBase += 4;
 	}
@@ -1217,28 +1250,30 @@ void GC::MarkUsedBlocks()
 
 void GC::MarkPendingRoots()
 {
-	if(!GC::next)
+	GC::MarkState &state = *GC::markState;
+
+	if(!state.next)
 		return;
 
-	if(GC::next->empty())
+	if(state.next->empty())
 		return;
 
-	while(GC::next->size())
+	while(state.next->size())
 	{
 		GC_DEBUG_PRINT("Checking new roots\n");
 
-		FastVector<char*> *tmp = GC::curr;
-		GC::curr = GC::next;
-		GC::next = tmp;
+		FastVector<char*> *tmp = state.curr;
+		state.curr = state.next;
+		state.next = tmp;
 
-		for(char **c = GC::curr->data, **e = GC::curr->data + GC::curr->size(); c != e; c++)
+		for(char **c = state.curr->data, **e = state.curr->data + state.curr->size(); c != e; c++)
 		{
 			GC_DEBUG_PRINT("\tRoot pointer base is %p\n", *c);
 
 			GC::CheckBasePointer(*c);
 		}
 
-		GC::curr->clear();
+		state.curr->clear();
 	}
 
 	GC_DEBUG_PRINT("\n");
@@ -1246,10 +1281,35 @@ void GC::MarkPendingRoots()
 
 void GC::ResetGC()
 {
-	GC::rootsA.reset();
-	GC::rootsB.reset();
+	GC::markState->rootsA.reset();
+	GC::markState->rootsB.reset();
+
+	GC::markState->functionIDs.reset();
+}
+
+unsigned GC::VisibleMark()
+{
+	return unsigned(GC::markState->visibleMark);
+}
 
-	GC::functionIDs.reset();
+void GC::FlipVisibleMark()
+{
+	GC::markState->visibleMark ^= OBJECT_VISIBLE;
+}
+
+GC::MarkState* GC::CreateMarkState()
+{
+	return NULLC::construct<MarkState>();
+}
+
+void GC::DestroyMarkState(MarkState *state)
+{
+	NULLC::destruct(state);
+}
+
+void GC::SetMarkState(MarkState *state)
+{
+	GC::markState = state ? state : &GC::defaultMarkState;
 }
 
 namespace
@@ -1787,6 +1847,76 @@ long long GetExecutorResultLong(unsigned tempStackType, unsigned *tempStackArray
 	return value;
 }
 
+namespace NULLCTime
+{
+	double clockPrecise();
+}
+
+namespace
+{
+	// Number of steps between deadline checks
+	const unsigned BUDGET_CHECK_INTERVAL = 4096;
+}
+
+int ExecutionBudget::Start()
+{
+	stepsLeft = stepLimit;
+	deadline = timeLimit ? NULLCTime::clockPrecise() + timeLimit : 0.0;
+
+	return Take();
+}
+
+int ExecutionBudget::Next()
+{
+	bool exhausted = (stepLimit && !stepsLeft) || (timeLimit && NULLCTime::clockPrecise() >= deadline);
+
+	if(!exhausted)
+		return Take();
+
+	if(!callback || callback(context) != NULLC_BUDGET_CONTINUE)
+		return 0;
+
+	return Start();
+}
+
+int ExecutionBudget::Take()
+{
+	// Without limits, the counter only runs out to be refilled again
+	unsigned steps = timeLimit ? BUDGET_CHECK_INTERVAL : 0x7fffffff;
+
+	if(stepLimit)
+	{
+		if(stepsLeft < steps)
+			steps = stepsLeft;
+
+		stepsLeft -= steps;
+	}
+
+	return int(steps);
+}
+
+unsigned GetExecutorResultSize(unsigned tempStackType)
+{
+	switch(tempStackType)
+	{
+	case NULLC_TYPE_BOOL:
+	case NULLC_TYPE_CHAR:
+	case NULLC_TYPE_SHORT:
+	case NULLC_TYPE_INT:
+		return sizeof(int);
+	case NULLC_TYPE_LONG:
+		return sizeof(long long);
+	case NULLC_TYPE_FLOAT:
+	case NULLC_TYPE_DOUBLE:
+		return sizeof(double);
+	default:
+		break;
+	}
+
+	// Void and complex return values are not stored by value
+	return 0;
+}
+
 int VmIntPow(int power, int number)
 {
 	if(power < 0)
@@ -38,6 +38,17 @@ namespace GC
 	void MarkUsedBlocks();
 	void MarkPendingRoots();
 	void ResetGC();
+
+	// Value of the visible bit of marked objects is flipped at the start of each collection, so that the marks of the last one don't have to be cleared
+	unsigned VisibleMark();
+	void FlipVisibleMark();
+
+	// Each heap has its own marking state, null state selects the state of the default heap
+	struct MarkState;
+
+	MarkState* CreateMarkState();
+	void DestroyMarkState(MarkState *state);
+	void SetMarkState(MarkState *state);
 }
 
 #if !defined(NULLC_NO_RAW_EXTERNAL_CALL)
@@ -53,6 +64,44 @@ const char* GetExecutorResult(char *execResult, unsigned execResultSize, unsigne
 int GetExecutorResultInt(unsigned tempStackType, unsigned *tempStackArrayBase);
 double GetExecutorResultDouble(unsigned tempStackType, unsigned *tempStackArrayBase);
 long long GetExecutorResultLong(unsigned tempStackType, unsigned *tempStackArrayBase);
+unsigned GetExecutorResultSize(unsigned tempStackType);
+
+// Execution budget is spent by loop iterations and function calls. Executors keep a counter of steps that are left before the budget has to be checked again
+struct ExecutionBudget
+{
+	ExecutionBudget()
+	{
+		stepLimit = 0;
+		timeLimit = 0;
+
+		stepsLeft = 0;
+		deadline = 0.0;
+
+		context = 0;
+		callback = 0;
+	}
+
+	// Without step or time limits, the step counter doesn't have to be checked at all
+	bool Active() const { return stepLimit != 0 || timeLimit != 0; }
+
+	// Returns the step counter for a new budget
+	int Start();
+
+	// Called when the step counter has run out. Returns the step counter to continue with or 0 if execution has to be stopped
+	int Next();
+
+	unsigned stepLimit;
+	unsigned timeLimit;
+
+	unsigned stepsLeft;
+	double deadline;
+
+	void *context;
+	unsigned (*callback)(void *context);
+
+private:
+	int Take();
+};
 
 int VmIntPow(int power, int number);
 long long VmLongPow(long long power, long long number);
@@ -49,6 +49,16 @@ namespace
 	{
 		memcpy(target, &value, sizeof(char*));
 	}
+
+	bool IsExecutionTerminator(const FastVector<RegVmCmd> &code)
+	{
+		if(code.empty())
+			return false;
+
+		const RegVmCmd &cmd = code.data[code.size() - 1];
+
+		return cmd.code == rviReturn && cmd.rA == 0 && cmd.rB == rvrError && cmd.rC == 0 && cmd.argument == 0;
+	}
 }
 
 ExecutorRegVm::ExecutorRegVm(Linker* linker) : exLinker(linker), exTypes(linker->exTypes), exFunctions(linker->exFunctions)
@@ -82,6 +92,9 @@ ExecutorRegVm::ExecutorRegVm(Linker* linker) : exLinker(linker), exTypes(linker-
 
 	breakFunctionContext = NULL;
 	breakFunction = NULL;
+
+	budgetActive = false;
+	budgetCounter = 0;
 }
 
 ExecutorRegVm::~ExecutorRegVm()
@@ -122,8 +135,14 @@ void ExecutorRegVm::InitExecution()
 	callContinue = true;
 
 	// Add return after the last instruction to end execution of code with no return at the end
-	exLinker->exRegVmCode.push_back(RegVmCmd(rviReturn, 0, rvrError, 0, 0));
-	exLinker->exRegVmExecCount.push_back(0);
+	if(!IsExecutionTerminator(exLinker->exRegVmCode))
+	{
+		// Code shared with a program image already has the return
+		exLinker->UnshareCode();
+
+		exLinker->exRegVmCode.push_back(RegVmCmd(rviReturn, 0, rvrError, 0, 0));
+		exLinker->exRegVmExecCount.push_back(0);
+	}
 
 	if(!tempStackArrayBase)
 	{
@@ -179,6 +198,13 @@ bool ExecutorRegVm::Run(unsigned functionID, const char *arguments)
 	unsigned prevLastFinalReturn = lastFinalReturn;
 	lastFinalReturn = callStack.size();
 
+	// Budget is renewed for each call from the host
+	if(lastFinalReturn == 0)
+	{
+		budgetActive = budget.Active();
+		budgetCounter = budget.Start();
+	}
+
 	unsigned prevDataSize = dataStack.size();
 
 	RegVmRegister *regFilePtr = regFileLastTop;
@@ -366,6 +392,146 @@ bool ExecutorRegVm::Run(unsigned functionID, const char *arguments)
 	return true;
 }
 
+bool ExecutorRegVm::RunBatch(unsigned functionID, char *arguments, unsigned argumentStride, unsigned count, char *results, unsigned resultStride)
+{
+	if(exLinker->exRegVmCode.empty())
+	{
+		Stop("ERROR: module contains no code");
+		return false;
+	}
+
+	ExternFuncInfo &target = exFunctions[functionID];
+
+	// External functions have no stack frame to reuse
+	if(target.regVmAddress == -1)
+	{
+		for(unsigned i = 0; i < count; i++)
+		{
+			if(!Run(functionID, arguments + i * argumentStride))
+				return false;
+
+			if(results)
+				memcpy(results + i * resultStride, tempStackArrayBase, GetExecutorResultSize(tempStackType));
+		}
+
+		return true;
+	}
+
+	if(!codeRunning)
+		InitExecution();
+
+	codeRunning = true;
+
+	RegVmReturnType retType = (RegVmReturnType)GetFunctionVmReturnType(target, exTypes.data, exLinker->exTypeExtra.data);
+
+	codeBase = &exLinker->exRegVmCode[0];
+	RegVmCmd *instruction = &exLinker->exRegVmCode[target.regVmAddress];
+
+	bool errorState = false;
+
+	unsigned prevLastFinalReturn = lastFinalReturn;
+	lastFinalReturn = callStack.size();
+
+	if(lastFinalReturn == 0)
+	{
+		budgetActive = budget.Active();
+		budgetCounter = budget.Start();
+	}
+
+	unsigned prevDataSize = dataStack.size();
+
+	assert(dataStack.size() % 16 == 0);
+
+	unsigned argumentsSize = target.argumentSize;
+	unsigned stackSize = (target.stackSize + 0xf) & ~0xf;
+
+	assert(argumentsSize <= stackSize);
+
+	if(dataStack.size() + stackSize >= dataStack.max)
+	{
+		callStack.push_back(instruction + 1);
+		Stop("ERROR: stack overflow");
+		errorState = true;
+	}
+
+	ExternTypeInfo &targetType = exTypes[target.funcType];
+
+	unsigned resultSize = GetExecutorResultSize(exLinker->exTypeExtra[targetType.memberOffset].type);
+
+	RegVmRegister *regFilePtr = regFileLastTop;
+	RegVmRegister *regFileTop = regFilePtr + target.regVmRegisters;
+
+	RegVmRegister *prevRegFileLastTop = regFileLastTop;
+
+	regFileLastTop = regFileTop;
+
+	if(!errorState)
+		dataStack.resize(dataStack.size() + stackSize);
+
+	// Stack frame placement and register file stay the same for all items, only frame contents are re-initialized
+	char *frame = (char*)(dataStack.data + prevDataSize);
+
+	for(unsigned i = 0; i < count && !errorState; i++)
+	{
+		memcpy(frame, arguments + i * argumentStride, argumentsSize);
+
+		if(stackSize - argumentsSize)
+			memset(frame + argumentsSize, 0, stackSize - argumentsSize);
+
+		regFilePtr[rvrrGlobals].ptrValue = uintptr_t(dataStack.data);
+		regFilePtr[rvrrFrame].ptrValue = uintptr_t(frame);
+		regFilePtr[rvrrConstants].ptrValue = uintptr_t(exLinker->exRegVmConstants.data);
+		regFilePtr[rvrrRegisters].ptrValue = uintptr_t(regFilePtr);
+
+		memset(regFilePtr + rvrrCount, 0, (regFileTop - regFilePtr - rvrrCount) * sizeof(regFilePtr[0]));
+
+		RegVmReturnType resultType = RunCode(instruction, regFilePtr, this, codeBase);
+
+		if(resultType == rvrError)
+		{
+			errorState = true;
+			break;
+		}
+
+		assert((retType == rvrVoid || retType == resultType) && "expected different result");
+		(void)retType;
+
+		if(results)
+			memcpy(results + i * resultStride, tempStackArrayBase, resultSize);
+	}
+
+	regFileLastTop = prevRegFileLastTop;
+
+	dataStack.shrink(prevDataSize);
+
+	if(errorState)
+	{
+		if(lastFinalReturn == 0)
+		{
+			char *currPos = execErrorBuffer + strlen(execErrorBuffer);
+			currPos += NULLC::SafeSprintf(currPos, NULLC_ERROR_BUFFER_SIZE - int(currPos - execErrorBuffer), "\r\nCall stack:\r\n");
+
+			unsigned currentFrame = 0;
+			while(unsigned address = GetCallStackAddress(currentFrame++))
+				currPos += PrintStackFrame(address, currPos, NULLC_ERROR_BUFFER_SIZE - int(currPos - execErrorBuffer), false);
+		}
+
+		execErrorFinalReturnDepth = lastFinalReturn;
+		lastFinalReturn = prevLastFinalReturn;
+
+		callContinue = false;
+		codeRunning = false;
+
+		return false;
+	}
+
+	lastFinalReturn = prevLastFinalReturn;
+
+	tempStackType = exLinker->exTypeExtra[targetType.memberOffset].type;
+
+	return true;
+}
+
 void ExecutorRegVm::Stop(const char* error)
 {
 	codeRunning = false;
@@ -420,6 +586,11 @@ bool ExecutorRegVm::SetStackSize(unsigned bytes)
 	return true;
 }
 
+unsigned ExecutorRegVm::GetStackSize()
+{
+	return minStackSize;
+}
+
 #if (defined(__clang__) || defined(__GNUC__)) && !defined(NULLC_REG_VM_PROFILE_INSTRUCTIONS)
 #define USE_COMPUTED_GOTO
 #endif
@@ -762,6 +933,10 @@ RegVmReturnType ExecutorRegVm::RunCode(RegVmCmd *instruction, RegVmRegister * co
 			instruction++;
 			BREAK;
 		CASE(rviJmp)
+			// Budget is spent on loop back-edges
+			if(rvm->budgetActive && cmd.argument <= unsigned(instruction - rvm->codeBase) && --rvm->budgetCounter <= 0 && !rvm->ExecBudget(instruction))
+				return rvrError;
+
 #ifdef _M_X64
 			instruction = codeBase + cmd.argument - 1;
 #else
@@ -772,6 +947,9 @@ RegVmReturnType ExecutorRegVm::RunCode(RegVmCmd *instruction, RegVmRegister * co
 		CASE(rviJmpz)
 			if(regFilePtr[cmd.rC].intValue == 0)
 			{
+				if(rvm->budgetActive && cmd.argument <= unsigned(instruction - rvm->codeBase) && --rvm->budgetCounter <= 0 && !rvm->ExecBudget(instruction))
+					return rvrError;
+
 #ifdef _M_X64
 				instruction = codeBase + cmd.argument - 1;
 #else
@@ -783,6 +961,9 @@ RegVmReturnType ExecutorRegVm::RunCode(RegVmCmd *instruction, RegVmRegister * co
 		CASE(rviJmpnz)
 			if(regFilePtr[cmd.rC].intValue != 0)
 			{
+				if(rvm->budgetActive && cmd.argument <= unsigned(instruction - rvm->codeBase) && --rvm->budgetCounter <= 0 && !rvm->ExecBudget(instruction))
+					return rvrError;
+
 #ifdef _M_X64
 				instruction = codeBase + cmd.argument - 1;
 #else
@@ -1451,6 +1632,9 @@ bool ExecutorRegVm::ExecCall(unsigned microcodePos, unsigned functionId, RegVmCm
 		return true;
 	}
 
+	if(budgetActive && --budgetCounter <= 0 && !ExecBudget(instruction))
+		return false;
+
 	callStack.push_back(instruction + 1);
 
 	unsigned prevDataSize = dataStack.size();
@@ -1697,6 +1881,29 @@ RegVmReturnType ExecutorRegVm::ExecError(RegVmCmd * const instruction, const cha
 	return rvrError;
 }
 
+bool ExecutorRegVm::ExecBudget(RegVmCmd * const instruction)
+{
+	// Host can inspect the call stack from the budget callback
+	callStack.push_back(instruction + 1);
+
+	budgetCounter = budget.Next();
+
+	if(!budgetCounter)
+	{
+		if(callContinue)
+			Stop("ERROR: execution budget exceeded");
+
+		return false;
+	}
+
+	if(!callContinue)
+		return false;
+
+	callStack.pop_back();
+
+	return true;
+}
+
 unsigned ExecutorRegVm::GetResultType()
 {
 	return tempStackType;
@@ -1745,6 +1952,24 @@ char* ExecutorRegVm::GetVariableData(unsigned *count)
 	return dataStack.data;
 }
 
+char* ExecutorRegVm::ResetGlobals()
+{
+	if(exLinker->exRegVmCode.empty())
+	{
+		Stop("ERROR: module contains no code");
+		return NULL;
+	}
+
+	InitExecution();
+
+	// Functions can be called after that as if the global code has finished
+	codeRunning = true;
+
+	memset(dataStack.data, 0, exLinker->globalVarSize);
+
+	return dataStack.data;
+}
+
 unsigned ExecutorRegVm::GetCallStackAddress(unsigned frame)
 {
 	if(frame >= callStack.size())
@@ -1778,8 +2003,24 @@ void ExecutorRegVm::SetBreakFunction(void *context, unsigned (*callback)(void*,
 	breakFunction = callback;
 }
 
+void ExecutorRegVm::SetExecutionBudget(unsigned steps, unsigned milliseconds)
+{
+	budget.stepLimit = steps;
+	budget.timeLimit = milliseconds;
+}
+
+void ExecutorRegVm::SetExecutionBudgetCallback(void *context, unsigned (*callback)(void*))
+{
+	budget.context = context;
+	budget.callback = callback;
+}
+
 void ExecutorRegVm::ClearBreakpoints()
 {
+	// Code shared with a program image is left untouched when there are no breakpoints
+	if(breakCode.empty())
+		return;
+
 	// Check all instructions for break instructions
 	for(unsigned i = 0; i < exLinker->exRegVmCode.size(); i++)
 	{
@@ -1800,6 +2041,14 @@ bool ExecutorRegVm::AddBreakpoint(unsigned instruction, bool oneHit)
 		return false;
 	}
 
+	// Breakpoints are placed in a private copy of the code shared with a program image
+	if(exLinker->codeShared)
+	{
+		exLinker->UnshareCode();
+
+		UpdateInstructionPointer();
+	}
+
 	unsigned pos = breakCode.size();
 
 	if(exLinker->exRegVmCode[instruction].code == rviNop)
@@ -3,6 +3,7 @@
 #include "Array.h"
 #include "Bytecode.h"
 #include "InstructionTreeRegVm.h"
+#include "Executor_Common.h"
 
 #if !defined(NULLC_NO_RAW_EXTERNAL_CALL)
 typedef struct DCCallVM_ DCCallVM;
@@ -17,11 +18,13 @@ public:
 	~ExecutorRegVm();
 
 	bool	Run(unsigned functionID, const char *arguments);
+	bool	RunBatch(unsigned functionID, char *arguments, unsigned argumentStride, unsigned count, char *results, unsigned resultStride);
 	void	Stop(const char* error);
 	void	Stop(NULLCRef error);
 	void	Resume();
 
 	bool	SetStackSize(unsigned bytes);
+	unsigned	GetStackSize();
 
 	unsigned	GetResultType();
 	NULLCRef	GetResultObject();
@@ -36,6 +39,9 @@ public:
 
 	char*		GetVariableData(unsigned *count);
 
+	// Prepares execution without running global code and returns zero-initialized global variable memory
+	char*		ResetGlobals();
+
 	unsigned	GetCallStackAddress(unsigned frame);
 
 	void*		GetStackStart();
@@ -48,6 +54,9 @@ public:
 
 	void	UpdateInstructionPointer();
 
+	void	SetExecutionBudget(unsigned steps, unsigned milliseconds);
+	void	SetExecutionBudgetCallback(void *context, unsigned (*callback)(void*));
+
 private:
 	void	InitExecution();
 
@@ -99,6 +108,10 @@ private:
 	void *breakFunctionContext;
 	unsigned (*breakFunction)(void*, unsigned);
 
+	ExecutionBudget	budget;
+	bool			budgetActive;
+	int				budgetCounter;
+
 	FastVector<RegVmCmd>	breakCode;
 
 	static RegVmReturnType RunCode(RegVmCmd *instruction, RegVmRegister * const regFilePtr, ExecutorRegVm *rvm, RegVmCmd *codeBase);
@@ -113,6 +126,8 @@ private:
 
 	RegVmReturnType ExecError(RegVmCmd * const instruction, const char *errorMessage);
 
+	bool ExecBudget(RegVmCmd * const instruction);
+
 	static const unsigned EXEC_BREAK_SIGNAL = 0;
 	static const unsigned EXEC_BREAK_RETURN = 1;
 	static const unsigned EXEC_BREAK_ONCE = 2;
@@ -89,6 +89,7 @@ struct UNWIND_INFO_FUNCTION
 	#define PAGESIZE 4096
 #endif
 #include <signal.h>
+#include <pthread.h>
 
 #if _MSC_VER <= 1600
 typedef struct _RUNTIME_FUNCTION
@@ -113,7 +114,8 @@ extern "C"
 
 namespace NULLC
 {
-	ExecutorX86	*currExecutor = NULL;
+	// Executor that is running on the thread
+	NULLC_THREAD_LOCAL ExecutorX86	*currExecutor = NULL;
 
 	unsigned GetInstructionFromAddress(uintptr_t address)
 	{
@@ -268,8 +270,16 @@ namespace NULLC
 #define EXCEPTION_INT_DIVIDE_BY_ZERO 1
 #define EXCEPTION_INVALID_POINTER 4
 
-	sigjmp_buf errorHandler;
-	
+	NULLC_THREAD_LOCAL sigjmp_buf errorHandler;
+
+	// Signal handlers are shared by the threads, they are installed by the first running executor and restored by the last one
+	pthread_mutex_t signalHandlerLock = PTHREAD_MUTEX_INITIALIZER;
+	unsigned signalHandlerUsers = 0;
+
+	struct sigaction prevSigFPE;
+	struct sigaction prevSigTRAP;
+	struct sigaction prevSigSEGV;
+
 	struct JmpBufData
 	{
 		char data[sizeof(sigjmp_buf)];
@@ -784,6 +794,9 @@ bool ExecutorX86::InitExecution()
 
 	CommonSetLinker(exLinker);
 
+	// Multiple executors can exist in different execution contexts
+	NULLC::currExecutor = this;
+
 	vmState.dataStackTop = vmState.dataStackBase + ((exLinker->globalVarSize + 0xf) & ~0xf);
 
 	if(vmState.dataStackTop >= vmState.dataStackEnd)
@@ -856,6 +869,10 @@ bool ExecutorX86::Run(unsigned int functionID, const char *arguments)
 	unsigned prevLastFinalReturn = lastFinalReturn;
 	lastFinalReturn = unsigned(vmState.callStackTop - vmState.callStackBase);
 
+	// Budget is renewed for each call from the host
+	if(lastFinalReturn == 0)
+		vmState.budgetCounter = budget.Start();
+
 	unsigned prevDataSize = unsigned(vmState.dataStackTop - vmState.dataStackBase);
 
 	assert(prevDataSize % 16 == 0);
@@ -983,20 +1000,24 @@ bool ExecutorX86::Run(unsigned int functionID, const char *arguments)
 		vmState.jitCodeActive = true;
 
 #ifdef __linux
-		struct sigaction sa;
-		struct sigaction sigFPE;
-		struct sigaction sigTRAP;
-		struct sigaction sigSEGV;
-
 		if(firstRun)
 		{
-			sa.sa_sigaction = NULLC::HandleError;
-			sigemptyset(&sa.sa_mask);
-			sa.sa_flags = SA_RESTART | SA_SIGINFO;
+			pthread_mutex_lock(&NULLC::signalHandlerLock);
 
-			sigaction(SIGFPE, &sa, &sigFPE);
-			sigaction(SIGTRAP, &sa, &sigTRAP);
-			sigaction(SIGSEGV, &sa, &sigSEGV);
+			if(NULLC::signalHandlerUsers++ == 0)
+			{
+				struct sigaction sa;
+
+				sa.sa_sigaction = NULLC::HandleError;
+				sigemptyset(&sa.sa_mask);
+				sa.sa_flags = SA_RESTART | SA_SIGINFO;
+
+				sigaction(SIGFPE, &sa, &NULLC::prevSigFPE);
+				sigaction(SIGTRAP, &sa, &NULLC::prevSigTRAP);
+				sigaction(SIGSEGV, &sa, &NULLC::prevSigSEGV);
+			}
+
+			pthread_mutex_unlock(&NULLC::signalHandlerLock);
 		}
 
 		int errorCode = 0;
@@ -1029,12 +1050,19 @@ bool ExecutorX86::Run(unsigned int functionID, const char *arguments)
 			resultType = rvrError;
 		}
 
-		// Disable signal handlers only from top-level Run
-		if(lastFinalReturn == 0)
+		// Disable signal handlers from the Run that has installed them when no other thread is running code
+		if(firstRun)
 		{
-			sigaction(SIGFPE, &sigFPE, NULL);
-			sigaction(SIGTRAP, &sigTRAP, NULL);
-			sigaction(SIGSEGV, &sigSEGV, NULL);
+			pthread_mutex_lock(&NULLC::signalHandlerLock);
+
+			if(--NULLC::signalHandlerUsers == 0)
+			{
+				sigaction(SIGFPE, &NULLC::prevSigFPE, NULL);
+				sigaction(SIGTRAP, &NULLC::prevSigTRAP, NULL);
+				sigaction(SIGSEGV, &NULLC::prevSigSEGV, NULL);
+			}
+
+			pthread_mutex_unlock(&NULLC::signalHandlerLock);
 		}
 
 		NULLC::copyMemory(NULLC::errorHandler, data.data, sizeof(sigjmp_buf));
@@ -1210,6 +1238,11 @@ bool ExecutorX86::SetStackSize(unsigned bytes)
 	return true;
 }
 
+unsigned ExecutorX86::GetStackSize()
+{
+	return minStackSize;
+}
+
 void ExecutorX86::ClearNative()
 {
 	TRACE_SCOPE("x86", "ClearNative");
@@ -1307,6 +1340,8 @@ bool ExecutorX86::TranslateToNative(bool enableLogFiles, OutputContext &output)
 
 	CommonSetLinker(exLinker);
 
+	NULLC::currExecutor = this;
+
 	EMIT_OP(codeGenCtx->ctx, o_use32);
 
 	codeJumpTargets.resize(exRegVmCode.size());
@@ -1327,6 +1362,15 @@ bool ExecutorX86::TranslateToNative(bool enableLogFiles, OutputContext &output)
 			codeJumpTargets[target.regVmAddress] |= 2 + (i << 8);
 	}
 
+	// Mark loop headers and function entries where execution budget is checked
+	for(unsigned i = lastInstructionCount, e = exRegVmCode.size(); i != e; i++)
+	{
+		RegVmCmd &cmd = exRegVmCode[i];
+
+		if((cmd.code == rviJmpz || cmd.code == rviJmpnz || (cmd.code == rviJmp && !cmd.rA)) && cmd.argument <= i)
+			codeJumpTargets[cmd.argument] |= 8;
+	}
+
 	// Find instruction register kill info positions
 	codeRegKillInfoOffsets.resize(exRegVmCode.size());
 	for(unsigned i = lastInstructionCount, e = exRegVmCode.size(); i != e; i++)
@@ -1554,6 +1598,9 @@ bool ExecutorX86::TranslateToNative(bool enableLogFiles, OutputContext &output)
 			}
 		}
 
+		if((codeJumpTargets[pos] & 10) != 0)
+			GenCodeBudgetCheck(*codeGenCtx);
+
 		if(cmd.code == rviJmp && cmd.rA)
 		{
 			codeJumpTargets[cmd.argument] |= 4;
@@ -2139,6 +2186,22 @@ char* ExecutorX86::GetVariableData(unsigned int *count)
 	return vmState.dataStackBase;
 }
 
+char* ExecutorX86::ResetGlobals()
+{
+	if(exRegVmCode.empty())
+	{
+		Stop("ERROR: module contains no code");
+		return NULL;
+	}
+
+	if(!InitExecution())
+		return NULL;
+
+	memset(vmState.dataStackBase, 0, exLinker->globalVarSize);
+
+	return vmState.dataStackBase;
+}
+
 unsigned int ExecutorX86::GetCallStackAddress(unsigned frame)
 {
 	return frame >= unsigned(vmState.callStackTop - vmState.callStackBase) ? 0 : vmState.callStackBase[frame].instruction;
@@ -2154,6 +2217,41 @@ void* ExecutorX86::GetStackEnd()
 	return vmState.regFileLastTop;
 }
 
+void ExecutorX86::SetExecutionBudget(unsigned steps, unsigned milliseconds)
+{
+	budget.stepLimit = steps;
+	budget.timeLimit = milliseconds;
+}
+
+void ExecutorX86::SetExecutionBudgetCallback(void *context, unsigned (*callback)(void*))
+{
+	budget.context = context;
+	budget.callback = callback;
+}
+
+bool ExecutorX86::ExecBudget()
+{
+	// Native code always counts steps, without a budget the counter is only refilled
+	if(!budget.Active())
+	{
+		vmState.budgetCounter = budget.Start();
+
+		return callContinue;
+	}
+
+	vmState.budgetCounter = budget.Next();
+
+	if(!vmState.budgetCounter)
+	{
+		if(callContinue)
+			Stop("ERROR: execution budget exceeded");
+
+		return false;
+	}
+
+	return callContinue;
+}
+
 void ExecutorX86::SetBreakFunction(void *context, unsigned (*callback)(void*, unsigned))
 {
 	breakFunctionContext = context;
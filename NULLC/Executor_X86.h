@@ -5,6 +5,7 @@
 #include "Array.h"
 #include "CodeGenRegVm_X86.h"
 #include "InstructionTreeRegVm.h"
+#include "Executor_Common.h"
 
 #if !defined(NULLC_NO_RAW_EXTERNAL_CALL)
 typedef struct DCCallVM_ DCCallVM;
@@ -44,6 +45,7 @@ public:
 	void	Resume();
 
 	bool	SetStackSize(unsigned bytes);
+	unsigned	GetStackSize();
 
 	unsigned	GetResultType();
 	NULLCRef	GetResultObject();
@@ -57,6 +59,9 @@ public:
 
 	char*		GetVariableData(unsigned int *count);
 
+	// Prepares execution without running global code and returns zero-initialized global variable memory
+	char*		ResetGlobals();
+
 	unsigned	GetCallStackAddress(unsigned frame);
 
 	void*		GetStackStart();
@@ -67,6 +72,12 @@ public:
 	bool	AddBreakpoint(unsigned int instruction, bool oneHit);
 	bool	RemoveBreakpoint(unsigned int instruction);
 
+	void	SetExecutionBudget(unsigned steps, unsigned milliseconds);
+	void	SetExecutionBudgetCallback(void *context, unsigned (*callback)(void*));
+
+	// Called from native code when the budget step counter has run out
+	bool	ExecBudget();
+
 	unsigned	GetInstructionAtAddress(void *address);
 	bool		IsCodeLaunchHeader(void *address);
 
@@ -167,6 +178,8 @@ public:
 	void *breakFunctionContext;
 	unsigned (*breakFunction)(void*, unsigned);
 
+	ExecutionBudget	budget;
+
 	struct Breakpoint
 	{
 		Breakpoint(): instIndex(0), oldOpcode(0), oneHit(false){}
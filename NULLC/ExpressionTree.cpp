@@ -1,5 +1,6 @@
 #include "ExpressionTree.h"
 
+#include "nullc.h"
 #include "BinaryCache.h"
 #include "Bytecode.h"
 #include "ExpressionEval.h"
@@ -177,16 +178,43 @@ namespace
 		StopAt(ctx, source, source->pos.begin, msg, args);
 	}
 
+	const unsigned cancellationCheckInterval = 64 * 1024;
+
+	void SetMemoryLimitCheckpoint(ExpressionContext &ctx);
+
 	void OnMemoryLimitHit(void *context)
 	{
 		ExpressionContext &ctx = *(ExpressionContext*)context;
 
+		SynBase *source = ctx.scope->ownerFunction ? ctx.scope->ownerFunction->source : ctx.typeAutoRef->members.head->source;
+
+		if(ctx.cancellation && nullcIsCancellationRequested(ctx.cancellation))
+		{
+			ctx.allocator->clear_limit();
+
+			Stop(ctx, source, "ERROR: analysis was cancelled");
+		}
+
+		// Limit might have been hit only at a cancellation check point
+		if(ctx.allocator->requested() <= ctx.memoryLimitTotal)
+		{
+			SetMemoryLimitCheckpoint(ctx);
+			return;
+		}
+
 		ctx.allocator->clear_limit();
 
-		if(ctx.scope->ownerFunction)
-			Stop(ctx, ctx.scope->ownerFunction->source, "ERROR: memory limit (%u) reached during compilation (analyze stage)", ctx.memoryLimit);
-		else
-			Stop(ctx, ctx.typeAutoRef->members.head->source, "ERROR: memory limit (%u) reached during compilation (analyze stage)", ctx.memoryLimit);
+		Stop(ctx, source, "ERROR: memory limit (%u) reached during compilation (analyze stage)", ctx.memoryLimit);
+	}
+
+	void SetMemoryLimitCheckpoint(ExpressionContext &ctx)
+	{
+		unsigned limit = ctx.memoryLimitTotal;
+
+		if(ctx.cancellation && ctx.allocator->requested() + cancellationCheckInterval < limit)
+			limit = ctx.allocator->requested() + cancellationCheckInterval;
+
+		ctx.allocator->set_limit(limit, &ctx, OnMemoryLimitHit);
 	}
 
 	unsigned char ParseEscapeSequence(ExpressionContext &ctx, SynBase *source, const char* str)
@@ -1157,6 +1185,9 @@ ExpressionContext::ExpressionContext(Allocator *allocator, int optimizationLevel
 	expressionDepth = 0;
 
 	memoryLimit = 0;
+	memoryLimitTotal = 0;
+
+	cancellation = NULL;
 
 	genericTypeMap.init();
 
@@ -3256,6 +3287,46 @@ TypeBase* ApplyArraySizesToType(ExpressionContext &ctx, TypeBase *type, SynBase
 	return NULL;
 }
 
+SynClassDefinition* ParseGenericClassDefinition(ExpressionContext &ctx, TypeGenericClassProto *proto)
+{
+	if(!proto->definition && proto->delayedDefinition)
+	{
+		ParseContext *parser = new (ctx.get<ParseContext>()) ParseContext(ctx.allocator, ctx.optimizationLevel, ArrayView<InplaceStr>());
+
+		parser->currentLexeme = proto->delayedDefinition;
+
+		unsigned traceDepth = NULLC::TraceGetDepth();
+
+		if(!setjmp(parser->errorHandler))
+		{
+			parser->errorHandlerActive = true;
+
+			ImportModuleNamespaces(*parser, proto->delayedDefinition, proto->importModule->bytecode);
+
+			proto->definition = getType<SynClassDefinition>(ParseClassDefinition(*parser));
+
+			parser->errorHandlerActive = false;
+		}
+		else
+		{
+			NULLC::TraceLeaveTo(traceDepth);
+		}
+
+		if(proto->definition)
+			proto->definition->imported = true;
+	}
+
+	return proto->definition;
+}
+
+SynClassDefinition* GetGenericClassDefinition(ExpressionContext &ctx, SynBase *source, TypeGenericClassProto *proto)
+{
+	if(!proto->definition && proto->delayedDefinition && !ParseGenericClassDefinition(ctx, proto))
+		Stop(ctx, source, "ERROR: failed to import generic class '%.*s' body", FMT_ISTR(proto->name));
+
+	return proto->definition;
+}
+
 TypeBase* CreateGenericTypeInstance(ExpressionContext &ctx, SynBase *source, TypeGenericClassProto *proto, IntrusiveList<TypeHandle> &types)
 {
 	InplaceStr className = GetGenericClassTypeName(ctx, proto, types);
@@ -3286,7 +3357,7 @@ TypeBase* CreateGenericTypeInstance(ExpressionContext &ctx, SynBase *source, Typ
 
 	if(!setjmp(ctx.errorHandler))
 	{
-		result = AnalyzeClassDefinition(ctx, proto->definition, proto, types);
+		result = AnalyzeClassDefinition(ctx, GetGenericClassDefinition(ctx, source, proto), proto, types);
 	}
 	else
 	{
@@ -3670,7 +3741,7 @@ TypeBase* AnalyzeType(ExpressionContext &ctx, SynBase *syntax, bool onlyType = t
 
 		if(TypeGenericClassProto *proto = getType<TypeGenericClassProto>(baseType))
 		{
-			IntrusiveList<SynIdentifier> aliases = proto->definition->aliases;
+			IntrusiveList<SynIdentifier> aliases = GetGenericClassDefinition(ctx, syntax, proto)->aliases;
 
 			if(node->types.size() < aliases.size())
 				Stop(ctx, syntax, "ERROR: there where only '%d' argument(s) to a generic type that expects '%d'", node->types.size(), aliases.size());
@@ -4794,7 +4865,7 @@ ExprBase* CreateTypeidMemberAccess(ExpressionContext &ctx, SynBase *source, Type
 
 	if(TypeGenericClass *typeGenericClass = getType<TypeGenericClass>(type))
 	{
-		for(SynIdentifier *curr = typeGenericClass->proto->definition->aliases.head; curr; curr = getType<SynIdentifier>(curr->next))
+		for(SynIdentifier *curr = GetGenericClassDefinition(ctx, source, typeGenericClass->proto)->aliases.head; curr; curr = getType<SynIdentifier>(curr->next))
 		{
 			if(curr->name == member->name)
 				return new (ctx.get<ExprTypeLiteral>()) ExprTypeLiteral(source, ctx.typeTypeID, ctx.typeGeneric);
@@ -8790,7 +8861,7 @@ bool RestoreParentTypeScope(ExpressionContext &ctx, SynBase *source, TypeBase *p
 		}
 		else if(TypeGenericClassProto *genericProto = getType<TypeGenericClassProto>(parentType))
 		{
-			SynClassDefinition *definition = genericProto->definition;
+			SynClassDefinition *definition = GetGenericClassDefinition(ctx, source, genericProto);
 
 			for(SynIdentifier *curr = definition->aliases.head; curr; curr = getType<SynIdentifier>(curr->next))
 				ctx.AddAlias(new (ctx.get<AliasData>()) AliasData(source, ctx.scope, ctx.GetGenericAliasType(curr), curr, ctx.uniqueAliasId++));
@@ -12188,7 +12259,8 @@ void ImportModuleDependencies(ExpressionContext &ctx, SynBase *source, ModuleCon
 			lexStream = moduleData->lexer->GetStreamStart();
 			lexStreamSize = moduleData->lexer->GetStreamSize();
 
-			BinaryCache::PutLexemes(moduleFileName, lexStream, lexStreamSize);
+			// Later imports of the module take lexemes from the cache, all imports have to refer to the same lexemes to find the source owner
+			lexStream = BinaryCache::PutLexemes(moduleFileName, lexStream, lexStreamSize, lexStreamSize);
 		}
 
 		moduleData->lexStream = lexStream;
@@ -12586,22 +12658,13 @@ void ImportModuleTypes(ExpressionContext &ctx, SynBase *source, ModuleContext &m
 					assert(!forwardDeclaration);
 
 					assert(type.definitionOffsetStart < importModule->lexStreamSize);
-					Lexeme *start = type.definitionOffsetStart + importModule->lexStream;
-
-					ParseContext *parser = new (ctx.get<ParseContext>()) ParseContext(ctx.allocator, ctx.optimizationLevel, ArrayView<InplaceStr>());
-
-					parser->currentLexeme = start;
 
-					ImportModuleNamespaces(*parser, start, importModule->bytecode);
+					// Class body is parsed on first use
+					TypeGenericClassProto *protoType = new (ctx.get<TypeGenericClassProto>()) TypeGenericClassProto(identifier, locationSource, ctx.scope, NULL);
 
-					SynClassDefinition *definition = getType<SynClassDefinition>(ParseClassDefinition(*parser));
+					protoType->delayedDefinition = type.definitionOffsetStart + importModule->lexStream;
 
-					if(!definition)
-						Stop(ctx, source, "ERROR: failed to import generic class body");
-
-					definition->imported = true;
-
-					importedType = new (ctx.get<TypeGenericClassProto>()) TypeGenericClassProto(identifier, locationSource, ctx.scope, definition);
+					importedType = protoType;
 
 					ctx.AddType(importedType);
 
@@ -13153,9 +13216,11 @@ void ImportModuleFunctions(ExpressionContext &ctx, SynBase *source, ModuleContex
 		// TODO: explicit flag
 		if(function.funcType == 0 || functionType->isGeneric || hasGenericExplicitType || (parentType && parentType->isGeneric))
 		{
-			assert(function.genericOffsetStart < data->importModule->lexStreamSize);
+			ModuleData *definitionModule = function.genericOffsetModule != 0 ? moduleCtx.dependencies[function.genericOffsetModule - 1] : data->importModule;
+
+			assert(function.genericOffsetStart < definitionModule->lexStreamSize);
 
-			data->delayedDefinition = function.genericOffsetStart + data->importModule->lexStream;
+			data->delayedDefinition = function.genericOffsetStart + definitionModule->lexStream;
 
 			TypeBase *returnType = ctx.typeAuto;
 
@@ -13250,7 +13315,7 @@ void ImportModule(ExpressionContext &ctx, SynBase *source, ByteCode* bytecode, L
 
 		assert(!*name.end);
 
-		BinaryCache::PutLexemes(name.begin, lexStream, lexStreamSize);
+		lexStream = BinaryCache::PutLexemes(name.begin, lexStream, lexStreamSize, lexStreamSize);
 	}
 
 	moduleData->lexStream = lexStream;
@@ -13701,18 +13766,18 @@ ExprModule* Analyze(ExpressionContext &ctx, SynModule *syntax, const char *code,
 	{
 		ctx.errorHandlerActive = true;
 
-		if(ctx.memoryLimit != 0)
+		if(ctx.memoryLimit != 0 || ctx.cancellation)
 		{
-			unsigned totalLimit = ctx.allocator->requested() + ctx.memoryLimit;
+			ctx.memoryLimitTotal = ctx.memoryLimit != 0 ? ctx.allocator->requested() + ctx.memoryLimit : ~0u;
 
-			ctx.allocator->set_limit(totalLimit, &ctx, OnMemoryLimitHit);
+			SetMemoryLimitCheckpoint(ctx);
 		}
 
 		ExprModule *module = AnalyzeModule(ctx, syntax);
 
 		ctx.errorHandlerActive = false;
 
-		if(ctx.memoryLimit != 0)
+		if(ctx.memoryLimit != 0 || ctx.cancellation)
 			ctx.allocator->clear_limit();
 
 		ctx.statistics.Start(NULLCTime::clockMicro());
@@ -13731,7 +13796,7 @@ ExprModule* Analyze(ExpressionContext &ctx, SynModule *syntax, const char *code,
 
 	NULLC::TraceLeaveTo(traceDepth);
 
-	if(ctx.memoryLimit != 0)
+	if(ctx.memoryLimit != 0 || ctx.cancellation)
 		ctx.allocator->clear_limit();
 
 	assert(ctx.errorPos != NULL);
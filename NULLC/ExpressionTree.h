@@ -334,6 +334,9 @@ struct ExpressionContext
 	unsigned expressionDepth;
 
 	unsigned memoryLimit;
+	unsigned memoryLimitTotal;
+
+	NULLCCancellation *cancellation;
 
 	// Error info
 	bool errorHandlerActive;
@@ -1263,5 +1266,8 @@ T* getType(ExprBase *node)
 }
 
 ExprModule* Analyze(ExpressionContext &context, SynModule *syntax, const char *code, const char *moduleRoot);
+
+// Body of an imported generic class is parsed when it is used for the first time, returns NULL if the body can't be parsed
+SynClassDefinition* ParseGenericClassDefinition(ExpressionContext &ctx, TypeGenericClassProto *proto);
 void VisitExpressionTreeNodes(ExprBase *expression, void *context, void(*accept)(void *context, ExprBase *child));
 const char* GetExpressionTreeNodeName(ExprBase *expression);
@@ -34,6 +34,9 @@ public:
 				entries = NULLC::construct<Node*>(bucketCount);
 
 			memset(entries, 0, sizeof(Node*) * bucketCount);
+
+		// Removed nodes belong to the pool that was cleared
+		freeList.clear();
 		}
 	}
 
@@ -71,6 +74,8 @@ public:
 
 		entries = NULL;
 		nodePool.~ChunkedStackPool();
+
+		freeList.reset();
 	}
 
 	void clear()
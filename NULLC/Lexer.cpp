@@ -1,5 +1,278 @@
 #include "Lexer.h"
 
+#if !defined(NULLC_NO_SIMD_LEXER) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+	// Block loads may read bytes past the terminating zero of the source, which address sanitizer reports
+	#if defined(__SANITIZE_ADDRESS__)
+		#define NULLC_NO_SIMD_LEXER
+	#elif defined(__has_feature)
+		#if __has_feature(address_sanitizer)
+			#define NULLC_NO_SIMD_LEXER
+		#endif
+	#endif
+#else
+	#define NULLC_NO_SIMD_LEXER
+#endif
+
+#if !defined(NULLC_NO_SIMD_LEXER)
+	#include <emmintrin.h>
+
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#endif
+#endif
+
+namespace
+{
+	struct KeywordInfo
+	{
+		const char *name;
+		unsigned length;
+		LexemeType type;
+	};
+
+	// Perfect hash table of all keywords, indexed by GetKeywordHash
+	const KeywordInfo keywordTable[64] =
+	{
+	{ "enum", 4, lex_enum },
+	{ NULL, 0, lex_none },
+	{ "do", 2, lex_do },
+	{ "return", 6, lex_return },
+	{ NULL, 0, lex_none },
+	{ NULL, 0, lex_none },
+	{ "align", 5, lex_align },
+	{ NULL, 0, lex_none },
+	{ "extendable", 10, lex_extendable },
+	{ "const", 5, lex_const },
+	{ "with", 4, lex_with },
+	{ NULL, 0, lex_none },
+	{ NULL, 0, lex_none },
+	{ "if", 2, lex_if },
+	{ NULL, 0, lex_none },
+	{ NULL, 0, lex_none },
+	{ NULL, 0, lex_none },
+	{ NULL, 0, lex_none },
+	{ NULL, 0, lex_none },
+	{ "operator", 8, lex_operator },
+	{ NULL, 0, lex_none },
+	{ "yield", 5, lex_yield },
+	{ "else", 4, lex_else },
+	{ NULL, 0, lex_none },
+	{ NULL, 0, lex_none },
+	{ "auto", 4, lex_auto },
+	{ "sizeof", 6, lex_sizeof },
+	{ "namespace", 9, lex_namespace },
+	{ NULL, 0, lex_none },
+	{ "case", 4, lex_case },
+	{ "switch", 6, lex_switch },
+	{ "continue", 8, lex_continue },
+	{ "coroutine", 9, lex_coroutine },
+	{ NULL, 0, lex_none },
+	{ "for", 3, lex_for },
+	{ NULL, 0, lex_none },
+	{ NULL, 0, lex_none },
+	{ NULL, 0, lex_none },
+	{ NULL, 0, lex_none },
+	{ NULL, 0, lex_none },
+	{ "ref", 3, lex_ref },
+	{ NULL, 0, lex_none },
+	{ "generic", 7, lex_generic },
+	{ "class", 5, lex_class },
+	{ NULL, 0, lex_none },
+	{ "in", 2, lex_in },
+	{ NULL, 0, lex_none },
+	{ "new", 3, lex_new },
+	{ NULL, 0, lex_none },
+	{ "true", 4, lex_true },
+	{ "noalign", 7, lex_noalign },
+	{ NULL, 0, lex_none },
+	{ "nullptr", 7, lex_nullptr },
+	{ "typeof", 6, lex_typeof },
+	{ "typedef", 7, lex_typedef },
+	{ NULL, 0, lex_none },
+	{ NULL, 0, lex_none },
+	{ "while", 5, lex_while },
+	{ "import", 6, lex_import },
+	{ NULL, 0, lex_none },
+	{ "default", 7, lex_default },
+	{ NULL, 0, lex_none },
+	{ "break", 5, lex_break },
+	{ "false", 5, lex_false },
+	};
+
+	inline unsigned GetKeywordHash(const char *pos, unsigned length)
+	{
+		return ((unsigned char)pos[0] * 11 + (unsigned char)pos[1] * 9 + (unsigned char)pos[length - 1] * 3 + length) & 63;
+	}
+
+	inline LexemeType GetKeywordType(const char *pos, unsigned length)
+	{
+		if(length < 2 || length > 10)
+			return lex_none;
+
+		const KeywordInfo &keyword = keywordTable[GetKeywordHash(pos, length)];
+
+		if(keyword.length == length && memcmp(keyword.name, pos, length) == 0)
+			return keyword.type;
+
+		return lex_none;
+	}
+
+	// Character classes for the scanning loops, each one never includes the terminating zero
+	struct BlankClass
+	{
+		static bool Test(char ch)
+		{
+			return (unsigned char)(ch - 1) < ' ' && ch != '\r' && ch != '\n';
+		}
+
+#if !defined(NULLC_NO_SIMD_LEXER)
+		static __m128i Match(__m128i data);
+#endif
+	};
+
+	struct LineCommentClass
+	{
+		static bool Test(char ch)
+		{
+			return ch != '\n' && ch != '\0';
+		}
+
+#if !defined(NULLC_NO_SIMD_LEXER)
+		static __m128i Match(__m128i data);
+#endif
+	};
+
+	struct BlockCommentClass
+	{
+		static bool Test(char ch)
+		{
+			return ch != '*' && ch != '/' && ch != '\"' && ch != '\r' && ch != '\n' && ch != '\0';
+		}
+
+#if !defined(NULLC_NO_SIMD_LEXER)
+		static __m128i Match(__m128i data);
+#endif
+	};
+
+	struct SymbolClass
+	{
+		static bool Test(char ch)
+		{
+			return (chartype_table[(unsigned char)ch] & ct_symbol) != 0;
+		}
+
+#if !defined(NULLC_NO_SIMD_LEXER)
+		static __m128i Match(__m128i data);
+#endif
+	};
+
+	struct DigitClass
+	{
+		static bool Test(char ch)
+		{
+			return isDigit(ch);
+		}
+
+#if !defined(NULLC_NO_SIMD_LEXER)
+		static __m128i Match(__m128i data);
+#endif
+	};
+
+#if !defined(NULLC_NO_SIMD_LEXER)
+	inline __m128i MatchByte(__m128i data, char value)
+	{
+		return _mm_cmpeq_epi8(data, _mm_set1_epi8(value));
+	}
+
+	inline __m128i MatchRange(__m128i data, char lower, char upper)
+	{
+		// Unsigned (data - lower) <= (upper - lower)
+		__m128i offset = _mm_sub_epi8(data, _mm_set1_epi8(lower));
+
+		return _mm_cmpeq_epi8(_mm_subs_epu8(offset, _mm_set1_epi8(char(upper - lower))), _mm_setzero_si128());
+	}
+
+	__m128i BlankClass::Match(__m128i data)
+	{
+		return _mm_andnot_si128(_mm_or_si128(MatchByte(data, '\r'), MatchByte(data, '\n')), MatchRange(data, 1, ' '));
+	}
+
+	__m128i LineCommentClass::Match(__m128i data)
+	{
+		return _mm_andnot_si128(_mm_or_si128(MatchByte(data, '\n'), MatchByte(data, '\0')), _mm_set1_epi8(-1));
+	}
+
+	__m128i BlockCommentClass::Match(__m128i data)
+	{
+		__m128i special = _mm_or_si128(_mm_or_si128(MatchByte(data, '*'), MatchByte(data, '/')), MatchByte(data, '\"'));
+
+		special = _mm_or_si128(special, _mm_or_si128(_mm_or_si128(MatchByte(data, '\r'), MatchByte(data, '\n')), MatchByte(data, '\0')));
+
+		return _mm_andnot_si128(special, _mm_set1_epi8(-1));
+	}
+
+	__m128i SymbolClass::Match(__m128i data)
+	{
+		__m128i letter = MatchRange(_mm_or_si128(data, _mm_set1_epi8(0x20)), 'a', 'z');
+		__m128i extended = _mm_cmplt_epi8(data, _mm_setzero_si128());
+
+		return _mm_or_si128(_mm_or_si128(letter, extended), _mm_or_si128(MatchRange(data, '0', '9'), MatchByte(data, '_')));
+	}
+
+	__m128i DigitClass::Match(__m128i data)
+	{
+		return MatchRange(data, '0', '9');
+	}
+
+	inline unsigned CountTrailingZeros(unsigned value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, value);
+		return index;
+#else
+		return __builtin_ctz(value);
+#endif
+	}
+#endif
+
+	// Returns the first position at or after 'pos' with a character outside of the class
+	template<typename Class, bool vectorized>
+	inline const char* Skip(const char *pos)
+	{
+#if !defined(NULLC_NO_SIMD_LEXER)
+		if(vectorized)
+		{
+			// Most runs are short and are scanned faster one character at a time
+			for(unsigned i = 0; i < 8; i++, pos++)
+			{
+				if(!Class::Test(*pos))
+					return pos;
+			}
+
+			// Aligned loads never cross a page boundary, so the block with the terminating zero can be read whole
+			const char *block = (const char*)(uintptr_t(pos) & ~uintptr_t(15));
+
+			unsigned mask = ~_mm_movemask_epi8(Class::Match(_mm_load_si128((const __m128i*)block))) & 0xffffu & (~0u << unsigned(pos - block));
+
+			while(!mask)
+			{
+				block += 16;
+
+				mask = ~_mm_movemask_epi8(Class::Match(_mm_load_si128((const __m128i*)block))) & 0xffffu;
+			}
+
+			return block + CountTrailingZeros(mask);
+		}
+#endif
+
+		while(Class::Test(*pos))
+			pos++;
+
+		return pos;
+	}
+}
+
 Lexer::Lexer(Allocator *allocator): lexems(allocator)
 {
 }
@@ -13,6 +286,17 @@ void Lexer::Clear(unsigned count)
 }
 
 void Lexer::Lexify(const char* code)
+{
+	LexifyImpl<true>(code);
+}
+
+void Lexer::LexifyScalar(const char* code)
+{
+	LexifyImpl<false>(code);
+}
+
+template<bool vectorized>
+void Lexer::LexifyImpl(const char* code)
 {
 	lexems.reserve(2048);
 
@@ -45,9 +329,7 @@ void Lexer::Lexify(const char* code)
 			continue;
 		case ' ':
 		case '\t':
-			code++;
-			while((unsigned char)(code[0] - 1) < ' ' && *code != '\r' && *code != '\n')
-				code++;
+			code = Skip<BlankClass, vectorized>(code + 1);
 			continue;
 		case '\"':
 			lType = lex_quotedstring;
@@ -181,8 +463,7 @@ void Lexer::Lexify(const char* code)
 				lType = lex_divset;
 				lLength = 2;
 			}else if(code[1] == '/'){
-				while(code[0] != '\n' && code[0] != '\0')
-					code++;
+				code = Skip<LineCommentClass, vectorized>(code);
 				continue;
 			}else if(code[1] == '*'){
 				code += 2;
@@ -254,7 +535,7 @@ void Lexer::Lexify(const char* code)
 					}
 					else
 					{
-						code++;
+						code = Skip<BlockCommentClass, vectorized>(code + 1);
 					}
 				}
 				continue;
@@ -396,120 +677,23 @@ void Lexer::Lexify(const char* code)
 					while(isDigit(*pos) || ((*pos & ~0x20) >= 'A' && (*pos & ~0x20) <= 'F'))
 						pos++;
 				}else{
-					while(isDigit(*pos))
-						pos++;
+					pos = Skip<DigitClass, vectorized>(pos);
 				}
 				if(*pos == '.')
-					pos++;
-				while(isDigit(*pos))
-					pos++;
+					pos = Skip<DigitClass, vectorized>(pos + 1);
 				if(*pos == 'e')
 				{
 					pos++;
 					if(*pos == '-')
 						pos++;
 				}
-				while(isDigit(*pos))
-					pos++;
+				pos = Skip<DigitClass, vectorized>(pos);
 				lLength = (int)(pos - code);
 			}else if(chartype_table[(unsigned char)*code] & ct_start_symbol){
-				const char *pos = code;
-				while(chartype_table[(unsigned char)*pos] & ct_symbol)
-					pos++;
+				const char *pos = Skip<SymbolClass, vectorized>(code + 1);
 				lLength = (int)(pos - code);
 
-				if(!(chartype_table[(unsigned char)*pos] & ct_symbol))
-				{
-					switch(lLength)
-					{
-					case 2:
-						if(memcmp(code, "if", 2) == 0)
-							lType = lex_if;
-						else if(memcmp(code, "in", 2) == 0)
-							lType = lex_in;
-						else if(memcmp(code, "do", 2) == 0)
-							lType = lex_do;
-						break;
-					case 3:
-						if(memcmp(code, "for", 3) == 0)
-							lType = lex_for;
-						else if(memcmp(code, "ref", 3) == 0)
-							lType = lex_ref;
-						else if(memcmp(code, "new", 3) == 0)
-							lType = lex_new;
-						break;
-					case 4:
-						if(memcmp(code, "case", 4) == 0)
-							lType = lex_case;
-						else if(memcmp(code, "else", 4) == 0)
-							lType = lex_else;
-						else if(memcmp(code, "auto", 4) == 0)
-							lType = lex_auto;
-						else if(memcmp(code, "true", 4) == 0)
-							lType = lex_true;
-						else if(memcmp(code, "enum", 4) == 0)
-							lType = lex_enum;
-						else if(memcmp(code, "with", 4) == 0)
-							lType = lex_with;
-						break;
-					case 5:
-						if(memcmp(code, "while", 5) == 0)
-							lType = lex_while;
-						else if(memcmp(code, "break", 5) == 0)
-							lType = lex_break;
-						else if(memcmp(code, "class", 5) == 0)
-							lType = lex_class;
-						else if(memcmp(code, "align", 5) == 0)
-							lType = lex_align;
-						else if(memcmp(code, "yield", 5) == 0)
-							lType = lex_yield;
-						else if(memcmp(code, "const", 5) == 0)
-							lType = lex_const;
-						else if(memcmp(code, "false", 5) == 0)
-							lType = lex_false;
-						break;
-					case 6:
-						if(memcmp(code, "switch", 6) == 0)
-							lType = lex_switch;
-						else if(memcmp(code, "return", 6) == 0)
-							lType = lex_return;
-						else if(memcmp(code, "typeof", 6) == 0)
-							lType = lex_typeof;
-						else if(memcmp(code, "sizeof", 6) == 0)
-							lType = lex_sizeof;
-						else if(memcmp(code, "import", 6) == 0)
-							lType = lex_import;
-						break;
-					case 7:
-						if(memcmp(code, "noalign", 7) == 0)
-							lType = lex_noalign;
-						else if(memcmp(code, "default", 7) == 0)
-							lType = lex_default;
-						else if(memcmp(code, "typedef", 7) == 0)
-							lType = lex_typedef;
-						else if(memcmp(code, "nullptr", 7) == 0)
-							lType = lex_nullptr;
-						else if(memcmp(code, "generic", 7) == 0)
-							lType = lex_generic;
-						break;
-					case 8:
-						if(memcmp(code, "continue", 8) == 0)
-							lType = lex_continue;
-						else if(memcmp(code, "operator", 8) == 0)
-							lType = lex_operator;
-						break;
-					case 9:
-						if(memcmp(code, "coroutine", 9) == 0)
-							lType = lex_coroutine;
-						else if(memcmp(code, "namespace", 9) == 0)
-							lType = lex_namespace;
-						break;
-					case 10:
-						if(memcmp(code, "extendable", 10) == 0)
-							lType = lex_extendable;
-						break;
-					}
-				}
+				lType = GetKeywordType(code, lLength);
 
 				if(lType == lex_none)
 					lType = lex_string;
@@ -77,12 +77,19 @@ public:
 
 	void			Clear(unsigned count);
 	void			Lexify(const char* code);
+
+	// Lexes the code without vectorized scanning, produces the same stream as Lexify
+	void			LexifyScalar(const char* code);
+
 	void			Append(Lexeme* stream, unsigned count);
 
 	Lexeme*			GetStreamStart();
 	unsigned int	GetStreamSize();
 
 private:
+	template<bool vectorized>
+	void			LexifyImpl(const char* code);
+
 	SmallArray<Lexeme, 32>	lexems;
 
 	unsigned line;
@@ -37,6 +37,40 @@ namespace NULLC
 
 		return size;
 	}
+
+	template<typename T>
+	void CopyArrayData(FastVector<T> &target, const FastVector<T> &source)
+	{
+		target.clear();
+
+		if(source.count)
+			target.push_back(source.data, source.count);
+	}
+
+	// Array refers to the source storage, it can't be modified until it's detached
+	template<typename T>
+	void ShareArrayData(FastVector<T> &target, const FastVector<T> &source)
+	{
+		target.reset();
+
+		target.data = source.data;
+		target.count = source.count;
+		target.max = source.count;
+	}
+
+	template<typename T>
+	void DetachArrayData(FastVector<T> &target, bool copyData)
+	{
+		T *data = target.data;
+		unsigned count = target.count;
+
+		target.data = NULL;
+		target.count = 0;
+		target.max = 0;
+
+		if(copyData && count)
+			target.push_back(data, count);
+	}
 }
 
 Linker::Linker(): exTypes(128), exTypeExtra(256), exTypeConstants(256), exVariables(128), exFunctions(256), exLocals(1024), exSymbols(8192), regVmJumpTargets(1024)
@@ -46,6 +80,10 @@ Linker::Linker(): exTypes(128), exTypeExtra(256), exTypeConstants(256), exVariab
 	typeMap.init();
 	funcMap.init();
 
+	codeShared = false;
+
+	keepRootBytecode = false;
+
 	debugOutputIndent = 0;
 
 	NULLC::SetLinker(this);
@@ -58,6 +96,9 @@ Linker::~Linker()
 
 void Linker::CleanCode()
 {
+	if(codeShared)
+		DetachSharedCode(false);
+
 	exTypes.clear();
 	exTypeExtra.clear();
 	exTypeConstants.clear();
@@ -72,6 +113,9 @@ void Linker::CleanCode()
 	exImportPaths.clear();
 	exMainModuleName.clear();
 
+	exRootBytecode.clear();
+	exModulePaths.clear();
+
 	exRegVmCode.clear();
 	exRegVmSourceInfo.clear();
 	exRegVmExecCount.clear();
@@ -108,17 +152,199 @@ void Linker::CleanCode()
 	funcRemap.clear();
 	moduleRemap.clear();
 
+	duplicateCode.clear();
+	codeRemap.clear();
+
 	funcMap.clear();
 
 	debugOutputIndent = 0;
+}
+
+void Linker::CopyCode(const Linker &source)
+{
+	TRACE_SCOPE("link", "CopyCode");
+
+	using namespace NULLC;
+
+	CleanCode();
+
+	linkError[0] = 0;
+
+	CopyArrayData(exTypes, source.exTypes);
+	CopyArrayData(exTypeExtra, source.exTypeExtra);
+	CopyArrayData(exTypeConstants, source.exTypeConstants);
+	CopyArrayData(exVariables, source.exVariables);
+	CopyArrayData(exFunctions, source.exFunctions);
+	CopyArrayData(exFunctionExplicitTypeArrayOffsets, source.exFunctionExplicitTypeArrayOffsets);
+	CopyArrayData(exFunctionExplicitTypes, source.exFunctionExplicitTypes);
+	CopyArrayData(exLocals, source.exLocals);
+	CopyArrayData(exModules, source.exModules);
+	CopyArrayData(exSymbols, source.exSymbols);
+	CopyArrayData(exSource, source.exSource);
+	CopyArrayData(exImportPaths, source.exImportPaths);
+	CopyArrayData(exMainModuleName, source.exMainModuleName);
+
+	CopyArrayData(exRootBytecode, source.exRootBytecode);
+	CopyArrayData(exModulePaths, source.exModulePaths);
+
+	CopyArrayData(exRegVmCode, source.exRegVmCode);
+	CopyArrayData(exRegVmSourceInfo, source.exRegVmSourceInfo);
+	CopyArrayData(exRegVmConstants, source.exRegVmConstants);
+	CopyArrayData(exRegVmRegKillInfo, source.exRegVmRegKillInfo);
+
+	// Execution counters are not shared
+	exRegVmExecCount.resize(exRegVmCode.size());
+	memset(exRegVmExecCount.data, 0, exRegVmExecCount.size() * sizeof(unsigned));
+
+	CopyArrayData(regVmJumpTargets, source.regVmJumpTargets);
+
+#ifdef NULLC_LLVM_SUPPORT
+	CopyArrayData(llvmModuleSizes, source.llvmModuleSizes);
+	CopyArrayData(llvmModuleCodes, source.llvmModuleCodes);
+
+	CopyArrayData(llvmTypeRemapSizes, source.llvmTypeRemapSizes);
+	CopyArrayData(llvmTypeRemapOffsets, source.llvmTypeRemapOffsets);
+	CopyArrayData(llvmTypeRemapValues, source.llvmTypeRemapValues);
+
+	CopyArrayData(llvmFuncRemapSizes, source.llvmFuncRemapSizes);
+	CopyArrayData(llvmFuncRemapOffsets, source.llvmFuncRemapOffsets);
+	CopyArrayData(llvmFuncRemapValues, source.llvmFuncRemapValues);
+#endif
+
+	globalVarSize = source.globalVarSize;
+
+	// Lookup tables are rebuilt for the code that is linked later
+	typeMap.clear();
+	for(unsigned i = 0; i < exTypes.size(); i++)
+		typeMap.insert(exTypes[i].nameHash, i);
+
+	for(unsigned i = 0; i < exFunctions.size(); i++)
+		funcMap.insert(exFunctions[i].nameHash, i);
+}
+
+void Linker::ShareCode(const Linker &source)
+{
+	TRACE_SCOPE("link", "ShareCode");
+
+	using namespace NULLC;
+
+	CleanCode();
+
+	linkError[0] = 0;
+
+	ShareArrayData(exTypes, source.exTypes);
+	ShareArrayData(exTypeExtra, source.exTypeExtra);
+	ShareArrayData(exTypeConstants, source.exTypeConstants);
+	ShareArrayData(exVariables, source.exVariables);
+	ShareArrayData(exFunctionExplicitTypeArrayOffsets, source.exFunctionExplicitTypeArrayOffsets);
+	ShareArrayData(exFunctionExplicitTypes, source.exFunctionExplicitTypes);
+	ShareArrayData(exLocals, source.exLocals);
+	ShareArrayData(exModules, source.exModules);
+	ShareArrayData(exSymbols, source.exSymbols);
+	ShareArrayData(exSource, source.exSource);
+	ShareArrayData(exImportPaths, source.exImportPaths);
+	ShareArrayData(exMainModuleName, source.exMainModuleName);
+
+	ShareArrayData(exRootBytecode, source.exRootBytecode);
+	ShareArrayData(exModulePaths, source.exModulePaths);
+
+	ShareArrayData(exRegVmCode, source.exRegVmCode);
+	ShareArrayData(exRegVmSourceInfo, source.exRegVmSourceInfo);
+	ShareArrayData(exRegVmConstants, source.exRegVmConstants);
+	ShareArrayData(exRegVmRegKillInfo, source.exRegVmRegKillInfo);
+
+	ShareArrayData(regVmJumpTargets, source.regVmJumpTargets);
+
+#ifdef NULLC_LLVM_SUPPORT
+	ShareArrayData(llvmModuleSizes, source.llvmModuleSizes);
+	ShareArrayData(llvmModuleCodes, source.llvmModuleCodes);
+
+	ShareArrayData(llvmTypeRemapSizes, source.llvmTypeRemapSizes);
+	ShareArrayData(llvmTypeRemapOffsets, source.llvmTypeRemapOffsets);
+	ShareArrayData(llvmTypeRemapValues, source.llvmTypeRemapValues);
+
+	ShareArrayData(llvmFuncRemapSizes, source.llvmFuncRemapSizes);
+	ShareArrayData(llvmFuncRemapOffsets, source.llvmFuncRemapOffsets);
+	ShareArrayData(llvmFuncRemapValues, source.llvmFuncRemapValues);
+#endif
+
+	// Functions are redirected by the context and execution counters are not shared
+	CopyArrayData(exFunctions, source.exFunctions);
+
+	exRegVmExecCount.resize(exRegVmCode.size());
+	memset(exRegVmExecCount.data, 0, exRegVmExecCount.size() * sizeof(unsigned));
+
+	globalVarSize = source.globalVarSize;
+
+	// Lookup tables are built when the code is unshared to link more code
+	codeShared = true;
+}
+
+void Linker::UnshareCode()
+{
+	TRACE_SCOPE("link", "UnshareCode");
+
+	if(!codeShared)
+		return;
 
-	NULLC::ClearMemory();
+	// Source storage is kept alive by the owner of the shared code while the code that refers to it is running
+	DetachSharedCode(true);
+
+	funcMap.clear();
+	for(unsigned i = 0; i < exFunctions.size(); i++)
+		funcMap.insert(exFunctions[i].nameHash, i);
+}
+
+void Linker::DetachSharedCode(bool copyData)
+{
+	using namespace NULLC;
+
+	DetachArrayData(exTypes, copyData);
+	DetachArrayData(exTypeExtra, copyData);
+	DetachArrayData(exTypeConstants, copyData);
+	DetachArrayData(exVariables, copyData);
+	DetachArrayData(exFunctionExplicitTypeArrayOffsets, copyData);
+	DetachArrayData(exFunctionExplicitTypes, copyData);
+	DetachArrayData(exLocals, copyData);
+	DetachArrayData(exModules, copyData);
+	DetachArrayData(exSymbols, copyData);
+	DetachArrayData(exSource, copyData);
+	DetachArrayData(exImportPaths, copyData);
+	DetachArrayData(exMainModuleName, copyData);
+
+	DetachArrayData(exRootBytecode, copyData);
+	DetachArrayData(exModulePaths, copyData);
+
+	DetachArrayData(exRegVmCode, copyData);
+	DetachArrayData(exRegVmSourceInfo, copyData);
+	DetachArrayData(exRegVmConstants, copyData);
+	DetachArrayData(exRegVmRegKillInfo, copyData);
+
+	DetachArrayData(regVmJumpTargets, copyData);
+
+#ifdef NULLC_LLVM_SUPPORT
+	DetachArrayData(llvmModuleSizes, copyData);
+	DetachArrayData(llvmModuleCodes, copyData);
+
+	DetachArrayData(llvmTypeRemapSizes, copyData);
+	DetachArrayData(llvmTypeRemapOffsets, copyData);
+	DetachArrayData(llvmTypeRemapValues, copyData);
+
+	DetachArrayData(llvmFuncRemapSizes, copyData);
+	DetachArrayData(llvmFuncRemapOffsets, copyData);
+	DetachArrayData(llvmFuncRemapValues, copyData);
+#endif
+
+	codeShared = false;
 }
 
 bool Linker::LinkCode(const char *code, const char *moduleName, bool rootModule)
 {
 	TRACE_SCOPE("link", "LinkCode");
 
+	// New code is appended to the tables
+	UnshareCode();
+
 	linkError[0] = 0;
 
 #ifdef VERBOSE_DEBUG_OUTPUT
@@ -211,6 +437,7 @@ bool Linker::LinkCode(const char *code, const char *moduleName, bool rootModule)
 			}
 
 			exModules.push_back(*mInfo);
+			exModulePaths.push_back(path, unsigned(strlen(path)) + 1);
 			exModules.back().nameOffset = 0;
 			exModules.back().nameHash = NULLC::GetStringHash(path);
 			exModules.back().funcStart = exFunctions.size() - mInfo->funcCount;
@@ -530,6 +757,10 @@ bool Linker::LinkCode(const char *code, const char *moduleName, bool rootModule)
 	// Add new functions
 	ExternVarInfo *explicitInfo = FindFirstVar(bCode) + bCode->variableCount;
 
+	unsigned int oldJumpTargetCount = regVmJumpTargets.size();
+
+	duplicateCode.clear();
+
 	ExternFuncInfo *fInfo = FindFirstFunc(bCode);
 
 	for(unsigned i = 0; i < bCode->functionCount - bCode->moduleFunctionCount; i++, fInfo++)
@@ -581,8 +812,15 @@ bool Linker::LinkCode(const char *code, const char *moduleName, bool rootModule)
 		if(index != index_none)
 		{
 			// It is allowed for generic base function and generic function instances
+			// Function table entry of a duplicate instance is pointed at the first definition and the duplicate body is removed from the module code
 			if(fInfo->isGenericInstance || fInfo->funcType == 0)
 			{
+				if(fInfo->isGenericInstance && fInfo->regVmAddress != -1 && fInfo->regVmCodeSize > 0)
+				{
+					duplicateCode.push_back(fInfo->regVmAddress);
+					duplicateCode.push_back(fInfo->regVmCodeSize);
+				}
+
 				exFunctions.push_back(exFunctions[index]);
 				funcMap.insert(exFunctions.back().nameHash, exFunctions.size()-1);
 
@@ -671,6 +909,9 @@ bool Linker::LinkCode(const char *code, const char *moduleName, bool rootModule)
 		exLocals[i].offsetToName += oldSymbolSize;
 	}
 
+	if(!duplicateCode.empty())
+		RemoveDuplicateCode(oldRegVmCodeSize, oldRegVmSourceInfoSize, oldRegVmRegKillInfoSize, oldFunctionCount, oldJumpTargetCount);
+
 	assert((fInfo = FindFirstFunc(bCode)) != NULL); // this is fine, we need this assignment only in debug configuration
 
 	// Fix register VM command arguments
@@ -820,6 +1061,9 @@ bool Linker::LinkCode(const char *code, const char *moduleName, bool rootModule)
 		exMainModuleName.push_back(moduleName, (unsigned)strlen(moduleName));
 	}
 
+	if(rootModule && keepRootBytecode)
+		exRootBytecode.push_back(code, bCode->size);
+
 #ifdef NULLC_LLVM_SUPPORT
 	unsigned llvmOldSize = llvmModuleCodes.size();
 	llvmModuleSizes.push_back(bCode->llvmSize);
@@ -1083,6 +1327,101 @@ const char*	Linker::GetLinkError()
 	return linkError;
 }
 
+void Linker::RemoveDuplicateCode(unsigned codeStart, unsigned sourceInfoStart, unsigned regKillInfoStart, unsigned functionStart, unsigned jumpTargetStart)
+{
+	TRACE_SCOPE("link", "RemoveDuplicateCode");
+
+	unsigned moduleCodeSize = exRegVmCode.size() - codeStart;
+
+	// Removed instructions are marked first, then every instruction gets its new position
+	codeRemap.resize(moduleCodeSize + 1);
+	memset(codeRemap.data, 0, codeRemap.size() * sizeof(codeRemap[0]));
+
+	for(unsigned i = 0; i < duplicateCode.size(); i += 2)
+	{
+		for(unsigned k = duplicateCode[i]; k < duplicateCode[i] + duplicateCode[i + 1]; k++)
+			codeRemap[k] = ~0u;
+	}
+
+	unsigned codeSize = 0;
+	unsigned regKillInfoSize = 0;
+
+	unsigned regKillInfoPos = regKillInfoStart;
+
+	for(unsigned i = 0; i < moduleCodeSize; i++)
+	{
+		unsigned counts = exRegVmRegKillInfo[regKillInfoPos];
+		unsigned regKillInfoCount = 1 + (counts >> 4) + (counts & 0xf);
+
+		if(codeRemap[i] == ~0u)
+		{
+			// Position of a removed instruction is the position of the next instruction that is kept
+			codeRemap[i] = codeSize;
+
+			regKillInfoPos += regKillInfoCount;
+			continue;
+		}
+
+		codeRemap[i] = codeSize;
+
+		exRegVmCode[codeStart + codeSize] = exRegVmCode[codeStart + i];
+
+		memmove(&exRegVmRegKillInfo[regKillInfoStart + regKillInfoSize], &exRegVmRegKillInfo[regKillInfoPos], regKillInfoCount);
+
+		codeSize++;
+		regKillInfoSize += regKillInfoCount;
+
+		regKillInfoPos += regKillInfoCount;
+	}
+
+	codeRemap[moduleCodeSize] = codeSize;
+
+	exRegVmCode.shrink(codeStart + codeSize);
+	exRegVmExecCount.shrink(codeStart + codeSize);
+	exRegVmRegKillInfo.shrink(regKillInfoStart + regKillInfoSize);
+
+	// Jump targets are still relative to the module code
+	for(unsigned i = codeStart; i < exRegVmCode.size(); i++)
+	{
+		RegVmCmd &cmd = exRegVmCode[i];
+
+		if(cmd.code == rviJmp || cmd.code == rviJmpz || cmd.code == rviJmpnz)
+			cmd.argument = codeRemap[cmd.argument];
+	}
+
+	// Location of a removed instruction is kept when it describes the next instruction that is kept
+	unsigned sourceInfoSize = sourceInfoStart;
+
+	for(unsigned i = sourceInfoStart; i < exRegVmSourceInfo.size(); i++)
+	{
+		ExternSourceInfo sourceInfo = exRegVmSourceInfo[i];
+
+		sourceInfo.instruction = codeStart + codeRemap[sourceInfo.instruction - codeStart];
+
+		if(sourceInfoSize != sourceInfoStart && exRegVmSourceInfo[sourceInfoSize - 1].instruction == sourceInfo.instruction)
+			sourceInfoSize--;
+
+		exRegVmSourceInfo[sourceInfoSize++] = sourceInfo;
+	}
+
+	exRegVmSourceInfo.shrink(sourceInfoSize);
+
+	// Function addresses and jump targets added by this module are already moved to the linked code
+	for(unsigned i = functionStart; i < exFunctions.size(); i++)
+	{
+		ExternFuncInfo &function = exFunctions[i];
+
+		if(function.regVmAddress != -1 && unsigned(function.regVmAddress) >= codeStart)
+			function.regVmAddress = codeStart + codeRemap[function.regVmAddress - codeStart];
+	}
+
+	for(unsigned i = jumpTargetStart; i < regVmJumpTargets.size(); i++)
+	{
+		if(regVmJumpTargets[i] >= codeStart)
+			regVmJumpTargets[i] = codeStart + codeRemap[regVmJumpTargets[i] - codeStart];
+	}
+}
+
 void Linker::FixupCallMicrocode(unsigned microcode, unsigned oldGlobalSize)
 {
 	while(exRegVmConstants[microcode] != rvmiCall)
@@ -18,6 +18,9 @@ public:
 
 	void	CleanCode();
 	bool	LinkCode(const char *bytecode, const char *moduleName, bool rootModule);
+	void	CopyCode(const Linker &source);
+	void	ShareCode(const Linker &source);
+	void	UnshareCode();
 	bool	SaveRegVmListing(OutputContext &output, bool withProfileInfo);
 
 	void	CollectDebugInfo(FastVector<unsigned char*> *instAddress);
@@ -42,6 +45,10 @@ public:
 	FastVector<char>				exImportPaths;
 	FastVector<char>				exMainModuleName;
 
+	// Bytecode of root modules and paths of imported modules in the order they were linked, snapshots relink the program from them
+	FastVector<char>				exRootBytecode;
+	FastVector<char>				exModulePaths;
+
 	FastVector<RegVmCmd>			exRegVmCode;
 	FastVector<ExternSourceInfo>	exRegVmSourceInfo;
 	FastVector<unsigned int>		exRegVmExecCount;
@@ -73,10 +80,25 @@ public:
 	FastVector<unsigned int>	funcRemap;
 	FastVector<unsigned int>	moduleRemap;
 
+	// Module code ranges of duplicate generic function instances and the new module code positions after they are removed
+	FastVector<unsigned int>	duplicateCode;
+	FastVector<unsigned int>	codeRemap;
+
 	HashMap<unsigned int>		typeMap;
 	HashMap<unsigned int>		funcMap;
 
 	FastVector<unsigned char>	fullLinkerData;
 
+	// Read-only tables and code refer to the storage of a linker that outlives this one
+	bool	codeShared;
+
+	// Root module bytecode is copied for snapshots
+	bool	keepRootBytecode;
+
 	unsigned debugOutputIndent;
+
+private:
+	void	DetachSharedCode(bool copyData);
+
+	void	RemoveDuplicateCode(unsigned codeStart, unsigned sourceInfoStart, unsigned regKillInfoStart, unsigned functionStart, unsigned jumpTargetStart);
 };
@@ -12,6 +12,8 @@
 
 void AddErrorLocationInfo(const char *codeStart, const char *errorPos, char *errorBuf, unsigned errorBufSize);
 
+ChunkedStackPool<65532>::ChunkCache compilerChunkCache;
+
 namespace
 {
 	void ReportAt(ParseContext &ctx, Lexeme *begin, Lexeme *end, const char *pos, const char *msg, va_list args)
@@ -3029,7 +3031,7 @@ const char* GetBytecodeFromPath(ParseContext &ctx, Lexeme *start, IntrusiveList<
 		const char *messageStart = ctx.errorBufLocation;
 
 		// Separate allocator for each module
-		ChunkedStackPool<65532> pool;
+		ChunkedStackPool<65532> pool(&compilerChunkCache);
 		GrowingAllocatorRef<ChunkedStackPool<65532>, 16384> allocator(pool);
 
 		ctx.statistics.Finish("Extra", NULLCTime::clockMicro());
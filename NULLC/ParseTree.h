@@ -5,6 +5,7 @@
 #include "Allocator.h"
 #include "Array.h"
 #include "DenseMap.h"
+#include "Pool.h"
 #include "Statistics.h"
 
 struct CompilerContext;
@@ -1163,3 +1164,6 @@ const char* GetOpName(SynBinaryOpType type);
 const char* GetOpName(SynModifyAssignType type);
 
 InplaceStr GetModuleName(Allocator *allocator, const char *moduleRoot, IntrusiveList<SynIdentifier> parts);
+
+// Chunks released by the compiler allocators are kept for reuse by the following module compilations, access is serialized by the lock set in nullcInit
+extern ChunkedStackPool<65532>::ChunkCache compilerChunkCache;
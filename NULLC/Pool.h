@@ -5,8 +5,139 @@
 template<int chunkSize>
 class ChunkedStackPool
 {
+	struct StackChunk
+	{
+		StackChunk *next;
+		char		data[chunkSize];
+	};
 public:
-	ChunkedStackPool()
+	// Chunks released by the pools that share a cache are kept for reuse until the retained size reaches the limit
+	class ChunkCache
+	{
+	public:
+		ChunkCache()
+		{
+			chunks = NULL;
+			retained = 0;
+			limit = ~0u;
+
+			lock = NULL;
+			unlock = NULL;
+		}
+		~ChunkCache()
+		{
+			Reset();
+		}
+
+		// Pools on different threads can share the cache when access to it is serialized by the lock functions
+		void SetLock(void (*lockFunc)(), void (*unlockFunc)())
+		{
+			lock = lockFunc;
+			unlock = unlockFunc;
+		}
+
+		void Reset()
+		{
+			Lock();
+
+			while(chunks)
+			{
+				StackChunk *next = chunks->next;
+				NULLC::dealloc(chunks);
+				chunks = next;
+			}
+			retained = 0;
+
+			Unlock();
+		}
+
+		void SetLimit(unsigned bytes)
+		{
+			Lock();
+
+			limit = bytes;
+
+			while(chunks && retained > limit)
+			{
+				StackChunk *next = chunks->next;
+				NULLC::dealloc(chunks);
+				chunks = next;
+
+				retained -= chunkSize;
+			}
+
+			Unlock();
+		}
+
+		unsigned GetSize()
+		{
+			Lock();
+
+			unsigned size = retained;
+
+			Unlock();
+
+			return size;
+		}
+
+		StackChunk* Take()
+		{
+			Lock();
+
+			StackChunk *chunk = chunks;
+
+			if(chunk)
+			{
+				chunks = chunk->next;
+				retained -= chunkSize;
+			}
+
+			Unlock();
+
+			return chunk;
+		}
+
+		void Put(StackChunk *chunk)
+		{
+			Lock();
+
+			if(limit < chunkSize || retained > limit - chunkSize)
+			{
+				Unlock();
+
+				NULLC::dealloc(chunk);
+				return;
+			}
+
+			chunk->next = chunks;
+			chunks = chunk;
+			retained += chunkSize;
+
+			Unlock();
+		}
+
+	private:
+		void Lock()
+		{
+			if(lock)
+				lock();
+		}
+
+		void Unlock()
+		{
+			if(unlock)
+				unlock();
+		}
+
+		StackChunk *chunks;
+		unsigned retained;
+		unsigned limit;
+
+		void (*lock)();
+		void (*unlock)();
+	};
+
+	ChunkedStackPool(ChunkCache *cache = NULL): cache(cache)
 	{
 		curr = first = NULL;
 		size = chunkSize;
@@ -21,7 +152,7 @@ public:
 		while(first)
 		{
 			StackChunk *next = first->next;
-			NULLC::dealloc(first);
+			ReleaseChunk(first);
 			first = next;
 		}
 		curr = first = NULL;
@@ -30,6 +161,16 @@ public:
 
 	void	Clear()
 	{
+		// Pool keeps a single chunk, the rest are returned to the cache to be shared with other pools
+		if(cache && first)
+		{
+			while(StackChunk *next = first->next)
+			{
+				first->next = next->next;
+				cache->Put(next);
+			}
+		}
+
 		curr = first;
 		size = first ? 0 : chunkSize;
 	}
@@ -66,11 +207,11 @@ public:
 		}
 		if(curr)
 		{
-			curr->next = new(NULLC::alloc(sizeof(StackChunk))) StackChunk;
+			curr->next = AllocateChunk();
 			curr = curr->next;
 			curr->next = NULL;
 		}else{
-			curr = first = new(NULLC::alloc(sizeof(StackChunk))) StackChunk;
+			curr = first = AllocateChunk();
 			curr->next = NULL;
 		}
 		size = bytes;
@@ -89,11 +230,24 @@ public:
 		return wholeSize + size;
 	}
 private:
-	struct StackChunk
+	StackChunk* AllocateChunk()
 	{
-		StackChunk *next;
-		char		data[chunkSize];
-	};
+		if(StackChunk *chunk = cache ? cache->Take() : NULL)
+			return chunk;
+
+		return new(NULLC::alloc(sizeof(StackChunk))) StackChunk;
+	}
+
+	void ReleaseChunk(StackChunk *chunk)
+	{
+		if(cache)
+			cache->Put(chunk);
+		else
+			NULLC::dealloc(chunk);
+	}
+
+	ChunkCache	*cache;
+
 	StackChunk	*first, *curr;
 	unsigned int size;
 };
@@ -0,0 +1,656 @@
+#include "Snapshot.h"
+
+#include "nullc.h"
+#include "BinaryCache.h"
+#include "Bytecode.h"
+#include "DenseMap.h"
+#include "Linker.h"
+#include "StdLib.h"
+#include "StrAlgo.h"
+
+typedef uintptr_t markerType;
+
+namespace
+{
+	const uintptr_t OBJECT_ARRAY = 1 << 4;
+
+	const unsigned SNAPSHOT_MAGIC = 0x504e534e; // 'NSNP'
+	const unsigned SNAPSHOT_VERSION = 1;
+
+	// Records are aligned so that bytecode can be linked in place from a loaded or a memory-mapped file
+	const unsigned SNAPSHOT_ALIGNMENT = 16;
+
+	const unsigned SNAPSHOT_OBJECT_ARRAY = 1 << 0;
+
+	struct SnapshotHeader
+	{
+		unsigned magic;
+		unsigned version;
+		unsigned pointerSize;
+
+		// Layout of the linked program that is checked after relinking
+		unsigned typeCount;
+		unsigned functionCount;
+		unsigned globalVarSize;
+		unsigned symbolHash;
+
+		unsigned moduleCount;
+		unsigned rootCount;
+		unsigned objectCount;
+		unsigned fixupCount;
+	};
+
+	struct SnapshotObject
+	{
+		unsigned typeId;
+		unsigned flags;
+		unsigned count;
+		unsigned size;
+	};
+
+	// Pointer at 'offset' in a block that targets 'targetOffset' in another block. Block 0 is the global variable memory, object blocks follow it
+	struct SnapshotFixup
+	{
+		unsigned block;
+		unsigned offset;
+
+		unsigned targetBlock;
+		unsigned targetOffset;
+	};
+
+	struct SnapshotPointerHasher
+	{
+		unsigned operator()(char *value) const
+		{
+			return unsigned(uintptr_t(value) >> 3) * 2654435769u;
+		}
+	};
+
+	unsigned GetSymbolHash(Linker *linker)
+	{
+		return NULLC::GetStringHash(linker->exSymbols.data, linker->exSymbols.data + linker->exSymbols.size());
+	}
+
+	unsigned GetArrayPadding(const ExternTypeInfo &type)
+	{
+		return type.defaultAlign > 4 ? type.defaultAlign : 4;
+	}
+
+	unsigned GetArrayObjectSize(const ExternTypeInfo &type, unsigned count)
+	{
+		unsigned bytes = count * type.size;
+
+		return GetArrayPadding(type) + (bytes == 0 ? 4 : bytes);
+	}
+
+	void WriteRecord(FastVector<char> &result, const void *data, unsigned size)
+	{
+		result.push_back((const char*)data, size);
+
+		while(result.size() % SNAPSHOT_ALIGNMENT != 0)
+			result.push_back(0);
+	}
+
+	const char* ReadRecord(const char *&pos, const char *end, unsigned size)
+	{
+		const char *record = pos;
+
+		unsigned alignedSize = (size + SNAPSHOT_ALIGNMENT - 1) & ~(SNAPSHOT_ALIGNMENT - 1);
+
+		if(alignedSize < size || unsigned(end - pos) < alignedSize)
+			return NULL;
+
+		pos += alignedSize;
+
+		return record;
+	}
+
+	// Reads a string record and the bytecode record that follows it
+	bool ReadModuleRecord(const char *&pos, const char *end, const char *&name, const char *&bytecode)
+	{
+		const char *length = ReadRecord(pos, end, sizeof(unsigned));
+
+		if(!length)
+			return false;
+
+		unsigned nameLength;
+		memcpy(&nameLength, length, sizeof(unsigned));
+
+		name = ReadRecord(pos, end, nameLength);
+
+		if(!name || nameLength == 0 || name[nameLength - 1] != 0)
+			return false;
+
+		if(unsigned(end - pos) < sizeof(ByteCode))
+			return false;
+
+		unsigned bytecodeSize;
+		memcpy(&bytecodeSize, pos, sizeof(unsigned));
+
+		if(bytecodeSize < sizeof(ByteCode))
+			return false;
+
+		bytecode = ReadRecord(pos, end, bytecodeSize);
+
+		return bytecode != NULL;
+	}
+
+	void WriteModuleRecord(FastVector<char> &result, const char *name, const char *bytecode)
+	{
+		unsigned nameLength = unsigned(strlen(name)) + 1;
+
+		WriteRecord(result, &nameLength, sizeof(unsigned));
+		WriteRecord(result, name, nameLength);
+		WriteRecord(result, bytecode, ((ByteCode*)bytecode)->size);
+	}
+
+	bool ReadHeader(const char *&pos, const char *end, SnapshotHeader &header, const char *&error)
+	{
+		const char *record = ReadRecord(pos, end, sizeof(SnapshotHeader));
+
+		if(!record)
+		{
+			error = "ERROR: snapshot is corrupted";
+			return false;
+		}
+
+		memcpy(&header, record, sizeof(SnapshotHeader));
+
+		if(header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION)
+		{
+			error = "ERROR: file is not a snapshot or it was saved by a different version";
+			return false;
+		}
+
+		if(header.pointerSize != sizeof(void*))
+		{
+			error = "ERROR: snapshot was saved on a platform with a different pointer size";
+			return false;
+		}
+
+		return true;
+	}
+
+	// Walks the object graph the same way as the garbage collector, but records every pointer it finds as a fixup
+	struct SnapshotWriter
+	{
+		SnapshotWriter(Linker *linker, char *globals): linker(linker), globals(globals)
+		{
+			currentBlock = 0;
+
+			error = NULL;
+		}
+
+		unsigned AddObject(char *base)
+		{
+			markerType marker;
+			memcpy(&marker, base - sizeof(markerType), sizeof(markerType));
+
+			SnapshotObject object;
+
+			object.typeId = unsigned(marker >> 8);
+
+			const ExternTypeInfo &type = linker->exTypes[object.typeId];
+
+			if(marker & OBJECT_ARRAY)
+			{
+				object.flags = SNAPSHOT_OBJECT_ARRAY;
+				memcpy(&object.count, base + GetArrayPadding(type) - sizeof(unsigned), sizeof(unsigned));
+				object.size = GetArrayObjectSize(type, object.count);
+			}
+			else
+			{
+				object.flags = 0;
+				object.count = 0;
+				object.size = NULLC::GetBlockSize(base);
+			}
+
+			unsigned block = blocks.size();
+
+			blocks.push_back(base);
+			objects.push_back(object);
+
+			blockMap.insert(base, block);
+
+			return block;
+		}
+
+		void CheckPointer(char *ptr)
+		{
+			char *target;
+			memcpy(&target, ptr, sizeof(char*));
+
+			// Range of 0x00000000-0x00010000 is used by upvalue offsets inside closures
+			if(target <= (char*)0x00010000)
+				return;
+
+			SnapshotFixup fixup;
+
+			fixup.block = currentBlock;
+			fixup.offset = unsigned(ptr - blocks[currentBlock]);
+
+			if(target >= globals && target <= globals + linker->globalVarSize)
+			{
+				fixup.targetBlock = 0;
+				fixup.targetOffset = unsigned(target - globals);
+			}
+			else
+			{
+				char *base = (char*)NULLC::GetBasePointer(target);
+
+				if(!base)
+				{
+					error = "ERROR: snapshot can't contain pointers to memory that is not managed by the garbage collector";
+					return;
+				}
+
+				if(unsigned *block = blockMap.find(base))
+					fixup.targetBlock = *block;
+				else
+					fixup.targetBlock = AddObject(base);
+
+				fixup.targetOffset = unsigned(target - base);
+			}
+
+			fixups.push_back(fixup);
+		}
+
+		void CheckArrayElements(char* ptr, unsigned size, const ExternTypeInfo& elementType)
+		{
+			if(!elementType.pointerCount)
+				return;
+
+			for(unsigned i = 0; i < size; i++, ptr += elementType.size)
+				CheckVariable(ptr, elementType);
+		}
+
+		void CheckArray(char* ptr, const ExternTypeInfo& type)
+		{
+			if(type.arrSize == ~0u)
+				CheckPointer((char*)&((NULLCArray*)ptr)->ptr);
+			else
+				CheckArrayElements(ptr, type.arrSize, linker->exTypes[type.subType]);
+		}
+
+		void CheckClass(char* ptr, const ExternTypeInfo& type)
+		{
+			if(type.nameHash == objectName)
+			{
+				CheckPointer((char*)&((NULLCRef*)ptr)->ptr);
+			}
+			else if(type.nameHash == autoArrayName)
+			{
+				CheckPointer((char*)&((NULLCAutoArray*)ptr)->ptr);
+			}
+			else
+			{
+				ExternMemberInfo *memberList = type.pointerCount ? &linker->exTypeExtra[type.memberOffset + type.memberCount] : NULL;
+
+				for(unsigned n = 0; n < type.pointerCount; n++)
+					CheckVariable(ptr + memberList[n].offset, linker->exTypes[memberList[n].type]);
+			}
+		}
+
+		void CheckFunction(char* ptr)
+		{
+			NULLCFuncPtr *fPtr = (NULLCFuncPtr*)ptr;
+
+			if(!fPtr->context)
+				return;
+
+			// Context can't be restored if its type is unknown
+			if(linker->exFunctions[fPtr->id].contextType == ~0u)
+			{
+				error = "ERROR: snapshot can't contain function pointers with an untyped context";
+				return;
+			}
+
+			CheckPointer((char*)&fPtr->context);
+		}
+
+		void CheckVariable(char* ptr, const ExternTypeInfo& type)
+		{
+			const ExternTypeInfo *realType = &type;
+
+			if(type.typeFlags & ExternTypeInfo::TYPE_IS_EXTENDABLE)
+				realType = &linker->exTypes[*(int*)ptr];
+
+			if(!realType->pointerCount)
+				return;
+
+			switch(type.subCat)
+			{
+			case ExternTypeInfo::CAT_NONE:
+				break;
+			case ExternTypeInfo::CAT_ARRAY:
+				CheckArray(ptr, type);
+				break;
+			case ExternTypeInfo::CAT_POINTER:
+				CheckPointer(ptr);
+				break;
+			case ExternTypeInfo::CAT_FUNCTION:
+				CheckFunction(ptr);
+				break;
+			case ExternTypeInfo::CAT_CLASS:
+				CheckClass(ptr, *realType);
+				break;
+			}
+		}
+
+		bool Run()
+		{
+			blocks.push_back(globals);
+
+			for(unsigned i = 0; i < linker->exVariables.size() && !error; i++)
+			{
+				ExternVarInfo &variable = linker->exVariables[i];
+
+				// Compiler temporaries don't hold program state after global code has finished
+				if(strncmp(linker->exSymbols.data + variable.offsetToName, "$temp", 5) == 0)
+					continue;
+
+				CheckVariable(globals + variable.offset, linker->exTypes[variable.type]);
+			}
+
+			// Objects are added to the list as they are found
+			for(unsigned i = 1; i < blocks.size() && !error; i++)
+			{
+				currentBlock = i;
+
+				SnapshotObject object = objects[i - 1];
+
+				const ExternTypeInfo &type = linker->exTypes[object.typeId];
+
+				if(object.flags & SNAPSHOT_OBJECT_ARRAY)
+					CheckArrayElements(blocks[i] + GetArrayPadding(type), object.count, type);
+				else if(type.subCat != ExternTypeInfo::CAT_NONE)
+					CheckVariable(blocks[i], type);
+			}
+
+			return error == NULL;
+		}
+
+		Linker *linker;
+		char *globals;
+
+		FastVector<char*> blocks;
+		FastVector<SnapshotObject> objects;
+		FastVector<SnapshotFixup> fixups;
+
+		SmallDenseMap<char*, unsigned, SnapshotPointerHasher, 1024> blockMap;
+
+		unsigned currentBlock;
+
+		const char *error;
+
+		static unsigned objectName;
+		static unsigned autoArrayName;
+	};
+
+	unsigned SnapshotWriter::objectName = NULLC::GetStringHash("auto ref");
+	unsigned SnapshotWriter::autoArrayName = NULLC::GetStringHash("auto[]");
+}
+
+bool NULLC::SaveSnapshot(Linker *linker, char *globals, FastVector<char> &result, const char *&error)
+{
+	SnapshotWriter writer(linker, globals);
+
+	if(!writer.Run())
+	{
+		error = writer.error;
+		return false;
+	}
+
+	SnapshotHeader header;
+
+	header.magic = SNAPSHOT_MAGIC;
+	header.version = SNAPSHOT_VERSION;
+	header.pointerSize = sizeof(void*);
+
+	header.typeCount = linker->exTypes.size();
+	header.functionCount = linker->exFunctions.size();
+	header.globalVarSize = linker->globalVarSize;
+	header.symbolHash = GetSymbolHash(linker);
+
+	header.moduleCount = 0;
+	header.rootCount = 0;
+	header.objectCount = writer.objects.size();
+	header.fixupCount = writer.fixups.size();
+
+	for(const char *path = linker->exModulePaths.data; path < linker->exModulePaths.data + linker->exModulePaths.size(); path += strlen(path) + 1)
+		header.moduleCount++;
+
+	for(unsigned pos = 0; pos < linker->exRootBytecode.size(); pos += ((ByteCode*)&linker->exRootBytecode[pos])->size)
+		header.rootCount++;
+
+	result.clear();
+
+	WriteRecord(result, &header, sizeof(header));
+
+	// Imported modules are stored so that the snapshot can be loaded without their sources
+	for(const char *path = linker->exModulePaths.data; path < linker->exModulePaths.data + linker->exModulePaths.size(); path += strlen(path) + 1)
+	{
+		const char *bytecode = BinaryCache::FindBytecode(path, false);
+
+		if(!bytecode)
+		{
+			error = "ERROR: imported module was removed after the program was linked";
+			return false;
+		}
+
+		WriteModuleRecord(result, path, bytecode);
+	}
+
+	// Imported modules are searched relative to the main module name
+	FastVector<char> mainModuleName;
+
+	if(!linker->exMainModuleName.empty())
+		mainModuleName.push_back(linker->exMainModuleName.data, linker->exMainModuleName.size());
+
+	mainModuleName.push_back(0);
+
+	for(unsigned pos = 0; pos < linker->exRootBytecode.size(); pos += ((ByteCode*)&linker->exRootBytecode[pos])->size)
+		WriteModuleRecord(result, mainModuleName.data, &linker->exRootBytecode[pos]);
+
+	FastVector<unsigned> blockOffsets;
+
+	blockOffsets.push_back(result.size());
+	WriteRecord(result, globals, linker->globalVarSize);
+
+	WriteRecord(result, writer.objects.data, writer.objects.size() * sizeof(SnapshotObject));
+	WriteRecord(result, writer.fixups.data, writer.fixups.size() * sizeof(SnapshotFixup));
+
+	for(unsigned i = 0; i < writer.objects.size(); i++)
+	{
+		blockOffsets.push_back(result.size());
+		WriteRecord(result, writer.blocks[i + 1], writer.objects[i].size);
+	}
+
+	// Pointer values are replaced on load, clear them to keep the snapshot independent of the memory layout
+	for(unsigned i = 0; i < writer.fixups.size(); i++)
+	{
+		SnapshotFixup &fixup = writer.fixups[i];
+
+		memset(&result[blockOffsets[fixup.block] + fixup.offset], 0, sizeof(void*));
+	}
+
+	return true;
+}
+
+bool NULLC::LinkSnapshotCode(Linker *linker, const char *data, unsigned size, const char *&error)
+{
+	const char *pos = data;
+	const char *end = data + size;
+
+	SnapshotHeader header;
+
+	if(!ReadHeader(pos, end, header, error))
+		return false;
+
+	for(unsigned i = 0; i < header.moduleCount; i++)
+	{
+		const char *path = NULL;
+		const char *bytecode = NULL;
+
+		if(!ReadModuleRecord(pos, end, path, bytecode))
+		{
+			error = "ERROR: snapshot is corrupted";
+			return false;
+		}
+
+		// Modules that are already loaded (with their external function bindings) are used instead
+		if(BinaryCache::FindBytecode(path, false))
+			continue;
+
+		unsigned bytecodeSize = ((ByteCode*)bytecode)->size;
+
+		char *copy = (char*)NULLC::alloc(bytecodeSize);
+		memcpy(copy, bytecode, bytecodeSize);
+
+		BinaryCache::PutBytecode(path, copy, NULL, 0);
+	}
+
+	for(unsigned i = 0; i < header.rootCount; i++)
+	{
+		const char *moduleName = NULL;
+		const char *bytecode = NULL;
+
+		if(!ReadModuleRecord(pos, end, moduleName, bytecode))
+		{
+			error = "ERROR: snapshot is corrupted";
+			return false;
+		}
+
+		if(!linker->LinkCode(bytecode, *moduleName ? moduleName : NULL, true))
+		{
+			error = linker->GetLinkError();
+			return false;
+		}
+	}
+
+	if(linker->exTypes.size() != header.typeCount || linker->exFunctions.size() != header.functionCount || linker->globalVarSize != header.globalVarSize || GetSymbolHash(linker) != header.symbolHash)
+	{
+		error = "ERROR: program linked from the snapshot doesn't match the saved one, imported modules have changed";
+		return false;
+	}
+
+	return true;
+}
+
+bool NULLC::LoadSnapshotData(Linker *linker, char *globals, const char *data, unsigned size, const char *&error)
+{
+	const char *pos = data;
+	const char *end = data + size;
+
+	SnapshotHeader header;
+
+	if(!ReadHeader(pos, end, header, error))
+		return false;
+
+	for(unsigned i = 0; i < header.moduleCount + header.rootCount; i++)
+	{
+		const char *name = NULL;
+		const char *bytecode = NULL;
+
+		if(!ReadModuleRecord(pos, end, name, bytecode))
+		{
+			error = "ERROR: snapshot is corrupted";
+			return false;
+		}
+	}
+
+	const char *globalData = ReadRecord(pos, end, header.globalVarSize);
+
+	const char *objectData = header.objectCount < (1u << 27) ? ReadRecord(pos, end, header.objectCount * sizeof(SnapshotObject)) : NULL;
+	const char *fixupData = header.fixupCount < (1u << 27) ? ReadRecord(pos, end, header.fixupCount * sizeof(SnapshotFixup)) : NULL;
+
+	if(!globalData || !objectData || !fixupData || header.globalVarSize != linker->globalVarSize)
+	{
+		error = "ERROR: snapshot is corrupted";
+		return false;
+	}
+
+	FastVector<char*> blocks;
+	FastVector<unsigned> blockSizes;
+
+	blocks.push_back(globals);
+	blockSizes.push_back(linker->globalVarSize);
+
+	// Objects are not reachable from the program until all pointers are restored
+	NULLC::SetCollectMemory(false);
+
+	for(unsigned i = 0; i < header.objectCount; i++)
+	{
+		SnapshotObject object;
+		memcpy(&object, objectData + i * sizeof(SnapshotObject), sizeof(SnapshotObject));
+
+		const char *source = object.typeId < linker->exTypes.size() ? ReadRecord(pos, end, object.size) : NULL;
+
+		if(!source)
+		{
+			NULLC::SetCollectMemory(true);
+
+			error = "ERROR: snapshot is corrupted";
+			return false;
+		}
+
+		const ExternTypeInfo &type = linker->exTypes[object.typeId];
+
+		char *base = NULL;
+
+		if(object.flags & SNAPSHOT_OBJECT_ARRAY)
+		{
+			if(object.size != GetArrayObjectSize(type, object.count))
+			{
+				NULLC::SetCollectMemory(true);
+
+				error = "ERROR: snapshot is corrupted";
+				return false;
+			}
+
+			if(char *elements = NULLC::AllocArray(type.size, object.count, object.typeId).ptr)
+				base = elements - GetArrayPadding(type);
+		}
+		else
+		{
+			base = (char*)NULLC::AllocObject(object.size, object.typeId);
+		}
+
+		if(!base)
+		{
+			NULLC::SetCollectMemory(true);
+
+			error = "ERROR: failed to allocate memory for snapshot objects";
+			return false;
+		}
+
+		memcpy(base, source, object.size);
+
+		blocks.push_back(base);
+		blockSizes.push_back(object.size);
+	}
+
+	memcpy(globals, globalData, header.globalVarSize);
+
+	for(unsigned i = 0; i < header.fixupCount; i++)
+	{
+		SnapshotFixup fixup;
+		memcpy(&fixup, fixupData + i * sizeof(SnapshotFixup), sizeof(SnapshotFixup));
+
+		if(fixup.block >= blocks.size() || fixup.targetBlock >= blocks.size() || blockSizes[fixup.block] < sizeof(char*) || fixup.offset > blockSizes[fixup.block] - sizeof(char*) || fixup.targetOffset > blockSizes[fixup.targetBlock])
+		{
+			NULLC::SetCollectMemory(true);
+
+			error = "ERROR: snapshot is corrupted";
+			return false;
+		}
+
+		char *target = blocks[fixup.targetBlock] + fixup.targetOffset;
+
+		memcpy(blocks[fixup.block] + fixup.offset, &target, sizeof(char*));
+	}
+
+	NULLC::SetCollectMemory(true);
+
+	return true;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "stdafx.h"
+#include "Array.h"
+
+class Linker;
+
+namespace NULLC
+{
+	// Saves code linked by the linker, global variables and all garbage collected objects reachable from them
+	bool SaveSnapshot(Linker *linker, char *globals, FastVector<char> &result, const char *&error);
+
+	// Loads modules from the snapshot that are missing in the binary cache and relinks the program code
+	bool LinkSnapshotCode(Linker *linker, const char *data, unsigned size, const char *&error);
+
+	// Recreates garbage collected objects and global variables of a program that was relinked from the same snapshot
+	bool LoadSnapshotData(Linker *linker, char *globals, const char *data, unsigned size, const char *&error);
+}
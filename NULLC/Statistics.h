@@ -29,6 +29,11 @@ struct CompilerStatistics
 		timers.push_back(Timer("Logging", "logs"));
 		timers.push_back(Timer("Tracing", "trace"));
 		timers.push_back(Timer("Extra", "extra"));
+
+		memory.push_back(Counter("Parse", "parse"));
+		memory.push_back(Counter("Analyze", "analyze"));
+		memory.push_back(Counter("Ir", "ir"));
+		memory.push_back(Counter("Lowering", "lower"));
 	}
 
 	void Start(unsigned timeMicros)
@@ -57,11 +62,44 @@ struct CompilerStatistics
 		assert(!"unknown timer");
 	}
 
+	void Allocated(const char *keyName, unsigned bytes)
+	{
+		InplaceStr key = InplaceStr(keyName);
+
+		for(unsigned i = 0; i < memory.size(); i++)
+		{
+			if(memory[i].keyName == key)
+			{
+				memory[i].total += bytes;
+				return;
+			}
+		}
+
+		assert(!"unknown memory counter");
+	}
+
+	unsigned Allocated(const char *keyName)
+	{
+		InplaceStr key = InplaceStr(keyName);
+
+		for(unsigned i = 0; i < memory.size(); i++)
+		{
+			if(memory[i].keyName == key)
+				return memory[i].total;
+		}
+
+		assert(!"unknown memory counter");
+		return 0;
+	}
+
 	void Add(CompilerStatistics& other)
 	{
 		for(unsigned i = 0; i < timers.size(); i++)
 			timers[i].total += other.timers[i].total;
 
+		for(unsigned i = 0; i < memory.size(); i++)
+			memory[i].total += other.memory[i].total;
+
 		finishTime = 0;
 	}
 
@@ -98,4 +136,9 @@ struct CompilerStatistics
 	};
 
 	SmallArray<Timer, 16> timers;
+
+	// Bytes requested from the compiler allocator by each phase
+	typedef Timer Counter;
+
+	SmallArray<Counter, 4> memory;
 };
@@ -12,6 +12,8 @@
 
 #include "Executor_Common.h"
 #include "Linker.h"
+#include "Output.h"
+#include "Trace.h"
 
 #include "includes/typeinfo.h"
 
@@ -40,40 +42,31 @@ namespace
 
 namespace NULLC
 {
-	static Linker	*linker = NULL;
-	FastVector<NULLCRef>	finalizeList;
+	static NULLC_THREAD_LOCAL Linker	*linker = NULL;
 
 	static uintptr_t OBJECT_VISIBLE		= 1 << 0;
 	static uintptr_t OBJECT_FREED		= 1 << 1;
 	static uintptr_t OBJECT_FINALIZABLE	= 1 << 2;
 	static uintptr_t OBJECT_FINALIZED	= 1 << 3;
 	static uintptr_t OBJECT_ARRAY		= 1 << 4;
+	static uintptr_t OBJECT_SAMPLED		= 1 << 5;
 	static uintptr_t OBJECT_MASK		= OBJECT_VISIBLE | OBJECT_FREED;
 
-	void FinalizeObject(markerType& marker, char* base)
+	// Visible bit of marked objects has the value that was selected at the start of the last collection
+	bool IsMarked(markerType marker)
 	{
-		if(marker & NULLC::OBJECT_ARRAY)
-		{
-			ExternTypeInfo &typeInfo = NULLC::linker->exTypes[(unsigned)marker >> 8];
+		return (marker & OBJECT_VISIBLE) == GC::VisibleMark();
+	}
 
-			unsigned arrayPadding = typeInfo.defaultAlign > 4 ? typeInfo.defaultAlign : 4;
+	void SetMarked(markerType &marker)
+	{
+		marker = (marker & ~OBJECT_VISIBLE) | GC::VisibleMark();
+	}
 
-			unsigned count = *(unsigned*)(base + sizeof(markerType) + arrayPadding - 4);
-			NULLCRef r = { (unsigned)marker >> 8, base + sizeof(markerType) + arrayPadding }; // skip over marker and array size
+	void ProfileFree(void* ptr);
+	void SweepFreed(unsigned elemSize, unsigned count, bool finished);
 
-			for(unsigned i = 0; i < count; i++)
-			{
-				NULLC::finalizeList.push_back(r);
-				r.ptr += typeInfo.size;
-			}
-		}
-		else
-		{
-			NULLCRef r = { (unsigned)marker >> 8, base + sizeof(markerType) }; // skip over marker
-			NULLC::finalizeList.push_back(r);
-		}
-		marker |= NULLC::OBJECT_FINALIZED;
-	}
+	void FinalizeObject(markerType& marker, char* base);
 }
 
 template<int elemSize>
@@ -109,6 +102,8 @@ public:
 		freeBlocks = &lastBlock;
 		activePages = NULL;
 		lastNum = countInBlock;
+
+		sweepPage = NULL;
 	}
 
 	~ObjectBlockPool()
@@ -131,13 +126,19 @@ public:
 		activePages = NULL;
 		lastNum = countInBlock;
 
+		sweepPage = NULL;
+
 		sortedPages.reset();
+		finalizableObjects.reset();
 		objectsToFinalize.reset();
-		objectsToFree.reset();
 	}
 
 	void* Alloc()
 	{
+		// Before taking a new block, sweep pages left from the last collection until a free block is found
+		while(freeBlocks == &lastBlock && sweepPage)
+			SweepPages(1);
+
 		MySmallBlock*	result;
 		if(freeBlocks && freeBlocks != &lastBlock)
 		{
@@ -225,39 +226,28 @@ public:
 		return (char*)best->page + (unsigned(fromBase) & ~(elemSize - 1)) + sizeof(markerType);
 	}
 
-	void Mark(unsigned int number)
+	void AddFinalizable(void* ptr)
 	{
-		assert(number <= 1);
-		MyLargeBlock *curr = activePages;
-		while(curr)
-		{
-			for(unsigned int i = 0; i < (curr == activePages ? lastNum : countInBlock); i++)
-			{
-				curr->page[i].marker = (curr->page[i].marker & ~NULLC::OBJECT_VISIBLE) | number;
-			}
-			curr = curr->next;
-		}
+		finalizableObjects.push_back(static_cast<MySmallBlock*>(ptr));
 	}
 
 	void CollectUnmarked()
 	{
-		for(MyLargeBlock *curr = activePages; curr; curr = curr->next)
+		// Only objects waiting for finalization are collected here, the rest is freed by lazy sweeping
+		for(unsigned i = 0; i < finalizableObjects.size();)
 		{
-			for(unsigned int i = 0; i < (curr == activePages ? lastNum : countInBlock); i++)
+			MySmallBlock *block = finalizableObjects[i];
+
+			if(!NULLC::IsMarked(block->marker))
 			{
-				markerType &marker = curr->page[i].marker;
+				objectsToFinalize.push_back(block);
 
-				if(!(marker & (NULLC::OBJECT_VISIBLE | NULLC::OBJECT_FREED)))
-				{
-					if((marker & NULLC::OBJECT_FINALIZABLE) && !(marker & NULLC::OBJECT_FINALIZED))
-					{
-						objectsToFinalize.push_back(&curr->page[i]);
-					}
-					else
-					{
-						objectsToFree.push_back(&curr->page[i]);
-					}
-				}
+				finalizableObjects[i] = finalizableObjects.back();
+				finalizableObjects.pop_back();
+			}
+			else
+			{
+				i++;
 			}
 		}
 	}
@@ -271,7 +261,7 @@ public:
 			markerType &marker = block->marker;
 
 			// Mark block as used
-			marker |= NULLC::OBJECT_VISIBLE;
+			NULLC::SetMarked(marker);
 
 			ExternTypeInfo &typeInfo = NULLC::linker->exTypes[(unsigned)marker >> 8];
 
@@ -296,30 +286,55 @@ public:
 		objectsToFinalize.clear();
 	}
 
-	unsigned FreePending(unsigned &usedMemory)
+	void StartSweep()
+	{
+		sweepPage = activePages;
+
+		if(!sweepPage)
+			NULLC::SweepFreed(elemSize, 0, true);
+	}
+
+	bool SweepPending()
+	{
+		return sweepPage != NULL;
+	}
+
+	// Free unmarked objects in up to 'pageCount' pages, all remaining pages are swept if 'pageCount' is 0
+	unsigned SweepPages(unsigned pageCount)
 	{
+		if(!sweepPage)
+			return 0;
+
+		unsigned pages = 0;
 		unsigned freed = 0;
 
-		for(unsigned i = 0, e = objectsToFree.size(); i < e; i++)
+		markerType visibleMark = GC::VisibleMark();
+
+		while(sweepPage && (pageCount == 0 || pages < pageCount))
 		{
-			MySmallBlock *block = objectsToFree[i];
+			// Objects allocated after the collection are marked and will not be freed
+			for(unsigned int i = 0; i < (sweepPage == activePages ? lastNum : countInBlock); i++)
+			{
+				markerType &marker = sweepPage->page[i].marker;
 
-			markerType &marker = block->marker;
+				if(!(marker & NULLC::OBJECT_FREED) && (marker & NULLC::OBJECT_VISIBLE) != visibleMark)
+				{
+					if(marker & NULLC::OBJECT_SAMPLED)
+						NULLC::ProfileFree(sweepPage->page[i].data + sizeof(markerType));
 
-			// Check flags again, finalizers might have some objects reachable
-			if(!(marker & (NULLC::OBJECT_VISIBLE | NULLC::OBJECT_FREED)))
-			{
-				Free(block);
+					Free(&sweepPage->page[i]);
 
-				freed++;
+					freed++;
+				}
 			}
-		}
 
-		objectsToFree.clear();
+			sweepPage = sweepPage->next;
+			pages++;
+		}
 
-		usedMemory -= freed * elemSize;
+		NULLC::SweepFreed(elemSize, freed, sweepPage == NULL);
 
-		return freed;
+		return pages;
 	}
 
 	MySmallBlock	lastBlock;
@@ -328,30 +343,23 @@ public:
 	MyLargeBlock	*activePages;
 	unsigned int	lastNum;
 
+	MyLargeBlock	*sweepPage;
+
 	FastVector<MyLargeBlock*> sortedPages;
 
+	FastVector<MySmallBlock*> finalizableObjects;
 	FastVector<MySmallBlock*> objectsToFinalize;
-	FastVector<MySmallBlock*> objectsToFree;
 };
 
 namespace NULLC
 {
 	const unsigned int poolBlockSize = 64 * 1024;
 
-	bool collectionEnabled = true;
-
-	unsigned int usedMemory = 0;
+	const NULLCCollectionPolicy defaultCollectionPolicy = { 1024 * 1024, 1.5, 8.0, 0.05, 10 };
 
-	unsigned int collectableMinimum = 1024 * 1024;
-	unsigned int globalMemoryLimit = 1024 * 1024 * 1024;
+	void UpdateCollectionThreshold(NULLCCollectionInfo &info, unsigned executionTime);
 
-	ObjectBlockPool<8, poolBlockSize / 8>		pool8;
-	ObjectBlockPool<16, poolBlockSize / 16>		pool16;
-	ObjectBlockPool<32, poolBlockSize / 32>		pool32;
-	ObjectBlockPool<64, poolBlockSize / 64>		pool64;
-	ObjectBlockPool<128, poolBlockSize / 128>	pool128;
-	ObjectBlockPool<256, poolBlockSize / 256>	pool256;
-	ObjectBlockPool<512, poolBlockSize / 512>	pool512;
+	void AddFinalizable(void* data, unsigned realSize);
 
 	struct Range
 	{
@@ -382,19 +390,213 @@ namespace NULLC
 	};
 
 	typedef Tree<Range>::iterator BigBlockIterator;
-	Tree<Range>	bigBlocks;
-
-	unsigned currentMark = 0;
-
-	FastVector<Range> blocksToFinalize;
-	FastVector<Range> blocksToFree;
 
-	void MarkBlock(Range& curr);
 	void CollectUnmarkedBlock(Range& curr);
 	void ClearBlock(Range& curr);
 
-	double	markTime = 0.0;
-	double	collectTime = 0.0;
+	void RunCollection(unsigned trigger);
+	void RecordCollectionPhase(unsigned phase, unsigned time);
+
+	// Allocation profiler
+	struct ProfileSample
+	{
+		void		*ptr;
+		unsigned	typeId;
+		unsigned	site;
+		unsigned	weight;
+	};
+
+	struct ProfileSite
+	{
+		unsigned	hash;
+		unsigned	frameOffset;
+		unsigned	frameCount;
+
+		NULLCAllocationStats stats;
+	};
+
+	const unsigned profileMaxFrames = 32;
+
+	unsigned GetPointerHash(void *ptr);
+	unsigned FindProfileSite(unsigned *frames, unsigned frameCount);
+	void ProfileAlloc(void *ptr, unsigned typeId, unsigned size);
+
+	// Host memory shared with the program without a copy
+	struct HostRegion
+	{
+		char	*start;
+		char	*end;
+
+		void	(*release)(void *data, void *context);
+		void	*context;
+
+		// Region is referenced by the program
+		bool	visible;
+
+		// Region is referenced by the host
+		bool	held;
+	};
+
+	void ReleaseHostRegions(bool all);
+
+	// Garbage collected memory of an execution context
+	struct GlobalHeap
+	{
+		GlobalHeap();
+
+		bool collectionEnabled;
+
+		unsigned int usedMemory;
+
+		unsigned int collectableMinimum;
+		unsigned int globalMemoryLimit;
+
+		// Adaptive collection trigger state
+		NULLCCollectionPolicy collectionPolicy;
+
+		double collectionGrowth;
+		unsigned lastCollectionEnd;
+		unsigned lastSurvivedMemory;
+
+		// Lazy sweeping state, collection record is completed when all pools are swept
+		unsigned sweepPendingPools;
+		NULLCCollectionInfo *sweepInfo;
+		unsigned sweepExecutionTime;
+
+		ObjectBlockPool<8, poolBlockSize / 8>		pool8;
+		ObjectBlockPool<16, poolBlockSize / 16>		pool16;
+		ObjectBlockPool<32, poolBlockSize / 32>		pool32;
+		ObjectBlockPool<64, poolBlockSize / 64>		pool64;
+		ObjectBlockPool<128, poolBlockSize / 128>	pool128;
+		ObjectBlockPool<256, poolBlockSize / 256>	pool256;
+		ObjectBlockPool<512, poolBlockSize / 512>	pool512;
+
+		Tree<Range>	bigBlocks;
+
+		FastVector<Range> blocksToFinalize;
+		FastVector<Range> blocksToFree;
+
+		FastVector<NULLCRef>	finalizeList;
+
+		// Objects with finalizers that are currently running, they are kept alive until the finalizers are complete
+		FastVector<NULLCRef>	finalizeActiveList;
+		bool	finalizeRunning;
+
+		// Finalizers are run by the host instead of the garbage collection
+		bool	finalizeDeferred;
+
+		double	markTime;
+		double	collectTime;
+
+		// Collection telemetry
+		unsigned	collectionCount;
+		NULLCCollectionInfo	collectionHistory[NULLC_GC_HISTORY_SIZE];
+		unsigned	collectionHistogram[NULLC_GC_PHASE_COUNT][NULLC_GC_HISTOGRAM_SIZE];
+
+		// Allocation profiler
+		unsigned	profileSampleBytes;
+		unsigned	profileNextSample;
+
+		FastVector<NULLCAllocationStats>	profileTypes;
+		FastVector<ProfileSite>	profileSites;
+		FastVector<unsigned>	profileFrames;
+		HashMap<unsigned>		profileSiteMap;
+
+		FastVector<ProfileSample>	profileSamples;
+		HashMap<unsigned>		profileSampleMap;
+
+		// Host memory regions sorted by address
+		FastVector<HostRegion>	hostRegions;
+
+		// Memory quota of the execution context, memory that is used outside of the heap is reported by the context
+		unsigned	quotaSoftLimit;
+		unsigned	quotaHardLimit;
+		bool		quotaSoftLimitReached;
+
+		void		*quotaCallbackContext;
+		unsigned	(*quotaCallback)(void *context, unsigned used, unsigned softLimit);
+
+		unsigned	externalMemory[NULLC_MEMORY_TOTAL];
+		unsigned	externalMemoryTotal;
+
+		// Garbage collector marking state, default heap is using the shared one
+		GC::MarkState	*markState;
+	};
+
+	GlobalHeap::GlobalHeap()
+	{
+		collectionEnabled = true;
+
+		usedMemory = 0;
+
+		collectableMinimum = 1024 * 1024;
+		globalMemoryLimit = 1024 * 1024 * 1024;
+
+		collectionPolicy = defaultCollectionPolicy;
+
+		collectionGrowth = 1.5;
+		lastCollectionEnd = 0;
+		lastSurvivedMemory = 0;
+
+		sweepPendingPools = 0;
+		sweepInfo = NULL;
+		sweepExecutionTime = 0;
+
+		finalizeRunning = false;
+		finalizeDeferred = false;
+
+		markTime = 0.0;
+		collectTime = 0.0;
+
+		collectionCount = 0;
+		memset(collectionHistory, 0, sizeof(collectionHistory));
+		memset(collectionHistogram, 0, sizeof(collectionHistogram));
+
+		profileSampleBytes = 0;
+		profileNextSample = 0;
+
+		quotaSoftLimit = 0;
+		quotaHardLimit = 0;
+		quotaSoftLimitReached = false;
+
+		quotaCallbackContext = NULL;
+		quotaCallback = NULL;
+
+		memset(externalMemory, 0, sizeof(externalMemory));
+		externalMemoryTotal = 0;
+
+		markState = NULL;
+	}
+
+	GlobalHeap	defaultHeap;
+
+	// Heap of the execution context that is current on the thread
+	NULLC_THREAD_LOCAL GlobalHeap	*heap = &defaultHeap;
+}
+
+void NULLC::FinalizeObject(markerType& marker, char* base)
+{
+	if(marker & NULLC::OBJECT_ARRAY)
+	{
+		ExternTypeInfo &typeInfo = NULLC::linker->exTypes[(unsigned)marker >> 8];
+
+		unsigned arrayPadding = typeInfo.defaultAlign > 4 ? typeInfo.defaultAlign : 4;
+
+		unsigned count = *(unsigned*)(base + sizeof(markerType) + arrayPadding - 4);
+		NULLCRef r = { (unsigned)marker >> 8, base + sizeof(markerType) + arrayPadding }; // skip over marker and array size
+
+		for(unsigned i = 0; i < count; i++)
+		{
+			heap->finalizeList.push_back(r);
+			r.ptr += typeInfo.size;
+		}
+	}
+	else
+	{
+		NULLCRef r = { (unsigned)marker >> 8, base + sizeof(markerType) }; // skip over marker
+		heap->finalizeList.push_back(r);
+	}
+	marker |= NULLC::OBJECT_FINALIZED;
 }
 
 void NULLC::SetLinker(Linker *linker)
@@ -402,6 +604,42 @@ void NULLC::SetLinker(Linker *linker)
 	NULLC::linker = linker;
 }
 
+NULLC::GlobalHeap* NULLC::CreateHeap()
+{
+	GlobalHeap *result = NULLC::construct<GlobalHeap>();
+
+	result->markState = GC::CreateMarkState();
+
+	return result;
+}
+
+void NULLC::DestroyHeap(GlobalHeap *target)
+{
+	GlobalHeap *current = heap;
+
+	SetHeap(target);
+
+	ResetMemory();
+
+	SetHeap(current == target ? &defaultHeap : current);
+
+	GC::DestroyMarkState(target->markState);
+
+	NULLC::destruct(target);
+}
+
+void NULLC::SetHeap(GlobalHeap *target)
+{
+	heap = target ? target : &defaultHeap;
+
+	GC::SetMarkState(heap->markState);
+}
+
+NULLC::GlobalHeap* NULLC::GetHeap()
+{
+	return heap;
+}
+
 void* NULLC::AllocObject(int size, unsigned type)
 {
 	if(size < 0)
@@ -413,19 +651,26 @@ void* NULLC::AllocObject(int size, unsigned type)
 	void *data = NULL;
 	size += sizeof(markerType);
 
-	if((unsigned int)(usedMemory + size) > globalMemoryLimit)
+	// Sweeping that is left from the last collection might bring the heap under the limits
+	if((unsigned int)(heap->usedMemory + size) > heap->collectableMinimum && heap->sweepPendingPools)
+		SweepMemory(0);
+
+	if((heap->quotaSoftLimit || heap->quotaHardLimit) && !CheckMemoryQuota(size))
+		return NULL;
+
+	if((unsigned int)(heap->usedMemory + size) > heap->globalMemoryLimit)
 	{
-		CollectMemory();
+		RunCollection(NULLC_GC_TRIGGER_LIMIT);
 
-		if((unsigned int)(usedMemory + size) > globalMemoryLimit)
+		if((unsigned int)(heap->usedMemory + size) > heap->globalMemoryLimit)
 		{
 			nullcThrowError("ERROR: reached global memory maximum");
 			return NULL;
 		}
 	}
-	else if((unsigned int)(usedMemory + size) > collectableMinimum)
+	else if((unsigned int)(heap->usedMemory + size) > heap->collectableMinimum)
 	{
-		CollectMemory();
+		RunCollection(NULLC_GC_TRIGGER_THRESHOLD);
 	}
 
 	unsigned int realSize = size;
@@ -435,19 +680,19 @@ void* NULLC::AllocObject(int size, unsigned type)
 		{
 			if(size <= 8)
 			{
-				data = pool8.Alloc();
+				data = heap->pool8.Alloc();
 				realSize = 8;
 			}else{
-				data = pool16.Alloc();
+				data = heap->pool16.Alloc();
 				realSize = 16;
 			}
 		}else{
 			if(size <= 32)
 			{
-				data = pool32.Alloc();
+				data = heap->pool32.Alloc();
 				realSize = 32;
 			}else{
-				data = pool64.Alloc();
+				data = heap->pool64.Alloc();
 				realSize = 64;
 			}
 		}
@@ -456,16 +701,16 @@ void* NULLC::AllocObject(int size, unsigned type)
 		{
 			if(size <= 128)
 			{
-				data = pool128.Alloc();
+				data = heap->pool128.Alloc();
 				realSize = 128;
 			}else{
-				data = pool256.Alloc();
+				data = heap->pool256.Alloc();
 				realSize = 256;
 			}
 		}else{
 			if(size <= 512)
 			{
-				data = pool512.Alloc();
+				data = heap->pool512.Alloc();
 				realSize = 512;
 			}else{
 				void *ptr = NULLC::alignedAlloc(size - sizeof(markerType), 4 + sizeof(markerType));
@@ -476,14 +721,14 @@ void* NULLC::AllocObject(int size, unsigned type)
 				}
 
 				Range range(ptr, (char*)ptr + size + 4);
-				bigBlocks.insert(range);
+				heap->bigBlocks.insert(range);
 
 				realSize = *(int*)ptr = size;
 				data = (char*)ptr + 4;
 			}
 		}
 	}
-	usedMemory += realSize;
+	heap->usedMemory += realSize;
 
 	if(data == NULL)
 	{
@@ -495,13 +740,63 @@ void* NULLC::AllocObject(int size, unsigned type)
 		finalize = (int)OBJECT_FINALIZABLE;
 
 	memset(data, 0, size);
-	*(markerType*)data = finalize | (type << 8);
+
+	// Objects are allocated marked so that lazy sweeping of their page will not free them, the mark is invalidated at the start of the next collection
+	*(markerType*)data = finalize | GC::VisibleMark() | (type << 8);
+
+	if(finalize && realSize <= 512)
+		AddFinalizable(data, realSize);
+
+	if(heap->profileSampleBytes)
+	{
+		if(realSize >= heap->profileNextSample)
+		{
+			*(markerType*)data |= OBJECT_SAMPLED;
+
+			ProfileAlloc((char*)data + sizeof(markerType), type, realSize);
+
+			heap->profileNextSample = heap->profileSampleBytes;
+		}
+		else
+		{
+			heap->profileNextSample -= realSize;
+		}
+	}
+
 	return (char*)data + sizeof(markerType);
 }
 
+void NULLC::AddFinalizable(void* data, unsigned realSize)
+{
+	switch(realSize)
+	{
+	case 8:
+		heap->pool8.AddFinalizable(data);
+		break;
+	case 16:
+		heap->pool16.AddFinalizable(data);
+		break;
+	case 32:
+		heap->pool32.AddFinalizable(data);
+		break;
+	case 64:
+		heap->pool64.AddFinalizable(data);
+		break;
+	case 128:
+		heap->pool128.AddFinalizable(data);
+		break;
+	case 256:
+		heap->pool256.AddFinalizable(data);
+		break;
+	case 512:
+		heap->pool512.AddFinalizable(data);
+		break;
+	}
+}
+
 unsigned int NULLC::UsedMemory()
 {
-	return usedMemory;
+	return heap->usedMemory;
 }
 
 NULLCArray NULLC::AllocArray(unsigned size, unsigned count, unsigned type)
@@ -511,7 +806,7 @@ NULLCArray NULLC::AllocArray(unsigned size, unsigned count, unsigned type)
 	ret.len = 0;
 	ret.ptr = NULL;
 
-	if((unsigned long long)size * count > globalMemoryLimit)
+	if((unsigned long long)size * count > heap->globalMemoryLimit)
 	{
 		nullcThrowError("ERROR: can't allocate array with %u elements of size %u", count, size);
 		return ret;
@@ -542,54 +837,42 @@ NULLCArray NULLC::AllocArray(unsigned size, unsigned count, unsigned type)
 	return ret;
 }
 
-void NULLC::MarkBlock(Range& curr)
-{
-	markerType *marker = (markerType*)((char*)curr.start + 4);
-	*marker = (*marker & ~NULLC::OBJECT_VISIBLE) | currentMark;
-}
-
-void NULLC::MarkMemory(unsigned int number)
+void NULLC::UnmarkMemory()
 {
-	assert(number <= 1);
-
-	currentMark = number;
+	// Pending sweeping has to be completed, so that all objects left in the heap carry the mark of the last collection
+	assert(heap->sweepPendingPools == 0);
 
-	bigBlocks.for_each(MarkBlock);
+	GC::FlipVisibleMark();
 
-	pool8.Mark(number);
-	pool16.Mark(number);
-	pool32.Mark(number);
-	pool64.Mark(number);
-	pool128.Mark(number);
-	pool256.Mark(number);
-	pool512.Mark(number);
+	for(unsigned i = 0; i < heap->hostRegions.size(); i++)
+		heap->hostRegions[i].visible = false;
 }
 
 void NULLC::CollectUnmarked()
 {
-	bigBlocks.for_each(CollectUnmarkedBlock);
+	heap->bigBlocks.for_each(CollectUnmarkedBlock);
 
-	pool8.CollectUnmarked();
-	pool16.CollectUnmarked();
-	pool32.CollectUnmarked();
-	pool64.CollectUnmarked();
-	pool128.CollectUnmarked();
-	pool256.CollectUnmarked();
-	pool512.CollectUnmarked();
+	heap->pool8.CollectUnmarked();
+	heap->pool16.CollectUnmarked();
+	heap->pool32.CollectUnmarked();
+	heap->pool64.CollectUnmarked();
+	heap->pool128.CollectUnmarked();
+	heap->pool256.CollectUnmarked();
+	heap->pool512.CollectUnmarked();
 }
 
 void NULLC::FinalizePending()
 {
-	for(unsigned i = 0; i < blocksToFinalize.size(); i++)
+	for(unsigned i = 0; i < heap->blocksToFinalize.size(); i++)
 	{
-		Range &curr = blocksToFinalize[i];
+		Range &curr = heap->blocksToFinalize[i];
 
 		void *block = curr.start;
 
 		markerType &marker = *(markerType*)((char*)block + 4);
 
 		// Mark block as used
-		marker |= NULLC::OBJECT_VISIBLE;
+		NULLC::SetMarked(marker);
 
 		ExternTypeInfo &typeInfo = NULLC::linker->exTypes[(unsigned)marker >> 8];
 
@@ -611,74 +894,139 @@ void NULLC::FinalizePending()
 		NULLC::FinalizeObject(marker, (char*)block + 4);
 	}
 
-	blocksToFinalize.clear();
+	heap->blocksToFinalize.clear();
 
-	pool8.FinalizePending();
-	pool16.FinalizePending();
-	pool32.FinalizePending();
-	pool64.FinalizePending();
-	pool128.FinalizePending();
-	pool256.FinalizePending();
-	pool512.FinalizePending();
+	heap->pool8.FinalizePending();
+	heap->pool16.FinalizePending();
+	heap->pool32.FinalizePending();
+	heap->pool64.FinalizePending();
+	heap->pool128.FinalizePending();
+	heap->pool256.FinalizePending();
+	heap->pool512.FinalizePending();
 
 	// Mark new roots
 	GC::MarkPendingRoots();
 }
 
-void NULLC::FreePending()
+void NULLC::FreePending(unsigned *freedObjects)
 {
-	for(unsigned i = 0; i < blocksToFree.size(); i++)
+	unsigned freedBlocks = 0;
+
+	for(unsigned i = 0; i < heap->blocksToFree.size(); i++)
 	{
-		Range &curr = blocksToFree[i];
+		Range &curr = heap->blocksToFree[i];
 
 		void *block = curr.start;
 
 		markerType &marker = *(markerType*)((char*)block + 4);
 
 		// Check flags again, finalizers might have some objects reachable
-		if(!(marker & (NULLC::OBJECT_VISIBLE | NULLC::OBJECT_FREED)))
+		if(!(marker & NULLC::OBJECT_FREED) && !NULLC::IsMarked(marker))
 		{
+			if(marker & NULLC::OBJECT_SAMPLED)
+				NULLC::ProfileFree((char*)block + 4 + sizeof(markerType));
+
 			unsigned size = *(unsigned int*)block;
 
-			usedMemory -= size;
+			heap->usedMemory -= size;
 
 			NULLC::alignedDealloc(block);
 
-			bigBlocks.erase(curr);
+			heap->bigBlocks.erase(curr);
+
+			freedBlocks++;
 		}
 	}
 
-	blocksToFree.clear();
+	heap->blocksToFree.clear();
+
+	// Small objects are freed later by lazy sweeping
+	for(unsigned i = 0; i < NULLC_GC_SIZE_CLASS_COUNT - 1; i++)
+		freedObjects[i] = 0;
+
+	freedObjects[NULLC_GC_SIZE_CLASS_COUNT - 1] = freedBlocks;
+}
+
+void NULLC::StartSweep(NULLCCollectionInfo &info, unsigned executionTime)
+{
+	assert(heap->sweepPendingPools == 0);
+
+	heap->sweepPendingPools = NULLC_GC_SIZE_CLASS_COUNT - 1;
+	heap->sweepInfo = &info;
+	heap->sweepExecutionTime = executionTime;
+
+	heap->pool8.StartSweep();
+	heap->pool16.StartSweep();
+	heap->pool32.StartSweep();
+	heap->pool64.StartSweep();
+	heap->pool128.StartSweep();
+	heap->pool256.StartSweep();
+	heap->pool512.StartSweep();
+}
+
+void NULLC::SweepFreed(unsigned elemSize, unsigned count, bool finished)
+{
+	assert(heap->sweepPendingPools != 0);
+
+	unsigned sizeClass = 0;
+
+	while((8u << sizeClass) < elemSize)
+		sizeClass++;
+
+	heap->usedMemory -= count * elemSize;
+
+	heap->sweepInfo->freedObjects[sizeClass] += count;
+	heap->sweepInfo->usedAfter -= count * elemSize;
+
+	if(finished && --heap->sweepPendingPools == 0)
+	{
+		UpdateCollectionThreshold(*heap->sweepInfo, heap->sweepExecutionTime);
+
+		heap->sweepInfo = NULL;
+	}
+}
+
+bool NULLC::SweepMemory(unsigned pageCount)
+{
+	unsigned pages = 0;
+
+	pages += heap->pool8.SweepPages(pageCount == 0 ? 0 : pageCount - pages);
+	if(pageCount == 0 || pages < pageCount)
+		pages += heap->pool16.SweepPages(pageCount == 0 ? 0 : pageCount - pages);
+	if(pageCount == 0 || pages < pageCount)
+		pages += heap->pool32.SweepPages(pageCount == 0 ? 0 : pageCount - pages);
+	if(pageCount == 0 || pages < pageCount)
+		pages += heap->pool64.SweepPages(pageCount == 0 ? 0 : pageCount - pages);
+	if(pageCount == 0 || pages < pageCount)
+		pages += heap->pool128.SweepPages(pageCount == 0 ? 0 : pageCount - pages);
+	if(pageCount == 0 || pages < pageCount)
+		pages += heap->pool256.SweepPages(pageCount == 0 ? 0 : pageCount - pages);
+	if(pageCount == 0 || pages < pageCount)
+		pages += heap->pool512.SweepPages(pageCount == 0 ? 0 : pageCount - pages);
 
-	pool8.FreePending(usedMemory);
-	pool16.FreePending(usedMemory);
-	pool32.FreePending(usedMemory);
-	pool64.FreePending(usedMemory);
-	pool128.FreePending(usedMemory);
-	pool256.FreePending(usedMemory);
-	pool512.FreePending(usedMemory);
+	return heap->sweepPendingPools != 0;
 }
 
 bool NULLC::IsBasePointer(void* ptr)
 {
 	// Search in range of every pool
-	if(pool8.IsBasePointer(ptr))
+	if(heap->pool8.IsBasePointer(ptr))
 		return true;
-	if(pool16.IsBasePointer(ptr))
+	if(heap->pool16.IsBasePointer(ptr))
 		return true;
-	if(pool32.IsBasePointer(ptr))
+	if(heap->pool32.IsBasePointer(ptr))
 		return true;
-	if(pool64.IsBasePointer(ptr))
+	if(heap->pool64.IsBasePointer(ptr))
 		return true;
-	if(pool128.IsBasePointer(ptr))
+	if(heap->pool128.IsBasePointer(ptr))
 		return true;
-	if(pool256.IsBasePointer(ptr))
+	if(heap->pool256.IsBasePointer(ptr))
 		return true;
-	if(pool512.IsBasePointer(ptr))
+	if(heap->pool512.IsBasePointer(ptr))
 		return true;
 
 	// Search in global pool
-	if(BigBlockIterator it = bigBlocks.find(Range(ptr, ptr)))
+	if(BigBlockIterator it = heap->bigBlocks.find(Range(ptr, ptr)))
 	{
 		void *block = it->key.start;
 
@@ -692,23 +1040,23 @@ bool NULLC::IsBasePointer(void* ptr)
 void* NULLC::GetBasePointer(void* ptr)
 {
 	// Search in range of every pool
-	if(void *base = pool8.GetBasePointer(ptr))
+	if(void *base = heap->pool8.GetBasePointer(ptr))
 		return base;
-	if(void *base = pool16.GetBasePointer(ptr))
+	if(void *base = heap->pool16.GetBasePointer(ptr))
 		return base;
-	if(void *base = pool32.GetBasePointer(ptr))
+	if(void *base = heap->pool32.GetBasePointer(ptr))
 		return base;
-	if(void *base = pool64.GetBasePointer(ptr))
+	if(void *base = heap->pool64.GetBasePointer(ptr))
 		return base;
-	if(void *base = pool128.GetBasePointer(ptr))
+	if(void *base = heap->pool128.GetBasePointer(ptr))
 		return base;
-	if(void *base = pool256.GetBasePointer(ptr))
+	if(void *base = heap->pool256.GetBasePointer(ptr))
 		return base;
-	if(void *base = pool512.GetBasePointer(ptr))
+	if(void *base = heap->pool512.GetBasePointer(ptr))
 		return base;
 
 	// Search in global pool
-	if(BigBlockIterator it = bigBlocks.find(Range(ptr, ptr)))
+	if(BigBlockIterator it = heap->bigBlocks.find(Range(ptr, ptr)))
 	{
 		void *block = it->key.start;
 
@@ -719,131 +1067,967 @@ void* NULLC::GetBasePointer(void* ptr)
 	return NULL;
 }
 
+unsigned NULLC::GetBlockSize(void* basePtr)
+{
+	// Object can use the whole pool element, even if it requested less memory
+	if(heap->pool8.GetBasePointer(basePtr))
+		return 8 - sizeof(markerType);
+	if(heap->pool16.GetBasePointer(basePtr))
+		return 16 - sizeof(markerType);
+	if(heap->pool32.GetBasePointer(basePtr))
+		return 32 - sizeof(markerType);
+	if(heap->pool64.GetBasePointer(basePtr))
+		return 64 - sizeof(markerType);
+	if(heap->pool128.GetBasePointer(basePtr))
+		return 128 - sizeof(markerType);
+	if(heap->pool256.GetBasePointer(basePtr))
+		return 256 - sizeof(markerType);
+	if(heap->pool512.GetBasePointer(basePtr))
+		return 512 - sizeof(markerType);
+
+	if(BigBlockIterator it = heap->bigBlocks.find(Range(basePtr, basePtr)))
+		return *(unsigned int*)it->key.start - sizeof(markerType);
+
+	return 0;
+}
+
 void NULLC::CollectUnmarkedBlock(Range& curr)
 {
 	void *block = curr.start;
 
 	markerType &marker = *(markerType*)((char*)block + 4);
 
-	if(!(marker & NULLC::OBJECT_VISIBLE))
+	if(!NULLC::IsMarked(marker))
 	{
 		if((marker & NULLC::OBJECT_FINALIZABLE) && !(marker & NULLC::OBJECT_FINALIZED))
 		{
-			blocksToFinalize.push_back(curr);
+			heap->blocksToFinalize.push_back(curr);
 		}
 		else
 		{
-			blocksToFree.push_back(curr);
+			heap->blocksToFree.push_back(curr);
 		}
 	}
 }
 
 void NULLC::SetCollectMemory(bool enabled)
 {
-	collectionEnabled = enabled;
+	heap->collectionEnabled = enabled;
 }
 
 void NULLC::CollectMemory()
 {
-	if(!collectionEnabled)
+	RunCollection(NULLC_GC_TRIGGER_EXPLICIT);
+
+	// Explicit collection doesn't leave any work for lazy sweeping
+	SweepMemory(0);
+}
+
+void NULLC::RunCollection(unsigned trigger)
+{
+	if(!heap->collectionEnabled)
 		return;
 
-	double time = (double(clock()) / CLOCKS_PER_SEC);
+	unsigned time = NULLCTime::clockMicro();
+
+	// Objects left from the last collection have to be freed before the marks are reset
+	unsigned sweepTime = 0;
+
+	if(heap->sweepPendingPools)
+	{
+		SweepMemory(0);
+
+		sweepTime = NULLCTime::clockMicro() - time;
+		time += sweepTime;
+	}
+
+	// Finalizers might trigger a nested collection, so the record is reserved in advance
+	NULLCCollectionInfo &info = heap->collectionHistory[heap->collectionCount++ % NULLC_GC_HISTORY_SIZE];
+
+	memset(&info, 0, sizeof(info));
+
+	info.trigger = trigger;
+	info.usedBefore = heap->usedMemory;
 
-	// All memory blocks are marked with 0
-	MarkMemory(0);
+	info.startTime = time;
 
-	// Used memory blocks are marked with 1
+	unsigned executionTime = heap->lastCollectionEnd != 0 && time > heap->lastCollectionEnd ? time - heap->lastCollectionEnd : 0;
+
+	// All memory blocks are unmarked without visiting them
+	UnmarkMemory();
+
+	// Used memory blocks are marked
 	GC::MarkUsedBlocks();
 
+	// Objects waiting for finalizers are still used
+	MarkFinalizeQueue();
+
 	// Collect sets of objects to finalize and to potentially free
 	CollectUnmarked();
 
-	markTime += (double(clock()) / CLOCKS_PER_SEC) - time;
-	time = (double(clock()) / CLOCKS_PER_SEC);
+	info.markTime = NULLCTime::clockMicro() - time;
+	time += info.markTime;
 
 	// Ressurect objects and register finalizers
 	FinalizePending();
 
+	info.finalizeTime = NULLCTime::clockMicro() - time;
+	time += info.finalizeTime;
+
 	// Free memory that remains unreachable
-	FreePending();
+	FreePending(info.freedObjects);
 
-	collectTime += (double(clock()) / CLOCKS_PER_SEC) - time;
+	// Return unreachable memory regions back to the host
+	ReleaseHostRegions(false);
 
-	if(usedMemory + (usedMemory >> 1) >= collectableMinimum)
-		collectableMinimum <<= 1;
+	info.usedAfter = heap->usedMemory;
 
-	(void)nullcRunFunction("__finalizeObjects");
-	finalizeList.clear();
-}
+	StartSweep(info, executionTime);
 
-double NULLC::MarkTime()
-{
-	return markTime;
-}
+	info.sweepTime = NULLCTime::clockMicro() - time;
+	time += info.sweepTime;
 
-double NULLC::CollectTime()
-{
-	return collectTime;
-}
+	// Sweeping of the previous collection is a part of this pause
+	info.sweepTime += sweepTime;
 
-void NULLC::FinalizeMemory()
-{
-	MarkMemory(0);
+	heap->markTime += info.markTime / 1000000.0;
+	heap->collectTime += (info.finalizeTime + info.sweepTime) / 1000000.0;
 
-	CollectUnmarked();
-	FinalizePending();
+	if(!heap->finalizeDeferred)
+		RunFinalizers();
 
-	(void)nullcRunFunction("__finalizeObjects");
-	finalizeList.clear();
-}
+	info.finalizeTime += NULLCTime::clockMicro() - time;
 
-void NULLC::ClearBlock(Range& curr)
-{
-	NULLC::alignedDealloc(curr.start);
+	RecordCollectionPhase(NULLC_GC_PHASE_MARK, info.markTime);
+	RecordCollectionPhase(NULLC_GC_PHASE_SWEEP, info.sweepTime);
+	RecordCollectionPhase(NULLC_GC_PHASE_FINALIZE, info.finalizeTime);
+	RecordCollectionPhase(NULLC_GC_PHASE_TOTAL, info.markTime + info.sweepTime + info.finalizeTime);
+
+	heap->lastCollectionEnd = NULLCTime::clockMicro();
 }
 
-void NULLC::ClearMemory()
+void NULLC::UpdateCollectionThreshold(NULLCCollectionInfo &info, unsigned executionTime)
 {
-	collectionEnabled = true;
+	unsigned pauseTime = info.markTime + info.sweepTime + info.finalizeTime;
+
+	// Skip rate estimation on the first collection, there is no reference point
+	if(executionTime != 0)
+	{
+		// When collections take too much time, let the heap grow further before the next one
+		if(pauseTime > executionTime * heap->collectionPolicy.targetPauseRatio)
+			heap->collectionGrowth *= 1.5;
+		else if(pauseTime < executionTime * heap->collectionPolicy.targetPauseRatio * 0.25)
+			heap->collectionGrowth *= 0.9;
+	}
+
+	// Collection that freed almost nothing means that the live set is large and the threshold is too close to it
+	if(info.usedBefore - info.usedAfter < (info.usedBefore >> 3))
+		heap->collectionGrowth *= 2.0;
+
+	if(heap->collectionGrowth < heap->collectionPolicy.minimumGrowth)
+		heap->collectionGrowth = heap->collectionPolicy.minimumGrowth;
+	if(heap->collectionGrowth > heap->collectionPolicy.maximumGrowth)
+		heap->collectionGrowth = heap->collectionPolicy.maximumGrowth;
+
+	double headroom = info.usedAfter * (heap->collectionGrowth - 1.0);
+
+	// Keep enough headroom for the current allocation rate to avoid back-to-back collections
+	if(executionTime != 0 && info.usedBefore > heap->lastSurvivedMemory)
+	{
+		double allocationRate = double(info.usedBefore - heap->lastSurvivedMemory) / double(executionTime);
 
-	usedMemory = 0;
+		if(allocationRate * heap->collectionPolicy.minimumInterval * 1000.0 > headroom)
+			headroom = allocationRate * heap->collectionPolicy.minimumInterval * 1000.0;
+	}
 
-	pool8.Reset();
-	pool16.Reset();
-	pool32.Reset();
-	pool64.Reset();
-	pool128.Reset();
-	pool256.Reset();
-	pool512.Reset();
+	double threshold = info.usedAfter + headroom;
 
-	bigBlocks.for_each(ClearBlock);
-	bigBlocks.clear();
+	if(threshold < heap->collectionPolicy.minimumHeap)
+		threshold = heap->collectionPolicy.minimumHeap;
+	if(threshold > heap->globalMemoryLimit)
+		threshold = heap->globalMemoryLimit;
 
-	blocksToFinalize.clear();
-	blocksToFree.clear();
+	heap->collectableMinimum = unsigned(threshold);
+	heap->lastSurvivedMemory = info.usedAfter;
 
-	finalizeList.clear();
+	info.threshold = heap->collectableMinimum;
 }
 
-void NULLC::ResetMemory()
+void NULLC::RecordCollectionPhase(unsigned phase, unsigned time)
 {
-	ClearMemory();
+	// Bucket index is the number of significant bits in the duration
+	unsigned bucket = 0;
 
-	bigBlocks.reset();
+	while(time && bucket + 1 < NULLC_GC_HISTOGRAM_SIZE)
+	{
+		time >>= 1;
+		bucket++;
+	}
+
+	heap->collectionHistogram[phase][bucket]++;
+}
 
-	blocksToFinalize.reset();
-	blocksToFree.reset();
+unsigned NULLC::CollectionCount()
+{
+	return heap->collectionCount;
+}
 
-	finalizeList.reset();
+bool NULLC::GetCollectionInfo(unsigned id, NULLCCollectionInfo &info)
+{
+	if(id >= heap->collectionCount || id >= NULLC_GC_HISTORY_SIZE)
+		return false;
 
-	GC::ResetGC();
+	info = heap->collectionHistory[(heap->collectionCount - id - 1) % NULLC_GC_HISTORY_SIZE];
+	return true;
 }
 
-void NULLC::SetGlobalLimit(unsigned int limit)
+unsigned NULLC::GetCollectionHistogram(unsigned phase, unsigned bucket)
 {
-	globalMemoryLimit = limit;
-	collectableMinimum = limit < 1024 * 1024 ? limit : 1024 * 1024;
+	if(phase >= NULLC_GC_PHASE_COUNT || bucket >= NULLC_GC_HISTOGRAM_SIZE)
+		return 0;
+
+	return heap->collectionHistogram[phase][bucket];
+}
+
+void NULLC::ResetCollectionStatistics()
+{
+	// Record of the last collection is completed by sweeping
+	SweepMemory(0);
+
+	heap->collectionCount = 0;
+
+	memset(heap->collectionHistory, 0, sizeof(heap->collectionHistory));
+	memset(heap->collectionHistogram, 0, sizeof(heap->collectionHistogram));
+}
+
+double NULLC::MarkTime()
+{
+	return heap->markTime;
+}
+
+double NULLC::CollectTime()
+{
+	return heap->collectTime;
+}
+
+void NULLC::FinalizeMemory()
+{
+	SweepMemory(0);
+
+	UnmarkMemory();
+
+	CollectUnmarked();
+	FinalizePending();
+
+	RunFinalizers();
+}
+
+void NULLC::MarkFinalizeQueue()
+{
+	for(unsigned i = 0; i < heap->finalizeList.size(); i++)
+		GC::CheckPointer((char*)&heap->finalizeList[i].ptr);
+
+	for(unsigned i = 0; i < heap->finalizeActiveList.size(); i++)
+		GC::CheckPointer((char*)&heap->finalizeActiveList[i].ptr);
+
+	GC::MarkPendingRoots();
+}
+
+bool NULLC::RunFinalizers()
+{
+	// Objects queued by a collection inside a finalizer are handled by the outer call
+	if(heap->finalizeRunning)
+		return true;
+
+	heap->finalizeRunning = true;
+
+	bool result = true;
+
+	while(!heap->finalizeList.empty() && result)
+	{
+		heap->finalizeActiveList.clear();
+
+		for(unsigned i = 0; i < heap->finalizeList.size(); i++)
+			heap->finalizeActiveList.push_back(heap->finalizeList[i]);
+
+		heap->finalizeList.clear();
+
+		result = nullcRunFunction("__finalizeObjects") != 0;
+	}
+
+	heap->finalizeActiveList.clear();
+
+	heap->finalizeRunning = false;
+
+	return result;
+}
+
+void NULLC::SetDeferredFinalization(bool enabled)
+{
+	heap->finalizeDeferred = enabled;
+}
+
+unsigned NULLC::PendingFinalizerCount()
+{
+	return heap->finalizeList.size();
+}
+
+void NULLC::ClearBlock(Range& curr)
+{
+	NULLC::alignedDealloc(curr.start);
+}
+
+void NULLC::ClearMemory()
+{
+	heap->collectionEnabled = true;
+
+	heap->usedMemory = 0;
+
+	heap->pool8.Reset();
+	heap->pool16.Reset();
+	heap->pool32.Reset();
+	heap->pool64.Reset();
+	heap->pool128.Reset();
+	heap->pool256.Reset();
+	heap->pool512.Reset();
+
+	heap->bigBlocks.for_each(ClearBlock);
+	heap->bigBlocks.clear();
+
+	heap->blocksToFinalize.clear();
+	heap->blocksToFree.clear();
+
+	heap->finalizeList.clear();
+	heap->finalizeActiveList.clear();
+
+	ClearAllocationProfile();
+
+	// Program can't reference any memory now
+	for(unsigned i = 0; i < heap->hostRegions.size(); i++)
+		heap->hostRegions[i].visible = false;
+
+	ReleaseHostRegions(false);
+
+	heap->collectableMinimum = heap->globalMemoryLimit < heap->collectionPolicy.minimumHeap ? heap->globalMemoryLimit : heap->collectionPolicy.minimumHeap;
+
+	heap->collectionGrowth = heap->collectionPolicy.minimumGrowth;
+	heap->lastCollectionEnd = 0;
+	heap->lastSurvivedMemory = 0;
+
+	heap->sweepPendingPools = 0;
+	heap->sweepInfo = NULL;
+
+	heap->quotaSoftLimitReached = false;
+}
+
+void NULLC::ResetMemory()
+{
+	ReleaseHostRegions(true);
+
+	ClearMemory();
+
+	heap->hostRegions.reset();
+
+	heap->bigBlocks.reset();
+
+	heap->blocksToFinalize.reset();
+	heap->blocksToFree.reset();
+
+	heap->finalizeList.reset();
+	heap->finalizeActiveList.reset();
+
+	heap->finalizeDeferred = false;
+
+	heap->profileSampleBytes = 0;
+
+	heap->profileTypes.reset();
+	heap->profileSites.reset();
+	heap->profileFrames.reset();
+	heap->profileSiteMap.reset();
+
+	heap->profileSamples.reset();
+	heap->profileSampleMap.reset();
+
+	ResetCollectionStatistics();
+
+	SetCollectionPolicy(NULL);
+
+	SetMemoryQuota(0, 0);
+	SetMemoryQuotaCallback(NULL, NULL);
+
+	memset(heap->externalMemory, 0, sizeof(heap->externalMemory));
+	heap->externalMemoryTotal = 0;
+
+	GC::ResetGC();
+}
+
+bool NULLC::RegisterHostRegion(void *data, unsigned size, void (*release)(void *data, void *context), void *context)
+{
+	HostRegion region;
+
+	region.start = (char*)data;
+	region.end = (char*)data + size;
+
+	region.release = release;
+	region.context = context;
+
+	region.visible = false;
+	region.held = true;
+
+	unsigned pos = 0;
+
+	while(pos < heap->hostRegions.size() && heap->hostRegions[pos].start < region.start)
+		pos++;
+
+	// Regions can't overlap
+	if(pos != 0 && heap->hostRegions[pos - 1].end > region.start)
+		return false;
+
+	if(pos < heap->hostRegions.size() && heap->hostRegions[pos].start < region.end)
+		return false;
+
+	heap->hostRegions.push_back(region);
+
+	for(unsigned i = heap->hostRegions.size() - 1; i > pos; i--)
+		heap->hostRegions[i] = heap->hostRegions[i - 1];
+
+	heap->hostRegions[pos] = region;
+
+	return true;
+}
+
+bool NULLC::ReleaseHostRegion(void *data)
+{
+	for(unsigned i = 0; i < heap->hostRegions.size(); i++)
+	{
+		HostRegion &region = heap->hostRegions[i];
+
+		if(region.start == data && region.held)
+		{
+			region.held = false;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void NULLC::MarkHostRegion(void *ptr)
+{
+	if(heap->hostRegions.empty())
+		return;
+
+	unsigned lower = 0;
+	unsigned upper = heap->hostRegions.size();
+
+	while(lower < upper)
+	{
+		unsigned middle = (lower + upper) / 2;
+
+		HostRegion &region = heap->hostRegions[middle];
+
+		if((char*)ptr < region.start)
+		{
+			upper = middle;
+		}
+		else if((char*)ptr >= region.end)
+		{
+			lower = middle + 1;
+		}
+		else
+		{
+			region.visible = true;
+			return;
+		}
+	}
+}
+
+bool NULLC::IsHostPointer(void *ptr)
+{
+	for(unsigned i = 0; i < heap->hostRegions.size(); i++)
+	{
+		HostRegion &region = heap->hostRegions[i];
+
+		if((char*)ptr >= region.start && (char*)ptr < region.end)
+			return true;
+	}
+
+	return false;
+}
+
+unsigned NULLC::HostRegionCount()
+{
+	return heap->hostRegions.size();
+}
+
+void NULLC::ReleaseHostRegions(bool all)
+{
+	FastVector<HostRegion> &regions = heap->hostRegions;
+
+	FastVector<HostRegion> released;
+
+	unsigned count = 0;
+
+	for(unsigned i = 0; i < regions.size(); i++)
+	{
+		if(all || (!regions[i].held && !regions[i].visible))
+			released.push_back(regions[i]);
+		else
+			regions[count++] = regions[i];
+	}
+
+	regions.shrink(count);
+
+	// Regions are removed before the callbacks, so the host is free to register the memory again
+	for(unsigned i = 0; i < released.size(); i++)
+	{
+		if(released[i].release)
+			released[i].release(released[i].start, released[i].context);
+	}
+}
+
+void NULLC::SetGlobalLimit(unsigned int limit)
+{
+	heap->globalMemoryLimit = limit;
+	heap->collectableMinimum = limit < heap->collectionPolicy.minimumHeap ? limit : heap->collectionPolicy.minimumHeap;
+}
+
+void NULLC::SetCollectionPolicy(const NULLCCollectionPolicy *policy)
+{
+	if(policy)
+	{
+		heap->collectionPolicy = *policy;
+
+		if(heap->collectionPolicy.minimumGrowth < 1.0)
+			heap->collectionPolicy.minimumGrowth = 1.0;
+		if(heap->collectionPolicy.maximumGrowth < heap->collectionPolicy.minimumGrowth)
+			heap->collectionPolicy.maximumGrowth = heap->collectionPolicy.minimumGrowth;
+	}
+	else
+	{
+		heap->collectionPolicy = defaultCollectionPolicy;
+	}
+
+	heap->collectableMinimum = heap->globalMemoryLimit < heap->collectionPolicy.minimumHeap ? heap->globalMemoryLimit : heap->collectionPolicy.minimumHeap;
+
+	heap->collectionGrowth = heap->collectionPolicy.minimumGrowth;
+}
+
+void NULLC::SetMemoryQuota(unsigned softLimit, unsigned hardLimit)
+{
+	heap->quotaSoftLimit = softLimit;
+	heap->quotaHardLimit = hardLimit;
+	heap->quotaSoftLimitReached = false;
+}
+
+void NULLC::SetMemoryQuotaCallback(void *context, unsigned (*callback)(void *context, unsigned used, unsigned softLimit))
+{
+	heap->quotaCallbackContext = context;
+	heap->quotaCallback = callback;
+}
+
+void NULLC::SetExternalMemory(GlobalHeap *target, unsigned category, unsigned bytes)
+{
+	assert(category != NULLC_MEMORY_HEAP && category < NULLC_MEMORY_TOTAL);
+
+	target->externalMemoryTotal += bytes - target->externalMemory[category];
+	target->externalMemory[category] = bytes;
+}
+
+unsigned NULLC::GetMemoryUsage(unsigned category)
+{
+	if(category == NULLC_MEMORY_HEAP)
+		return heap->usedMemory;
+
+	if(category == NULLC_MEMORY_TOTAL)
+		return heap->usedMemory + heap->externalMemoryTotal;
+
+	if(category < NULLC_MEMORY_TOTAL)
+		return heap->externalMemory[category];
+
+	return 0;
+}
+
+unsigned NULLC::GetMemoryQuotaLeft(unsigned category)
+{
+	if(!heap->quotaHardLimit)
+		return ~0u;
+
+	unsigned used = GetMemoryUsage(NULLC_MEMORY_TOTAL) - GetMemoryUsage(category);
+
+	return used < heap->quotaHardLimit ? heap->quotaHardLimit - used : 0;
+}
+
+bool NULLC::CheckMemoryQuota(unsigned size)
+{
+	unsigned used = heap->usedMemory + heap->externalMemoryTotal + size;
+
+	if(heap->quotaHardLimit && used > heap->quotaHardLimit)
+	{
+		RunCollection(NULLC_GC_TRIGGER_LIMIT);
+
+		used = heap->usedMemory + heap->externalMemoryTotal + size;
+
+		if(used > heap->quotaHardLimit)
+		{
+			nullcThrowError("ERROR: reached memory quota of %u bytes (%u bytes used)", heap->quotaHardLimit, heap->usedMemory + heap->externalMemoryTotal);
+			return false;
+		}
+	}
+
+	if(!heap->quotaSoftLimit)
+		return true;
+
+	// Callback is called once when the soft limit is crossed and again only after the memory usage has dropped below it
+	if(used <= heap->quotaSoftLimit)
+	{
+		heap->quotaSoftLimitReached = false;
+	}
+	else if(!heap->quotaSoftLimitReached)
+	{
+		heap->quotaSoftLimitReached = true;
+
+		unsigned action = heap->quotaCallback ? heap->quotaCallback(heap->quotaCallbackContext, used, heap->quotaSoftLimit) : NULLC_QUOTA_CONTINUE;
+
+		if(action == NULLC_QUOTA_STOP)
+		{
+			nullcThrowError("ERROR: reached memory quota soft limit of %u bytes", heap->quotaSoftLimit);
+			return false;
+		}
+
+		if(action == NULLC_QUOTA_COLLECT)
+		{
+			RunCollection(NULLC_GC_TRIGGER_LIMIT);
+
+			if(heap->usedMemory + heap->externalMemoryTotal + size <= heap->quotaSoftLimit)
+				heap->quotaSoftLimitReached = false;
+		}
+	}
+
+	return true;
+}
+
+NULLCCollectionPolicy NULLC::GetCollectionPolicy()
+{
+	return heap->collectionPolicy;
+}
+
+unsigned NULLC::GetPointerHash(void *ptr)
+{
+	uintptr_t value = (uintptr_t)ptr;
+
+	return unsigned(value >> 3) ^ unsigned((unsigned long long)value >> 32);
+}
+
+unsigned NULLC::FindProfileSite(unsigned *frames, unsigned frameCount)
+{
+	unsigned hash = 5381;
+	for(unsigned i = 0; i < frameCount; i++)
+		hash = ((hash << 5) + hash) + frames[i];
+
+	heap->profileSiteMap.init();
+
+	for(HashMap<unsigned>::Node *curr = heap->profileSiteMap.first(hash); curr; curr = heap->profileSiteMap.next(curr))
+	{
+		ProfileSite &site = heap->profileSites[curr->value];
+
+		if(site.frameCount == frameCount && memcmp(&heap->profileFrames[site.frameOffset], frames, frameCount * sizeof(unsigned)) == 0)
+			return curr->value;
+	}
+
+	ProfileSite site;
+
+	site.hash = hash;
+	site.frameOffset = heap->profileFrames.size();
+	site.frameCount = frameCount;
+
+	memset(&site.stats, 0, sizeof(site.stats));
+
+	for(unsigned i = 0; i < frameCount; i++)
+		heap->profileFrames.push_back(frames[i]);
+
+	heap->profileSiteMap.insert(hash, heap->profileSites.size());
+
+	heap->profileSites.push_back(site);
+
+	return heap->profileSites.size() - 1;
+}
+
+void NULLC::ProfileAlloc(void *ptr, unsigned typeId, unsigned size)
+{
+	// Sample represents all the memory allocated since the last sample
+	unsigned weight = size > heap->profileSampleBytes ? size : heap->profileSampleBytes;
+
+	unsigned frameCount = 0;
+	while(nullcDebugEnumStackFrame(frameCount))
+		frameCount++;
+
+	// Keep the innermost frames and the type as the last frame
+	unsigned frames[profileMaxFrames + 1];
+
+	unsigned firstFrame = frameCount > profileMaxFrames ? frameCount - profileMaxFrames : 0;
+
+	for(unsigned i = firstFrame; i < frameCount; i++)
+		frames[i - firstFrame] = nullcDebugEnumStackFrame(i);
+
+	frames[frameCount - firstFrame] = typeId;
+
+	unsigned siteIndex = FindProfileSite(frames, frameCount - firstFrame + 1);
+
+	while(typeId >= heap->profileTypes.size())
+	{
+		NULLCAllocationStats &stats = *heap->profileTypes.push_back();
+
+		memset(&stats, 0, sizeof(stats));
+	}
+
+	NULLCAllocationStats* statList[2] = { &heap->profileTypes[typeId], &heap->profileSites[siteIndex].stats };
+
+	for(unsigned i = 0; i < 2; i++)
+	{
+		statList[i]->liveBytes += weight;
+		statList[i]->liveCount++;
+
+		statList[i]->totalBytes += weight;
+		statList[i]->totalCount++;
+	}
+
+	ProfileSample sample;
+
+	sample.ptr = ptr;
+	sample.typeId = typeId;
+	sample.site = siteIndex;
+	sample.weight = weight;
+
+	heap->profileSampleMap.init();
+	heap->profileSampleMap.insert(GetPointerHash(ptr), heap->profileSamples.size());
+
+	heap->profileSamples.push_back(sample);
+}
+
+void NULLC::ProfileFree(void* ptr)
+{
+	// Samples might have been cleared before the object was freed
+	if(heap->profileSamples.empty())
+		return;
+
+	unsigned hash = GetPointerHash(ptr);
+
+	unsigned index = ~0u;
+
+	for(HashMap<unsigned>::Node *curr = heap->profileSampleMap.first(hash); curr && index == ~0u; curr = heap->profileSampleMap.next(curr))
+	{
+		if(heap->profileSamples[curr->value].ptr == ptr)
+			index = curr->value;
+	}
+
+	if(index == ~0u)
+		return;
+
+	ProfileSample &sample = heap->profileSamples[index];
+
+	NULLCAllocationStats* statList[2] = { &heap->profileTypes[sample.typeId], &heap->profileSites[sample.site].stats };
+
+	for(unsigned i = 0; i < 2; i++)
+	{
+		statList[i]->liveBytes -= sample.weight;
+		statList[i]->liveCount--;
+	}
+
+	// Move the last sample in place of the removed one
+	heap->profileSampleMap.remove(hash, index);
+
+	unsigned last = heap->profileSamples.size() - 1;
+
+	if(index != last)
+	{
+		heap->profileSampleMap.remove(GetPointerHash(heap->profileSamples[last].ptr), last);
+
+		heap->profileSamples[index] = heap->profileSamples[last];
+
+		heap->profileSampleMap.insert(GetPointerHash(heap->profileSamples[index].ptr), index);
+	}
+
+	heap->profileSamples.pop_back();
+}
+
+void NULLC::SetAllocationProfiler(unsigned sampleBytes)
+{
+	ClearAllocationProfile();
+
+	heap->profileSampleBytes = sampleBytes;
+	heap->profileNextSample = 0;
+}
+
+void NULLC::ClearAllocationProfile()
+{
+	if(heap->profileSites.empty())
+		return;
+
+	heap->profileTypes.clear();
+	heap->profileSites.clear();
+	heap->profileFrames.clear();
+	heap->profileSiteMap.clear();
+
+	heap->profileSamples.clear();
+	heap->profileSampleMap.clear();
+}
+
+bool NULLC::GetAllocationTypeStats(unsigned typeId, NULLCAllocationStats &stats)
+{
+	if(typeId >= heap->profileTypes.size())
+	{
+		memset(&stats, 0, sizeof(stats));
+		return false;
+	}
+
+	stats = heap->profileTypes[typeId];
+	return true;
+}
+
+bool NULLC::GetAllocationSiteStats(unsigned siteId, NULLCAllocationStats &stats, unsigned &typeId, const unsigned **frames, unsigned &frameCount)
+{
+	if(siteId >= heap->profileSites.size())
+		return false;
+
+	ProfileSite &site = heap->profileSites[siteId];
+
+	stats = site.stats;
+
+	// Type is stored after the last stack frame
+	typeId = heap->profileFrames[site.frameOffset + site.frameCount - 1];
+
+	if(frames)
+		*frames = &heap->profileFrames[site.frameOffset];
+
+	frameCount = site.frameCount - 1;
+
+	return true;
+}
+
+namespace
+{
+	struct ProfileFunctionRange
+	{
+		unsigned start;
+		unsigned end;
+
+		const char *name;
+	};
+
+	int SortByStartAddress(const void *a, const void *b)
+	{
+		unsigned lhs = ((const ProfileFunctionRange*)a)->start;
+		unsigned rhs = ((const ProfileFunctionRange*)b)->start;
+
+		return lhs < rhs ? -1 : (lhs > rhs ? 1 : 0);
+	}
+
+	const char* FindProfileFunctionName(FastVector<ProfileFunctionRange> &ranges, unsigned address)
+	{
+		unsigned lower = 0, upper = ranges.size();
+
+		// Find the last function starting at or before the address
+		while(lower < upper)
+		{
+			unsigned middle = (lower + upper) / 2;
+
+			if(ranges[middle].start <= address)
+				lower = middle + 1;
+			else
+				upper = middle;
+		}
+
+		if(lower != 0 && address < ranges[lower - 1].end)
+			return ranges[lower - 1].name;
+
+		return "nullcGlobal()";
+	}
+}
+
+void NULLC::SaveAllocationProfile(OutputContext &output, unsigned format)
+{
+	if(format == NULLC_ALLOCATION_PROFILE_FOLDED)
+	{
+		FastVector<ProfileFunctionRange> ranges;
+
+		for(unsigned i = 0; i < linker->exFunctions.size(); i++)
+		{
+			ExternFuncInfo &function = linker->exFunctions[i];
+
+			if(function.regVmAddress == -1 || function.regVmCodeSize == 0)
+				continue;
+
+			ProfileFunctionRange range;
+
+			range.start = unsigned(function.regVmAddress);
+			range.end = unsigned(function.regVmAddress + function.regVmCodeSize);
+			range.name = linker->exSymbols.data + function.offsetToName;
+
+			ranges.push_back(range);
+		}
+
+		if(!ranges.empty())
+			qsort(ranges.data, ranges.size(), sizeof(ranges[0]), SortByStartAddress);
+
+		for(unsigned i = 0; i < heap->profileSites.size(); i++)
+		{
+			ProfileSite &site = heap->profileSites[i];
+
+			if(!site.stats.totalBytes)
+				continue;
+
+			output.Print("nullcGlobal()");
+
+			for(unsigned k = 0; k + 1 < site.frameCount; k++)
+			{
+				unsigned address = heap->profileFrames[site.frameOffset + k];
+
+				const char *name = FindProfileFunctionName(ranges, address);
+
+				// Skip frames of the global code
+				if(k == 0 && strcmp(name, "nullcGlobal()") == 0)
+					continue;
+
+				output.Printf(";%s", name);
+			}
+
+			unsigned typeId = heap->profileFrames[site.frameOffset + site.frameCount - 1];
+
+			output.Printf(";new %s %llu\n", linker->exSymbols.data + linker->exTypes[typeId].offsetToName, site.stats.totalBytes);
+		}
+	}
+	else if(format == NULLC_ALLOCATION_PROFILE_HEAP)
+	{
+		NULLCAllocationStats totals;
+		memset(&totals, 0, sizeof(totals));
+
+		for(unsigned i = 0; i < heap->profileSites.size(); i++)
+		{
+			totals.liveCount += heap->profileSites[i].stats.liveCount;
+			totals.liveBytes += heap->profileSites[i].stats.liveBytes;
+			totals.totalCount += heap->profileSites[i].stats.totalCount;
+			totals.totalBytes += heap->profileSites[i].stats.totalBytes;
+		}
+
+		output.Printf("heap profile: %u: %llu [%u: %llu] @ heap_v2/%u\n", totals.liveCount, totals.liveBytes, totals.totalCount, totals.totalBytes, heap->profileSampleBytes);
+
+		for(unsigned i = 0; i < heap->profileSites.size(); i++)
+		{
+			ProfileSite &site = heap->profileSites[i];
+
+			output.Printf("%u: %llu [%u: %llu] @", site.stats.liveCount, site.stats.liveBytes, site.stats.totalCount, site.stats.totalBytes);
+
+			// Addresses are VM instruction indices, innermost frame goes first
+			for(unsigned k = site.frameCount - 1; k > 0; k--)
+				output.Printf(" 0x%x", heap->profileFrames[site.frameOffset + k - 1]);
+
+			output.Print("\n");
+		}
+	}
+
+	output.Flush();
 }
 
 void NULLC::Assert(int val)
@@ -1437,7 +2621,7 @@ void NULLC::AutoArray(NULLCAutoArray* arr, int type, unsigned count)
 		nullcThrowError("ERROR: null pointer access");
 		return;
 	}
-	if((unsigned long long)count * linker->exTypes[type].size > globalMemoryLimit)
+	if((unsigned long long)count * linker->exTypes[type].size > heap->globalMemoryLimit)
 	{
 		nullcThrowError("ERROR: can't allocate array with %u elements of size %u", count, linker->exTypes[type].size);
 		return;
@@ -1523,8 +2707,8 @@ void NULLC::AssertCoroutine(NULLCRef f)
 NULLCArray NULLC::GetFinalizationList()
 {
 	NULLCArray arr;
-	arr.ptr = (char*)finalizeList.data;
-	arr.len = finalizeList.size();
+	arr.ptr = (char*)heap->finalizeActiveList.data;
+	arr.len = heap->finalizeActiveList.size();
 	return arr;
 }
 
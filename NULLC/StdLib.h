@@ -4,6 +4,8 @@
 
 class Linker;
 
+struct OutputContext;
+
 struct NULLCArray;
 struct NULLCRef;
 struct NULLCFuncPtr;
@@ -13,6 +15,13 @@ namespace NULLC
 {
 	void	SetLinker(Linker *linker);
 
+	struct GlobalHeap;
+
+	GlobalHeap*	CreateHeap();
+	void		DestroyHeap(GlobalHeap *heap);
+	void		SetHeap(GlobalHeap *heap);
+	GlobalHeap*	GetHeap();
+
 	void	Assert(int val);
 	void	Assert2(int val, NULLCArray message);
 
@@ -53,13 +62,22 @@ namespace NULLC
 	int			CompareObjects(NULLCRef l, NULLCRef r);
 	void		AssignObject(NULLCRef l, NULLCRef r);
 
-	void		MarkMemory(unsigned int number);
+	void		UnmarkMemory();
 	void		CollectUnmarked();
 	void		FinalizePending();
-	void		FreePending();
+	void		FreePending(unsigned *freedObjects);
+	void		StartSweep(NULLCCollectionInfo &info, unsigned executionTime);
+	bool		SweepMemory(unsigned pageCount);
 
 	bool		IsBasePointer(void* ptr);
 	void*		GetBasePointer(void* ptr);
+	unsigned	GetBlockSize(void* basePtr);
+
+	bool		RegisterHostRegion(void *data, unsigned size, void (*release)(void *data, void *context), void *context);
+	bool		ReleaseHostRegion(void *data);
+	void		MarkHostRegion(void *ptr);
+	bool		IsHostPointer(void *ptr);
+	unsigned	HostRegionCount();
 
 	void		SetCollectMemory(bool enabled);
 	void		CollectMemory();
@@ -67,11 +85,35 @@ namespace NULLC
 	double		MarkTime();
 	double		CollectTime();
 
+	unsigned	CollectionCount();
+	bool		GetCollectionInfo(unsigned id, NULLCCollectionInfo &info);
+	unsigned	GetCollectionHistogram(unsigned phase, unsigned bucket);
+	void		ResetCollectionStatistics();
+
 	void		FinalizeMemory();
+	void		MarkFinalizeQueue();
+	bool		RunFinalizers();
+	void		SetDeferredFinalization(bool enabled);
+	unsigned	PendingFinalizerCount();
 	void		ClearMemory();
 	void		ResetMemory();
 
 	void		SetGlobalLimit(unsigned int limit);
+	void		SetCollectionPolicy(const NULLCCollectionPolicy *policy);
+	NULLCCollectionPolicy	GetCollectionPolicy();
+
+	void		SetMemoryQuota(unsigned softLimit, unsigned hardLimit);
+	void		SetMemoryQuotaCallback(void *context, unsigned (*callback)(void *context, unsigned used, unsigned softLimit));
+	void		SetExternalMemory(GlobalHeap *target, unsigned category, unsigned bytes);
+	unsigned	GetMemoryUsage(unsigned category);
+	unsigned	GetMemoryQuotaLeft(unsigned category);
+	bool		CheckMemoryQuota(unsigned size);
+
+	void		SetAllocationProfiler(unsigned sampleBytes);
+	void		ClearAllocationProfile();
+	bool		GetAllocationTypeStats(unsigned typeId, NULLCAllocationStats &stats);
+	bool		GetAllocationSiteStats(unsigned siteId, NULLCAllocationStats &stats, unsigned &typeId, const unsigned **frames, unsigned &frameCount);
+	void		SaveAllocationProfile(OutputContext &output, unsigned format);
 
 	NULLCFuncPtr	FunctionRedirect(NULLCRef r, NULLCArray* arr);
 	NULLCFuncPtr	FunctionRedirectPtr(NULLCRef r, NULLCArray* arr);
@@ -1057,6 +1057,8 @@ struct TypeGenericClassProto: TypeBase
 	TypeGenericClassProto(const SynIdentifier& identifier, SynBase *source, ScopeData *scope, SynClassDefinition *definition): TypeBase(myTypeID, identifier.name), identifier(identifier), source(source), scope(scope), definition(definition)
 	{
 		isGeneric = true;
+
+		delayedDefinition = NULL;
 	}
 
 	SynIdentifier identifier;
@@ -1066,6 +1068,7 @@ struct TypeGenericClassProto: TypeBase
 	ScopeData *scope;
 
 	SynClassDefinition *definition;
+	Lexeme *delayedDefinition;
 
 	IntrusiveList<ExprBase> instances;
 
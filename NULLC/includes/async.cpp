@@ -0,0 +1,491 @@
+#include "async.h"
+
+#include "../../NULLC/nullc.h"
+#include "../../NULLC/nullbind.h"
+#include "../../NULLC/Array.h"
+
+#include <time.h>
+
+#if defined(__linux)
+	#include <sys/epoll.h>
+	#include <unistd.h>
+	#include <errno.h>
+#elif defined(_WIN32)
+	#include <Windows.h>
+#endif
+
+namespace NULLCTime
+{
+	double clockPrecise();
+}
+
+namespace NULLCAsync
+{
+	enum FutureKind
+	{
+		FUTURE_HOST,
+		FUTURE_TIMER,
+		FUTURE_READ,
+		FUTURE_WRITE
+	};
+
+	struct Future
+	{
+		bool used;
+		bool ready;
+
+		FutureKind kind;
+
+		long long result;
+
+		int fd;
+		double deadline;
+	};
+}
+
+// Futures of an execution context, each context has its own event queue
+struct nullcAsyncState
+{
+	nullcAsyncState(): readyPos(0), pendingFds(0), epollFd(-1)
+	{
+	}
+
+	// Future ids start at 1, slot 0 is never used
+	FastVector<NULLCAsync::Future> futures;
+	FastVector<int> freeFutures;
+
+	// Futures that became ready since the last async_next_ready call
+	FastVector<int> readyFutures;
+	unsigned readyPos;
+
+	// Futures waiting for an fd or a timer
+	unsigned pendingFds;
+	FastVector<int> pendingTimers;
+
+	int epollFd;
+};
+
+namespace NULLCAsync
+{
+	nullcAsyncState defaultState;
+
+	// State of the execution context that is current on the thread
+	NULLC_THREAD_LOCAL nullcAsyncState *state = &defaultState;
+
+	void ResetState(nullcAsyncState &target)
+	{
+		target.futures.reset();
+		target.freeFutures.reset();
+
+		target.readyFutures.reset();
+		target.readyPos = 0;
+
+		target.pendingFds = 0;
+		target.pendingTimers.reset();
+
+#if defined(__linux)
+		if(target.epollFd != -1)
+			close(target.epollFd);
+#endif
+
+		target.epollFd = -1;
+	}
+
+	int CreateFuture(FutureKind kind)
+	{
+		if(state->futures.empty())
+		{
+			Future empty;
+			memset(&empty, 0, sizeof(empty));
+
+			state->futures.push_back(empty);
+		}
+
+		int id = 0;
+
+		if(!state->freeFutures.empty())
+		{
+			id = state->freeFutures.back();
+			state->freeFutures.pop_back();
+		}
+		else
+		{
+			id = int(state->futures.size());
+
+			state->futures.push_back(Future());
+		}
+
+		Future &future = state->futures[id];
+
+		future.used = true;
+		future.ready = false;
+		future.kind = kind;
+		future.result = 0;
+		future.fd = -1;
+		future.deadline = 0.0;
+
+		return id;
+	}
+
+	bool future_valid(int id)
+	{
+		return id > 0 && unsigned(id) < state->futures.size() && state->futures[id].used;
+	}
+
+	Future* GetFuture(int id)
+	{
+		if(!future_valid(id))
+		{
+			nullcThrowError("ERROR: future %d is not valid", id);
+			return NULL;
+		}
+
+		return &state->futures[id];
+	}
+
+	void CompleteFuture(int id, long long result)
+	{
+		Future &future = state->futures[id];
+
+		if(future.ready)
+			return;
+
+		future.ready = true;
+		future.result = result;
+
+		state->readyFutures.push_back(id);
+	}
+
+	void RemoveTimer(int id)
+	{
+		for(unsigned i = 0; i < state->pendingTimers.size(); i++)
+		{
+			if(state->pendingTimers[i] == id)
+			{
+				state->pendingTimers[i] = state->pendingTimers.back();
+				state->pendingTimers.pop_back();
+				return;
+			}
+		}
+	}
+
+	void RemoveFd(Future &future)
+	{
+#if defined(__linux)
+		epoll_ctl(state->epollFd, EPOLL_CTL_DEL, future.fd, NULL);
+#endif
+
+		state->pendingFds--;
+		future.fd = -1;
+	}
+
+	int fd_future(int fd, FutureKind kind)
+	{
+#if defined(__linux)
+		if(state->epollFd == -1)
+			state->epollFd = epoll_create1(EPOLL_CLOEXEC);
+
+		if(state->epollFd == -1)
+		{
+			nullcThrowError("ERROR: failed to create an event queue");
+			return 0;
+		}
+
+		int id = CreateFuture(kind);
+
+		epoll_event event;
+		memset(&event, 0, sizeof(event));
+
+		event.events = (kind == FUTURE_READ ? EPOLLIN : EPOLLOUT) | EPOLLONESHOT;
+		event.data.u32 = unsigned(id);
+
+		if(epoll_ctl(state->epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+		{
+			state->futures[id].used = false;
+			state->freeFutures.push_back(id);
+
+			if(errno == EEXIST)
+				nullcThrowError("ERROR: fd %d already has a pending future", fd);
+			else
+				nullcThrowError("ERROR: fd %d can't be waited for", fd);
+
+			return 0;
+		}
+
+		state->futures[id].fd = fd;
+		state->pendingFds++;
+
+		return id;
+#else
+		(void)fd;
+		(void)kind;
+
+		nullcThrowError("ERROR: fd readiness is not supported on this platform");
+		return 0;
+#endif
+	}
+
+	int read_ready(int fd)
+	{
+		return fd_future(fd, FUTURE_READ);
+	}
+
+	int write_ready(int fd)
+	{
+		return fd_future(fd, FUTURE_WRITE);
+	}
+
+	int sleep(int milliseconds)
+	{
+		int id = CreateFuture(FUTURE_TIMER);
+
+		state->futures[id].deadline = NULLCTime::clockPrecise() + (milliseconds > 0 ? milliseconds : 0);
+
+		state->pendingTimers.push_back(id);
+
+		return id;
+	}
+
+	int host_future()
+	{
+		return CreateFuture(FUTURE_HOST);
+	}
+
+	bool future_ready(int id)
+	{
+		if(Future *future = GetFuture(id))
+			return future->ready;
+
+		return false;
+	}
+
+	long long future_result(int id)
+	{
+		if(Future *future = GetFuture(id))
+			return future->result;
+
+		return 0;
+	}
+
+	void future_release(int id)
+	{
+		Future *future = GetFuture(id);
+
+		if(!future)
+			return;
+
+		if(!future->ready)
+		{
+			if(future->kind == FUTURE_TIMER)
+				RemoveTimer(id);
+			else if(future->kind == FUTURE_READ || future->kind == FUTURE_WRITE)
+				RemoveFd(*future);
+		}
+
+		future->used = false;
+		state->freeFutures.push_back(id);
+	}
+
+	// Wait until at least one future is ready or until 'timeout' milliseconds pass (negative timeout waits without a limit)
+	// Returns the number of ready futures. If there is nothing to wait for, the function doesn't block
+	int async_poll(int timeout)
+	{
+		if(state->readyPos == state->readyFutures.size())
+		{
+			state->readyFutures.clear();
+			state->readyPos = 0;
+		}
+
+		if(state->readyPos != state->readyFutures.size())
+			timeout = 0;
+
+		if(!state->pendingFds && state->pendingTimers.empty())
+			return int(state->readyFutures.size() - state->readyPos);
+
+		double time = NULLCTime::clockPrecise();
+
+		for(unsigned i = 0; i < state->pendingTimers.size(); i++)
+		{
+			double remaining = state->futures[state->pendingTimers[i]].deadline - time;
+
+			int wait = remaining > 0.0 ? int(remaining + 0.999) : 0;
+
+			if(timeout < 0 || wait < timeout)
+				timeout = wait;
+		}
+
+#if defined(__linux)
+		if(state->pendingFds)
+		{
+			epoll_event events[64];
+
+			int count = epoll_wait(state->epollFd, events, 64, timeout);
+
+			for(int i = 0; i < count; i++)
+			{
+				int id = int(events[i].data.u32);
+
+				Future &future = state->futures[id];
+
+				RemoveFd(future);
+
+				CompleteFuture(id, events[i].events);
+			}
+		}
+		else if(timeout > 0)
+		{
+			usleep(timeout * 1000);
+		}
+#elif defined(_WIN32)
+		if(timeout > 0)
+			Sleep(timeout);
+#endif
+
+		time = NULLCTime::clockPrecise();
+
+		for(unsigned i = 0; i < state->pendingTimers.size();)
+		{
+			int id = state->pendingTimers[i];
+
+			if(state->futures[id].deadline <= time)
+			{
+				state->pendingTimers[i] = state->pendingTimers.back();
+				state->pendingTimers.pop_back();
+
+				CompleteFuture(id, 0);
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		return int(state->readyFutures.size() - state->readyPos);
+	}
+
+	// Futures might be released after they became ready
+	int async_next_ready()
+	{
+		if(state->readyPos == state->readyFutures.size())
+			return 0;
+
+		return state->readyFutures[state->readyPos++];
+	}
+
+	bool async_has_pending()
+	{
+		return state->pendingFds != 0 || !state->pendingTimers.empty();
+	}
+
+	int read(int fd, NULLCArray buffer)
+	{
+#if defined(__linux)
+		return int(::read(fd, buffer.ptr, buffer.len));
+#else
+		(void)fd;
+		(void)buffer;
+
+		nullcThrowError("ERROR: fd access is not supported on this platform");
+		return -1;
+#endif
+	}
+
+	int write(int fd, NULLCArray data)
+	{
+#if defined(__linux)
+		return int(::write(fd, data.ptr, data.len));
+#else
+		(void)fd;
+		(void)data;
+
+		nullcThrowError("ERROR: fd access is not supported on this platform");
+		return -1;
+#endif
+	}
+}
+
+int nullcAsyncCreateFuture()
+{
+	return NULLCAsync::CreateFuture(NULLCAsync::FUTURE_HOST);
+}
+
+bool nullcAsyncCompleteFuture(int id, long long result)
+{
+	using namespace NULLCAsync;
+
+	if(!future_valid(id) || state->futures[id].kind != FUTURE_HOST)
+		return false;
+
+	CompleteFuture(id, result);
+
+	return true;
+}
+
+unsigned nullcAsyncFutureCount()
+{
+	using namespace NULLCAsync;
+
+	return state->futures.empty() ? 0 : state->futures.size() - 1 - state->freeFutures.size();
+}
+
+#define REGISTER_FUNC(funcPtr, name, index) if(!nullcBindModuleFunctionHelper("std.async", NULLCAsync::funcPtr, name, index)) return false;
+
+bool	nullcInitAsyncModule()
+{
+	REGISTER_FUNC(read_ready, "async_read_ready", 0);
+	REGISTER_FUNC(write_ready, "async_write_ready", 0);
+	REGISTER_FUNC(sleep, "async_sleep", 0);
+	REGISTER_FUNC(host_future, "async_host_future", 0);
+
+	REGISTER_FUNC(future_valid, "async_future_valid", 0);
+	REGISTER_FUNC(future_ready, "async_future_ready", 0);
+	REGISTER_FUNC(future_result, "async_future_result", 0);
+	REGISTER_FUNC(future_release, "async_future_release", 0);
+
+	REGISTER_FUNC(async_poll, "async_poll", 0);
+	REGISTER_FUNC(async_next_ready, "async_next_ready", 0);
+	REGISTER_FUNC(async_has_pending, "async_has_pending", 0);
+
+	REGISTER_FUNC(read, "async_fd_read", 0);
+	REGISTER_FUNC(write, "async_fd_write", 0);
+
+	return true;
+}
+
+void	nullcDeinitAsyncModule()
+{
+	using namespace NULLCAsync;
+
+	ResetState(defaultState);
+}
+
+nullcAsyncState*	nullcAsyncCreateState()
+{
+	return NULLC::construct<nullcAsyncState>();
+}
+
+void	nullcAsyncDestroyState(nullcAsyncState *target)
+{
+	using namespace NULLCAsync;
+
+	if(!target)
+		return;
+
+	ResetState(*target);
+
+	NULLC::destruct(target);
+}
+
+void	nullcAsyncResetState()
+{
+	using namespace NULLCAsync;
+
+	ResetState(*state);
+}
+
+void	nullcAsyncSetState(nullcAsyncState *target)
+{
+	using namespace NULLCAsync;
+
+	state = target ? target : &defaultState;
+}
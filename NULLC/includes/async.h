@@ -0,0 +1,23 @@
+#pragma once
+
+bool	nullcInitAsyncModule();
+void	nullcDeinitAsyncModule();
+
+// Futures and the event queue of an execution context. Null state is the state of the default context
+struct nullcAsyncState;
+
+nullcAsyncState*	nullcAsyncCreateState();
+void	nullcAsyncDestroyState(nullcAsyncState *state);
+void	nullcAsyncSetState(nullcAsyncState *state);
+
+// Release futures, timers and the event queue of the current context when its program is cleaned or replaced
+void	nullcAsyncResetState();
+
+// Create a future in the current context that is completed by the host with nullcAsyncCompleteFuture. Returns 0 on failure
+int		nullcAsyncCreateFuture();
+
+// Complete a host future of the current context with a result value. Coroutines waiting for it are resumed by the next async_run call
+bool	nullcAsyncCompleteFuture(int id, long long result);
+
+// Returns the number of futures of the current context that are not released
+unsigned	nullcAsyncFutureCount();
@@ -3,12 +3,14 @@
 #include "../nullc.h"
 #include "../nullbind.h"
 #include "../nullc_debug.h"
+#include "../nullc_internal.h"
 
 #include "../StrAlgo.h"
 
 namespace NULLCDynamic
 {
-	Linker *linker = NULL;
+	// Linker of the execution context that is current on the thread
+	NULLC_THREAD_LOCAL Linker *linker = NULL;
 
 	void OverrideFunction(NULLCRef dest, NULLCRef src)
 	{
@@ -52,15 +54,24 @@ namespace NULLCDynamic
 		for(unsigned int i = 0, memberCount = linker->exTypes[dest.typeID].memberCount; i != memberCount; i++)
 			it += NULLC::SafeSprintf(it, 2048 - int(it - tmp), "%s arg%d%s", &linker->exSymbols[0] + linker->exTypes[memberList[i + 1].type].offsetToName, i, i == memberCount - 1 ? "" : ", ");
 		it += NULLC::SafeSprintf(it, 2048 - int(it - tmp), "){ %s }", code.ptr);
+
+		// Other threads can't use the compiler until the bytecode is taken
+		nullcLockCompiler();
+
 		overrideID++;
 
 		if(!nullcCompile(tmp))
 		{
+			nullcUnlockCompiler();
+
 			nullcThrowError("%s", nullcGetLastError());
 			return;
 		}
 		char *bytecode = NULL;
 		nullcGetBytecodeNoCache(&bytecode);
+
+		nullcUnlockCompiler();
+
 		if(!nullcLinkCode(bytecode))
 		{
 			delete[] bytecode;
@@ -84,6 +95,11 @@ bool	nullcInitDynamicModule(Linker* linker)
 	return true;
 }
 
+void	nullcInitDynamicModuleLinkerOnly(Linker* linker)
+{
+	NULLCDynamic::linker = linker;
+}
+
 void	nullcDeinitDynamicModule()
 {
 	NULLCDynamic::linker = NULL;
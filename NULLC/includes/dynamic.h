@@ -3,4 +3,5 @@
 #include "../Linker.h"
 
 bool	nullcInitDynamicModule(Linker* linker);
+void	nullcInitDynamicModuleLinkerOnly(Linker* linker);
 void	nullcDeinitDynamicModule();
@@ -4,6 +4,62 @@
 
 #include "../StdLib.h"
 
+namespace NULLCGC
+{
+	void SetAllocationProfiler(int sampleBytes)
+	{
+		if(sampleBytes < 0)
+		{
+			nullcThrowError("ERROR: sample interval can't be negative");
+			return;
+		}
+
+		NULLC::SetAllocationProfiler(unsigned(sampleBytes));
+	}
+
+	long long LiveBytes(unsigned typeID)
+	{
+		NULLCAllocationStats stats;
+		NULLC::GetAllocationTypeStats(typeID, stats);
+
+		return (long long)stats.liveBytes;
+	}
+
+	long long TotalBytes(unsigned typeID)
+	{
+		NULLCAllocationStats stats;
+		NULLC::GetAllocationTypeStats(typeID, stats);
+
+		return (long long)stats.totalBytes;
+	}
+
+	int CollectionCount()
+	{
+		return int(NULLC::CollectionCount());
+	}
+
+	double LastPauseTime()
+	{
+		NULLCCollectionInfo info;
+
+		if(!NULLC::GetCollectionInfo(0, info))
+			return 0.0;
+
+		return (info.markTime + info.sweepTime + info.finalizeTime) / 1000.0;
+	}
+
+	int PauseHistogram(int bucket)
+	{
+		if(unsigned(bucket) >= NULLC_GC_HISTOGRAM_SIZE)
+		{
+			nullcThrowError("ERROR: histogram bucket index is out of range");
+			return 0;
+		}
+
+		return int(NULLC::GetCollectionHistogram(NULLC_GC_PHASE_TOTAL, unsigned(bucket)));
+	}
+}
+
 #define REGISTER_FUNC(funcPtr, name, index) if(!nullcBindModuleFunctionHelper("std.gc", NULLC::funcPtr, name, index)) return false;
 bool	nullcInitGCModule()
 {
@@ -12,5 +68,13 @@ bool	nullcInitGCModule()
 	REGISTER_FUNC(MarkTime, "NamespaceGC::MarkTime", 0);
 	REGISTER_FUNC(CollectTime, "NamespaceGC::CollectTime", 0);
 
+	if(!nullcBindModuleFunctionHelper("std.gc", NULLCGC::SetAllocationProfiler, "NamespaceGC::SetAllocationProfiler", 0)) return false;
+	if(!nullcBindModuleFunctionHelper("std.gc", NULLCGC::LiveBytes, "NamespaceGC::LiveBytes", 0)) return false;
+	if(!nullcBindModuleFunctionHelper("std.gc", NULLCGC::TotalBytes, "NamespaceGC::TotalBytes", 0)) return false;
+
+	if(!nullcBindModuleFunctionHelper("std.gc", NULLCGC::CollectionCount, "NamespaceGC::CollectionCount", 0)) return false;
+	if(!nullcBindModuleFunctionHelper("std.gc", NULLCGC::LastPauseTime, "NamespaceGC::LastPauseTime", 0)) return false;
+	if(!nullcBindModuleFunctionHelper("std.gc", NULLCGC::PauseHistogram, "NamespaceGC::PauseHistogram", 0)) return false;
+
 	return true;
 }
@@ -0,0 +1,393 @@
+#include "task.h"
+
+#include "../../NULLC/nullc.h"
+#include "../../NULLC/nullbind.h"
+#include "../../NULLC/nullc_debug.h"
+
+#include <string.h>
+
+#if defined(_WIN32)
+	#include <windows.h>
+	#include <process.h>
+#else
+	#include <pthread.h>
+	#include <unistd.h>
+#endif
+
+namespace NULLCTask
+{
+	bool is_coroutine(NULLCRef function)
+	{
+		if(!function.ptr)
+		{
+			nullcThrowError("ERROR: null pointer access");
+			return false;
+		}
+
+		ExternTypeInfo *exTypes = nullcDebugTypeInfo(NULL);
+
+		if(exTypes[function.typeID].subCat != ExternTypeInfo::CAT_FUNCTION)
+		{
+			nullcThrowError("ERROR: argument is not a function");
+			return false;
+		}
+
+		ExternFuncInfo *exFunctions = nullcDebugFunctionInfo(NULL);
+
+		NULLCFuncPtr functionValue = *(NULLCFuncPtr*)function.ptr;
+
+		return exFunctions[functionValue.id].funcCat == ExternFuncInfo::COROUTINE;
+	}
+
+#if defined(_WIN32)
+	struct WorkerLock
+	{
+		void Init(){ InitializeCriticalSection(&section); }
+		void Destroy(){ DeleteCriticalSection(&section); }
+
+		void Lock(){ EnterCriticalSection(&section); }
+		void Unlock(){ LeaveCriticalSection(&section); }
+
+		CRITICAL_SECTION section;
+	};
+#else
+	struct WorkerLock
+	{
+		void Init(){ pthread_mutex_init(&mutex, NULL); }
+		void Destroy(){ pthread_mutex_destroy(&mutex); }
+
+		void Lock(){ pthread_mutex_lock(&mutex); }
+		void Unlock(){ pthread_mutex_unlock(&mutex); }
+
+		pthread_mutex_t mutex;
+	};
+#endif
+
+	struct WorkerQueue
+	{
+		nullcProgram *program;
+		unsigned executor;
+
+		NULLCFuncPtr function;
+
+		unsigned typeID;
+		unsigned elementSize;
+
+		const char *source;
+		char *result;
+
+		unsigned count;
+		unsigned chunkSize;
+
+		unsigned nextChunk;
+
+		WorkerLock lock;
+
+		bool failed;
+		char error[256];
+	};
+
+	const unsigned maxWorkers = 64;
+	const unsigned workerStackSize = 8 * 1024 * 1024;
+
+	void FailWorkerQueue(WorkerQueue &queue, const char *error)
+	{
+		queue.lock.Lock();
+
+		// First error is reported
+		if(!queue.failed)
+		{
+			queue.failed = true;
+
+			strncpy(queue.error, error, sizeof(queue.error) - 1);
+			queue.error[sizeof(queue.error) - 1] = 0;
+		}
+
+		queue.lock.Unlock();
+	}
+
+	bool CallWorkerFunction(WorkerQueue &queue, nullcContext *context, unsigned index)
+	{
+		const char *source = queue.source + index * queue.elementSize;
+		char *result = queue.result + index * queue.elementSize;
+
+		switch(queue.typeID)
+		{
+		case NULLC_TYPE_INT:
+			if(!nullcContextCallFunction(context, queue.function, *(int*)source))
+				return false;
+			*(int*)result = nullcGetResultInt();
+			break;
+		case NULLC_TYPE_LONG:
+			if(!nullcContextCallFunction(context, queue.function, *(long long*)source))
+				return false;
+			*(long long*)result = nullcGetResultLong();
+			break;
+		case NULLC_TYPE_FLOAT:
+			if(!nullcContextCallFunction(context, queue.function, double(*(float*)source)))
+				return false;
+			*(float*)result = float(nullcGetResultDouble());
+			break;
+		case NULLC_TYPE_DOUBLE:
+			if(!nullcContextCallFunction(context, queue.function, *(double*)source))
+				return false;
+			*(double*)result = nullcGetResultDouble();
+			break;
+		}
+
+		return true;
+	}
+
+	void RunWorker(WorkerQueue &queue)
+	{
+		// Worker thread doesn't use the default context
+		nullcContextDetach();
+
+		nullcContext *context = nullcContextCreate();
+
+		if(!context)
+		{
+			FailWorkerQueue(queue, nullcGetLastError());
+			return;
+		}
+
+		// Context is selected first, so that the executor is not set for the default context
+		if(!nullcContextMakeCurrent(context))
+		{
+			FailWorkerQueue(queue, nullcGetLastError());
+
+			nullcContextDestroy(context);
+			return;
+		}
+
+		nullcSetExecutor(queue.executor);
+
+		// Global code is not executed, global variables are in their initial state
+		if(!nullcContextLoadProgram(context, queue.program))
+		{
+			FailWorkerQueue(queue, nullcGetLastError());
+
+			nullcContextDestroy(context);
+			return;
+		}
+
+		for(;;)
+		{
+			// Workers take the next chunk when they are done with the previous one, so that a slow chunk doesn't hold back the others
+			queue.lock.Lock();
+
+			unsigned start = queue.nextChunk * queue.chunkSize;
+
+			bool finished = queue.failed || start >= queue.count;
+
+			if(!finished)
+				queue.nextChunk++;
+
+			queue.lock.Unlock();
+
+			if(finished)
+				break;
+
+			unsigned end = start + queue.chunkSize < queue.count ? start + queue.chunkSize : queue.count;
+
+			for(unsigned i = start; i < end; i++)
+			{
+				if(!CallWorkerFunction(queue, context, i))
+				{
+					FailWorkerQueue(queue, nullcGetLastError());
+					break;
+				}
+			}
+		}
+
+		nullcContextDestroy(context);
+	}
+
+#if defined(_WIN32)
+	unsigned __stdcall RunWorkerThread(void *queue)
+	{
+		RunWorker(*(WorkerQueue*)queue);
+
+		return 0;
+	}
+#else
+	void* RunWorkerThread(void *queue)
+	{
+		RunWorker(*(WorkerQueue*)queue);
+
+		return NULL;
+	}
+#endif
+
+	unsigned GetProcessorCount()
+	{
+#if defined(_WIN32)
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+
+		return info.dwNumberOfProcessors;
+#else
+		long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+		return count > 0 ? unsigned(count) : 1;
+#endif
+	}
+
+	NULLCArray parallel_map(NULLCArray arr, NULLCFuncPtr function, int workers, unsigned typeID, unsigned elementSize)
+	{
+		NULLCArray result = { 0, 0 };
+
+		if(!function.id)
+		{
+			nullcThrowError("ERROR: invalid function pointer");
+			return result;
+		}
+
+		// Worker contexts have their own memory and can't access the closure
+		if(function.context)
+		{
+			nullcThrowError("ERROR: function called on worker contexts can't capture variables");
+			return result;
+		}
+
+		if(workers < 0)
+		{
+			nullcThrowError("ERROR: worker count can't be negative");
+			return result;
+		}
+
+		result = nullcAllocateArrayTyped(typeID, arr.len);
+
+		if(!result.ptr || !arr.len)
+			return result;
+
+		WorkerQueue queue;
+
+		queue.program = nullcProgramCreate();
+
+		if(!queue.program)
+		{
+			nullcThrowError("%s", nullcGetLastError());
+			return result;
+		}
+
+		queue.executor = nullcGetCurrentExecutor(NULL);
+
+		queue.function = function;
+
+		queue.typeID = typeID;
+		queue.elementSize = elementSize;
+
+		queue.source = arr.ptr;
+		queue.result = result.ptr;
+
+		queue.count = arr.len;
+
+		unsigned workerCount = workers ? unsigned(workers) : GetProcessorCount();
+
+		if(workerCount > maxWorkers)
+			workerCount = maxWorkers;
+
+		if(workerCount > arr.len)
+			workerCount = arr.len;
+
+		// Each worker gets several chunks to balance the load
+		queue.chunkSize = (arr.len + workerCount * 4 - 1) / (workerCount * 4);
+
+		queue.nextChunk = 0;
+
+		queue.failed = false;
+		*queue.error = 0;
+
+		queue.lock.Init();
+
+		// Calling thread is running the program and can't switch to a worker context
+#if defined(_WIN32)
+		HANDLE threads[maxWorkers];
+#else
+		pthread_t threads[maxWorkers];
+#endif
+
+		unsigned threadsStarted = 0;
+
+		for(unsigned i = 0; i < workerCount; i++)
+		{
+#if defined(_WIN32)
+			HANDLE thread = (HANDLE)_beginthreadex(NULL, workerStackSize, RunWorkerThread, &queue, 0, NULL);
+
+			if(!thread)
+				break;
+
+			threads[threadsStarted++] = thread;
+#else
+			pthread_attr_t attributes;
+			pthread_attr_init(&attributes);
+			pthread_attr_setstacksize(&attributes, workerStackSize);
+
+			int error = pthread_create(&threads[threadsStarted], &attributes, RunWorkerThread, &queue);
+
+			pthread_attr_destroy(&attributes);
+
+			if(error != 0)
+				break;
+
+			threadsStarted++;
+#endif
+		}
+
+		for(unsigned i = 0; i < threadsStarted; i++)
+		{
+#if defined(_WIN32)
+			WaitForSingleObject(threads[i], INFINITE);
+			CloseHandle(threads[i]);
+#else
+			pthread_join(threads[i], NULL);
+#endif
+		}
+
+		queue.lock.Destroy();
+
+		nullcProgramRelease(queue.program);
+
+		if(!threadsStarted)
+			nullcThrowError("ERROR: failed to start worker threads");
+		else if(queue.failed)
+			nullcThrowError("ERROR: worker context failed: %s", queue.error);
+
+		return result;
+	}
+
+	NULLCArray parallel_map_int(NULLCArray arr, NULLCFuncPtr function, int workers)
+	{
+		return parallel_map(arr, function, workers, NULLC_TYPE_INT, sizeof(int));
+	}
+
+	NULLCArray parallel_map_long(NULLCArray arr, NULLCFuncPtr function, int workers)
+	{
+		return parallel_map(arr, function, workers, NULLC_TYPE_LONG, sizeof(long long));
+	}
+
+	NULLCArray parallel_map_float(NULLCArray arr, NULLCFuncPtr function, int workers)
+	{
+		return parallel_map(arr, function, workers, NULLC_TYPE_FLOAT, sizeof(float));
+	}
+
+	NULLCArray parallel_map_double(NULLCArray arr, NULLCFuncPtr function, int workers)
+	{
+		return parallel_map(arr, function, workers, NULLC_TYPE_DOUBLE, sizeof(double));
+	}
+}
+
+#define REGISTER_FUNC(funcPtr, name, index) if(!nullcBindModuleFunctionHelper("std.task", NULLCTask::funcPtr, name, index)) return false;
+
+bool	nullcInitTaskModule()
+{
+	REGISTER_FUNC(is_coroutine, "is_coroutine", 0);
+
+	REGISTER_FUNC(parallel_map_int, "parallel_map", 0);
+	REGISTER_FUNC(parallel_map_long, "parallel_map", 1);
+	REGISTER_FUNC(parallel_map_float, "parallel_map", 2);
+	REGISTER_FUNC(parallel_map_double, "parallel_map", 3);
+
+	return true;
+}
@@ -7,7 +7,8 @@
 
 namespace NULLCTypeInfo
 {
-	Linker *linker = NULL;
+	// Linker of the execution context that is current on the thread
+	NULLC_THREAD_LOCAL Linker *linker = NULL;
 
 	struct TypeID{ unsigned typeID;  };
 	TypeID getTypeID(unsigned id){ TypeID ret; ret.typeID = id; return ret; }
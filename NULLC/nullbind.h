@@ -806,3 +806,91 @@ DEFINE_HELPER_WRAPPER(12)
 DEFINE_HELPER_WRAPPER(13)
 DEFINE_HELPER_WRAPPER(14)
 DEFINE_HELPER_WRAPPER(15)
+
+// Typed prepared function calls
+#define PSTORE(X) typedef typename NullcCallBaseType<A##X>::type A##X##u; A##X##u A##X##v = (A##X##u)a##X; memcpy(buffer + call->argumentOffsets[X - 1], &A##X##v, sizeof(A##X##v))
+
+#define PSTORES_1 PSTORE(1)
+#define PSTORES_2 PSTORES_1; PSTORE(2)
+#define PSTORES_3 PSTORES_2; PSTORE(3)
+#define PSTORES_4 PSTORES_3; PSTORE(4)
+#define PSTORES_5 PSTORES_4; PSTORE(5)
+#define PSTORES_6 PSTORES_5; PSTORE(6)
+#define PSTORES_7 PSTORES_6; PSTORE(7)
+#define PSTORES_8 PSTORES_7; PSTORE(8)
+#define PSTORES_9 PSTORES_8; PSTORE(9)
+#define PSTORES_10 PSTORES_9; PSTORE(10)
+#define PSTORES_11 PSTORES_10; PSTORE(11)
+#define PSTORES_12 PSTORES_11; PSTORE(12)
+#define PSTORES_13 PSTORES_12; PSTORE(13)
+#define PSTORES_14 PSTORES_13; PSTORE(14)
+#define PSTORES_15 PSTORES_14; PSTORE(15)
+
+#define PTYPES_1 typename A1
+#define PTYPES_2 PTYPES_1, typename A2
+#define PTYPES_3 PTYPES_2, typename A3
+#define PTYPES_4 PTYPES_3, typename A4
+#define PTYPES_5 PTYPES_4, typename A5
+#define PTYPES_6 PTYPES_5, typename A6
+#define PTYPES_7 PTYPES_6, typename A7
+#define PTYPES_8 PTYPES_7, typename A8
+#define PTYPES_9 PTYPES_8, typename A9
+#define PTYPES_10 PTYPES_9, typename A10
+#define PTYPES_11 PTYPES_10, typename A11
+#define PTYPES_12 PTYPES_11, typename A12
+#define PTYPES_13 PTYPES_12, typename A13
+#define PTYPES_14 PTYPES_13, typename A14
+#define PTYPES_15 PTYPES_14, typename A15
+
+#define PARG(X) A##X a##X
+
+#define PARGS_1 PARG(1)
+#define PARGS_2 PARGS_1, PARG(2)
+#define PARGS_3 PARGS_2, PARG(3)
+#define PARGS_4 PARGS_3, PARG(4)
+#define PARGS_5 PARGS_4, PARG(5)
+#define PARGS_6 PARGS_5, PARG(6)
+#define PARGS_7 PARGS_6, PARG(7)
+#define PARGS_8 PARGS_7, PARG(8)
+#define PARGS_9 PARGS_8, PARG(9)
+#define PARGS_10 PARGS_9, PARG(10)
+#define PARGS_11 PARGS_10, PARG(11)
+#define PARGS_12 PARGS_11, PARG(12)
+#define PARGS_13 PARGS_12, PARG(13)
+#define PARGS_14 PARGS_13, PARG(14)
+#define PARGS_15 PARGS_14, PARG(15)
+
+#define DEFINE_PREPARED_CALL(X) template<PTYPES_##X> nullres nullcInvokePrepared(const NULLCPreparedCall *call, PARGS_##X)\
+{\
+	char buffer[NULLC_PREPARED_CALL_BUFFER_SIZE];\
+	if(call->argumentCount != X || call->bufferSize > NULLC_PREPARED_CALL_BUFFER_SIZE)\
+		return nullcCallPrepared(call, NULL);\
+	PSTORES_##X;\
+	return nullcCallPrepared(call, buffer);\
+}
+
+inline nullres nullcInvokePrepared(const NULLCPreparedCall *call)
+{
+	char buffer[NULLC_PREPARED_CALL_BUFFER_SIZE];
+
+	if(call->argumentCount != 0 || call->bufferSize > NULLC_PREPARED_CALL_BUFFER_SIZE)
+		return nullcCallPrepared(call, NULL);
+
+	return nullcCallPrepared(call, buffer);
+}
+
+DEFINE_PREPARED_CALL(1)
+DEFINE_PREPARED_CALL(2)
+DEFINE_PREPARED_CALL(3)
+DEFINE_PREPARED_CALL(4)
+DEFINE_PREPARED_CALL(5)
+DEFINE_PREPARED_CALL(6)
+DEFINE_PREPARED_CALL(7)
+DEFINE_PREPARED_CALL(8)
+DEFINE_PREPARED_CALL(9)
+DEFINE_PREPARED_CALL(10)
+DEFINE_PREPARED_CALL(11)
+DEFINE_PREPARED_CALL(12)
+DEFINE_PREPARED_CALL(13)
+DEFINE_PREPARED_CALL(14)
+DEFINE_PREPARED_CALL(15)
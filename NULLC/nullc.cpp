@@ -17,10 +17,18 @@
 
 #include "StdLib.h"
 #include "BinaryCache.h"
+#include "Snapshot.h"
 #include "Trace.h"
 
 #include "includes/typeinfo.h"
 #include "includes/dynamic.h"
+#include "includes/async.h"
+
+#if defined(_WIN32)
+	#include <windows.h>
+#else
+	#include <pthread.h>
+#endif
 
 class ExecutorX86;
 class ExecutorLLVM;
@@ -28,7 +36,7 @@ class ExecutorRegVm;
 
 class Linker;
 
-namespace NULLC
+struct nullcContext
 {
 	Linker*		linker;
 
@@ -36,25 +44,128 @@ namespace NULLC
 	ExecutorLLVM*	executorLLVM;
 	ExecutorRegVm*	executorRegVm;
 
-	const char*	nullcLastError = NULL;
+	const char*	lastError;
+	char *errorBuf;
 
-	unsigned currExec = NULLC_REG_VM;
-	char *argBuf = NULL;
+	unsigned currExec;
+	char *argBuf;
 
-	bool initialized = false;
+	unsigned currDebugCallStackFrame;
+
+	NULLC::GlobalHeap	*heap;
+
+	nullcAsyncState	*asyncState;
+
+	// Program image which tables and code are shared by the linker
+	nullcProgram	*program;
+};
+
+namespace NULLC
+{
+	// Lock can be taken again by the thread that holds it, linked code is able to compile and link more code
+#if defined(_WIN32)
+	struct CompilerLock
+	{
+		void Init(){ InitializeCriticalSection(&section); }
+		void Destroy(){ DeleteCriticalSection(&section); }
+
+		void Lock(){ EnterCriticalSection(&section); }
+		void Unlock(){ LeaveCriticalSection(&section); }
+
+		CRITICAL_SECTION section;
+	};
+#else
+	struct CompilerLock
+	{
+		void Init()
+		{
+			pthread_mutexattr_t attributes;
+			pthread_mutexattr_init(&attributes);
+			pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+
+			pthread_mutex_init(&mutex, &attributes);
+
+			pthread_mutexattr_destroy(&attributes);
+		}
+		void Destroy(){ pthread_mutex_destroy(&mutex); }
+
+		void Lock(){ pthread_mutex_lock(&mutex); }
+		void Unlock(){ pthread_mutex_unlock(&mutex); }
+
+		pthread_mutex_t mutex;
+	};
+#endif
+
+	struct CompilerLockScope
+	{
+		CompilerLockScope(){ nullcLockCompiler(); }
+		~CompilerLockScope(){ nullcUnlockCompiler(); }
+	};
+
+	void SaveContext(nullcContext *context);
+	void LoadContext(nullcContext *context);
+	void SwitchContext(nullcContext *context);
+}
+
+struct nullcProgram
+{
+	// Program image can be retained and released by contexts on different threads
+	volatile long	refCount;
 
-	char *errorBuf = NULL;
+	Linker*		linker;
+};
+
+struct nullcAnalysis
+{
+	nullcAnalysis(): allocator(pool), context(NULL)
+	{
+	}
+
+	// Pool doesn't take chunks from the compiler chunk cache, analysis can be destroyed without taking the compiler lock
+	ChunkedStackPool<65532> pool;
+	GrowingAllocatorRef<ChunkedStackPool<65532>, 16384> allocator;
+
+	CompilerContext *context;
+
+	char errorBuf[NULLC_ERROR_BUFFER_SIZE];
+};
+
+namespace NULLC
+{
+	// State of the current execution context is kept by each thread, different contexts can run on different threads at the same time
+	NULLC_THREAD_LOCAL Linker*		linker;
+
+	NULLC_THREAD_LOCAL ExecutorX86*	executorX86;
+	NULLC_THREAD_LOCAL ExecutorLLVM*	executorLLVM;
+	NULLC_THREAD_LOCAL ExecutorRegVm*	executorRegVm;
+
+	NULLC_THREAD_LOCAL const char*	nullcLastError = NULL;
+	NULLC_THREAD_LOCAL char *errorBuf = NULL;
+
+	NULLC_THREAD_LOCAL unsigned currExec = NULLC_REG_VM;
+	NULLC_THREAD_LOCAL char *argBuf = NULL;
+
+	bool initialized = false;
 
 	char *outputBuf = NULL;
 
 	char *tempOutputBuf = NULL;
 
-	ChunkedStackPool<65532> pool;
+	ChunkedStackPool<65532> pool(&compilerChunkCache);
 	GrowingAllocatorRef<ChunkedStackPool<65532>, 16384> allocator(pool);
 
+	unsigned compilerMemoryRetention = 64 * 1024 * 1024;
+
+	NULLCCompilerMemoryStats compilerMemoryStats;
+
 	CompilerContext *compilerCtx = NULL;
 
+	// Heap of the context that memory retained by the compiler is accounted to
+	GlobalHeap *compilerHeap = NULL;
+
 	bool enableLogFiles = false;
+	bool enableSnapshots = false;
+	bool enableBaseModuleReuse = false;
 	bool enableExternalDebugger = false;
 
 	void* (*openStream)(const char* name) = OutputContext::FileOpen;
@@ -67,15 +178,80 @@ namespace NULLC
 
 	unsigned moduleAnalyzeMemoryLimit = 128 * 1024 * 1024;
 
+	NULLCCancellation *analyzeCancellation = NULL;
+
+	unsigned moduleBuildThreads = 0;
+
 	TraceContext *traceContext = NULL;
 
-	unsigned currDebugCallStackFrame = 0;
+	NULLC_THREAD_LOCAL unsigned currDebugCallStackFrame = 0;
+
+	// Context created by nullcInit is current on the thread that has called it, other threads use it until they select a context
+	nullcContext defaultContext;
+	NULLC_THREAD_LOCAL nullcContext *currContext = NULL;
+
+	// Default context is owned by the thread that has initialized the library
+	NULLC_THREAD_LOCAL bool defaultContextThread = false;
+
+	// Thread has selected its current context explicitly and is not switched to the default context
+	NULLC_THREAD_LOCAL bool contextSelected = false;
+
+	// Default context is loaded again by other threads after the library is initialized again
+	unsigned defaultContextGeneration = 0;
+	NULLC_THREAD_LOCAL unsigned loadedContextGeneration = 0;
+
+	bool SelectCurrentContext();
+
+	// Compiler, module cache and native code translation are shared by all contexts
+	CompilerLock compilerLock;
+
+	// Chunk cache is shared by compilers on module build threads and analysis contexts
+	CompilerLock chunkCacheLock;
+
+	void LockChunkCache()
+	{
+		chunkCacheLock.Lock();
+	}
+
+	void UnlockChunkCache()
+	{
+		chunkCacheLock.Unlock();
+	}
+
+	// Allocation functions provided by the user are serialized, memory is allocated by contexts and module build threads at the same time
+	CompilerLock allocationLock;
+	bool allocationLockReady = false;
+
+	void* (*userAlloc)(int) = NULL;
+	void (*userDealloc)(void*) = NULL;
+
+	void* LockedAlloc(int size)
+	{
+		allocationLock.Lock();
+		void *ptr = userAlloc(size);
+		allocationLock.Unlock();
+
+		return ptr;
+	}
+
+	void LockedDealloc(void* ptr)
+	{
+		allocationLock.Lock();
+		userDealloc(ptr);
+		allocationLock.Unlock();
+	}
 }
 
 unsigned nullcFindFunctionIndex(const char* name);
+nullres nullcCallFunctionInternal(NULLCFuncPtr ptr, const char* argBuf);
+nullres nullcPrepareLinkedCode();
 nullres	nullcCompileWithModuleRoot(const char* code, const char *moduleRoot);
+void nullcUpdateExecutorMemory();
+bool nullcStartCompilerMemory(unsigned &limit);
+bool nullcFinishCompilerMemory();
 
-#define NULLC_CHECK_INITIALIZED(retval) if(!initialized){ nullcLastError = "ERROR: NULLC is not initialized"; return retval; }
+#define NULLC_CHECK_LIBRARY_INITIALIZED(retval) if(!initialized){ nullcLastError = "ERROR: NULLC is not initialized"; return retval; }
+#define NULLC_CHECK_INITIALIZED(retval) NULLC_CHECK_LIBRARY_INITIALIZED(retval) if(!SelectCurrentContext()){ nullcLastError = "ERROR: there is no current context on this thread"; return retval; }
 
 nullres nullcInit()
 {
@@ -98,9 +274,33 @@ nullres nullcInitCustomAlloc(void* (*allocFunc)(int), void (*deallocFunc)(void*)
 
 	TRACE_SCOPE("nullc", "nullcInitCustomAlloc");
 
-	NULLC::alloc = allocFunc ? allocFunc : NULLC::defaultAlloc;
-	NULLC::dealloc = deallocFunc ? deallocFunc : NULLC::defaultDealloc;
+	compilerLock.Init();
+
+	chunkCacheLock.Init();
+	compilerChunkCache.SetLock(LockChunkCache, UnlockChunkCache);
+
+	currContext = &defaultContext;
+
+	defaultContextThread = true;
+	contextSelected = true;
+
+	defaultContextGeneration++;
+	loadedContextGeneration = defaultContextGeneration;
+
+	// Lock is never destroyed, memory can be released after the library is terminated
+	if(!allocationLockReady)
+	{
+		allocationLock.Init();
+		allocationLockReady = true;
+	}
+
+	userAlloc = allocFunc;
+	userDealloc = deallocFunc;
+
+	NULLC::alloc = allocFunc ? LockedAlloc : NULLC::defaultAlloc;
+	NULLC::dealloc = deallocFunc ? LockedDealloc : NULLC::defaultDealloc;
 	NULLC::fileLoad = NULLC::defaultFileLoad;
+	NULLC::fileSave = NULLC::defaultFileSave;
 
 	errorBuf = (char*)NULLC::alloc(NULLC_ERROR_BUFFER_SIZE);
 	outputBuf = (char*)NULLC::alloc(NULLC_OUTPUT_BUFFER_SIZE);
@@ -109,6 +309,10 @@ nullres nullcInitCustomAlloc(void* (*allocFunc)(int), void (*deallocFunc)(void*)
 	BinaryCache::Initialize();
 	BinaryCache::AddImportPath("");
 
+	compilerChunkCache.SetLimit(compilerMemoryRetention);
+
+	memset(&compilerMemoryStats, 0, sizeof(compilerMemoryStats));
+
 #ifndef NULLC_NO_EXECUTOR
 	linker = NULLC::construct<Linker>();
 
@@ -138,15 +342,25 @@ nullres nullcInitCustomAlloc(void* (*allocFunc)(int), void (*deallocFunc)(void*)
 
 	initialized = true;
 
-	if(!BuildBaseModule(&allocator, NULLC::optimizationLevel))
+	nullcUpdateExecutorMemory();
+
 	{
-		allocator.Clear();
+		// Base module kept by an earlier initialization is shared with the build
+		CompilerLockScope lockScope;
 
-		nullcLastError = "ERROR: Failed to initialize base module";
-		return 0;
+		if(!BuildBaseModule(&allocator, NULLC::optimizationLevel))
+		{
+			allocator.Clear();
+
+			nullcLastError = "ERROR: Failed to initialize base module";
+			return 0;
+		}
+
+		allocator.Clear();
 	}
 
-	allocator.Clear();
+	// Default context can be selected by other threads
+	SaveContext(&defaultContext);
 
 	return 1;
 }
@@ -172,17 +386,47 @@ nullres nullcHasImportPath(const char* importPath)
 	return BinaryCache::HasImportPath(importPath);
 }
 
+void nullcSetModuleCacheDirectory(const char* path)
+{
+	BinaryCache::SetCacheDirectory(path);
+}
+
+void nullcGetModuleCacheStatistics(unsigned *hits, unsigned *misses)
+{
+	unsigned cacheHits = 0, cacheMisses = 0;
+
+	BinaryCache::GetCacheStatistics(cacheHits, cacheMisses);
+
+	if(hits)
+		*hits = cacheHits;
+	if(misses)
+		*misses = cacheMisses;
+}
+
 void nullcSetFileReadHandler(const char* (*fileLoadFunc)(const char* name, unsigned* size), void (*fileFreeFunc)(const char* data))
 {
 	NULLC::fileLoad = fileLoadFunc ? fileLoadFunc : NULLC::defaultFileLoad;
 	NULLC::fileFree = fileFreeFunc ? fileFreeFunc : NULLC::defaultFileFree;
 }
 
+void nullcSetFileWriteHandler(int (*fileSaveFunc)(const char* name, const char* data, unsigned size))
+{
+	NULLC::fileSave = fileSaveFunc ? fileSaveFunc : NULLC::defaultFileSave;
+}
+
 void nullcSetExecutor(unsigned id)
 {
 	using namespace NULLC;
 
 	currExec = id;
+
+	if(initialized && SelectCurrentContext())
+	{
+		// Default context can be loaded by other threads
+		currContext->currExec = id;
+
+		nullcUpdateExecutorMemory();
+	}
 }
 
 nullres nullcSetExecutorStackSize(unsigned bytes)
@@ -191,6 +435,11 @@ nullres nullcSetExecutorStackSize(unsigned bytes)
 	NULLC_CHECK_INITIALIZED(0);
 
 #ifndef NULLC_NO_EXECUTOR
+	if(bytes > NULLC::GetMemoryQuotaLeft(NULLC_MEMORY_STACK))
+	{
+		nullcLastError = "ERROR: executor stack size exceeds memory quota";
+		return 0;
+	}
 
 #ifdef NULLC_BUILD_X86_JIT
 	if(!executorX86->SetStackSize(bytes))
@@ -203,6 +452,8 @@ nullres nullcSetExecutorStackSize(unsigned bytes)
 #endif
 	if(!executorRegVm->SetStackSize(bytes))
 		return 0;
+
+	nullcUpdateExecutorMemory();
 #endif
 
 	(void)bytes;
@@ -214,6 +465,17 @@ void nullcSetGlobalMemoryLimit(unsigned limit)
 {
 	NULLC::SetGlobalLimit(limit);
 }
+
+void nullcSetCollectionPolicy(const NULLCCollectionPolicy *policy)
+{
+	NULLC::SetCollectionPolicy(policy);
+}
+
+void nullcGetCollectionPolicy(NULLCCollectionPolicy *policy)
+{
+	if(policy)
+		*policy = NULLC::GetCollectionPolicy();
+}
 #endif
 
 void nullcSetEnableLogFiles(int enable, void* (*openStream)(const char* name), void (*writeStream)(void *stream, const char *data, unsigned size), void (*closeStream)(void* stream))
@@ -245,6 +507,11 @@ void nullcSetOptimizationLevel(int level)
 	NULLC::optimizationLevel = level;
 }
 
+void nullcSetEnableBaseModuleReuse(int enable)
+{
+	NULLC::enableBaseModuleReuse = enable != 0;
+}
+
 void nullcSetEnableTimeTrace(int enable)
 {
 	NULLC::traceContext = NULLC::TraceGetContext();
@@ -257,6 +524,62 @@ void nullcSetModuleAnalyzeMemoryLimit(unsigned bytes)
 	NULLC::moduleAnalyzeMemoryLimit = bytes;
 }
 
+void nullcSetAnalyzeCancellation(NULLCCancellation *cancellation)
+{
+	NULLC::analyzeCancellation = cancellation;
+}
+
+void nullcRequestCancellation(NULLCCancellation *cancellation)
+{
+#if defined(_WIN32)
+	InterlockedExchange(&cancellation->requested, 1);
+#else
+	__sync_lock_test_and_set(&cancellation->requested, 1);
+	__sync_synchronize();
+#endif
+}
+
+void nullcResetCancellation(NULLCCancellation *cancellation)
+{
+#if defined(_WIN32)
+	InterlockedExchange(&cancellation->requested, 0);
+#else
+	__sync_lock_test_and_set(&cancellation->requested, 0);
+	__sync_synchronize();
+#endif
+}
+
+int nullcIsCancellationRequested(NULLCCancellation *cancellation)
+{
+#if defined(_WIN32)
+	return InterlockedCompareExchange(&cancellation->requested, 0, 0) != 0;
+#else
+	return __sync_fetch_and_add(&cancellation->requested, 0) != 0;
+#endif
+}
+
+void nullcSetCompilerMemoryRetention(unsigned bytes)
+{
+	NULLC::compilerMemoryRetention = bytes;
+
+	compilerChunkCache.SetLimit(bytes);
+}
+
+void nullcGetCompilerMemoryStatistics(NULLCCompilerMemoryStats *stats)
+{
+	if(!stats)
+		return;
+
+	*stats = NULLC::compilerMemoryStats;
+
+	stats->retained = compilerChunkCache.GetSize();
+}
+
+void nullcSetModuleBuildThreads(unsigned count)
+{
+	NULLC::moduleBuildThreads = count;
+}
+
 void nullcSetEnableExternalDebugger(int enable)
 {
 	NULLC::enableExternalDebugger = enable != 0;
@@ -410,6 +733,8 @@ nullres nullcLoadModuleBySource(const char* module, const char* code)
 	TRACE_SCOPE("nullc", "nullcLoadModuleBySource");
 	TRACE_LABEL(module);
 
+	CompilerLockScope lockScope;
+
 	const unsigned moduleRootLength = 1024;
 	char moduleRoot[moduleRootLength];
 	*moduleRoot = 0;
@@ -461,6 +786,8 @@ nullres nullcLoadModuleByBinary(const char* module, const char* binary)
 	TRACE_SCOPE("nullc", "nullcLoadModuleByBinary");
 	TRACE_LABEL(module);
 
+	CompilerLockScope lockScope;
+
 	if(strlen(module) > 512)
 	{
 		nullcLastError = "ERROR: module name is too long";
@@ -489,6 +816,66 @@ nullres nullcLoadModuleByBinary(const char* module, const char* binary)
 	return 1;
 }
 
+nullres nullcSaveModulePack(const char* fileName, const char** modules, unsigned count)
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(false);
+
+	TRACE_SCOPE("nullc", "nullcSaveModulePack");
+	TRACE_LABEL(fileName);
+
+	char **paths = (char**)NULLC::alloc(sizeof(char*) * (count + 1));
+
+	for(unsigned i = 0; i < count; i++)
+	{
+		unsigned length = unsigned(strlen(modules[i]));
+
+		paths[i] = (char*)NULLC::alloc(length + 4);
+
+		strcpy(paths[i], modules[i]);
+		for(char *pos = paths[i]; *pos; pos++)
+		{
+			if(*pos == '.')
+				*pos = '/';
+		}
+		strcat(paths[i], ".nc");
+	}
+
+	const char *error = NULL;
+	bool result = BinaryCache::SaveModulePack(fileName, (const char**)paths, count, error);
+
+	for(unsigned i = 0; i < count; i++)
+		NULLC::dealloc(paths[i]);
+	NULLC::dealloc(paths);
+
+	if(!result)
+	{
+		nullcLastError = error;
+		return false;
+	}
+
+	return true;
+}
+
+nullres nullcLoadModulePack(const char* fileName)
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(false);
+
+	TRACE_SCOPE("nullc", "nullcLoadModulePack");
+	TRACE_LABEL(fileName);
+
+	const char *error = NULL;
+
+	if(!BinaryCache::LoadModulePack(fileName, error))
+	{
+		nullcLastError = error;
+		return false;
+	}
+
+	return true;
+}
+
 void nullcRemoveModule(const char* module)
 {
 	using namespace NULLC;
@@ -497,6 +884,8 @@ void nullcRemoveModule(const char* module)
 	TRACE_SCOPE("nullc", "nullcRemoveModule");
 	TRACE_LABEL(module);
 
+	CompilerLockScope lockScope;
+
 	BinaryCache::RemoveBytecode(module);
 }
 
@@ -508,6 +897,92 @@ const char* nullcEnumerateModules(unsigned id)
 	return BinaryCache::EnumerateModules(id);
 }
 
+void nullcUpdateExecutorMemory()
+{
+	using namespace NULLC;
+
+#ifndef NULLC_NO_EXECUTOR
+	unsigned stackSize = 0;
+	unsigned codeSize = 0;
+
+#ifdef NULLC_BUILD_X86_JIT
+	if(currExec == NULLC_X86)
+		stackSize = executorX86->GetStackSize();
+
+	// Code blocks replaced by the dynamic code linking are kept alive until the code is cleaned
+	codeSize = executorX86->binCodeReserved;
+
+	for(unsigned i = 0; i < executorX86->expiredCodeBlocks.size(); i++)
+		codeSize += executorX86->expiredCodeBlocks[i].codeSize;
+#endif
+
+	if(currExec == NULLC_REG_VM)
+		stackSize = executorRegVm->GetStackSize();
+
+	NULLC::SetExternalMemory(NULLC::GetHeap(), NULLC_MEMORY_STACK, stackSize);
+	NULLC::SetExternalMemory(NULLC::GetHeap(), NULLC_MEMORY_CODE, codeSize);
+#endif
+}
+
+bool nullcStartCompilerMemory(unsigned &limit)
+{
+	using namespace NULLC;
+
+#ifndef NULLC_NO_EXECUTOR
+	// Compiler memory is shared by all contexts and is accounted to the context that has used it last
+	if(compilerHeap)
+		NULLC::SetExternalMemory(compilerHeap, NULLC_MEMORY_COMPILER, 0);
+
+	compilerHeap = NULLC::GetHeap();
+
+	unsigned quotaLeft = NULLC::GetMemoryQuotaLeft(NULLC_MEMORY_COMPILER);
+
+	if(quotaLeft == 0)
+	{
+		nullcLastError = "ERROR: memory quota is exhausted";
+		return false;
+	}
+
+	if(quotaLeft != ~0u && (limit == 0 || limit > quotaLeft))
+		limit = quotaLeft;
+#endif
+
+	(void)limit;
+	return true;
+}
+
+bool nullcFinishCompilerMemory()
+{
+	using namespace NULLC;
+
+	if(compilerCtx)
+	{
+		compilerMemoryStats.parse = compilerCtx->statistics.Allocated("Parse");
+		compilerMemoryStats.analyze = compilerCtx->statistics.Allocated("Analyze");
+		compilerMemoryStats.ir = compilerCtx->statistics.Allocated("Ir");
+		compilerMemoryStats.lowering = compilerCtx->statistics.Allocated("Lowering");
+	}
+
+#ifndef NULLC_NO_EXECUTOR
+	if(!compilerHeap)
+		return true;
+
+	NULLC::GlobalHeap *current = NULLC::GetHeap();
+
+	NULLC::SetHeap(compilerHeap);
+
+	NULLC::SetExternalMemory(compilerHeap, NULLC_MEMORY_COMPILER, allocator.requested());
+
+	bool result = NULLC::GetMemoryUsage(NULLC_MEMORY_COMPILER) <= NULLC::GetMemoryQuotaLeft(NULLC_MEMORY_COMPILER);
+
+	NULLC::SetHeap(current);
+
+	return result;
+#else
+	return true;
+#endif
+}
+
 nullres nullcAnalyze(const char* code)
 {
 	using namespace NULLC;
@@ -515,6 +990,8 @@ nullres nullcAnalyze(const char* code)
 
 	TRACE_SCOPE("nullc", "nullcAnalyze");
 
+	CompilerLockScope lockScope;
+
 	nullcLastError = "";
 
 	NULLC::destruct(compilerCtx);
@@ -541,6 +1018,12 @@ nullres nullcAnalyze(const char* code)
 	compilerCtx->outputCtx.tempBufSize = NULLC_TEMP_OUTPUT_BUFFER_SIZE;
 
 	compilerCtx->exprMemoryLimit = moduleAnalyzeMemoryLimit;
+	compilerCtx->exprCancellation = analyzeCancellation;
+
+	compilerCtx->importBuildThreads = moduleBuildThreads;
+
+	if(!nullcStartCompilerMemory(compilerCtx->exprMemoryLimit))
+		return 0;
 
 	compilerCtx->code = code;
 
@@ -551,15 +1034,94 @@ nullres nullcAnalyze(const char* code)
 		else
 			nullcLastError = "ERROR: internal error";
 
+		nullcFinishCompilerMemory();
+
+		return 0;
+	}
+
+	if(!nullcFinishCompilerMemory())
+	{
+		nullcLastError = "ERROR: compiler memory exceeds memory quota";
 		return 0;
 	}
 
 	return 1;
 }
 
-nullres	nullcCompile(const char* code)
+nullres nullcCreateAnalysis(const char* code, nullcAnalysis **analysis)
 {
-	return nullcCompileWithModuleRoot(code, NULL);
+	using namespace NULLC;
+	NULLC_CHECK_LIBRARY_INITIALIZED(false);
+
+	TRACE_SCOPE("nullc", "nullcCreateAnalysis");
+
+	CompilerLockScope lockScope;
+
+	nullcLastError = "";
+
+	nullcAnalysis *result = new(NULLC::alloc(sizeof(nullcAnalysis))) nullcAnalysis();
+
+	CompilerContext *context = new(NULLC::alloc(sizeof(CompilerContext))) CompilerContext(&result->allocator, optimizationLevel, ArrayView<InplaceStr>());
+
+	result->context = context;
+
+	*result->errorBuf = 0;
+
+	context->errorBuf = result->errorBuf;
+	context->errorBufSize = NULLC_ERROR_BUFFER_SIZE;
+
+	context->enableLogFiles = enableLogFiles;
+
+	context->outputCtx.openStream = openStream;
+	context->outputCtx.writeStream = writeStream;
+	context->outputCtx.closeStream = closeStream;
+
+	context->outputCtx.outputBuf = outputBuf;
+	context->outputCtx.outputBufSize = NULLC_OUTPUT_BUFFER_SIZE;
+
+	context->outputCtx.tempBuf = tempOutputBuf;
+	context->outputCtx.tempBufSize = NULLC_TEMP_OUTPUT_BUFFER_SIZE;
+
+	// Analysis doesn't belong to an execution context, its memory is only limited by the module analysis limit
+	context->exprMemoryLimit = moduleAnalyzeMemoryLimit;
+	context->exprCancellation = analyzeCancellation;
+
+	context->importBuildThreads = moduleBuildThreads;
+
+	context->code = code;
+
+	*analysis = result;
+
+	if(!AnalyzeModuleFromSource(*context))
+	{
+		if(context->errorPos)
+			nullcLastError = context->errorBuf;
+		else
+			nullcLastError = "ERROR: internal error";
+
+		return 0;
+	}
+
+	return 1;
+}
+
+CompilerContext* nullcGetAnalysisContext(nullcAnalysis *analysis)
+{
+	return analysis ? analysis->context : NULL;
+}
+
+void nullcDestroyAnalysis(nullcAnalysis *analysis)
+{
+	if(!analysis)
+		return;
+
+	NULLC::destruct(analysis->context);
+	NULLC::destruct(analysis);
+}
+
+nullres	nullcCompile(const char* code)
+{
+	return nullcCompileWithModuleRoot(code, NULL);
 }
 
 nullres	nullcCompileWithModuleRoot(const char* code, const char *moduleRoot)
@@ -571,6 +1133,8 @@ nullres	nullcCompileWithModuleRoot(const char* code, const char *moduleRoot)
 
 	TRACE_SCOPE("nullc", "nullcCompile");
 
+	CompilerLockScope lockScope;
+
 	nullcLastError = "";
 
 	NULLC::destruct(compilerCtx);
@@ -587,6 +1151,12 @@ nullres	nullcCompileWithModuleRoot(const char* code, const char *moduleRoot)
 	compilerCtx->enableLogFiles = enableLogFiles;
 
 	compilerCtx->exprMemoryLimit = moduleAnalyzeMemoryLimit;
+	compilerCtx->exprCancellation = analyzeCancellation;
+
+	compilerCtx->importBuildThreads = moduleBuildThreads;
+
+	if(!nullcStartCompilerMemory(compilerCtx->exprMemoryLimit))
+		return 0;
 
 	compilerCtx->outputCtx.openStream = openStream;
 	compilerCtx->outputCtx.writeStream = writeStream;
@@ -608,6 +1178,14 @@ nullres	nullcCompileWithModuleRoot(const char* code, const char *moduleRoot)
 		else
 			nullcLastError = "ERROR: internal error";
 
+		nullcFinishCompilerMemory();
+
+		return 0;
+	}
+
+	if(!nullcFinishCompilerMemory())
+	{
+		nullcLastError = "ERROR: compiler memory exceeds memory quota";
 		return 0;
 	}
 
@@ -621,6 +1199,8 @@ unsigned nullcGetBytecode(char **bytecode)
 
 	TRACE_SCOPE("nullc", "nullcGetBytecode");
 
+	CompilerLockScope lockScope;
+
 	if(!compilerCtx)
 	{
 		nullcLastError = "ERROR: there is no active compiler context";
@@ -641,6 +1221,8 @@ unsigned nullcGetBytecodeNoCache(char **bytecode)
 
 	TRACE_SCOPE("nullc", "nullcGetBytecodeNoCache");
 
+	CompilerLockScope lockScope;
+
 	if(!compilerCtx)
 	{
 		nullcLastError = "ERROR: there is no active compiler context";
@@ -701,14 +1283,24 @@ void nullcClean()
 
 	TRACE_SCOPE("nullc", "nullcClean");
 
+	CompilerLockScope lockScope;
+
 #ifndef NULLC_NO_EXECUTOR
+	executorRegVm->ClearBreakpoints();
+
 	linker->CleanCode();
 
+	NULLC::ClearMemory();
+
+	// Futures and timers refer to the objects of the old program
+	nullcAsyncResetState();
+
 	#ifdef NULLC_BUILD_X86_JIT
 	executorX86->ClearNative();
 	#endif
 
-	executorRegVm->ClearBreakpoints();
+	nullcProgramRelease(currContext->program);
+	currContext->program = NULL;
 #endif
 
 	nullcLastError = "";
@@ -717,6 +1309,10 @@ void nullcClean()
 	compilerCtx = NULL;
 
 	allocator.Clear();
+
+#ifndef NULLC_NO_EXECUTOR
+	nullcFinishCompilerMemory();
+#endif
 }
 
 nullres nullcLinkCode(const char *bytecode)
@@ -731,7 +1327,11 @@ nullres nullcLinkCodeWithModuleName(const char *bytecode, const char *moduleName
 
 	TRACE_SCOPE("nullc", "nullcLinkCode");
 
+	CompilerLockScope lockScope;
+
 #ifndef NULLC_NO_EXECUTOR
+	linker->keepRootBytecode = enableSnapshots;
+
 	if(!linker->LinkCode(bytecode, moduleName, true))
 	{
 		nullcLastError = linker->GetLinkError();
@@ -739,7 +1339,24 @@ nullres nullcLinkCodeWithModuleName(const char *bytecode, const char *moduleName
 	}
 
 	nullcLastError = linker->GetLinkError();
+#else
+	(void)bytecode;
+	(void)moduleName;
+
+	nullcLastError = "No executor available, compile library without NULLC_NO_EXECUTOR";
+#endif
+
+	return nullcPrepareLinkedCode();
+}
+
+nullres nullcPrepareLinkedCode()
+{
+	using namespace NULLC;
+
+	// Native code translation and log output are using shared state
+	CompilerLockScope lockScope;
 
+#ifndef NULLC_NO_EXECUTOR
 	OutputContext outputCtx;
 
 	outputCtx.openStream = openStream;
@@ -764,11 +1381,6 @@ nullres nullcLinkCodeWithModuleName(const char *bytecode, const char *moduleName
 			outputCtx.stream = NULL;
 		}
 	}
-#else
-	(void)bytecode;
-	(void)moduleName;
-
-	nullcLastError = "No executor available, compile library without NULLC_NO_EXECUTOR";
 #endif
 
 	if(currExec == NULLC_X86)
@@ -779,6 +1391,14 @@ nullres nullcLinkCodeWithModuleName(const char *bytecode, const char *moduleName
 			nullcLastError = executorX86->GetErrorMessage();
 			return false;
 		}
+
+		nullcUpdateExecutorMemory();
+
+		if(NULLC::GetMemoryUsage(NULLC_MEMORY_CODE) > NULLC::GetMemoryQuotaLeft(NULLC_MEMORY_CODE))
+		{
+			nullcLastError = "ERROR: native code exceeds memory quota";
+			return false;
+		}
 #else
 		nullcLastError = "X86 JIT isn't available";
 		return false;
@@ -832,7 +1452,8 @@ nullres nullcBuildWithModuleName(const char* code, const char* moduleName)
 
 	TRACE_SCOPE("nullc", "nullcBuild");
 
-	using namespace NULLC;
+	// Build steps are sharing the compiler context
+	CompilerLockScope lockScope;
 
 	unsigned start = NULLCTime::clockMicro();
 
@@ -1224,7 +1845,14 @@ nullres nullcCallFunction(NULLCFuncPtr ptr, ...)
 
 	if(!argBuf)
 		return false;
-	
+
+	return nullcCallFunctionInternal(ptr, argBuf);
+}
+
+nullres nullcCallFunctionInternal(NULLCFuncPtr ptr, const char* argBuf)
+{
+	using namespace NULLC;
+
 	if(currExec == NULLC_X86)
 	{
 #ifdef NULLC_BUILD_X86_JIT
@@ -1260,6 +1888,155 @@ nullres nullcCallFunction(NULLCFuncPtr ptr, ...)
 	return true;
 }
 
+nullres nullcPrepareCall(const char* funcName, NULLCPreparedCall *call)
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(false);
+
+	unsigned functionID = nullcFindFunctionIndex(funcName);
+
+	if(functionID == ~0u)
+		return false;
+
+	NULLCFuncPtr ptr = { 0, functionID };
+
+	return nullcPrepareCallPointer(ptr, call);
+}
+
+nullres nullcPrepareCallPointer(NULLCFuncPtr ptr, NULLCPreparedCall *call)
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(false);
+
+	if(ptr.id >= linker->exFunctions.size())
+	{
+		nullcLastError = "ERROR: function index is out of range";
+		return false;
+	}
+
+	ExternFuncInfo &func = linker->exFunctions[ptr.id];
+
+	if(func.paramCount > NULLC_PREPARED_CALL_MAX_ARGUMENTS)
+	{
+		nullcLastError = "ERROR: function has too many arguments for a prepared call";
+		return false;
+	}
+
+	call->functionID = ptr.id;
+	call->context = ptr.context;
+
+	ExternTypeInfo &funcType = linker->exTypes[func.funcType];
+
+	call->returnType = linker->exTypeExtra[funcType.memberOffset].type;
+
+	call->argumentCount = func.paramCount;
+
+	for(unsigned i = 0; i < func.paramCount; i++)
+	{
+		ExternLocalInfo &lInfo = linker->exLocals[func.offsetToFirstLocal + i];
+
+		call->argumentTypes[i] = lInfo.type;
+		call->argumentOffsets[i] = lInfo.offset;
+	}
+
+	call->bufferSize = func.argumentSize;
+
+	return true;
+}
+
+nullres nullcCallPrepared(const NULLCPreparedCall *call, char *arguments)
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(false);
+
+	if(!arguments)
+	{
+		nullcLastError = "ERROR: prepared call arguments don't match the function";
+		return false;
+	}
+
+	memcpy(arguments + call->bufferSize - sizeof(void*), &call->context, sizeof(void*));
+
+	NULLCFuncPtr ptr = { call->context, call->functionID };
+
+	return nullcCallFunctionInternal(ptr, arguments);
+}
+
+nullres nullcCallPreparedBatch(const NULLCPreparedCall *call, char *arguments, unsigned argumentStride, unsigned count, void *results, unsigned resultStride)
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(false);
+
+	if(!count)
+		return true;
+
+	if(!arguments || argumentStride < call->bufferSize)
+	{
+		nullcLastError = "ERROR: prepared call arguments don't match the function";
+		return false;
+	}
+
+	unsigned resultSize = GetExecutorResultSize(call->returnType);
+
+	if(!resultSize && call->returnType != NULLC_TYPE_VOID)
+	{
+		nullcLastError = "ERROR: batched call can only return a basic type";
+		return false;
+	}
+
+	if(results && resultStride < resultSize)
+	{
+		nullcLastError = "ERROR: batched call result stride is too small";
+		return false;
+	}
+
+	for(unsigned i = 0; i < count; i++)
+		memcpy(arguments + i * argumentStride + call->bufferSize - sizeof(void*), &call->context, sizeof(void*));
+
+	if(currExec == NULLC_REG_VM)
+	{
+		if(!executorRegVm->RunBatch(call->functionID, arguments, argumentStride, count, (char*)results, resultStride))
+		{
+			nullcLastError = executorRegVm->GetErrorMessage();
+
+			return false;
+		}
+
+		return true;
+	}
+
+	NULLCFuncPtr ptr = { call->context, call->functionID };
+
+	for(unsigned i = 0; i < count; i++)
+	{
+		if(!nullcCallFunctionInternal(ptr, arguments + i * argumentStride))
+			return false;
+
+		if(!results || !resultSize)
+			continue;
+
+		char *result = (char*)results + i * resultStride;
+
+		if(call->returnType == NULLC_TYPE_LONG)
+		{
+			long long value = nullcGetResultLong();
+			memcpy(result, &value, sizeof(value));
+		}
+		else if(call->returnType == NULLC_TYPE_FLOAT || call->returnType == NULLC_TYPE_DOUBLE)
+		{
+			double value = nullcGetResultDouble();
+			memcpy(result, &value, sizeof(value));
+		}
+		else
+		{
+			int value = nullcGetResultInt();
+			memcpy(result, &value, sizeof(value));
+		}
+	}
+
+	return true;
+}
+
 nullres nullcSetGlobal(const char* name, void* data)
 {
 	using namespace NULLC;
@@ -1433,274 +2210,1115 @@ nullres nullcIsManagedPointer(void* ptr)
 	return NULLC::IsBasePointer(ptr);
 }
 
-#endif
+nullres nullcSweepMemory(unsigned pageCount)
+{
+	return NULLC::SweepMemory(pageCount);
+}
 
-unsigned nullcGetResultType()
+void nullcSetDeferredFinalization(int enable)
 {
-	using namespace NULLC;
-	NULLC_CHECK_INITIALIZED(NULLC_TYPE_VOID);
+	NULLC::SetDeferredFinalization(enable != 0);
+}
 
-#ifdef NULLC_BUILD_X86_JIT
-	if(currExec == NULLC_X86)
-		return executorX86->GetResultType();
-#endif
-#if defined(NULLC_LLVM_SUPPORT) && !defined(NULLC_NO_EXECUTOR)
-	if(currExec == NULLC_LLVM)
-		return executorLLVM->GetResultType();
-#endif
-#ifndef NULLC_NO_EXECUTOR
-	if(currExec == NULLC_REG_VM)
-		return executorRegVm->GetResultType();
-#endif
+nullres nullcRunFinalizers()
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(false);
 
-	return NULLC_TYPE_VOID;
+	return NULLC::RunFinalizers();
 }
 
-NULLCRef nullcGetResultObject()
+unsigned nullcGetPendingFinalizerCount()
 {
-	NULLCRef empty = { 0, 0 };
+	return NULLC::PendingFinalizerCount();
+}
 
+nullres nullcSetExecutionBudget(unsigned steps, unsigned milliseconds)
+{
 	using namespace NULLC;
-	NULLC_CHECK_INITIALIZED(empty);
+	NULLC_CHECK_INITIALIZED(false);
 
 #ifdef NULLC_BUILD_X86_JIT
-	if(currExec == NULLC_X86)
-		return executorX86->GetResultObject();
-#endif
-#if defined(NULLC_LLVM_SUPPORT) && !defined(NULLC_NO_EXECUTOR)
-	if(currExec == NULLC_LLVM)
-		return executorLLVM->GetResultObject();
-#endif
-#ifndef NULLC_NO_EXECUTOR
-	if(currExec == NULLC_REG_VM)
-		return executorRegVm->GetResultObject();
+	executorX86->SetExecutionBudget(steps, milliseconds);
 #endif
 
-	return empty;
+	executorRegVm->SetExecutionBudget(steps, milliseconds);
+
+	return true;
 }
 
-const char* nullcGetResult()
+nullres nullcSetExecutionBudgetCallback(void *context, unsigned (*callback)(void *context))
 {
 	using namespace NULLC;
-	NULLC_CHECK_INITIALIZED("");
+	NULLC_CHECK_INITIALIZED(false);
 
 #ifdef NULLC_BUILD_X86_JIT
-	if(currExec == NULLC_X86)
-		return executorX86->GetResult();
-#endif
-#if defined(NULLC_LLVM_SUPPORT) && !defined(NULLC_NO_EXECUTOR)
-	if(currExec == NULLC_LLVM)
-		return executorLLVM->GetResult();
-#endif
-#ifndef NULLC_NO_EXECUTOR
-	if(currExec == NULLC_REG_VM)
-		return executorRegVm->GetResult();
+	executorX86->SetExecutionBudgetCallback(context, callback);
 #endif
 
-	return "unknown executor";
+	executorRegVm->SetExecutionBudgetCallback(context, callback);
+
+	return true;
+}
+
+nullres nullcSetMemoryQuota(unsigned softLimit, unsigned hardLimit)
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(false);
+
+	NULLC::SetMemoryQuota(softLimit, hardLimit);
+
+	return true;
+}
+
+nullres nullcSetMemoryQuotaCallback(void *context, unsigned (*callback)(void *context, unsigned used, unsigned softLimit))
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(false);
+
+	NULLC::SetMemoryQuotaCallback(context, callback);
+
+	return true;
+}
+
+unsigned nullcGetMemoryUsage(unsigned category)
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(0);
+
+	return NULLC::GetMemoryUsage(category);
+}
+
+NULLCArray nullcRegisterHostArray(void *data, unsigned typeID, unsigned count, void (*release)(void *data, void *context), void *context)
+{
+	using namespace NULLC;
+	NULLCArray arr = { 0, 0 };
+	NULLC_CHECK_INITIALIZED(arr);
+
+	if(!data || !count)
+	{
+		nullcLastError = "ERROR: host array is empty";
+		return arr;
+	}
+
+	if(typeID >= linker->exTypes.size() || !linker->exTypes[typeID].size)
+	{
+		nullcLastError = "ERROR: host array element type is invalid";
+		return arr;
+	}
+
+	ExternTypeInfo &type = linker->exTypes[typeID];
+
+	if(type.pointerCount != 0 || (type.typeFlags & ExternTypeInfo::TYPE_IS_EXTENDABLE) != 0)
+	{
+		nullcLastError = "ERROR: host array element type can't contain pointers";
+		return arr;
+	}
+
+	if(count > ~0u / type.size)
+	{
+		nullcLastError = "ERROR: host array is too large";
+		return arr;
+	}
+
+	if(NULLC::GetBasePointer(data) || NULLC::GetBasePointer((char*)data + count * type.size - 1))
+	{
+		nullcLastError = "ERROR: host array can't be placed in memory managed by GC";
+		return arr;
+	}
+
+	if(!NULLC::RegisterHostRegion(data, count * type.size, release, context))
+	{
+		nullcLastError = "ERROR: host array overlaps with another host array";
+		return arr;
+	}
+
+	arr.ptr = (char*)data;
+	arr.len = count;
+
+	return arr;
+}
+
+nullres nullcReleaseHostArray(void *data)
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(false);
+
+	if(!NULLC::ReleaseHostRegion(data))
+	{
+		nullcLastError = "ERROR: pointer is not a start of a held host array";
+		return false;
+	}
+
+	return true;
+}
+
+nullres nullcIsHostArrayPointer(void *ptr)
+{
+	return NULLC::IsHostPointer(ptr);
+}
+
+unsigned nullcGetHostArrayCount()
+{
+	return NULLC::HostRegionCount();
+}
+
+void nullcSetAllocationProfiler(unsigned sampleBytes)
+{
+	NULLC::SetAllocationProfiler(sampleBytes);
+}
+
+nullres nullcGetAllocationTypeProfile(unsigned typeID, NULLCAllocationStats *stats)
+{
+	using namespace NULLC;
+
+	if(!stats)
+	{
+		nullcLastError = "ERROR: passed pointer to statistics is 'null'";
+		return false;
+	}
+
+	return NULLC::GetAllocationTypeStats(typeID, *stats) && stats->totalCount != 0;
+}
+
+const unsigned* nullcGetAllocationSiteProfile(unsigned id, NULLCAllocationStats *stats, unsigned *typeID, unsigned *frameCount)
+{
+	NULLCAllocationStats siteStats;
+	unsigned siteTypeID = 0;
+	const unsigned *siteFrames = NULL;
+	unsigned siteFrameCount = 0;
+
+	if(!NULLC::GetAllocationSiteStats(id, siteStats, siteTypeID, &siteFrames, siteFrameCount))
+		return NULL;
+
+	if(stats)
+		*stats = siteStats;
+
+	if(typeID)
+		*typeID = siteTypeID;
+
+	if(frameCount)
+		*frameCount = siteFrameCount;
+
+	return siteFrames;
+}
+
+nullres nullcSaveAllocationProfile(const char *fileName, unsigned format)
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(false);
+
+	TRACE_SCOPE("nullc", "nullcSaveAllocationProfile");
+
+	if(format != NULLC_ALLOCATION_PROFILE_FOLDED && format != NULLC_ALLOCATION_PROFILE_HEAP)
+	{
+		nullcLastError = "ERROR: unknown allocation profile format";
+		return false;
+	}
+
+	OutputContext outputCtx;
+
+	outputCtx.openStream = openStream;
+	outputCtx.writeStream = writeStream;
+	outputCtx.closeStream = closeStream;
+
+	outputCtx.outputBuf = outputBuf;
+	outputCtx.outputBufSize = NULLC_OUTPUT_BUFFER_SIZE;
+
+	outputCtx.tempBuf = tempOutputBuf;
+	outputCtx.tempBufSize = NULLC_TEMP_OUTPUT_BUFFER_SIZE;
+
+	outputCtx.stream = outputCtx.openStream(fileName);
+
+	if(!outputCtx.stream)
+	{
+		nullcLastError = "ERROR: failed to open allocation profile file";
+		return false;
+	}
+
+	NULLC::SaveAllocationProfile(outputCtx, format);
+
+	outputCtx.closeStream(outputCtx.stream);
+	outputCtx.stream = NULL;
+
+	return true;
+}
+
+unsigned nullcGetCollectionCount()
+{
+	return NULLC::CollectionCount();
+}
+
+nullres nullcGetCollectionInfo(unsigned id, NULLCCollectionInfo *info)
+{
+	using namespace NULLC;
+
+	if(!info)
+	{
+		nullcLastError = "ERROR: passed pointer to collection info is 'null'";
+		return false;
+	}
+
+	if(!NULLC::GetCollectionInfo(id, *info))
+	{
+		nullcLastError = "ERROR: collection record is not available";
+		return false;
+	}
+
+	return true;
+}
+
+nullres nullcGetCollectionHistogram(unsigned phase, unsigned *buckets)
+{
+	using namespace NULLC;
+
+	if(phase >= NULLC_GC_PHASE_COUNT)
+	{
+		nullcLastError = "ERROR: unknown collection phase";
+		return false;
+	}
+
+	if(!buckets)
+	{
+		nullcLastError = "ERROR: passed pointer to histogram buckets is 'null'";
+		return false;
+	}
+
+	for(unsigned i = 0; i < NULLC_GC_HISTOGRAM_SIZE; i++)
+		buckets[i] = NULLC::GetCollectionHistogram(phase, i);
+
+	return true;
+}
+
+void nullcResetCollectionStatistics()
+{
+	NULLC::ResetCollectionStatistics();
+}
+
+#endif
+
+unsigned nullcGetResultType()
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(NULLC_TYPE_VOID);
+
+#ifdef NULLC_BUILD_X86_JIT
+	if(currExec == NULLC_X86)
+		return executorX86->GetResultType();
+#endif
+#if defined(NULLC_LLVM_SUPPORT) && !defined(NULLC_NO_EXECUTOR)
+	if(currExec == NULLC_LLVM)
+		return executorLLVM->GetResultType();
+#endif
+#ifndef NULLC_NO_EXECUTOR
+	if(currExec == NULLC_REG_VM)
+		return executorRegVm->GetResultType();
+#endif
+
+	return NULLC_TYPE_VOID;
+}
+
+NULLCRef nullcGetResultObject()
+{
+	NULLCRef empty = { 0, 0 };
+
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(empty);
+
+#ifdef NULLC_BUILD_X86_JIT
+	if(currExec == NULLC_X86)
+		return executorX86->GetResultObject();
+#endif
+#if defined(NULLC_LLVM_SUPPORT) && !defined(NULLC_NO_EXECUTOR)
+	if(currExec == NULLC_LLVM)
+		return executorLLVM->GetResultObject();
+#endif
+#ifndef NULLC_NO_EXECUTOR
+	if(currExec == NULLC_REG_VM)
+		return executorRegVm->GetResultObject();
+#endif
+
+	return empty;
+}
+
+const char* nullcGetResult()
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED("");
+
+#ifdef NULLC_BUILD_X86_JIT
+	if(currExec == NULLC_X86)
+		return executorX86->GetResult();
+#endif
+#if defined(NULLC_LLVM_SUPPORT) && !defined(NULLC_NO_EXECUTOR)
+	if(currExec == NULLC_LLVM)
+		return executorLLVM->GetResult();
+#endif
+#ifndef NULLC_NO_EXECUTOR
+	if(currExec == NULLC_REG_VM)
+		return executorRegVm->GetResult();
+#endif
+
+	return "unknown executor";
+}
+
+int nullcGetResultInt()
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(0);
+
+#ifdef NULLC_BUILD_X86_JIT
+	if(currExec == NULLC_X86)
+		return executorX86->GetResultInt();
+#endif
+#if defined(NULLC_LLVM_SUPPORT) && !defined(NULLC_NO_EXECUTOR)
+	if(currExec == NULLC_LLVM)
+		return executorLLVM->GetResultInt();
+#endif
+#ifndef NULLC_NO_EXECUTOR
+	if(currExec == NULLC_REG_VM)
+		return executorRegVm->GetResultInt();
+#endif
+
+	return 0;
+}
+
+double nullcGetResultDouble()
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(0.0);
+
+#ifdef NULLC_BUILD_X86_JIT
+	if(currExec == NULLC_X86)
+		return executorX86->GetResultDouble();
+#endif
+#if defined(NULLC_LLVM_SUPPORT) && !defined(NULLC_NO_EXECUTOR)
+	if(currExec == NULLC_LLVM)
+		return executorLLVM->GetResultDouble();
+#endif
+#ifndef NULLC_NO_EXECUTOR
+	if(currExec == NULLC_REG_VM)
+		return executorRegVm->GetResultDouble();
+#endif
+
+	return 0.0;
+}
+long long nullcGetResultLong()
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(0);
+
+#ifdef NULLC_BUILD_X86_JIT
+	if(currExec == NULLC_X86)
+		return executorX86->GetResultLong();
+#endif
+#if defined(NULLC_LLVM_SUPPORT) && !defined(NULLC_NO_EXECUTOR)
+	if(currExec == NULLC_LLVM)
+		return executorLLVM->GetResultLong();
+#endif
+#ifndef NULLC_NO_EXECUTOR
+	if(currExec == NULLC_REG_VM)
+		return executorRegVm->GetResultLong();
+#endif
+
+	return 0;
+}
+
+const char*	nullcGetLastError()
+{
+	return NULLC::nullcLastError;
+}
+
+NULLCRef nullcGetLastErrorObject()
+{
+	using namespace NULLC;
+	NULLCRef empty = { 0, 0 };
+	NULLC_CHECK_INITIALIZED(empty);
+
+#ifdef NULLC_BUILD_X86_JIT
+	if(currExec == NULLC_X86)
+		return executorX86->GetErrorObject();
+#endif
+#if defined(NULLC_LLVM_SUPPORT) && !defined(NULLC_NO_EXECUTOR)
+	if(currExec == NULLC_LLVM)
+		return executorLLVM->GetErrorObject();
+#endif
+#ifndef NULLC_NO_EXECUTOR
+	if(currExec == NULLC_REG_VM)
+		return executorRegVm->GetErrorObject();
+#endif
+
+	return empty;
+}
+
+#ifndef NULLC_NO_EXECUTOR
+nullres nullcFinalize()
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(false);
+
+	TRACE_SCOPE("nullc", "nullcFinalize");
+
+	FinalizeMemory();
+
+	return 1;
+}
+
+void* nullcAllocate(unsigned size)
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(0);
+
+	return NULLC::AllocObject(size, 0);
+}
+
+void* nullcAllocateTyped(unsigned typeID)
+{
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(0);
+
+	return NULLC::AllocObject(nullcGetTypeSize(typeID), typeID);
+}
+
+NULLCRef nullcAllocateObjectTyped(unsigned typeID)
+{
+	using namespace NULLC;
+	NULLCRef r = { 0, 0 };
+	NULLC_CHECK_INITIALIZED(r);
+
+	r.ptr = (char*)NULLC::AllocObject(nullcGetTypeSize(typeID), typeID);
+	r.typeID = typeID;
+
+	return r;
+}
+
+NULLCArray nullcAllocateArrayTyped(unsigned typeID, unsigned count)
+{
+	using namespace NULLC;
+	NULLCArray arr = { 0, 0 };
+	NULLC_CHECK_INITIALIZED(arr);
+	
+	return NULLC::AllocArray(nullcGetTypeSize(typeID), count, typeID);
+}
+
+int nullcInitTypeinfoModule()
+{
+	TRACE_SCOPE("nullc", "nullcInitTypeinfoModule");
+
+	return nullcInitTypeinfoModule(NULLC::linker);
+}
+
+int nullcInitDynamicModule()
+{
+	TRACE_SCOPE("nullc", "nullcInitDynamicModule");
+
+	return nullcInitDynamicModule(NULLC::linker);
+}
+#endif
+
+void nullcTerminate()
+{
+	using namespace NULLC;
+	nullcLastError = "";
+	if(!initialized)
+		return;
+
+	nullcContextMakeCurrent(NULL);
+
+	NULLC::destruct(compilerCtx);
+	compilerCtx = NULL;
+
+	allocator.Reset();
+
+	compilerChunkCache.Reset();
+	compilerChunkCache.SetLock(NULL, NULL);
+
+	chunkCacheLock.Destroy();
+
+	NULLC::dealloc(argBuf);
+	argBuf = NULL;
+
+	NULLC::dealloc(errorBuf);
+	errorBuf = NULL;
+
+	NULLC::dealloc(outputBuf);
+	outputBuf = NULL;
+
+	NULLC::dealloc(tempOutputBuf);
+	tempOutputBuf = NULL;
+
+	BinaryCache::Terminate();
+
+	if(!enableBaseModuleReuse)
+	{
+		CompilerLockScope lockScope;
+
+		ReleaseBaseModule();
+	}
+
+#ifndef NULLC_NO_EXECUTOR
+	nullcDeinitTypeinfoModule();
+	nullcDeinitDynamicModule();
+	nullcDeinitAsyncModule();
+
+	NULLC::destruct(linker);
+	linker = NULL;
+
+	nullcProgramRelease(defaultContext.program);
+	defaultContext.program = NULL;
+#endif
+#ifdef NULLC_BUILD_X86_JIT
+	NULLC::destruct(executorX86);
+	executorX86 = NULL;
+#endif
+#ifndef NULLC_NO_EXECUTOR
+	NULLC::destruct(executorRegVm);
+	executorRegVm = NULL;
+#endif
+
+#ifndef NULLC_NO_EXECUTOR
+	NULLC::ResetMemory();
+#endif
+
+	compilerLock.Destroy();
+
+	defaultContextThread = false;
+	contextSelected = false;
+
+	initialized = false;
+}
+
+namespace NULLC
+{
+	void SaveContext(nullcContext *context)
+	{
+		context->linker = linker;
+
+		context->executorX86 = executorX86;
+		context->executorLLVM = executorLLVM;
+		context->executorRegVm = executorRegVm;
+
+		context->lastError = nullcLastError;
+		context->errorBuf = errorBuf;
+
+		context->currExec = currExec;
+		context->argBuf = argBuf;
+
+		context->currDebugCallStackFrame = currDebugCallStackFrame;
+
+#ifndef NULLC_NO_EXECUTOR
+		context->heap = NULLC::GetHeap();
+#endif
+	}
+
+	void LoadContext(nullcContext *context)
+	{
+		// Thread is left without a current context
+		if(!context)
+		{
+			static nullcContext emptyContext;
+
+			LoadContext(&emptyContext);
+
+			currContext = NULL;
+			return;
+		}
+
+		linker = context->linker;
+
+		executorX86 = context->executorX86;
+		executorLLVM = context->executorLLVM;
+		executorRegVm = context->executorRegVm;
+
+		nullcLastError = context->lastError;
+		errorBuf = context->errorBuf;
+
+		currExec = context->currExec;
+		argBuf = context->argBuf;
+
+		currDebugCallStackFrame = context->currDebugCallStackFrame;
+
+#ifndef NULLC_NO_EXECUTOR
+		NULLC::SetHeap(context->heap);
+
+		// Standard library and the runtime modules access type information of the current linker
+		NULLC::SetLinker(linker);
+		CommonSetLinker(linker);
+
+		nullcInitTypeinfoModuleLinkerOnly(linker);
+		nullcInitDynamicModuleLinkerOnly(linker);
+
+		nullcAsyncSetState(context->asyncState);
+#endif
+
+		currContext = context;
+	}
+
+	// Null context leaves the thread without a current context
+	void SwitchContext(nullcContext *context)
+	{
+		if(context == currContext)
+			return;
+
+		if(currContext)
+			SaveContext(currContext);
+
+		LoadContext(context);
+	}
+
+	// Thread that has never selected a context uses the default context
+	bool SelectCurrentContext()
+	{
+		if(contextSelected)
+			return currContext != NULL;
+
+		if(currContext != &defaultContext || loadedContextGeneration != defaultContextGeneration)
+		{
+			LoadContext(&defaultContext);
+
+			loadedContextGeneration = defaultContextGeneration;
+		}
+
+		return true;
+	}
+}
+
+nullcContext* nullcContextCreate()
+{
+	using namespace NULLC;
+	NULLC_CHECK_LIBRARY_INITIALIZED(NULL);
+
+	TRACE_SCOPE("nullc", "nullcContextCreate");
+
+	nullcContext *context = NULLC::construct<nullcContext>();
+
+	context->linker = NULL;
+
+	context->executorX86 = NULL;
+	context->executorLLVM = NULL;
+	context->executorRegVm = NULL;
+
+	context->lastError = "";
+	context->errorBuf = (char*)NULLC::alloc(NULLC_ERROR_BUFFER_SIZE);
+
+	context->currExec = currExec;
+	context->argBuf = (char*)NULLC::alloc(64 * 1024);
+
+	context->currDebugCallStackFrame = 0;
+
+	context->heap = NULL;
+
+	context->asyncState = NULL;
+
+	context->program = NULL;
+
+#ifndef NULLC_NO_EXECUTOR
+	context->linker = NULLC::construct<Linker>();
+
+	context->heap = NULLC::CreateHeap();
+
+	context->asyncState = nullcAsyncCreateState();
+#endif
+
+#ifdef NULLC_BUILD_X86_JIT
+	{
+		// Code generator function table is shared
+		CompilerLockScope lockScope;
+
+		context->executorX86 = new(NULLC::alloc(sizeof(ExecutorX86))) ExecutorX86(context->linker);
+		bool initx86 = context->executorX86->Initialize();
+		assert(initx86);
+		(void)initx86;
+	}
+#endif
+
+#if defined(NULLC_LLVM_SUPPORT) && !defined(NULLC_NO_EXECUTOR)
+	context->executorLLVM = new(NULLC::alloc(sizeof(ExecutorLLVM))) ExecutorLLVM(context->linker);
+#endif
+
+#ifndef NULLC_NO_EXECUTOR
+	context->executorRegVm = new(NULLC::alloc(sizeof(ExecutorRegVm))) ExecutorRegVm(context->linker);
+#endif
+
+	// Setup new heap and restore global state modified by the linker creation
+	if(currContext)
+		SaveContext(currContext);
+
+	nullcContext *current = currContext;
+
+	LoadContext(context);
+
+#ifndef NULLC_NO_EXECUTOR
+	NULLC::SetGlobalLimit(NULLC_DEFAULT_GLOBAL_MEMORY_LIMIT);
+#endif
+
+	nullcUpdateExecutorMemory();
+
+	LoadContext(current);
+
+	return context;
+}
+
+void nullcContextDestroy(nullcContext *context)
+{
+	using namespace NULLC;
+	NULLC_CHECK_LIBRARY_INITIALIZED((void)0);
+
+	if(!context || context == &defaultContext)
+		return;
+
+	TRACE_SCOPE("nullc", "nullcContextDestroy");
+
+	// Default context is selected only on the thread that has initialized the library
+	if(context == currContext)
+		SwitchContext(defaultContextThread ? &defaultContext : NULL);
+
+	if(currContext)
+		SaveContext(currContext);
+
+#ifdef NULLC_BUILD_X86_JIT
+	{
+		// Native code translation state is shared
+		CompilerLockScope lockScope;
+
+		NULLC::destruct(context->executorX86);
+	}
+#endif
+
+#if defined(NULLC_LLVM_SUPPORT) && !defined(NULLC_NO_EXECUTOR)
+	NULLC::destruct(context->executorLLVM);
+#endif
+
+#ifndef NULLC_NO_EXECUTOR
+	NULLC::destruct(context->executorRegVm);
+
+	NULLC::destruct(context->linker);
+
+	nullcProgramRelease(context->program);
+
+	if(compilerHeap == context->heap)
+		compilerHeap = NULL;
+
+	NULLC::DestroyHeap(context->heap);
+
+	nullcAsyncDestroyState(context->asyncState);
+#endif
+
+	NULLC::dealloc(context->argBuf);
+	NULLC::dealloc(context->errorBuf);
+
+	NULLC::destruct(context);
+
+	LoadContext(currContext);
+}
+
+nullres nullcContextMakeCurrent(nullcContext *context)
+{
+	using namespace NULLC;
+	NULLC_CHECK_LIBRARY_INITIALIZED(0);
+
+	SwitchContext(context ? context : &defaultContext);
+
+	contextSelected = true;
+
+	return 1;
 }
 
-int nullcGetResultInt()
+void nullcContextDetach()
 {
 	using namespace NULLC;
-	NULLC_CHECK_INITIALIZED(0);
 
-#ifdef NULLC_BUILD_X86_JIT
-	if(currExec == NULLC_X86)
-		return executorX86->GetResultInt();
-#endif
-#if defined(NULLC_LLVM_SUPPORT) && !defined(NULLC_NO_EXECUTOR)
-	if(currExec == NULLC_LLVM)
-		return executorLLVM->GetResultInt();
-#endif
-#ifndef NULLC_NO_EXECUTOR
-	if(currExec == NULLC_REG_VM)
-		return executorRegVm->GetResultInt();
-#endif
+	SwitchContext(NULL);
 
-	return 0;
+	contextSelected = true;
 }
 
-double nullcGetResultDouble()
+nullcContext* nullcContextGetCurrent()
 {
 	using namespace NULLC;
-	NULLC_CHECK_INITIALIZED(0.0);
-
-#ifdef NULLC_BUILD_X86_JIT
-	if(currExec == NULLC_X86)
-		return executorX86->GetResultDouble();
-#endif
-#if defined(NULLC_LLVM_SUPPORT) && !defined(NULLC_NO_EXECUTOR)
-	if(currExec == NULLC_LLVM)
-		return executorLLVM->GetResultDouble();
-#endif
-#ifndef NULLC_NO_EXECUTOR
-	if(currExec == NULLC_REG_VM)
-		return executorRegVm->GetResultDouble();
-#endif
 
-	return 0.0;
+	return currContext == &defaultContext ? NULL : currContext;
 }
-long long nullcGetResultLong()
-{
-	using namespace NULLC;
-	NULLC_CHECK_INITIALIZED(0);
 
-#ifdef NULLC_BUILD_X86_JIT
-	if(currExec == NULLC_X86)
-		return executorX86->GetResultLong();
-#endif
-#if defined(NULLC_LLVM_SUPPORT) && !defined(NULLC_NO_EXECUTOR)
-	if(currExec == NULLC_LLVM)
-		return executorLLVM->GetResultLong();
-#endif
-#ifndef NULLC_NO_EXECUTOR
-	if(currExec == NULLC_REG_VM)
-		return executorRegVm->GetResultLong();
-#endif
+nullres nullcContextBuild(nullcContext *context, const char* code)
+{
+	if(!nullcContextMakeCurrent(context))
+		return 0;
 
-	return 0;
+	return nullcBuild(code);
 }
 
-const char*	nullcGetLastError()
+nullres nullcContextRun(nullcContext *context)
 {
-	return NULLC::nullcLastError;
+	if(!nullcContextMakeCurrent(context))
+		return 0;
+
+	return nullcRun();
 }
 
-NULLCRef nullcGetLastErrorObject()
+nullres nullcContextCallFunction(nullcContext *context, NULLCFuncPtr ptr, ...)
 {
 	using namespace NULLC;
-	NULLCRef empty = { 0, 0 };
-	NULLC_CHECK_INITIALIZED(empty);
 
-#ifdef NULLC_BUILD_X86_JIT
-	if(currExec == NULLC_X86)
-		return executorX86->GetErrorObject();
-#endif
-#if defined(NULLC_LLVM_SUPPORT) && !defined(NULLC_NO_EXECUTOR)
-	if(currExec == NULLC_LLVM)
-		return executorLLVM->GetErrorObject();
-#endif
+	if(!nullcContextMakeCurrent(context))
+		return 0;
+
 #ifndef NULLC_NO_EXECUTOR
-	if(currExec == NULLC_REG_VM)
-		return executorRegVm->GetErrorObject();
-#endif
+	// Copy arguments in argument buffer
+	va_list args;
 
-	return empty;
+	va_start(args, ptr);
+	const char *argBuf = nullcGetArgumentVector(ptr.id, (uintptr_t)ptr.context, args);
+	va_end(args);
+
+	if(!argBuf)
+		return false;
+
+	return nullcCallFunctionInternal(ptr, argBuf);
+#else
+	(void)ptr;
+
+	nullcLastError = "No executor available, compile library without NULLC_NO_EXECUTOR";
+	return false;
+#endif
 }
 
-#ifndef NULLC_NO_EXECUTOR
-nullres nullcFinalize()
+nullcProgram* nullcProgramCreate()
 {
 	using namespace NULLC;
-	NULLC_CHECK_INITIALIZED(false);
+	NULLC_CHECK_INITIALIZED(NULL);
 
-	TRACE_SCOPE("nullc", "nullcFinalize");
+	TRACE_SCOPE("nullc", "nullcProgramCreate");
 
-	FinalizeMemory();
+#ifndef NULLC_NO_EXECUTOR
+	if(linker->exRegVmCode.empty())
+	{
+		nullcLastError = "ERROR: no code is linked";
+		return NULL;
+	}
 
-	return 1;
+	for(unsigned i = 0; i < linker->exRegVmCode.size(); i++)
+	{
+		// nop instruction is used for breaks
+		if(linker->exRegVmCode[i].code == rviNop)
+		{
+			nullcLastError = "ERROR: cannot create program image while breakpoints are set";
+			return NULL;
+		}
+	}
+
+	nullcProgram *program = NULLC::construct<nullcProgram>();
+
+	program->refCount = 1;
+
+	program->linker = NULLC::construct<Linker>();
+	program->linker->CopyCode(*linker);
+
+	// Return at the end of the code is added once for all contexts that share it
+	program->linker->exRegVmCode.push_back(RegVmCmd(rviReturn, 0, rvrError, 0, 0));
+	program->linker->exRegVmExecCount.push_back(0);
+
+	// Native code translation reads register kill info of every instruction, the return doesn't kill any registers
+	program->linker->exRegVmRegKillInfo.push_back(0);
+
+	// Linker registers itself in the standard library on creation
+	NULLC::SetLinker(linker);
+
+	return program;
+#else
+	nullcLastError = "No executor available, compile library without NULLC_NO_EXECUTOR";
+	return NULL;
+#endif
 }
 
-void* nullcAllocate(unsigned size)
+void nullcProgramRetain(nullcProgram *program)
 {
-	using namespace NULLC;
-	NULLC_CHECK_INITIALIZED(0);
+	if(!program)
+		return;
 
-	return NULLC::AllocObject(size, 0);
+#if defined(_WIN32)
+	InterlockedIncrement(&program->refCount);
+#else
+	__sync_add_and_fetch(&program->refCount, 1);
+#endif
 }
 
-void* nullcAllocateTyped(unsigned typeID)
+void nullcProgramRelease(nullcProgram *program)
 {
-	using namespace NULLC;
-	NULLC_CHECK_INITIALIZED(0);
+	if(!program)
+		return;
 
-	return NULLC::AllocObject(nullcGetTypeSize(typeID), typeID);
+#if defined(_WIN32)
+	if(InterlockedDecrement(&program->refCount) != 0)
+		return;
+#else
+	if(__sync_sub_and_fetch(&program->refCount, 1) != 0)
+		return;
+#endif
+
+	NULLC::destruct(program->linker);
+	NULLC::destruct(program);
 }
 
-NULLCRef nullcAllocateObjectTyped(unsigned typeID)
+nullres nullcContextLoadProgram(nullcContext *context, nullcProgram *program)
 {
 	using namespace NULLC;
-	NULLCRef r = { 0, 0 };
-	NULLC_CHECK_INITIALIZED(r);
 
-	r.ptr = (char*)NULLC::AllocObject(nullcGetTypeSize(typeID), typeID);
-	r.typeID = typeID;
+	if(!nullcContextMakeCurrent(context))
+		return 0;
 
-	return r;
+	if(!program)
+	{
+		nullcLastError = "ERROR: program image is not specified";
+		return 0;
+	}
+
+	TRACE_SCOPE("nullc", "nullcContextLoadProgram");
+
+#ifndef NULLC_NO_EXECUTOR
+	executorRegVm->ClearBreakpoints();
+
+	// Tables and code are used in place, context keeps its own globals, heap and stack
+	nullcProgramRetain(program);
+
+	linker->ShareCode(*program->linker);
+
+	nullcProgramRelease(currContext->program);
+	currContext->program = program;
+
+	NULLC::ClearMemory();
+
+	nullcAsyncResetState();
+
+	#ifdef NULLC_BUILD_X86_JIT
+	executorX86->ClearNative();
+	#endif
+#endif
+
+	nullcLastError = "";
+
+	return nullcPrepareLinkedCode();
 }
 
-NULLCArray nullcAllocateArrayTyped(unsigned typeID, unsigned count)
+nullcContext* nullcContextCreateFromProgram(nullcProgram *program)
 {
 	using namespace NULLC;
-	NULLCArray arr = { 0, 0 };
-	NULLC_CHECK_INITIALIZED(arr);
-	
-	return NULLC::AllocArray(nullcGetTypeSize(typeID), count, typeID);
+
+	nullcContext *current = currContext;
+
+	nullcContext *context = nullcContextCreate();
+
+	if(!context)
+		return NULL;
+
+	if(!nullcContextLoadProgram(context, program))
+	{
+		// Keep the error message after the context is destroyed
+		const char *error = nullcLastError;
+
+		nullcContextDestroy(context);
+		SwitchContext(current);
+
+		nullcLastError = error;
+		return NULL;
+	}
+
+	SwitchContext(current);
+
+	return context;
 }
 
-int nullcInitTypeinfoModule()
+void nullcSetEnableSnapshots(int enable)
 {
-	TRACE_SCOPE("nullc", "nullcInitTypeinfoModule");
-
-	return nullcInitTypeinfoModule(NULLC::linker);
+	NULLC::enableSnapshots = enable != 0;
 }
 
-int nullcInitDynamicModule()
+nullres nullcSaveSnapshot(const char *fileName)
 {
-	TRACE_SCOPE("nullc", "nullcInitDynamicModule");
+	using namespace NULLC;
+	NULLC_CHECK_INITIALIZED(false);
 
-	return nullcInitDynamicModule(NULLC::linker);
+	TRACE_SCOPE("nullc", "nullcSaveSnapshot");
+
+	if(linker->exRegVmCode.empty())
+	{
+		nullcLastError = "ERROR: no code is linked";
+		return false;
+	}
+
+	if(currExec == NULLC_LLVM)
+	{
+		nullcLastError = "ERROR: snapshots are not supported by LLVM executor";
+		return false;
+	}
+
+	if(linker->exRootBytecode.empty())
+	{
+		nullcLastError = "ERROR: snapshots were not enabled when the program was linked";
+		return false;
+	}
+
+	FastVector<char> result;
+
+	if(!NULLC::SaveSnapshot(linker, (char*)nullcGetVariableData(NULL), result, nullcLastError))
+		return false;
+
+	if(!fileSave(fileName, result.data, result.size()))
+	{
+		nullcLastError = "ERROR: failed to write snapshot file";
+		return false;
+	}
+
+	return true;
 }
-#endif
 
-void nullcTerminate()
+nullres nullcLoadSnapshot(const char *fileName)
 {
 	using namespace NULLC;
-	nullcLastError = "";
-	if(!initialized)
-		return;
+	NULLC_CHECK_INITIALIZED(false);
 
-	NULLC::destruct(compilerCtx);
-	compilerCtx = NULL;
+	TRACE_SCOPE("nullc", "nullcLoadSnapshot");
 
-	allocator.Reset();
+	if(currExec == NULLC_LLVM)
+	{
+		nullcLastError = "ERROR: snapshots are not supported by LLVM executor";
+		return false;
+	}
 
-	NULLC::dealloc(argBuf);
-	argBuf = NULL;
+	unsigned size = 0;
+	const char *data = fileLoad(fileName, &size);
 
-	NULLC::dealloc(errorBuf);
-	errorBuf = NULL;
+	if(!data)
+	{
+		nullcLastError = "ERROR: failed to open snapshot file";
+		return false;
+	}
 
-	NULLC::dealloc(outputBuf);
-	outputBuf = NULL;
+	nullcClean();
 
-	NULLC::dealloc(tempOutputBuf);
-	tempOutputBuf = NULL;
+	linker->keepRootBytecode = enableSnapshots;
 
-	BinaryCache::Terminate();
+	if(!NULLC::LinkSnapshotCode(linker, data, size, nullcLastError) || !nullcPrepareLinkedCode())
+	{
+		fileFree(data);
+		return false;
+	}
 
-#ifndef NULLC_NO_EXECUTOR
-	nullcDeinitTypeinfoModule();
-	nullcDeinitDynamicModule();
+	char *globals = NULL;
 
-	NULLC::destruct(linker);
-	linker = NULL;
-#endif
 #ifdef NULLC_BUILD_X86_JIT
-	NULLC::destruct(executorX86);
-	executorX86 = NULL;
-#endif
-#ifndef NULLC_NO_EXECUTOR
-	NULLC::destruct(executorRegVm);
-	executorRegVm = NULL;
+	if(currExec == NULLC_X86 && !(globals = executorX86->ResetGlobals()))
+		nullcLastError = executorX86->GetErrorMessage();
 #endif
 
-#ifndef NULLC_NO_EXECUTOR
-	NULLC::ResetMemory();
-#endif
+	if(currExec == NULLC_REG_VM && !(globals = executorRegVm->ResetGlobals()))
+		nullcLastError = executorRegVm->GetErrorMessage();
 
-	initialized = false;
+	bool success = globals && NULLC::LoadSnapshotData(linker, globals, data, size, nullcLastError);
+
+	fileFree(data);
+
+	return success;
 }
 
 nullres nullcTestEvaluateExpressionTree(char *resultBuf, unsigned resultBufSize)
@@ -2377,6 +3995,16 @@ CompilerContext* nullcGetCompilerContext()
 	return NULLC::compilerCtx;
 }
 
+void nullcLockCompiler()
+{
+	NULLC::compilerLock.Lock();
+}
+
+void nullcUnlockCompiler()
+{
+	NULLC::compilerLock.Unlock();
+}
+
 void nullcVisitParseTreeNodes(SynBase *syntax, void *context, void(*accept)(void *context, SynBase *child))
 {
 	TRACE_SCOPE("nullc", "nullcVisitParseTreeNodes");
@@ -19,17 +19,118 @@ void		nullcAddImportPath(const char* importPath);
 void		nullcRemoveImportPath(const char* importPath);
 nullres		nullcHasImportPath(const char* importPath);
 
+/*	Modules built from files are saved to the directory and are loaded from it later if their source, the sources of their dependencies and the optimization level are the same.
+	Directory path is a prefix of entry file names, so it should end with a slash. Passing NULL disables the cache and resets the hit and miss counters	*/
+void		nullcSetModuleCacheDirectory(const char* path);
+void		nullcGetModuleCacheStatistics(unsigned *hits, unsigned *misses);
+
 void		nullcSetFileReadHandler(const char* (*fileLoadFunc)(const char* name, unsigned* size), void (*fileFreeFunc)(const char* data));
+
+/*	Files that are produced by the library to be read back later with the file read handler are saved with this handler. Function returns 0 on failure	*/
+void		nullcSetFileWriteHandler(int (*fileSaveFunc)(const char* name, const char* data, unsigned size));
 void		nullcSetGlobalMemoryLimit(unsigned limit);
+void		nullcSetCollectionPolicy(const NULLCCollectionPolicy *policy);
+void		nullcGetCollectionPolicy(NULLCCollectionPolicy *policy);
 void		nullcSetEnableLogFiles(int enable, void* (*openStream)(const char* name), void (*writeStream)(void *stream, const char *data, unsigned size), void (*closeStream)(void* stream));
 void		nullcSetOptimizationLevel(int level);
 void		nullcSetEnableTimeTrace(int enable);
 void		nullcSetModuleAnalyzeMemoryLimit(unsigned bytes);
+
+/*	Compiler allocator memory is kept between compilations for reuse, memory over the 'bytes' limit is returned to the system. Default limit is 64MB	*/
+void		nullcSetCompilerMemoryRetention(unsigned bytes);
+
+/*	Get the compiler allocator memory requested by each phase of the last module analysis or compilation	*/
+void		nullcGetCompilerMemoryStatistics(NULLCCompilerMemoryStats *stats);
+
+/*	When set, module analysis stops with an error as soon as the cancellation is requested.
+	Cancellation is checked each time the analyzer has allocated another 64KB of memory, so it can be requested by another thread while the analysis is running	*/
+void		nullcSetAnalyzeCancellation(NULLCCancellation *cancellation);
+
+/*	Cancellation can be requested and reset from any thread	*/
+void		nullcRequestCancellation(NULLCCancellation *cancellation);
+void		nullcResetCancellation(NULLCCancellation *cancellation);
+int			nullcIsCancellationRequested(NULLCCancellation *cancellation);
+
+/*	When set, imports missing from the module cache are discovered before the module is parsed and are compiled in dependency order, independent modules are compiled concurrently by 'count' threads.
+	Default value of 0 compiles each import when the parser reaches it	*/
+void		nullcSetModuleBuildThreads(unsigned count);
 void		nullcSetEnableExternalDebugger(int enable);
 void		nullcSetMissingFunctionLookup(void* (*lookup)(const char* name));
 
+/*	When enabled, nullcTerminate keeps the compiled base module and the next nullcInit with the same optimization level registers a copy of it instead of compiling it again.
+	Disabled by default, the kept module is released by nullcTerminate when reuse is disabled	*/
+void		nullcSetEnableBaseModuleReuse(int enable);
+
 void		nullcTerminate();
 
+/************************************************************************/
+/*							Execution contexts							*/
+
+/*	Execution context owns a linker, executors with their stacks and a garbage collected heap. Modules, bindings and compiler settings are shared by all contexts.
+	Context created by nullcInit is the default one; it is represented by a null pointer.
+	Each thread has its own current context, different contexts can run code on different threads at the same time. Builds are serialized by the library, but a sequence of separate compiler calls has to be serialized by the host.
+	Allocation functions passed to nullcInitCustomAlloc are serialized by the library	*/
+typedef struct nullcContext nullcContext;
+
+/*	Creates a new execution context. Current context is not changed	*/
+nullcContext*	nullcContextCreate();
+
+/*	Destroys an execution context and frees its memory. If the context is current, default context becomes current on the thread that has called nullcInit, other threads are left without a current context. Contexts should be destroyed before nullcTerminate is called	*/
+void		nullcContextDestroy(nullcContext *context);
+
+/*	Makes the context current on the calling thread. Build, execution, interaction and memory functions operate on the current context.
+	Context can be current on only one thread at a time and current context can't be changed while code is running.
+	Default context is current on the thread that has called nullcInit. Other threads use the default context until they call nullcContextMakeCurrent or nullcContextDetach, after that they use only the context they have selected	*/
+nullres		nullcContextMakeCurrent(nullcContext *context);
+nullcContext*	nullcContextGetCurrent();
+
+/*	Leaves the calling thread without a current context, so that the context can be made current on another thread	*/
+void		nullcContextDetach();
+
+/*	Makes the context current and compiles and links code, runs global code or calls a function in it	*/
+nullres		nullcContextBuild(nullcContext *context, const char* code);
+nullres		nullcContextRun(nullcContext *context);
+nullres		nullcContextCallFunction(nullcContext *context, NULLCFuncPtr ptr, ...);
+
+/************************************************************************/
+/*							Program images								*/
+
+/*	Program image is an immutable copy of linked code that is used to start new contexts without compilation and linking.
+	Contexts that load the image share its type tables and bytecode, each context has its own global variables, heap, stack and native code.
+	References are counted atomically, image can be retained and released on different threads	*/
+typedef struct nullcProgram nullcProgram;
+
+/*	Creates a program image from the code linked in the current context. Image starts with a single reference. Breakpoints must be cleared before	*/
+nullcProgram*	nullcProgramCreate();
+
+/*	Adds or releases an image reference. Image is destroyed when the last reference is released. Images should be released before nullcTerminate is called	*/
+void		nullcProgramRetain(nullcProgram *program);
+void		nullcProgramRelease(nullcProgram *program);
+
+/*	Makes the context current and replaces its code with the program. Global variables and garbage collected memory are reset. Context keeps a reference to the image	*/
+nullres		nullcContextLoadProgram(nullcContext *context, nullcProgram *program);
+
+/*	Creates a new execution context with the program loaded. Current context is not changed	*/
+nullcContext*	nullcContextCreateFromProgram(nullcProgram *program);
+
+/************************************************************************/
+/*							Snapshots									*/
+
+/*	Snapshot is a file with the linked program, its global variables and all garbage collected objects reachable from them.
+	It is saved after global code has finished and it is loaded later (in another process too) without compiling the program and running its global code.
+	Imported modules are stored in the snapshot, but modules with external functions have to be registered before the snapshot is loaded.
+	Pointers to host memory, including host arrays, can't be saved. State kept by modules on the host side is not saved	*/
+
+/*	Bytecode of the linked program is kept for snapshots only when they are enabled before the program is linked, it is disabled by default	*/
+void		nullcSetEnableSnapshots(int enable);
+
+/*	Save a snapshot of the program in the current context. File is written with the file write handler (see nullcSetFileWriteHandler)	*/
+nullres		nullcSaveSnapshot(const char *fileName);
+
+/*	Replace code, global variables and garbage collected memory of the current context with the ones saved in the snapshot.
+	File is read with the file read handler (see nullcSetFileReadHandler), so it can be memory-mapped by the host	*/
+nullres		nullcLoadSnapshot(const char *fileName);
+
 /************************************************************************/
 /*				NULLC execution settings and environment				*/
 
@@ -49,6 +150,13 @@ nullres		nullcLoadModuleBySource(const char* module, const char* code);
 /*	Loads module into binary cache	*/
 nullres		nullcLoadModuleByBinary(const char* module, const char* binary);
 
+/*	Saves modules from binary cache into a module pack file, module names are the same as in nullcLoadModuleByBinary	*/
+nullres		nullcSaveModulePack(const char* fileName, const char** modules, unsigned count);
+
+/*	Maps a module pack file into memory and loads modules that are not in binary cache without copying their bytecode.
+	File stays mapped until nullcTerminate and memory pages are copied only when module function bindings modify them	*/
+nullres		nullcLoadModulePack(const char* fileName);
+
 /* Removes module from binary cache	*/
 void		nullcRemoveModule(const char* module);
 
@@ -133,6 +241,19 @@ void		nullcClearError();
 /*	Call function using NULLCFuncPtr	*/
 nullres		nullcCallFunction(NULLCFuncPtr ptr, ...);
 
+/*	Resolve a function by name or by a function pointer once for repeated calls. Prepared call is valid until the code is rebuilt	*/
+nullres		nullcPrepareCall(const char* funcName, NULLCPreparedCall *call);
+nullres		nullcPrepareCallPointer(NULLCFuncPtr ptr, NULLCPreparedCall *call);
+
+/*	Call a prepared function. Arguments are placed at 'argumentOffsets' of a buffer that has 'bufferSize' bytes. Function context is written at the end of the buffer.
+	Typed wrappers are available in nullbind.h as nullcInvokePrepared	*/
+nullres		nullcCallPrepared(const NULLCPreparedCall *call, char *arguments);
+
+/*	Call a prepared function 'count' times with argument buffers placed 'argumentStride' bytes apart. Stack frame is set up once for the whole batch.
+	When 'results' is not NULL, result of each call is written 'resultStride' bytes apart as an 'int' for bool, char, short and int, as a 'long long' for long and as a 'double' for float and double.
+	Only functions that return void or a basic type can be called in a batch. Execution stops at the first error	*/
+nullres		nullcCallPreparedBatch(const NULLCPreparedCall *call, char *arguments, unsigned argumentStride, unsigned count, void *results, unsigned resultStride);
+
 /*	Get global variable value	*/
 void*		nullcGetGlobal(const char* name);
 
@@ -157,6 +278,124 @@ nullres		nullcIsStackPointer(void* ptr);
 /*	Function returns 1 if passed pointer points to a memory managed by NULLC GC; otherwise, the return value is 0	*/
 nullres		nullcIsManagedPointer(void* ptr);
 
+/*	Small objects left unreachable by garbage collection are freed lazily, as allocations need memory. This function frees them in up to 'pageCount' memory pages
+	(or in all pages if 'pageCount' is 0) and can be called when application is idle. Function returns 1 if there are pages left to sweep; otherwise, the return value is 0	*/
+nullres		nullcSweepMemory(unsigned pageCount);
+
+/*	By default, finalizers of unreachable objects are run at the end of garbage collection. When deferred finalization is enabled,
+	objects are kept alive in a queue until the host application runs their finalizers with nullcRunFinalizers (from an idle loop, for example)	*/
+void		nullcSetDeferredFinalization(int enable);
+
+/*	Run finalizers of objects queued by garbage collection. Function returns 1 on success; otherwise, the return value is 0 and error can be retrieved with nullcGetLastError	*/
+nullres		nullcRunFinalizers();
+
+/*	Returns the number of objects waiting for their finalizers to run	*/
+unsigned	nullcGetPendingFinalizerCount();
+
+/************************************************************************/
+/*							Execution budget							*/
+
+#define NULLC_BUDGET_STOP		0
+#define NULLC_BUDGET_CONTINUE	1
+
+/*	Limits each call from the host into the current context by a number of steps and by a deadline in 'milliseconds'. A limit of 0 is disabled.
+	Steps are counted at loop back-edges and at script function calls. When the budget is exhausted, execution is stopped with an error unless the budget callback renews it	*/
+nullres		nullcSetExecutionBudget(unsigned steps, unsigned milliseconds);
+
+/*	Callback is called on the program thread when the budget is exhausted. Host can perform other work inside of it and return NULLC_BUDGET_CONTINUE to resume execution
+	with a renewed budget or NULLC_BUDGET_STOP to stop execution. Callback can also stop execution with its own error using nullcThrowError	*/
+nullres		nullcSetExecutionBudgetCallback(void *context, unsigned (*callback)(void *context));
+
+/************************************************************************/
+/*							Memory quotas								*/
+
+#define NULLC_MEMORY_HEAP		0
+#define NULLC_MEMORY_STACK		1
+#define NULLC_MEMORY_COMPILER	2
+#define NULLC_MEMORY_CODE		3
+#define NULLC_MEMORY_TOTAL		4
+
+#define NULLC_QUOTA_STOP		0
+#define NULLC_QUOTA_CONTINUE	1
+#define NULLC_QUOTA_COLLECT		2
+
+/*	Limits memory used by the current context: garbage collected heap, stack of the current executor, compiler arenas retained from the last compilation in this context and native code.
+	Allocations, compilation, native code translation and stack size changes that would go over the 'hardLimit' fail with an error. A limit of 0 is disabled	*/
+nullres		nullcSetMemoryQuota(unsigned softLimit, unsigned hardLimit);
+
+/*	Callback is called when a heap allocation takes the memory usage of the current context over the 'softLimit'. It is called again only after the usage has dropped below the limit.
+	Host can shed load and return NULLC_QUOTA_CONTINUE to let the allocation proceed, NULLC_QUOTA_COLLECT to run garbage collection before it or NULLC_QUOTA_STOP to stop execution with an error	*/
+nullres		nullcSetMemoryQuotaCallback(void *context, unsigned (*callback)(void *context, unsigned used, unsigned softLimit));
+
+/*	Returns the number of bytes used by the current context in one of the NULLC_MEMORY_* categories	*/
+unsigned	nullcGetMemoryUsage(unsigned category);
+
+/************************************************************************/
+/*							Host arrays									*/
+
+/*	Host array is a memory region owned by the host application that is passed to NULLC programs as an array without a copy.
+	Garbage collector doesn't free the region and doesn't look for pointers inside of it, so element type can't contain pointers.
+	Multiple non-overlapping regions can be registered in each execution context	*/
+
+/*	Registers 'count' elements of type 'typeID' at 'data' as a host array and returns it. On failure, array pointer is null and error can be retrieved with nullcGetLastError.
+	'release' callback is called when the host has released the array and garbage collection doesn't find any references to it in the program.
+	Callback is also called for all arrays when the program is cleaned or its context is destroyed	*/
+NULLCArray	nullcRegisterHostArray(void *data, unsigned typeID, unsigned count, void (*release)(void *data, void *context), void *context);
+
+/*	Releases host reference to the array. Host must keep the memory alive until the 'release' callback is called	*/
+nullres		nullcReleaseHostArray(void *data);
+
+/*	Function returns 1 if passed pointer points inside of a host array; otherwise, the return value is 0	*/
+nullres		nullcIsHostArrayPointer(void *ptr);
+
+/*	Returns the number of registered host arrays	*/
+unsigned	nullcGetHostArrayCount();
+
+/************************************************************************/
+/*							Allocation profiler							*/
+
+#define NULLC_ALLOCATION_PROFILE_FOLDED	0
+#define NULLC_ALLOCATION_PROFILE_HEAP	1
+
+/*	Record an allocation with its type and call stack every 'sampleBytes' bytes of GC memory allocated. Each sample accounts for the memory allocated since the previous one.
+	Passing 1 records every allocation, passing 0 disables the profiler. Collected data is cleared on each call and when the program is relinked	*/
+void		nullcSetAllocationProfiler(unsigned sampleBytes);
+
+/*	Get live and total memory allocated for a type. Returns 0 if no allocations of the type were recorded	*/
+nullres		nullcGetAllocationTypeProfile(unsigned typeID, NULLCAllocationStats *stats);
+
+/*	Get memory allocated at a site (a unique pair of call stack and type). Null pointer is returned if a site at index 'id' doesn't exist.
+	Returned array contains 'frameCount' VM instruction addresses, starting from the outermost frame	*/
+const unsigned*	nullcGetAllocationSiteProfile(unsigned id, NULLCAllocationStats *stats, unsigned *typeID, unsigned *frameCount);
+
+/*	Save allocation profile as folded call stacks (flame graph input) or as a text heap profile readable by pprof	*/
+nullres		nullcSaveAllocationProfile(const char *fileName, unsigned format);
+
+/************************************************************************/
+/*							Collection telemetry						*/
+
+#define NULLC_GC_TRIGGER_EXPLICIT	0
+#define NULLC_GC_TRIGGER_THRESHOLD	1
+#define NULLC_GC_TRIGGER_LIMIT		2
+
+#define NULLC_GC_PHASE_TOTAL	0
+#define NULLC_GC_PHASE_MARK		1
+#define NULLC_GC_PHASE_SWEEP	2
+#define NULLC_GC_PHASE_FINALIZE	3
+#define NULLC_GC_PHASE_COUNT	4
+
+/*	Returns the number of garbage collections performed since the start or since the last statistics reset	*/
+unsigned	nullcGetCollectionCount();
+
+/*	Get a record of one of the last NULLC_GC_HISTORY_SIZE collections. Latest collection has an 'id' of 0	*/
+nullres		nullcGetCollectionInfo(unsigned id, NULLCCollectionInfo *info);
+
+/*	Get a histogram of collection phase durations into an array of NULLC_GC_HISTOGRAM_SIZE elements.
+	Bucket 0 counts durations under 1us, bucket N counts durations in [2^(N-1), 2^N) microsecond range	*/
+nullres		nullcGetCollectionHistogram(unsigned phase, unsigned *buckets);
+
+void		nullcResetCollectionStatistics();
+
 #endif
 
 /************************************************************************/
@@ -14,7 +14,7 @@
 
 namespace NULLC
 {
-	extern const char*	nullcLastError;
+	extern NULLC_THREAD_LOCAL const char*	nullcLastError;
 }
 
 namespace
@@ -9,6 +9,18 @@
 
 CompilerContext* nullcGetCompilerContext();
 
+// Analysis is owned by the caller and is not replaced by later compiler calls, it can be inspected on one thread while the compiler is used on another
+// Analysis is returned even when it has failed, so that the errors can be inspected. Source code has to be kept alive until the analysis is destroyed
+struct nullcAnalysis;
+
+nullres nullcCreateAnalysis(const char* code, nullcAnalysis **analysis);
+CompilerContext* nullcGetAnalysisContext(nullcAnalysis *analysis);
+void nullcDestroyAnalysis(nullcAnalysis *analysis);
+
+// Compiler and module cache are shared by execution contexts running on different threads, a sequence of compiler calls has to be made under the lock
+void nullcLockCompiler();
+void nullcUnlockCompiler();
+
 #define NULLC_BUILTIN_SQRT 1
 
 nullres nullcBindModuleFunctionBuiltin(const char* module, const char* name, int index, unsigned builtinIndex);
@@ -1,6 +1,9 @@
 #ifndef NULLC_DEF_INCLUDED
 #define NULLC_DEF_INCLUDED
 
+// Library version in 0xMMmmpppp format, it is raised with changes of the compiler output so that persistent module caches are not reused by a different compiler
+#define NULLC_VERSION 0x00090000
+
 #pragma pack(push, 4)
 
 // Wrapper over NULLC array, for use in external functions
@@ -32,6 +35,91 @@ struct NULLCAutoArray
 	unsigned int	len;
 };
 
+// Allocation profiler statistics of a type or an allocation site
+struct NULLCAllocationStats
+{
+	unsigned long long	liveBytes;
+	unsigned long long	totalBytes;
+	unsigned int	liveCount;
+	unsigned int	totalCount;
+};
+
+#define NULLC_GC_SIZE_CLASS_COUNT 8
+
+// Garbage collection telemetry record, time is measured in microseconds
+struct NULLCCollectionInfo
+{
+	unsigned int	trigger;
+
+	unsigned int	startTime;
+	unsigned int	markTime;
+	unsigned int	sweepTime;
+	unsigned int	finalizeTime;
+
+	unsigned int	usedBefore;
+	unsigned int	usedAfter;
+
+	// Heap size that will trigger the next collection
+	unsigned int	threshold;
+
+	// Objects freed from 8, 16, 32, 64, 128, 256 and 512 byte pools and large objects
+	unsigned int	freedObjects[NULLC_GC_SIZE_CLASS_COUNT];
+};
+
+// Compiler allocator statistics of the last module compilation, sizes are in bytes
+struct NULLCCompilerMemoryStats
+{
+	unsigned int	parse;
+	unsigned int	analyze;
+	unsigned int	ir;
+	unsigned int	lowering;
+
+	// Size of the allocator chunks that are kept for reuse by the following compilations
+	unsigned int	retained;
+};
+
+// Cancellation of a module analysis that can be requested by another thread
+// Flag is accessed atomically by nullcRequestCancellation, nullcResetCancellation and nullcIsCancellationRequested, it shouldn't be read or written directly
+struct NULLCCancellation
+{
+	volatile long	requested;
+};
+
+// Adaptive garbage collection trigger policy
+struct NULLCCollectionPolicy
+{
+	// Collection is not triggered until the heap reaches this size
+	unsigned int	minimumHeap;
+
+	// Next collection is triggered when surviving heap grows by a factor in [minimumGrowth, maximumGrowth] range
+	double			minimumGrowth;
+	double			maximumGrowth;
+
+	// Growth factor is raised when collection pauses take more than this fraction of the execution time
+	double			targetPauseRatio;
+
+	// Heap headroom is kept large enough to sustain the current allocation rate for this number of milliseconds
+	unsigned int	minimumInterval;
+};
+
+#define NULLC_PREPARED_CALL_MAX_ARGUMENTS 16
+
+// Function call with a resolved target and argument buffer layout
+struct NULLCPreparedCall
+{
+	unsigned int	functionID;
+	void			*context;
+
+	unsigned int	returnType;
+
+	unsigned int	argumentCount;
+	unsigned int	argumentTypes[NULLC_PREPARED_CALL_MAX_ARGUMENTS];
+	unsigned int	argumentOffsets[NULLC_PREPARED_CALL_MAX_ARGUMENTS];
+
+	// Argument buffer size, including the space for function context at the end
+	unsigned int	bufferSize;
+};
+
 #pragma pack(pop)
 
 #define NULLC_MAX_VARIABLE_NAME_LENGTH 2048
@@ -43,6 +131,9 @@ struct NULLCAutoArray
 #define NULLC_MAX_GENERIC_INSTANCE_DEPTH 64
 #define NULLC_MAX_EXPRESSION_DEPTH 2048
 #define NULLC_MAX_TYPE_SIZE	256 * 1024 * 1024
+#define NULLC_GC_HISTORY_SIZE 64
+#define NULLC_GC_HISTOGRAM_SIZE 32
+#define NULLC_PREPARED_CALL_BUFFER_SIZE 1024
 
 //#define NULLC_STACK_TRACE_WITH_LOCALS
 
@@ -86,5 +86,22 @@ void NULLC::defaultFileFree(const char* data)
 		NULLC::dealloc((char*)data);
 }
 
+int NULLC::defaultFileSave(const char* name, const char* data, unsigned size)
+{
+	assert(name);
+
+	FILE *file = fopen(name, "wb");
+	if(!file)
+		return 0;
+
+	bool written = fwrite(data, 1, size, file) == size;
+
+	if(fclose(file) != 0)
+		written = false;
+
+	return written;
+}
+
 const char* (*NULLC::fileLoad)(const char*, unsigned*) = NULLC::defaultFileLoad;
 void (*NULLC::fileFree)(const char*) = NULLC::defaultFileFree;
+int (*NULLC::fileSave)(const char*, const char*, unsigned) = NULLC::defaultFileSave;
@@ -12,6 +12,13 @@
 #define __forceinline inline // TODO: NULLC_FORCEINLINE?
 #endif
 
+// State of the execution context that is current on the thread
+#ifdef _MSC_VER
+#define NULLC_THREAD_LOCAL __declspec(thread)
+#else
+#define NULLC_THREAD_LOCAL __thread
+#endif
+
 #include "nullcdef.h"
 
 #include <new>
@@ -78,7 +85,9 @@ namespace NULLC
 
 	const char* defaultFileLoad(const char* name, unsigned* size);
 	void defaultFileFree(const char* data);
+	int defaultFileSave(const char* name, const char* data, unsigned size);
 
 	extern const char* (*fileLoad)(const char*, unsigned*);
 	extern void (*fileFree)(const char*);
+	extern int (*fileSave)(const char*, const char*, unsigned);
 }
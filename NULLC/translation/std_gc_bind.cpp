@@ -20,3 +20,30 @@ double NamespaceGC__CollectTime_double_ref__(NamespaceGC * __context)
 {
 	return NULLC::CollectTime();
 }
+
+// Allocation profiler is not available in translated code
+void NamespaceGC__SetAllocationProfiler_void_ref_int_(int sampleBytes, NamespaceGC * __context)
+{
+}
+long long NamespaceGC__LiveBytes_long_ref_typeid_(unsigned type, NamespaceGC * __context)
+{
+	return 0;
+}
+long long NamespaceGC__TotalBytes_long_ref_typeid_(unsigned type, NamespaceGC * __context)
+{
+	return 0;
+}
+
+// Collection telemetry is not available in translated code
+int NamespaceGC__CollectionCount_int_ref__(NamespaceGC * __context)
+{
+	return 0;
+}
+double NamespaceGC__LastPauseTime_double_ref__(NamespaceGC * __context)
+{
+	return 0.0;
+}
+int NamespaceGC__PauseHistogram_int_ref_int_(int bucket, NamespaceGC * __context)
+{
+	return 0;
+}
@@ -23,6 +23,8 @@
 #include "../NULLC/includes/gc.h"
 #include "../NULLC/includes/memory.h"
 #include "../NULLC/includes/error.h"
+#include "../NULLC/includes/task.h"
+#include "../NULLC/includes/async.h"
 
 #include "../NULLC/includes/canvas.h"
 
@@ -79,36 +81,15 @@ int main(int argc, char** argv)
 	#define X64_LIB "nullclib_x64.ncm"
 #endif
 
-	FILE *modulePack = fopen(sizeof(void*) == sizeof(int) ? "nullclib.ncm" : X64_LIB, "rb");
-	if(!modulePack)
+	if(!nullcLoadModulePack(sizeof(void*) == sizeof(int) ? "nullclib.ncm" : X64_LIB))
 	{
 		if(verbose)
 		{
-			printf("WARNING: Failed to open precompiled module file ");
-			printf(sizeof(void*) == sizeof(int) ? "nullclib.ncm\r\n" : X64_LIB"\r\n");
+			printf("WARNING: Failed to load precompiled module file ");
+			printf(sizeof(void*) == sizeof(int) ? "nullclib.ncm" : X64_LIB);
+			printf(" (%s)\r\n", nullcGetLastError());
 		}
 	}
-	else
-	{
-		fseek(modulePack, 0, SEEK_END);
-		unsigned int fileSize = ftell(modulePack);
-		fseek(modulePack, 0, SEEK_SET);
-		char *fileContent = new char[fileSize];
-		fread(fileContent, 1, fileSize, modulePack);
-		fclose(modulePack);
-
-		char *filePos = fileContent;
-		while((unsigned int)(filePos - fileContent) < fileSize)
-		{
-			char *moduleName = filePos;
-			filePos += strlen(moduleName) + 1;
-			char *binaryCode = filePos;
-			filePos += *(unsigned int*)binaryCode;
-			nullcLoadModuleByBinary(moduleName, binaryCode);
-		}
-
-		delete[] fileContent;
-	}
 
 	if(!nullcInitTypeinfoModule() && verbose)
 		printf("ERROR: Failed to init std.typeinfo module\r\n");
@@ -142,6 +123,10 @@ int main(int argc, char** argv)
 		printf("ERROR: Failed to init std.memory module\r\n");
 	if(!nullcInitErrorModule() && verbose)
 		printf("ERROR: Failed to init std.error module\r\n");
+	if(!nullcInitTaskModule() && verbose)
+		printf("ERROR: Failed to init std.task module\r\n");
+	if(!nullcInitAsyncModule() && verbose)
+		printf("ERROR: Failed to init std.async module\r\n");
 
 	if(!nullcInitPugiXMLModule() && verbose)
 		printf("ERROR: Failed to init ext.pugixml module\r\n");
@@ -50,6 +50,8 @@
 #include "../NULLC/includes/gc.h"
 #include "../NULLC/includes/memory.h"
 #include "../NULLC/includes/error.h"
+#include "../NULLC/includes/task.h"
+#include "../NULLC/includes/async.h"
 
 #include "../NULLC/includes/window.h"
 
@@ -532,30 +534,10 @@ int APIENTRY WinMain(HINSTANCE	hInstance,
 	memset(ideExecutionErrorBuf, 0, ideExecutionErrorBufSize);
 
 	// in possible, load precompiled modules from nullclib.ncm
-	FILE *modulePack = fopen(sizeof(void*) == sizeof(int) ? "nullclib.ncm" : "nullclib_x64.ncm", "rb");
-	if(!modulePack)
+	if(!nullcLoadModulePack(sizeof(void*) == sizeof(int) ? "nullclib.ncm" : "nullclib_x64.ncm"))
 	{
-		strcat(initErrorBuf, "WARNING: Failed to open precompiled module file ");
+		strcat(initErrorBuf, "WARNING: Failed to load precompiled module file ");
 		strcat(initErrorBuf, sizeof(void*) == sizeof(int) ? "nullclib.ncm\r\n" : "nullclib_x64.ncm\r\n");
-	}else{
-		fseek(modulePack, 0, SEEK_END);
-		unsigned int fileSize = ftell(modulePack);
-		fseek(modulePack, 0, SEEK_SET);
-		char *fileContent = new char[fileSize];
-		fread(fileContent, 1, fileSize, modulePack);
-		fclose(modulePack);
-
-		char *filePos = fileContent;
-		while((unsigned int)(filePos - fileContent) < fileSize)
-		{
-			char *moduleName = filePos;
-			filePos += strlen(moduleName) + 1;
-			char *binaryCode = filePos;
-			filePos += *(unsigned int*)binaryCode;
-			nullcLoadModuleByBinary(moduleName, binaryCode);
-		}
-
-		delete[] fileContent;
 	}
 
 	if(!nullcInitTypeinfoModule())
@@ -589,6 +571,10 @@ int APIENTRY WinMain(HINSTANCE	hInstance,
 		strcat(initErrorBuf, "ERROR: Failed to init std.memory module\r\n");
 	if(!nullcInitErrorModule())
 		strcat(initErrorBuf, "ERROR: Failed to init std.error module\r\n");
+	if(!nullcInitTaskModule())
+		strcat(initErrorBuf, "ERROR: Failed to init std.task module\r\n");
+	if(!nullcInitAsyncModule())
+		strcat(initErrorBuf, "ERROR: Failed to init std.async module\r\n");
 
 	if(!nullcInitPugiXMLModule())
 		strcat(initErrorBuf, "ERROR: Failed to init ext.pugixml module\r\n");
@@ -81,14 +81,16 @@ int main(int argc, char** argv)
 
 	if(argc == 1)
 	{
-		printf("usage: nullcl [-o output.ncm] file.nc [-m module.name] [file2.nc [-m module.name] ...]\n");
-		printf("usage: nullcl -c [-i import_folder] output.cpp file.nc\n");
-		printf("usage: nullcl -x [-i import_folder] output.exe file.nc\n");
+		printf("usage: nullcl [-j threads] [-o output.ncm] file.nc [-m module.name] [file2.nc [-m module.name] ...]\n");
+		printf("usage: nullcl [-j threads] -c [-i import_folder] output.cpp file.nc\n");
+		printf("usage: nullcl [-j threads] -x [-i import_folder] output.exe file.nc\n");
 		return 1;
 	}
 
 	int argIndex = 1;
-	FILE *mergeFile = NULL;
+	const char *packFileName = NULL;
+	char **packModules = NULL;
+	unsigned packModuleCount = 0;
 	bool verbose = false;
 
 	if(strcmp("-v", argv[argIndex]) == 0)
@@ -98,22 +100,32 @@ int main(int argc, char** argv)
 		verbose = true;
 	}
 
-	if(strcmp("-o", argv[argIndex]) == 0)
+	if(argIndex < argc && strcmp("-j", argv[argIndex]) == 0)
 	{
 		argIndex++;
 		if(argIndex == argc)
 		{
-			printf("Output file name not found after -o\n");
+			printf("Thread count not found after -j\n");
 			nullcTerminate();
 			return 1;
 		}
-		mergeFile = fopen(argv[argIndex], "wb");
-		if(!mergeFile)
+
+		// Imports are compiled concurrently when there is more than one thread
+		nullcSetModuleBuildThreads(unsigned(atoi(argv[argIndex])));
+		argIndex++;
+	}
+
+	if(strcmp("-o", argv[argIndex]) == 0)
+	{
+		argIndex++;
+		if(argIndex == argc)
 		{
-			printf("Cannot create output file %s\n", argv[argIndex]);
+			printf("Output file name not found after -o\n");
 			nullcTerminate();
 			return 1;
 		}
+		packFileName = argv[argIndex];
+		packModules = new char*[argc];
 		argIndex++;
 	}else if(strcmp("-c", argv[argIndex]) == 0 || strcmp("-x", argv[argIndex]) == 0){
 		bool link = strcmp("-x", argv[argIndex]) == 0;
@@ -323,7 +335,7 @@ int main(int argc, char** argv)
 		}
 		nullcLoadModuleByBinary(moduleName, (const char*)bytecode);
 
-		if(!mergeFile)
+		if(!packFileName)
 		{
 			char newName[1024];
 
@@ -350,8 +362,7 @@ int main(int argc, char** argv)
 			fwrite(bytecode, 1, *bytecode, nmcFile);
 			fclose(nmcFile);
 		}else{
-			fwrite(moduleName, 1, strlen(moduleName) + 1, mergeFile);
-			fwrite(bytecode, 1, *bytecode, mergeFile);
+			packModules[packModuleCount++] = strcpy(new char[strlen(moduleName) + 1], moduleName);
 		}
 
 		delete[] bytecode;
@@ -359,10 +370,22 @@ int main(int argc, char** argv)
 	if(currIndex == argIndex)
 		printf("None of the input files were found\n");
 
-	if(mergeFile)
-		fclose(mergeFile);
+	bool packFailed = false;
+
+	if(packFileName)
+	{
+		if(!nullcSaveModulePack(packFileName, (const char**)packModules, packModuleCount))
+		{
+			printf("Cannot create output file %s: %s\n", packFileName, nullcGetLastError());
+			packFailed = true;
+		}
+
+		for(unsigned i = 0; i < packModuleCount; i++)
+			delete[] packModules[i];
+		delete[] packModules;
+	}
 
 	nullcTerminate();
 
-	return argIndex != argc;	
+	return argIndex != argc || packFailed;	
 }
@@ -668,3 +668,78 @@ for (a in arr3)\r\n\
 \r\n\
 return sum3;";
 TEST_RESULT("Coroutine local variables are closed when they go out of scope 4", testCoroutineLocalClosure4, "90");
+
+const char	*testTaskScheduleJoin =
+"import std.task;\r\n\
+int Square(int x){ return x * x; }\r\n\
+auto a = schedule(auto(){ return Square(4); });\r\n\
+auto b = schedule(auto(){ return Square(5); });\r\n\
+int c = 0;\r\n\
+auto d = schedule(auto(){ c = 7; });\r\n\
+d.join();\r\n\
+return a.join() + b.join() + c + task_pending_count();";
+TEST_RESULT("std.task schedule and join", testTaskScheduleJoin, "48");
+
+const char	*testTaskCoroutineSuspension =
+"import std.task;\r\n\
+char[] log = new char[6];\r\n\
+int pos = 0;\r\n\
+auto worker(char name, int steps)\r\n\
+{\r\n\
+	coroutine int run()\r\n\
+	{\r\n\
+		for(int i = 0; i < steps; i++)\r\n\
+		{\r\n\
+			log[pos++] = name;\r\n\
+			yield 0;\r\n\
+		}\r\n\
+		return steps;\r\n\
+	}\r\n\
+	return run;\r\n\
+}\r\n\
+auto a = schedule(worker('a', 3));\r\n\
+auto b = schedule(worker('b', 2));\r\n\
+int result = a.join() * 10 + b.join();\r\n\
+assert(a.done() && b.done());\r\n\
+return log == \"babaa\" && result == 32;";
+TEST_RESULT("std.task coroutine tasks are suspended when they yield", testTaskCoroutineSuspension, "1");
+
+const char	*testTaskFor =
+"import std.task;\r\n\
+int[] arr = new int[5000];\r\n\
+task_for(0, arr.size, 700, auto(int i){ arr[i] = i; });\r\n\
+task_for(arr, auto(int ref x){ *x *= 2; });\r\n\
+auto squares = task_map(arr, auto(int x){ return double(x) * 0.5; });\r\n\
+long sum = 0;\r\n\
+for(i in arr) sum += i;\r\n\
+return sum == 4999l * 5000 && squares[4999] == 4999.0;";
+TEST_RESULT("std.task task_for and task_map", testTaskFor, "1");
+
+const char	*testTaskNestedJoin =
+"import std.task;\r\n\
+int Fib(int n)\r\n\
+{\r\n\
+	if(n < 2)\r\n\
+		return n;\r\n\
+	auto a = schedule(auto(){ return Fib(n - 1); });\r\n\
+	auto b = schedule(auto(){ return Fib(n - 2); });\r\n\
+	return a.join() + b.join();\r\n\
+}\r\n\
+return Fib(12);";
+TEST_RESULT("std.task nested schedule and join", testTaskNestedJoin, "144");
+
+const char	*testTaskParallelMap =
+"import std.task;\r\n\
+int Collatz(int x){ int steps = 0; while(x != 1){ x = x % 2 == 0 ? x / 2 : x * 3 + 1; steps++; } return steps; }\r\n\
+long Cube(long x){ return x * x * x; }\r\n\
+float Half(float x){ return x * 0.5f; }\r\n\
+double Root(double x){ int[] tmp = new int[16]; tmp[15] = 2; return x / tmp[15]; }\r\n\
+int[] numbers = new int[3000];\r\n\
+for(int i = 0; i < numbers.size; i++) numbers[i] = i + 1;\r\n\
+int[] steps = parallel_map(numbers, Collatz, 4);\r\n\
+long[] cubes = parallel_map({ 1l, 2l, 3l, 100000l }, Cube);\r\n\
+float[] halves = parallel_map({ 1.0f, 3.0f }, Half, 2);\r\n\
+double[] roots = parallel_map({ 4.0, 9.0, 16.0 }, Root, 8);\r\n\
+int[] empty = parallel_map(new int[0], Collatz);\r\n\
+return steps[0] == 0 && steps[26] == 111 && steps[2999] == Collatz(3000) && cubes[3] == 1000000000000000l && halves[1] == 1.5f && roots[2] == 8.0 && empty.size == 0;";
+TEST_RESULT("std.task parallel_map on worker contexts", testTaskParallelMap, "1");
@@ -227,3 +227,60 @@ for(int i = 0; i < 10; i++) new int(7);\r\n\
 \r\n\
 return *global;";
 TEST_RESULT_SIMPLE("Finalizer object ressurection test 4 (large array)", testFinalizerRessurection4, "13");
+
+const char	*testFinalizerDeferred =
+"import std.gc;\r\n\
+\r\n\
+int z = 0;\r\n\
+\r\n\
+class Foo{ int ref value; }\r\n\
+void Foo:finalize(){ z += *value; }\r\n\
+\r\n\
+void test()\r\n\
+{\r\n\
+	for(int i = 0; i < 10; i++)\r\n\
+	{\r\n\
+		Foo ref f = new Foo;\r\n\
+		f.value = new int(i);\r\n\
+	}\r\n\
+}\r\n\
+\r\n\
+test();\r\n\
+\r\n\
+GC.CollectMemory();\r\n\
+\r\n\
+for(int i = 0; i < 100; i++) new int(7);\r\n\
+\r\n\
+GC.CollectMemory();\r\n\
+\r\n\
+for(int i = 0; i < 1000; i++) new int(7);\r\n\
+\r\n\
+return z;";
+TEST_SIMPLE_WITH_SETUP("Deferred finalization keeps objects alive until finalizers are run", testFinalizerDeferred, "0")
+{
+	if(before)
+	{
+		nullcSetDeferredFinalization(1);
+		return;
+	}
+
+	nullcSetDeferredFinalization(0);
+
+	// Queued finalizers only run when the host asks for them
+	if(!nullcRunFinalizers() || nullcGetPendingFinalizerCount() != 0)
+	{
+		TEST_NAME();
+		printf(" Failed to run finalizers: %s\r\n", nullcGetLastError());
+		lastFailed = true;
+		return;
+	}
+
+	int *z = (int*)nullcGetGlobal("z");
+
+	if(!z || *z != 45)
+	{
+		TEST_NAME();
+		printf(" Finalizers didn't run on the queued objects\r\n");
+		lastFailed = true;
+	}
+}
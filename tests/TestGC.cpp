@@ -611,6 +611,31 @@ GC.CollectMemory();\r\n\
 return a[0].len();";
 TEST_RESULT("Stack overflow on deep unsized array chain in GC", testDeepArrayWalkGC, "10000");
 
+const char *testGCMarkAlternation =
+"import std.gc;\r\n\
+class Node{ int value; int[] data; Node ref next; }\r\n\
+Node ref head;\r\n\
+int sum = 0;\r\n\
+for(int k = 0; k < 5; k++)\r\n\
+{\r\n\
+	for(int i = 0; i < 1000; i++)\r\n\
+	{\r\n\
+		Node ref garbage = new Node;\r\n\
+		garbage.data = new int[i % 2 ? 2 : 200];\r\n\
+		Node ref n = new Node;\r\n\
+		n.value = i;\r\n\
+		n.data = new int[i % 3 ? 1 : 300];\r\n\
+		n.data[0] = i;\r\n\
+		n.next = head;\r\n\
+		head = n;\r\n\
+	}\r\n\
+	GC.CollectMemory();\r\n\
+}\r\n\
+for(Node ref n = head; n; n = n.next)\r\n\
+	sum += n.value + n.data[0];\r\n\
+return sum;";
+TEST_RESULT("Objects from earlier collections stay marked by later ones", testGCMarkAlternation, "4995000");
+
 const char *testGCOnAllocatedArrayPointer =
 "import std.gc;\r\n\
 \r\n\
@@ -706,3 +731,277 @@ assert(*a == 5);\r\n\
 assert(m == 6);\r\n\
 return 1;";
 TEST_RESULT_SIMPLE("GC execution when callstack is full of NULLC->C transitions", testGCWhenTransitions, "1");
+
+namespace
+{
+	char profileOutput[4096];
+	unsigned profileOutputSize = 0;
+
+	void* OpenProfileStream(const char *name)
+	{
+		(void)name;
+
+		profileOutputSize = 0;
+		profileOutput[0] = 0;
+
+		return profileOutput;
+	}
+
+	void WriteProfileStream(void *stream, const char *data, unsigned size)
+	{
+		(void)stream;
+
+		if(size > sizeof(profileOutput) - profileOutputSize - 1)
+			size = sizeof(profileOutput) - profileOutputSize - 1;
+
+		memcpy(profileOutput + profileOutputSize, data, size);
+		profileOutputSize += size;
+		profileOutput[profileOutputSize] = 0;
+	}
+
+	void CloseProfileStream(void *stream)
+	{
+		(void)stream;
+	}
+}
+
+const char	*testAllocationProfiler =
+"import std.gc;\r\n\
+class Foo{ int a, b; }\r\n\
+Foo ref[] arr;\r\n\
+void fill(){ arr = new Foo ref[8]; for(i in arr) i = new Foo; new Foo; new Foo; }\r\n\
+fill();\r\n\
+GC.CollectMemory();\r\n\
+long total = GC.TotalBytes(Foo), live = GC.LiveBytes(Foo);\r\n\
+return int(total * 1000 + live);";
+TEST_SIMPLE_WITH_SETUP("Allocation profiler by type and call site", testAllocationProfiler, "160128")
+{
+	if(before)
+	{
+		nullcSetAllocationProfiler(1);
+		return;
+	}
+
+	bool foundSite = false;
+
+	NULLCAllocationStats stats;
+	unsigned typeID = 0, frameCount = 0;
+
+	for(unsigned i = 0; nullcGetAllocationSiteProfile(i, &stats, &typeID, &frameCount); i++)
+	{
+		if(frameCount != 0 && stats.totalCount == 8 && stats.liveCount == 8)
+			foundSite = true;
+	}
+
+	if(!foundSite)
+	{
+		TEST_NAME();
+		printf(" Failed to find an allocation site of 'Foo' inside 'fill'\r\n");
+		lastFailed = true;
+	}
+
+	// Folded stacks name the function that has allocated the objects
+	nullcSetEnableLogFiles(Tests::enableLogFiles, OpenProfileStream, WriteProfileStream, CloseProfileStream);
+
+	bool saved = nullcSaveAllocationProfile("profile.txt", NULLC_ALLOCATION_PROFILE_FOLDED) != 0;
+
+	nullcSetEnableLogFiles(Tests::enableLogFiles, Tests::openStreamFunc, Tests::writeStreamFunc, Tests::closeStreamFunc);
+
+	if(!saved || !strstr(profileOutput, ";fill;new Foo "))
+	{
+		TEST_NAME();
+		printf(" Failed to find 'fill' in the folded allocation profile\r\n");
+		lastFailed = true;
+	}
+
+	nullcSetAllocationProfiler(0);
+}
+
+const char	*testCollectionTelemetry =
+"import std.gc;\r\n\
+class Foo{ int a, b; }\r\n\
+for(int i = 0; i < 1000; i++) new Foo;\r\n\
+GC.CollectMemory();\r\n\
+GC.CollectMemory();\r\n\
+int pauses = 0;\r\n\
+for(int i = 0; i < 32; i++) pauses += GC.PauseHistogram(i);\r\n\
+return GC.CollectionCount() * 10 + pauses;";
+TEST_SIMPLE_WITH_SETUP("Collection telemetry", testCollectionTelemetry, "22")
+{
+	if(before)
+	{
+		nullcResetCollectionStatistics();
+		return;
+	}
+
+	NULLCCollectionInfo first, last;
+
+	if(!nullcGetCollectionInfo(1, &first) || !nullcGetCollectionInfo(0, &last) || nullcGetCollectionInfo(2, &last))
+	{
+		TEST_NAME();
+		printf(" Failed to find collection records\r\n");
+		lastFailed = true;
+		return;
+	}
+
+	if(first.trigger != NULLC_GC_TRIGGER_EXPLICIT || first.usedAfter >= first.usedBefore || first.freedObjects[1] != 1000 || last.usedBefore != first.usedAfter)
+	{
+		TEST_NAME();
+		printf(" Collection record doesn't match the expected heap state\r\n");
+		lastFailed = true;
+	}
+
+	unsigned buckets[NULLC_GC_HISTOGRAM_SIZE];
+
+	if(!nullcGetCollectionHistogram(NULLC_GC_PHASE_MARK, buckets))
+	{
+		TEST_NAME();
+		printf(" Failed to get collection histogram\r\n");
+		lastFailed = true;
+	}
+}
+
+const char	*testCollectionPolicy =
+"import std.gc;\r\n\
+class Foo{ int a, b; }\r\n\
+int[] live = new int[256 * 1024];\r\n\
+for(int i = 0; i < 256 * 1024; i++) new Foo;\r\n\
+return GC.CollectionCount() != 0;";
+TEST_SIMPLE_WITH_SETUP("Collection threshold scales with live heap size", testCollectionPolicy, "1")
+{
+	if(before)
+	{
+		NULLCCollectionPolicy policy = { 64 * 1024, 2.0, 2.0, 1.0, 0 };
+
+		nullcSetCollectionPolicy(&policy);
+		nullcResetCollectionStatistics();
+		return;
+	}
+
+	// Threshold is updated when lazy sweeping is complete
+	while(nullcSweepMemory(1));
+
+	NULLCCollectionInfo info;
+
+	if(!nullcGetCollectionInfo(0, &info) || info.trigger != NULLC_GC_TRIGGER_THRESHOLD || info.usedAfter < 1024 * 1024 || info.threshold != info.usedAfter * 2)
+	{
+		TEST_NAME();
+		printf(" Collection threshold doesn't follow the surviving heap size\r\n");
+		lastFailed = true;
+	}
+
+	nullcSetCollectionPolicy(NULL);
+}
+
+int hostArrayReleaseCount = 0;
+void *hostArrayReleaseData = NULL;
+
+void HostArrayRelease(void *data, void *context)
+{
+	hostArrayReleaseCount++;
+	hostArrayReleaseData = data;
+
+	*(int*)context += 1;
+}
+
+const char	*testHostArrays =
+"import std.gc;\r\n\
+float[] kept;\r\n\
+double Sum(float[] data){ double s = 0; for(i in data) s += i; return s; }\r\n\
+void Keep(float[] data){ kept = data; }\r\n\
+void Drop(){ float[] empty; kept = empty; GC.CollectMemory(); }\r\n\
+void Collect(){ GC.CollectMemory(); }\r\n\
+return 1;";
+TEST_SIMPLE("Host arrays are shared without a copy", testHostArrays, "1")
+{
+	hostArrayReleaseCount = 0;
+	hostArrayReleaseData = NULL;
+
+	float data[1024];
+
+	for(unsigned i = 0; i < 1024; i++)
+		data[i] = float(i);
+
+	int releaseContext = 0;
+
+	NULLCArray arr = nullcRegisterHostArray(data, NULLC_TYPE_FLOAT, 1024, HostArrayRelease, &releaseContext);
+
+	if(!arr.ptr || arr.len != 1024 || !nullcIsHostArrayPointer(data + 10) || nullcIsManagedPointer(data))
+	{
+		TEST_NAME();
+		printf(" Failed to register a host array: %s\r\n", nullcGetLastError());
+		lastFailed = true;
+		return;
+	}
+
+	if(nullcRegisterHostArray(data + 512, NULLC_TYPE_FLOAT, 16, HostArrayRelease, &releaseContext).ptr || nullcRegisterHostArray(data, NULLC_TYPE_VOID, 16, HostArrayRelease, &releaseContext).ptr)
+	{
+		TEST_NAME();
+		printf(" Registered an invalid host array\r\n");
+		lastFailed = true;
+	}
+
+	NULLCPreparedCall sum, keep, drop, collect;
+
+	if(!nullcPrepareCall("Sum", &sum) || !nullcPrepareCall("Keep", &keep) || !nullcPrepareCall("Drop", &drop) || !nullcPrepareCall("Collect", &collect))
+	{
+		TEST_NAME();
+		printf(" Failed to prepare calls: %s\r\n", nullcGetLastError());
+		lastFailed = true;
+		return;
+	}
+
+	char buffer[NULLC_PREPARED_CALL_BUFFER_SIZE];
+
+	memcpy(buffer + sum.argumentOffsets[0], &arr, sizeof(arr));
+
+	// Host changes are visible to the program
+	data[0] = 1000.0f;
+
+	if(!nullcCallPrepared(&sum, buffer) || nullcGetResultDouble() != 1023 * 512 + 1000.0)
+	{
+		TEST_NAME();
+		printf(" Host array contents are incorrect: %s\r\n", nullcGetLastError());
+		lastFailed = true;
+	}
+
+	memcpy(buffer + keep.argumentOffsets[0], &arr, sizeof(arr));
+
+	if(!nullcCallPrepared(&keep, buffer) || !nullcReleaseHostArray(data) || nullcReleaseHostArray(data))
+	{
+		TEST_NAME();
+		printf(" Failed to release a host array: %s\r\n", nullcGetLastError());
+		lastFailed = true;
+	}
+
+	// Program still references the array
+	if(!nullcCallPrepared(&collect, buffer) || hostArrayReleaseCount != 0 || nullcGetHostArrayCount() != 1)
+	{
+		TEST_NAME();
+		printf(" Host array was released while it was referenced\r\n");
+		lastFailed = true;
+	}
+
+	if(!nullcCallPrepared(&drop, buffer) || hostArrayReleaseCount != 1 || hostArrayReleaseData != data || releaseContext != 1 || nullcGetHostArrayCount() != 0)
+	{
+		TEST_NAME();
+		printf(" Host array wasn't released when the last reference was dropped\r\n");
+		lastFailed = true;
+	}
+
+	// Memory can be registered again after it was returned to the host
+	if(!nullcRegisterHostArray(data, NULLC_TYPE_FLOAT, 1024, HostArrayRelease, &releaseContext).ptr || !nullcReleaseHostArray(data))
+	{
+		TEST_NAME();
+		printf(" Failed to register a host array again: %s\r\n", nullcGetLastError());
+		lastFailed = true;
+		return;
+	}
+
+	if(!nullcCallPrepared(&collect, buffer) || hostArrayReleaseCount != 2 || releaseContext != 2)
+	{
+		TEST_NAME();
+		printf(" Unreferenced host array wasn't released\r\n");
+		lastFailed = true;
+	}
+}
@@ -2500,3 +2500,15 @@ auto ref y = b;\r\n\
 \r\n\
 return x.foo('a') + y.foo(2l);";
 TEST_RESULT("Generic class external function definition and auto ref calls (generic function, multiple instances)", testGenericType153, "141");
+
+LOAD_MODULE(test_generic_type154a, "test.generic_type154a",
+"class Foo<T>{ T x; int y; }\r\n\
+class Bar<T>{ T z; }");
+LOAD_MODULE(test_generic_type154b, "test.generic_type154b",
+"import test.generic_type154a;\r\n\
+int bar(){ return 7; }");
+const char *testGenericType154 =
+"import test.generic_type154b;\r\n\
+Foo<int> a; a.x = 30; a.y = 4;\r\n\
+return a.x + a.y + bar() + (Foo<int>.T == int);";
+TEST_RESULT("Generic class body import is delayed until instantiation (indirect import)", testGenericType154, "42");
@@ -4,6 +4,22 @@
 
 #include "../NULLC/nullc_debug.h"
 #include "../NULLC/Array.h"
+#include "../NULLC/Lexer.h"
+#include "../NULLC/StrAlgo.h"
+
+#include "../NULLC/includes/async.h"
+
+#if defined(__linux)
+	#include <sys/socket.h>
+	#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+	#include <windows.h>
+	#include <process.h>
+#else
+	#include <pthread.h>
+#endif
 
 bool	initialized;
 
@@ -16,28 +32,2227 @@ bool	initialized;
 		testsPassed[TEST_TYPE_EXTRA]++;\
 	}
 
-#define TEST_COMPARES(test, result)\
-	testsCount[TEST_TYPE_EXTRA]++;\
-	if(strcmp((test), result) != 0)\
-	{\
-		printf("\"%s\" didn't return '%s'.\r\n", #test, result);\
-	}else{\
-		testsPassed[TEST_TYPE_EXTRA]++;\
+#define TEST_COMPARES(test, result)\
+	testsCount[TEST_TYPE_EXTRA]++;\
+	if(strcmp((test), result) != 0)\
+	{\
+		printf("\"%s\" didn't return '%s'.\r\n", #test, result);\
+	}else{\
+		testsPassed[TEST_TYPE_EXTRA]++;\
+	}
+
+bool RunExecutionContextTest()
+{
+	const char *codeA = "int value = 5; int ref ptr = new int(4); int add(int x){ value += x; return value; } return value;";
+	const char *codeB = "int value = 20; int add(int x){ value -= x; return value; } return value;";
+
+	nullcContext *contextA = nullcContextCreate();
+	nullcContext *contextB = nullcContextCreate();
+
+	bool result = false;
+
+	NULLCFuncPtr addA, addB;
+	void *ptrA = NULL;
+
+	if(!nullcContextBuild(contextA, codeA) || !nullcContextBuild(contextB, codeB))
+		printf("Build failed: %s\r\n", nullcGetLastError());
+	else if(!nullcContextRun(contextA) || nullcGetResultInt() != 5 || !nullcGetFunction("add", &addA))
+		printf("Context A run failed: %s\r\n", nullcGetLastError());
+	else if(!(ptrA = *(void**)nullcGetGlobal("ptr")) || !nullcIsManagedPointer(ptrA))
+		printf("Context A object is not allocated\r\n");
+	else if(!nullcContextRun(contextB) || nullcGetResultInt() != 20 || !nullcGetFunction("add", &addB))
+		printf("Context B run failed: %s\r\n", nullcGetLastError());
+	else if(!nullcContextCallFunction(contextA, addA, 3) || nullcGetResultInt() != 8)
+		printf("Context A call failed: %s\r\n", nullcGetLastError());
+	else if(!nullcContextCallFunction(contextB, addB, 3) || nullcGetResultInt() != 17)
+		printf("Context B call failed: %s\r\n", nullcGetLastError());
+	else if(nullcIsManagedPointer(ptrA))
+		printf("Context B shares the heap with context A\r\n");
+	else if(!nullcContextMakeCurrent(contextA) || *(int*)nullcGetGlobal("value") != 8 || !nullcIsManagedPointer(ptrA))
+		printf("Context A state was changed\r\n");
+	else
+		result = true;
+
+	nullcContextDestroy(contextA);
+	nullcContextDestroy(contextB);
+
+	if(nullcContextGetCurrent() != NULL)
+	{
+		printf("Default context was not restored\r\n");
+		return false;
+	}
+
+	return result;
+}
+
+struct ContextThreadData
+{
+	nullcContext *context;
+
+	int seed;
+
+	bool result;
+};
+
+void RunContextThread(ContextThreadData &data)
+{
+	// Objects are kept alive by a list on the stack while the collector runs on the other thread
+	const char *code = "\
+class Node{ int value; int[] data; Node ref next; }\r\n\
+int sum(int seed)\r\n\
+{\r\n\
+	Node ref list = nullptr;\r\n\
+	for(int i = 0; i < 1000; i++)\r\n\
+	{\r\n\
+		Node ref node = new Node;\r\n\
+		node.value = i + seed;\r\n\
+		node.data = new int[1024];\r\n\
+		node.data[1023] = i;\r\n\
+		node.next = list;\r\n\
+		list = node;\r\n\
+	}\r\n\
+	int result = 0;\r\n\
+	for(Node ref it = list; it != nullptr; it = it.next)\r\n\
+		result += it.value + it.data[1023];\r\n\
+	return result;\r\n\
+}\r\n\
+return sum(0);";
+
+	data.result = false;
+
+	NULLCFuncPtr sum;
+
+	if(!nullcContextBuild(data.context, code))
+		printf("Build failed: %s\r\n", nullcGetLastError());
+	else if(!nullcRun() || nullcGetResultInt() != 999000 || !nullcGetFunction("sum", &sum))
+		printf("Run failed: %s\r\n", nullcGetLastError());
+	else
+		data.result = true;
+
+	for(int i = 0; i < 4 && data.result; i++)
+	{
+		int seed = data.seed + i;
+
+		if(!nullcContextCallFunction(data.context, sum, seed) || nullcGetResultInt() != 999000 + seed * 1000)
+		{
+			printf("Call failed: %s\r\n", nullcGetLastError());
+			data.result = false;
+		}
+	}
+
+	if(data.result && nullcGetCollectionCount() == 0)
+	{
+		printf("Garbage collection didn't run\r\n");
+		data.result = false;
+	}
+
+	nullcContextDetach();
+}
+
+void RunDefaultContextThread(ContextThreadData &data)
+{
+	// Thread that hasn't selected a context uses the default one
+	data.result = false;
+
+	if(!nullcBuild("int x = 4; return x * 5;"))
+		printf("Default context build failed: %s\r\n", nullcGetLastError());
+	else if(!nullcRun() || nullcGetResultInt() != 20)
+		printf("Default context run failed: %s\r\n", nullcGetLastError());
+	else
+		data.result = true;
+}
+
+#if defined(_WIN32)
+unsigned __stdcall RunContextThreadEntry(void *data)
+{
+	RunContextThread(*(ContextThreadData*)data);
+
+	return 0;
+}
+
+unsigned __stdcall RunDefaultContextThreadEntry(void *data)
+{
+	RunDefaultContextThread(*(ContextThreadData*)data);
+
+	return 0;
+}
+#else
+void* RunContextThreadEntry(void *data)
+{
+	RunContextThread(*(ContextThreadData*)data);
+
+	return NULL;
+}
+
+void* RunDefaultContextThreadEntry(void *data)
+{
+	RunDefaultContextThread(*(ContextThreadData*)data);
+
+	return NULL;
+}
+#endif
+
+bool RunConcurrentContextTest()
+{
+	ContextThreadData data[2];
+
+	for(unsigned i = 0; i < 2; i++)
+	{
+		data[i].context = nullcContextCreate();
+		data[i].seed = i * 10 + 1;
+		data[i].result = false;
+	}
+
+#if defined(_WIN32)
+	HANDLE threads[2];
+
+	for(unsigned i = 0; i < 2; i++)
+		threads[i] = (HANDLE)_beginthreadex(NULL, 0, RunContextThreadEntry, &data[i], 0, NULL);
+
+	for(unsigned i = 0; i < 2; i++)
+	{
+		WaitForSingleObject(threads[i], INFINITE);
+		CloseHandle(threads[i]);
+	}
+#else
+	pthread_t threads[2];
+
+	for(unsigned i = 0; i < 2; i++)
+		pthread_create(&threads[i], NULL, RunContextThreadEntry, &data[i]);
+
+	for(unsigned i = 0; i < 2; i++)
+		pthread_join(threads[i], NULL);
+#endif
+
+	bool result = data[0].result && data[1].result;
+
+	// Contexts are usable by this thread after the other threads have detached from them
+	if(result && (!nullcContextMakeCurrent(data[0].context) || !nullcRun() || nullcGetResultInt() != 999000))
+	{
+		printf("Context run after thread exit failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	nullcContextMakeCurrent(NULL);
+
+	for(unsigned i = 0; i < 2; i++)
+		nullcContextDestroy(data[i].context);
+
+	if(!result)
+		return false;
+
+	// Default context is used by a thread that hasn't selected a context while this thread waits for it
+	ContextThreadData defaultData;
+
+	defaultData.context = NULL;
+	defaultData.seed = 0;
+	defaultData.result = false;
+
+#if defined(_WIN32)
+	HANDLE defaultThread = (HANDLE)_beginthreadex(NULL, 0, RunDefaultContextThreadEntry, &defaultData, 0, NULL);
+
+	WaitForSingleObject(defaultThread, INFINITE);
+	CloseHandle(defaultThread);
+#else
+	pthread_t defaultThread;
+
+	pthread_create(&defaultThread, NULL, RunDefaultContextThreadEntry, &defaultData);
+	pthread_join(defaultThread, NULL);
+#endif
+
+	if(!defaultData.result)
+		return false;
+
+	// Program built by the other thread is visible in the default context of this thread
+	if(!nullcRun() || nullcGetResultInt() != 20)
+	{
+		printf("Default context run after thread exit failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	return true;
+}
+
+bool RunProgramImageTest()
+{
+	if(!nullcBuild("int value = 5; int ref ptr = new int(4); int add(int x){ value += x + *ptr; return value; } int neg(int x){ return -x; } return value;"))
+	{
+		printf("Build failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	nullcProgram *program = nullcProgramCreate();
+
+	if(!program)
+	{
+		printf("Program image creation failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	nullcContext *contextA = nullcContextCreateFromProgram(program);
+	nullcContext *contextB = nullcContextCreateFromProgram(program);
+
+	// Image can outlive the code that it was created from
+	nullcBuild("return 1;");
+
+	bool result = false;
+
+	NULLCFuncPtr addA, addB, negA;
+
+	if(!contextA || !contextB)
+		printf("Context creation failed: %s\r\n", nullcGetLastError());
+	else if(!nullcContextRun(contextA) || nullcGetResultInt() != 5 || !nullcGetFunction("add", &addA))
+		printf("Context A run failed: %s\r\n", nullcGetLastError());
+	else if(!nullcContextCallFunction(contextA, addA, 3) || nullcGetResultInt() != 12)
+		printf("Context A call failed: %s\r\n", nullcGetLastError());
+	else if(!nullcContextRun(contextB) || nullcGetResultInt() != 5 || !nullcGetFunction("add", &addB))
+		printf("Context B run failed: %s\r\n", nullcGetLastError());
+	else if(!nullcContextCallFunction(contextB, addB, 1) || nullcGetResultInt() != 10)
+		printf("Context B call failed: %s\r\n", nullcGetLastError());
+	else if(!nullcContextMakeCurrent(contextA) || !nullcGetFunction("neg", &negA) || !nullcRedirectFunction(addA.id, negA.id))
+		printf("Context A redirect failed: %s\r\n", nullcGetLastError());
+	else if(!nullcContextCallFunction(contextA, addA, 3) || nullcGetResultInt() != -3)
+		printf("Context A redirected call failed: %s\r\n", nullcGetLastError());
+	else if(!nullcContextCallFunction(contextB, addB, 1) || nullcGetResultInt() != 15)
+		printf("Context B call after redirect in context A failed: %s\r\n", nullcGetLastError());
+	else if(!nullcContextLoadProgram(contextA, program) || !nullcRun() || nullcGetResultInt() != 5)
+		printf("Context A reload failed: %s\r\n", nullcGetLastError());
+	else
+		result = true;
+
+	nullcContextDestroy(contextA);
+	nullcContextDestroy(contextB);
+
+	nullcProgramRelease(program);
+
+	return result;
+}
+
+bool RunPreparedCallTest()
+{
+	const char *code = "int count = 0; int Mix(char a, long b, double c, float d){ count++; return a + int(b) + int(c * 10) + int(d); } long Sum(int[] arr){ long s = 0; for(i in arr) s += i; return s; } int offset = 100; int ref(int) adder = auto(int x){ return x + offset; };";
+
+	if(!nullcBuild(code) || !nullcRun())
+	{
+		printf("Build failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	NULLCPreparedCall mix, sum, adder;
+
+	if(!nullcPrepareCall("Mix", &mix) || !nullcPrepareCall("Sum", &sum) || !nullcPrepareCallPointer(*(NULLCFuncPtr*)nullcGetGlobal("adder"), &adder))
+	{
+		printf("Prepare failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	if(mix.argumentCount != 4 || mix.returnType != NULLC_TYPE_INT || mix.argumentTypes[2] != NULLC_TYPE_DOUBLE || sum.returnType != NULLC_TYPE_LONG)
+	{
+		printf("Prepared call signature is incorrect\r\n");
+		return false;
+	}
+
+	// Raw argument buffer
+	char buffer[NULLC_PREPARED_CALL_BUFFER_SIZE];
+
+	int a = 3;
+	long long b = 40;
+	double c = 0.5;
+	float d = 200.0f;
+
+	memcpy(buffer + mix.argumentOffsets[0], &a, sizeof(a));
+	memcpy(buffer + mix.argumentOffsets[1], &b, sizeof(b));
+	memcpy(buffer + mix.argumentOffsets[2], &c, sizeof(c));
+	memcpy(buffer + mix.argumentOffsets[3], &d, sizeof(d));
+
+	for(int i = 0; i < 100; i++)
+	{
+		if(!nullcCallPrepared(&mix, buffer) || nullcGetResultInt() != 248)
+		{
+			printf("Prepared call failed: %s\r\n", nullcGetLastError());
+			return false;
+		}
+	}
+
+	if(*(int*)nullcGetGlobal("count") != 100)
+	{
+		printf("Prepared call count is incorrect\r\n");
+		return false;
+	}
+
+	// Typed wrappers
+	if(!nullcInvokePrepared(&mix, 1, 2ll, 0.1, 3.0f) || nullcGetResultInt() != 7)
+	{
+		printf("Typed prepared call failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	int values[] = { 1, 2, 3, 4 };
+	NULLCArray arr = { (char*)values, 4 };
+
+	if(!nullcInvokePrepared(&sum, arr) || nullcGetResultLong() != 10)
+	{
+		printf("Typed prepared array call failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	if(!nullcInvokePrepared(&adder, 5) || nullcGetResultInt() != 105)
+	{
+		printf("Typed prepared closure call failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	if(nullcInvokePrepared(&mix, 1))
+	{
+		printf("Prepared call with wrong argument count succeeded\r\n");
+		return false;
+	}
+
+	return true;
+}
+
+bool RunPreparedBatchTest()
+{
+	const char *code = "int count = 0; bool Check(int x){ count++; return x % 3 == 0; } double Scale(int x, float y){ return x * y; } int Fresh(int x){ int[4] tmp; tmp[1] += x; return tmp[1]; } int Div(int x){ return 100 / x; } int offset = 100; int ref(int) adder = auto(int x){ return x + offset; };";
+
+	if(!nullcBuild(code) || !nullcRun())
+	{
+		printf("Build failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	NULLCPreparedCall check, scale, fresh, div, adder;
+
+	if(!nullcPrepareCall("Check", &check) || !nullcPrepareCall("Scale", &scale) || !nullcPrepareCall("Fresh", &fresh) || !nullcPrepareCall("Div", &div) || !nullcPrepareCallPointer(*(NULLCFuncPtr*)nullcGetGlobal("adder"), &adder))
+	{
+		printf("Prepare failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	const unsigned count = 64;
+	const unsigned stride = 32;
+
+	char arguments[count * stride];
+	int intResults[count];
+	double doubleResults[count];
+
+	for(unsigned i = 0; i < count; i++)
+	{
+		int x = int(i);
+
+		memcpy(arguments + i * stride + check.argumentOffsets[0], &x, sizeof(x));
+	}
+
+	if(!nullcCallPreparedBatch(&check, arguments, stride, count, intResults, sizeof(int)))
+	{
+		printf("Batched call failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	for(unsigned i = 0; i < count; i++)
+	{
+		if(intResults[i] != (i % 3 == 0 ? 1 : 0))
+		{
+			printf("Batched call result %d is incorrect\r\n", i);
+			return false;
+		}
+	}
+
+	if(*(int*)nullcGetGlobal("count") != int(count))
+	{
+		printf("Batched call count is incorrect\r\n");
+		return false;
+	}
+
+	// Context pointer of a single argument function overlaps the second argument
+	char scaleArguments[count * stride];
+
+	for(unsigned i = 0; i < count; i++)
+	{
+		int x = int(i);
+		float y = 0.5f;
+
+		memcpy(scaleArguments + i * stride + scale.argumentOffsets[0], &x, sizeof(x));
+		memcpy(scaleArguments + i * stride + scale.argumentOffsets[1], &y, sizeof(y));
+	}
+
+	if(!nullcCallPreparedBatch(&scale, scaleArguments, stride, count, doubleResults, sizeof(double)))
+	{
+		printf("Batched call failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	for(unsigned i = 0; i < count; i++)
+	{
+		if(doubleResults[i] != i * 0.5)
+		{
+			printf("Batched call result %d is incorrect\r\n", i);
+			return false;
+		}
+	}
+
+	// Locals must not leak between items
+	if(!nullcCallPreparedBatch(&fresh, arguments, stride, count, intResults, sizeof(int)) || intResults[count - 1] != int(count - 1))
+	{
+		printf("Batched call doesn't reset the stack frame: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	// Closure context is written into each argument block
+	if(!nullcCallPreparedBatch(&adder, arguments, stride, count, intResults, sizeof(int)) || intResults[5] != 105 || intResults[count - 1] != int(count - 1 + 100))
+	{
+		printf("Batched closure call failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	// Results are optional
+	if(!nullcCallPreparedBatch(&check, arguments, stride, count, NULL, 0))
+	{
+		printf("Batched call without results failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	// First item divides by zero
+	if(nullcCallPreparedBatch(&div, arguments, stride, count, intResults, sizeof(int)))
+	{
+		printf("Batched call with an error succeeded\r\n");
+		return false;
+	}
+
+	if(!strstr(nullcGetLastError(), "division by zero"))
+	{
+		printf("Batched call error is incorrect: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	if(nullcCallPreparedBatch(&check, arguments, 4, count, intResults, sizeof(int)))
+	{
+		printf("Batched call with a small argument stride succeeded\r\n");
+		return false;
+	}
+
+	return true;
+}
+
+unsigned budgetCallbackCalls = 0;
+unsigned budgetCallbackRenewals = 0;
+
+unsigned OnBudgetExhausted(void *context)
+{
+	(void)context;
+
+	budgetCallbackCalls++;
+
+	if(budgetCallbackCalls > budgetCallbackRenewals)
+		return NULLC_BUDGET_STOP;
+
+	return NULLC_BUDGET_CONTINUE;
+}
+
+bool RunExecutionBudgetTest()
+{
+	const char *code =
+"int counter = 0;\r\n\
+int loop(int n){ for(int i = 0; i < n; i++) counter++; return counter; }\r\n\
+int depth(int n){ return n ? depth(n - 1) + 1 : 0; }\r\n\
+int forever(){ while(true) counter++; return 0; }";
+
+	if(!nullcBuild(code) || !nullcRun())
+	{
+		printf("Build failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	NULLCPreparedCall loop, depth, forever;
+
+	if(!nullcPrepareCall("loop", &loop) || !nullcPrepareCall("depth", &depth) || !nullcPrepareCall("forever", &forever))
+	{
+		printf("Prepare failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	bool result = true;
+
+	nullcSetExecutionBudget(1000, 0);
+	nullcSetExecutionBudgetCallback(NULL, NULL);
+
+	if(!nullcInvokePrepared(&loop, 500))
+	{
+		printf("Call within the budget failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	// Budget is renewed for each call
+	if(result && !nullcInvokePrepared(&loop, 500))
+	{
+		printf("Budget wasn't renewed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	if(result && (nullcInvokePrepared(&loop, 5000) || !strstr(nullcGetLastError(), "execution budget exceeded")))
+	{
+		printf("Loop over the budget should have been stopped\r\n");
+		result = false;
+	}
+
+	// Host can renew the budget a number of times before stopping the program
+	budgetCallbackCalls = 0;
+	budgetCallbackRenewals = 3;
+
+	nullcSetExecutionBudgetCallback(NULL, OnBudgetExhausted);
+
+	if(result && (nullcInvokePrepared(&forever) || budgetCallbackCalls != 4))
+	{
+		printf("Budget callback wasn't called the expected number of times (%d)\r\n", budgetCallbackCalls);
+		result = false;
+	}
+
+	// Function calls spend the budget as well
+	budgetCallbackCalls = 0;
+	budgetCallbackRenewals = ~0u;
+
+	nullcSetExecutionBudget(100, 0);
+
+	if(result && (!nullcInvokePrepared(&depth, 1000) || nullcGetResultInt() != 1000 || budgetCallbackCalls != 10))
+	{
+		printf("Recursion should have been resumed by the budget callback (%d)\r\n", budgetCallbackCalls);
+		result = false;
+	}
+
+	// Deadline
+	nullcSetExecutionBudget(0, 10);
+	nullcSetExecutionBudgetCallback(NULL, NULL);
+
+	if(result && (nullcInvokePrepared(&forever) || !strstr(nullcGetLastError(), "execution budget exceeded")))
+	{
+		printf("Loop over the deadline should have been stopped\r\n");
+		result = false;
+	}
+
+	nullcSetExecutionBudget(0, 0);
+
+	if(result && (!nullcInvokePrepared(&loop, 100000)))
+	{
+		printf("Call without a budget failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	// Callback is not reached without a budget
+	budgetCallbackCalls = 0;
+	budgetCallbackRenewals = 0;
+
+	nullcSetExecutionBudgetCallback(NULL, OnBudgetExhausted);
+
+	if(result && (!nullcInvokePrepared(&depth, 1000) || !nullcInvokePrepared(&loop, 100000) || budgetCallbackCalls != 0))
+	{
+		printf("Call without a budget was stopped: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	nullcSetExecutionBudgetCallback(NULL, NULL);
+
+	return result;
+}
+
+unsigned quotaCallbackCalls = 0;
+unsigned quotaCallbackAction = NULLC_QUOTA_CONTINUE;
+
+unsigned OnMemoryQuotaSoftLimit(void *context, unsigned used, unsigned softLimit)
+{
+	(void)context;
+
+	if(used > softLimit)
+		quotaCallbackCalls++;
+
+	return quotaCallbackAction;
+}
+
+bool RunMemoryQuotaTest()
+{
+	const char *code =
+"int[] keep;\r\n\
+int grow(int n){ keep = new int[n]; return n; }\r\n\
+int churn(int n){ for(int i = 0; i < n; i++) keep = new int[16384]; return n; }";
+
+	if(!nullcBuild(code) || !nullcRun())
+	{
+		printf("Build failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	NULLCPreparedCall grow, churn;
+
+	if(!nullcPrepareCall("grow", &grow) || !nullcPrepareCall("churn", &churn))
+	{
+		printf("Prepare failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	bool result = true;
+
+	unsigned total = nullcGetMemoryUsage(NULLC_MEMORY_TOTAL);
+
+	if(nullcGetMemoryUsage(NULLC_MEMORY_HEAP) == 0 || nullcGetMemoryUsage(NULLC_MEMORY_STACK) == 0)
+	{
+		printf("Heap and stack memory is not accounted\r\n");
+		result = false;
+	}
+
+	if(total != nullcGetMemoryUsage(NULLC_MEMORY_HEAP) + nullcGetMemoryUsage(NULLC_MEMORY_STACK) + nullcGetMemoryUsage(NULLC_MEMORY_COMPILER) + nullcGetMemoryUsage(NULLC_MEMORY_CODE))
+	{
+		printf("Total memory usage doesn't match the categories\r\n");
+		result = false;
+	}
+
+	nullcSetMemoryQuota(0, total + 512 * 1024);
+	nullcSetMemoryQuotaCallback(NULL, NULL);
+
+	if(result && (nullcInvokePrepared(&grow, 1024 * 1024) || !strstr(nullcGetLastError(), "reached memory quota")))
+	{
+		printf("Allocation over the hard limit should have failed\r\n");
+		result = false;
+	}
+
+	// Unreachable memory is collected before the hard limit is reported
+	if(result && !nullcInvokePrepared(&churn, 100))
+	{
+		printf("Allocation of collectable memory failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	if(result && (nullcSetExecutorStackSize(total + 1024 * 1024) || !strstr(nullcGetLastError(), "memory quota")))
+	{
+		printf("Stack size over the hard limit should have been rejected\r\n");
+		result = false;
+	}
+
+	// Soft limit callback is called once until the memory usage goes under the limit
+	nullcSetMemoryQuota(nullcGetMemoryUsage(NULLC_MEMORY_TOTAL) + 128 * 1024, 0);
+	nullcSetMemoryQuotaCallback(NULL, OnMemoryQuotaSoftLimit);
+
+	quotaCallbackCalls = 0;
+	quotaCallbackAction = NULLC_QUOTA_CONTINUE;
+
+	if(result && (!nullcInvokePrepared(&grow, 256 * 1024) || !nullcInvokePrepared(&grow, 256 * 1024) || quotaCallbackCalls != 1))
+	{
+		printf("Soft limit callback wasn't called once (%d): %s\r\n", quotaCallbackCalls, nullcGetLastError());
+		result = false;
+	}
+
+	// Collection requested by the callback brings the memory usage under the limit again
+	nullcSetMemoryQuota(nullcGetMemoryUsage(NULLC_MEMORY_TOTAL) + 128 * 1024, 0);
+
+	quotaCallbackCalls = 0;
+	quotaCallbackAction = NULLC_QUOTA_COLLECT;
+
+	if(result && (!nullcInvokePrepared(&churn, 100) || quotaCallbackCalls < 2))
+	{
+		printf("Soft limit callback wasn't called after collections (%d): %s\r\n", quotaCallbackCalls, nullcGetLastError());
+		result = false;
+	}
+
+	quotaCallbackAction = NULLC_QUOTA_STOP;
+
+	if(result && (nullcInvokePrepared(&churn, 100) || !strstr(nullcGetLastError(), "soft limit")))
+	{
+		printf("Soft limit callback should have stopped the program\r\n");
+		result = false;
+	}
+
+	// Compiler memory is limited by the quota as well
+	nullcSetMemoryQuota(0, nullcGetMemoryUsage(NULLC_MEMORY_TOTAL) - nullcGetMemoryUsage(NULLC_MEMORY_COMPILER) + 1024);
+	nullcSetMemoryQuotaCallback(NULL, NULL);
+
+	if(result && nullcBuild(code))
+	{
+		printf("Compilation over the hard limit should have failed\r\n");
+		result = false;
+	}
+
+	nullcSetMemoryQuota(0, 0);
+
+	return result;
+}
+
+bool RunAnalyzeCancellationTest()
+{
+	// Enough functions for the analysis to pass several cancellation check points
+	const unsigned functionCount = 2000;
+
+	char *code = new char[functionCount * 64 + 64];
+	char *pos = code;
+
+	for(unsigned i = 0; i < functionCount; i++)
+		pos += NULLC::SafeSprintf(pos, 64, "int f%d(int x){ return x + %d; }\r\n", i, i);
+
+	NULLC::SafeSprintf(pos, 64, "return f%d(1);", functionCount - 1);
+
+	NULLCCancellation cancellation;
+	nullcResetCancellation(&cancellation);
+	nullcRequestCancellation(&cancellation);
+
+	nullcSetAnalyzeCancellation(&cancellation);
+
+	bool result = true;
+
+	if(nullcAnalyze(code) || !strstr(nullcGetLastError(), "analysis was cancelled"))
+	{
+		printf("Analysis should have been cancelled: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	nullcResetCancellation(&cancellation);
+
+	if(result && !nullcAnalyze(code))
+	{
+		printf("Analysis failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	nullcSetAnalyzeCancellation(NULL);
+
+	nullcClean();
+
+	delete[] code;
+
+	return result;
+}
+
+bool RunCompilerMemoryRetentionTest()
+{
+	// Enough functions for the compiler to use multiple allocator chunks
+	const unsigned functionCount = 200;
+
+	char *code = new char[functionCount * 64 + 64];
+	char *pos = code;
+
+	for(unsigned i = 0; i < functionCount; i++)
+		pos += NULLC::SafeSprintf(pos, 64, "int f%d(int x){ return x + %d; }\r\n", i, i);
+
+	NULLC::SafeSprintf(pos, 64, "return f%d(1);", functionCount - 1);
+
+	const unsigned retention = 4 * 1024 * 1024;
+
+	bool result = true;
+
+	NULLCCompilerMemoryStats first, second;
+
+	nullcSetCompilerMemoryRetention(0);
+
+	if(!nullcCompile(code))
+	{
+		printf("Compilation failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	nullcGetCompilerMemoryStatistics(&first);
+
+	if(result && (first.parse == 0 || first.analyze == 0 || first.ir == 0 || first.lowering == 0))
+	{
+		printf("Phase memory is not recorded: %d %d %d %d\r\n", first.parse, first.analyze, first.ir, first.lowering);
+		result = false;
+	}
+
+	nullcClean();
+
+	nullcGetCompilerMemoryStatistics(&first);
+
+	if(result && first.retained != 0)
+	{
+		printf("Memory is retained without a limit: %d\r\n", first.retained);
+		result = false;
+	}
+
+	nullcSetCompilerMemoryRetention(retention);
+
+	if(result && !nullcCompile(code))
+	{
+		printf("Compilation failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	nullcClean();
+
+	nullcGetCompilerMemoryStatistics(&first);
+
+	if(result && (first.retained == 0 || first.retained > retention))
+	{
+		printf("Retained memory %d is outside of the limit\r\n", first.retained);
+		result = false;
+	}
+
+	// Compilation reuses the retained memory
+	if(result && !nullcCompile(code))
+	{
+		printf("Compilation failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	nullcClean();
+
+	nullcGetCompilerMemoryStatistics(&second);
+
+	if(result && (second.parse != first.parse || second.analyze != first.analyze || second.ir != first.ir || second.lowering != first.lowering || second.retained != first.retained))
+	{
+		printf("Repeated compilation has different memory statistics\r\n");
+		result = false;
+	}
+
+	nullcSetCompilerMemoryRetention(64 * 1024 * 1024);
+
+	delete[] code;
+
+	return result;
+}
+
+bool WriteModuleCacheTestFile(const char *name, const char *content)
+{
+	FILE *file = fopen(name, "wb");
+
+	if(!file)
+		return false;
+
+	fwrite(content, 1, strlen(content), file);
+	fclose(file);
+
+	return true;
+}
+
+// Moves the first lexeme of a cache entry past the end of the module source
+bool DamageModuleCacheLexeme(const char *name)
+{
+	FILE *file = fopen(name, "r+b");
+
+	if(!file)
+		return false;
+
+	// Entry header is followed by dependency hashes and lexemes
+	unsigned header[10];
+
+	bool changed = false;
+
+	if(fread(header, sizeof(header), 1, file) == 1 && header[8] != 0)
+	{
+		unsigned offset = 0x7fffffff;
+
+		if(fseek(file, long(sizeof(header) + header[7] * sizeof(unsigned) + sizeof(unsigned)), SEEK_SET) == 0)
+			changed = fwrite(&offset, sizeof(offset), 1, file) == 1;
+	}
+
+	fclose(file);
+
+	return changed;
+}
+
+void RemoveModuleCacheTestModules()
+{
+	nullcRemoveModule("cache_test_a.nc");
+	nullcRemoveModule("cache_test_b.nc");
+}
+
+bool CheckModuleCacheStatistics(const char *stage, unsigned expectedHits, unsigned expectedMisses)
+{
+	unsigned hits = 0, misses = 0;
+	nullcGetModuleCacheStatistics(&hits, &misses);
+
+	if(hits != expectedHits || misses != expectedMisses)
+	{
+		printf("%s: expected %d hits and %d misses, got %d and %d\r\n", stage, expectedHits, expectedMisses, hits, misses);
+		return false;
+	}
+
+	// Counters are reset
+	nullcSetModuleCacheDirectory(FILE_PATH);
+
+	return true;
+}
+
+bool RunModuleCacheTest()
+{
+	const char *moduleA = "import cache_test_b; int a(int x){ return b(x) * 2; }";
+	const char *moduleB1 = "int b(int x){ return x + 1; }";
+	const char *moduleB2 = "int b(int x){ return x + 10; }";
+
+	const char *code = "import cache_test_a; return a(2);";
+
+	remove(FILE_PATH "cache_test_a.nc.nbc");
+	remove(FILE_PATH "cache_test_b.nc.nbc");
+
+	if(!WriteModuleCacheTestFile(FILE_PATH "cache_test_a.nc", moduleA) || !WriteModuleCacheTestFile(FILE_PATH "cache_test_b.nc", moduleB1))
+	{
+		printf("Failed to write test modules\r\n");
+		return false;
+	}
+
+	nullcSetModuleCacheDirectory(FILE_PATH);
+
+	bool result = true;
+
+	// Cold build saves modules
+	if(!nullcBuild(code) || !nullcRun() || nullcGetResultInt() != 6)
+	{
+		printf("Cold build failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	result = result && CheckModuleCacheStatistics("Cold build", 0, 2);
+
+	// Warm build loads both modules
+	RemoveModuleCacheTestModules();
+
+	if(result && (!nullcBuild(code) || !nullcRun() || nullcGetResultInt() != 6))
+	{
+		printf("Warm build failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	result = result && CheckModuleCacheStatistics("Warm build", 2, 0);
+
+	// Module is rebuilt when its dependency has changed
+	RemoveModuleCacheTestModules();
+
+	if(result && !WriteModuleCacheTestFile(FILE_PATH "cache_test_b.nc", moduleB2))
+		result = false;
+
+	if(result && (!nullcBuild(code) || !nullcRun() || nullcGetResultInt() != 24))
+	{
+		printf("Build with a changed dependency failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	result = result && CheckModuleCacheStatistics("Build with a changed dependency", 0, 2);
+
+	// Damaged entry is ignored and replaced
+	RemoveModuleCacheTestModules();
+
+	if(result && !WriteModuleCacheTestFile(FILE_PATH "cache_test_a.nc.nbc", "NNMC"))
+		result = false;
+
+	if(result && (!nullcBuild(code) || !nullcRun() || nullcGetResultInt() != 24))
+	{
+		printf("Build with a damaged entry failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	result = result && CheckModuleCacheStatistics("Build with a damaged entry", 1, 1);
+
+	RemoveModuleCacheTestModules();
+
+	if(result && (!nullcBuild(code) || !nullcRun() || nullcGetResultInt() != 24))
+	{
+		printf("Build after a damaged entry failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	result = result && CheckModuleCacheStatistics("Build after a damaged entry", 2, 0);
+
+	// Entry with a lexeme outside of the module source is ignored
+	RemoveModuleCacheTestModules();
+
+	if(result && !DamageModuleCacheLexeme(FILE_PATH "cache_test_a.nc.nbc"))
+	{
+		printf("Failed to change the cache entry lexeme\r\n");
+		result = false;
+	}
+
+	if(result && (!nullcBuild(code) || !nullcRun() || nullcGetResultInt() != 24))
+	{
+		printf("Build with a damaged entry lexeme failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	result = result && CheckModuleCacheStatistics("Build with a damaged entry lexeme", 1, 1);
+
+	nullcSetModuleCacheDirectory(NULL);
+
+	RemoveModuleCacheTestModules();
+
+	remove(FILE_PATH "cache_test_a.nc");
+	remove(FILE_PATH "cache_test_b.nc");
+	remove(FILE_PATH "cache_test_a.nc.nbc");
+	remove(FILE_PATH "cache_test_b.nc.nbc");
+
+	return result;
+}
+
+void RemoveModulePackTestModules()
+{
+	nullcRemoveModule("test/pack_a.nc");
+	nullcRemoveModule("test/pack_b.nc");
+}
+
+bool RunModulePackTest()
+{
+	const char *moduleA = "int pack_a(int x){ return x * 3; } class PackBox<T>{ T value; } auto pack_get(generic box){ return box.value; }";
+	const char *moduleB = "import test.pack_a; int pack_b(int x){ return pack_a(x) + 1; }";
+
+	const char *code = "import test.pack_b; import test.pack_a; PackBox<int> box; box.value = 4; return pack_b(2) + pack_get(box);";
+
+	RemoveModulePackTestModules();
+
+	if(!nullcLoadModuleBySource("test.pack_a", moduleA) || !nullcLoadModuleBySource("test.pack_b", moduleB))
+	{
+		printf("Failed to build test modules: %s\r\n", nullcGetLastError());
+		RemoveModulePackTestModules();
+		return false;
+	}
+
+	const char *modules[] = { "test.pack_a", "test.pack_b" };
+
+	bool result = true;
+
+	if(!nullcSaveModulePack(FILE_PATH "pack_test.ncm", modules, 2))
+	{
+		printf("Failed to save module pack: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	RemoveModulePackTestModules();
+
+	// Generic instantiation uses source of the module in the mapped file
+	if(result && !nullcLoadModulePack(FILE_PATH "pack_test.ncm"))
+	{
+		printf("Failed to load module pack: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	if(result && (!nullcBuild(code) || !nullcRun() || nullcGetResultInt() != 11))
+	{
+		printf("Build with modules from a pack failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	// Modules that are already loaded are skipped
+	if(result && (!nullcLoadModulePack(FILE_PATH "pack_test.ncm") || !nullcBuild(code) || !nullcRun() || nullcGetResultInt() != 11))
+	{
+		printf("Loading module pack again failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	RemoveModulePackTestModules();
+
+	if(result && (!WriteModuleCacheTestFile(FILE_PATH "pack_test.ncm", "NNMP") || nullcLoadModulePack(FILE_PATH "pack_test.ncm")))
+	{
+		printf("Damaged module pack was loaded\r\n");
+		result = false;
+	}
+
+	if(result && nullcLoadModulePack(FILE_PATH "pack_test_missing.ncm"))
+	{
+		printf("Missing module pack was loaded\r\n");
+		result = false;
+	}
+
+	RemoveModulePackTestModules();
+
+	remove(FILE_PATH "pack_test.ncm");
+
+	return result;
+}
+
+void RemoveModuleBuildTestModules()
+{
+	nullcRemoveModule("build_test_base.nc");
+	nullcRemoveModule("build_test_left.nc");
+	nullcRemoveModule("build_test_right.nc");
+	nullcRemoveModule("build_test_bad.nc");
+}
+
+bool RunModuleBuildThreadsTest()
+{
+	const char *moduleBase = "int base(int x){ return x + 1; }";
+	const char *moduleLeft = "import build_test_base; int left(int x){ return base(x) * 2; }";
+	const char *moduleRight = "import build_test_base; import std.vector; int right(int x){ vector<int> v; v.push_back(x); return base(v[0]) * 3; }";
+	const char *moduleBad = "import build_test_base; int bad(int x){ return base(y); }";
+
+	if(!WriteModuleCacheTestFile(FILE_PATH "build_test_base.nc", moduleBase) || !WriteModuleCacheTestFile(FILE_PATH "build_test_left.nc", moduleLeft) || !WriteModuleCacheTestFile(FILE_PATH "build_test_right.nc", moduleRight) || !WriteModuleCacheTestFile(FILE_PATH "build_test_bad.nc", moduleBad))
+	{
+		printf("Failed to write test modules\r\n");
+		return false;
+	}
+
+	bool result = true;
+
+	RemoveModuleBuildTestModules();
+
+	nullcSetModuleBuildThreads(4);
+
+	// Shared dependency is built once before the modules that import it
+	if(!nullcBuild("import build_test_left; import build_test_right; return left(1) + right(2);") || !nullcRun() || nullcGetResultInt() != 13)
+	{
+		printf("Build with concurrent imports failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	// Errors in imports are the same as in a serial build
+	RemoveModuleBuildTestModules();
+
+	char concurrentError[1024];
+	*concurrentError = 0;
+
+	if(result && nullcBuild("import build_test_left; import build_test_bad; return left(1);"))
+	{
+		printf("Build with an error in import succeeded\r\n");
+		result = false;
+	}
+
+	strncpy(concurrentError, nullcGetLastError(), 1023);
+	concurrentError[1023] = 0;
+
+	nullcSetModuleBuildThreads(0);
+
+	RemoveModuleBuildTestModules();
+
+	if(result && nullcBuild("import build_test_left; import build_test_bad; return left(1);"))
+	{
+		printf("Serial build with an error in import succeeded\r\n");
+		result = false;
+	}
+
+	if(result && strcmp(concurrentError, nullcGetLastError()) != 0)
+	{
+		printf("Error mismatch:\r\n%s\r\n%s\r\n", concurrentError, nullcGetLastError());
+		result = false;
+	}
+
+	RemoveModuleBuildTestModules();
+
+	remove(FILE_PATH "build_test_base.nc");
+	remove(FILE_PATH "build_test_left.nc");
+	remove(FILE_PATH "build_test_right.nc");
+	remove(FILE_PATH "build_test_bad.nc");
+
+	return result;
+}
+
+unsigned CountOwnFunctions(const char *bytecode, const char *name)
+{
+	ByteCode *code = (ByteCode*)bytecode;
+
+	ExternFuncInfo *functions = FindFirstFunc(code);
+	char *symbols = FindSymbols(code);
+
+	unsigned count = 0;
+
+	for(unsigned i = 0; i < code->functionCount - code->moduleFunctionCount; i++)
+	{
+		if(strcmp(symbols + functions[i].offsetToName, name) == 0)
+			count++;
+	}
+
+	return count;
+}
+
+void RemoveGenericInstanceImportTestModules()
+{
+	nullcRemoveModule("test/share_proto.nc");
+	nullcRemoveModule("test/share_user.nc");
+}
+
+bool RunGenericInstanceImportTest()
+{
+	const char *moduleProto = "class ShareBox<T>{ T value; auto add(generic x){ return value + x; } }";
+	const char *moduleUser = "import test.share_proto; int share_user(){ ShareBox<int> box; box.value = 1; return box.add(2); }";
+
+	RemoveGenericInstanceImportTestModules();
+
+	if(!nullcLoadModuleBySource("test.share_proto", moduleProto) || !nullcLoadModuleBySource("test.share_user", moduleUser))
+	{
+		printf("Failed to build test modules: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	bool result = true;
+
+	// Member function instance for 'int' is taken from the module that created it, instance for 'double' is created from the generic type module source
+	const char *code = "import test.share_user; import test.share_proto; ShareBox<int> box; box.value = 3; return share_user() + box.add(4) + int(box.add(0.5) * 2);";
+
+	char *bytecode = NULL;
+
+	if(!nullcCompile(code) || !nullcGetBytecode(&bytecode))
+	{
+		printf("Compilation failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	if(result && CountOwnFunctions(bytecode, "ShareBox<int>::add") != 1)
+	{
+		printf("Imported generic function instance was not reused (%d own instances)\r\n", CountOwnFunctions(bytecode, "ShareBox<int>::add"));
+		result = false;
+	}
+
+	delete[] bytecode;
+
+	if(result && (!nullcBuild(code) || !nullcRun() || nullcGetResultInt() != 17))
+	{
+		printf("Build with an imported generic function instance failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	RemoveGenericInstanceImportTestModules();
+
+	return result;
+}
+
+ExternFuncInfo* FindOwnFunction(const char *bytecode, const char *name)
+{
+	ByteCode *code = (ByteCode*)bytecode;
+
+	ExternFuncInfo *functions = FindFirstFunc(code);
+	char *symbols = FindSymbols(code);
+
+	for(unsigned i = 0; i < code->functionCount - code->moduleFunctionCount; i++)
+	{
+		if(strcmp(symbols + functions[i].offsetToName, name) == 0)
+			return &functions[i];
+	}
+
+	return NULL;
+}
+
+ExternFuncInfo* FindLinkedFunction(const char *name)
+{
+	unsigned count = 0;
+	ExternFuncInfo *functions = nullcDebugFunctionInfo(&count);
+	char *symbols = nullcDebugSymbols(NULL);
+
+	for(unsigned i = 0; i < count; i++)
+	{
+		if(strcmp(symbols + functions[i].offsetToName, name) == 0)
+			return &functions[i];
+	}
+
+	return NULL;
+}
+
+void RemoveGenericInstanceDeduplicationTestModules()
+{
+	nullcRemoveModule("test/dedup_proto.nc");
+	nullcRemoveModule("test/dedup_a.nc");
+	nullcRemoveModule("test/dedup_b.nc");
+}
+
+bool RunGenericInstanceDeduplicationTest()
+{
+	const char *moduleProto = "auto Twice(generic x){ int[] tmp = new int[2]; tmp[0] = x; tmp[1] = x; return tmp[0] + tmp[1]; }";
+	const char *moduleA = "import test.dedup_proto; int dedup_a(){ return Twice(2); }";
+	const char *moduleB = "import test.dedup_proto; int dedup_first(){ return 1; } int dedup_b(){ return Twice(3); } int dedup_last(int x){ for(int i = 0; i < 3; i++) x += i; return x; }";
+
+	RemoveGenericInstanceDeduplicationTestModules();
+
+	if(!nullcLoadModuleBySource("test.dedup_proto", moduleProto) || !nullcLoadModuleBySource("test.dedup_a", moduleA) || !nullcLoadModuleBySource("test.dedup_b", moduleB))
+	{
+		printf("Failed to build test modules: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	bool result = true;
+
+	// Sibling modules have their own instances of Twice<int>, the second one is removed from the linked code
+	if(!nullcBuild("import test.dedup_a; import test.dedup_b; return dedup_a() + dedup_b() + dedup_first() + dedup_last(10);") || !nullcRun() || nullcGetResultInt() != 24)
+	{
+		printf("Build with duplicate generic function instances failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	const char *bytecodeB = (const char*)nullcGetModule("test/dedup_b.nc");
+
+	ExternFuncInfo *ownFirst = bytecodeB ? FindOwnFunction(bytecodeB, "dedup_first") : NULL;
+	ExternFuncInfo *ownLast = bytecodeB ? FindOwnFunction(bytecodeB, "dedup_last") : NULL;
+	ExternFuncInfo *ownInstance = bytecodeB ? FindOwnFunction(bytecodeB, "Twice") : NULL;
+
+	ExternFuncInfo *linkedFirst = FindLinkedFunction("dedup_first");
+	ExternFuncInfo *linkedLast = FindLinkedFunction("dedup_last");
+
+	if(result && (!ownFirst || !ownLast || !ownInstance || !linkedFirst || !linkedLast))
+	{
+		printf("Failed to find test functions\r\n");
+		result = false;
+	}
+
+	// Instance body is placed between the other functions of the module
+	if(result && (ownInstance->regVmAddress < ownFirst->regVmAddress || ownInstance->regVmAddress > ownLast->regVmAddress))
+	{
+		printf("Unexpected generic function instance placement\r\n");
+		result = false;
+	}
+
+	if(result && linkedLast->regVmAddress - linkedFirst->regVmAddress != ownLast->regVmAddress - ownFirst->regVmAddress - ownInstance->regVmCodeSize)
+	{
+		printf("Duplicate generic function instance body was not removed (%d != %d)\r\n", linkedLast->regVmAddress - linkedFirst->regVmAddress, ownLast->regVmAddress - ownFirst->regVmAddress - ownInstance->regVmCodeSize);
+		result = false;
+	}
+
+	RemoveGenericInstanceDeduplicationTestModules();
+
+	return result;
+}
+
+bool RunAsyncTest()
+{
+#if defined(__linux)
+	const char *code =
+"import std.async;\r\n\
+int served = 0, received = 0, timers = 0, hostFuture = 0;\r\n\
+long hostValue = 0;\r\n\
+auto server(int fd)\r\n\
+{\r\n\
+	coroutine int run()\r\n\
+	{\r\n\
+		future f = read_ready(fd);\r\n\
+		yield await(f);\r\n\
+		f.release();\r\n\
+		char[] buffer = new char[16];\r\n\
+		if(fd_read(fd, buffer) == 5 && buffer[1] == 'i')\r\n\
+		{\r\n\
+			fd_write(fd, \"pong\");\r\n\
+			served++;\r\n\
+		}\r\n\
+		return 0;\r\n\
+	}\r\n\
+	return run;\r\n\
+}\r\n\
+auto client(int fd)\r\n\
+{\r\n\
+	coroutine int run()\r\n\
+	{\r\n\
+		future t = sleep(5);\r\n\
+		yield await(t);\r\n\
+		t.release();\r\n\
+		fd_write(fd, \"ping\");\r\n\
+		future f = read_ready(fd);\r\n\
+		yield await(f);\r\n\
+		f.release();\r\n\
+		char[] buffer = new char[16];\r\n\
+		received = fd_read(fd, buffer);\r\n\
+		return 0;\r\n\
+	}\r\n\
+	return run;\r\n\
+}\r\n\
+auto sleeper(int ms)\r\n\
+{\r\n\
+	coroutine int run(){ future t = sleep(ms); yield await(t); t.release(); timers++; return 0; }\r\n\
+	return run;\r\n\
+}\r\n\
+coroutine int waiter(){ future f = host_future(); hostFuture = f.id; yield await(f); hostValue = f.result(); f.release(); return 0; }\r\n\
+int droppedFuture = 0;\r\n\
+coroutine int dropped(){ future f = host_future(); droppedFuture = f.id; yield await(f); return 0; }\r\n\
+void drop(){ future f; f.id = droppedFuture; f.release(); }\r\n\
+void start(int a, int b)\r\n\
+{\r\n\
+	async_spawn(server(a));\r\n\
+	async_spawn(client(b));\r\n\
+	for(int i = 0; i < 1000; i++)\r\n\
+		async_spawn(sleeper(i % 10));\r\n\
+	async_spawn(waiter);\r\n\
+	async_spawn(dropped);\r\n\
+	async_run();\r\n\
+}\r\n\
+void resume(){ async_run(); }";
+
+	if(!nullcBuild(code) || !nullcRun())
+	{
+		printf("Build failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	int fds[2];
+
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+	{
+		printf("Failed to create a socket pair\r\n");
+		return false;
+	}
+
+	NULLCPreparedCall start, resume, drop, taskCount;
+
+	if(!nullcPrepareCall("start", &start) || !nullcPrepareCall("resume", &resume) || !nullcPrepareCall("drop", &drop) || !nullcPrepareCall("async_task_count", &taskCount))
+	{
+		printf("Prepare failed: %s\r\n", nullcGetLastError());
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	}
+
+	bool result = true;
+
+	if(!nullcInvokePrepared(&start, fds[0], fds[1]))
+	{
+		printf("Async run failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+	else if(*(int*)nullcGetGlobal("served") != 1 || *(int*)nullcGetGlobal("received") != 5 || *(int*)nullcGetGlobal("timers") != 1000)
+	{
+		printf("Async tasks didn't complete\r\n");
+		result = false;
+	}
+	else if(!nullcInvokePrepared(&taskCount) || nullcGetResultInt() != 2)
+	{
+		printf("Tasks waiting for the host futures should be left\r\n");
+		result = false;
+	}
+	else if(!nullcAsyncCompleteFuture(*(int*)nullcGetGlobal("hostFuture"), 42) || !nullcAsyncCompleteFuture(*(int*)nullcGetGlobal("droppedFuture"), 7))
+	{
+		printf("Failed to complete host futures\r\n");
+		result = false;
+	}
+	else if(!nullcInvokePrepared(&drop) || !nullcInvokePrepared(&resume))
+	{
+		printf("Failed to resume tasks after a future was released: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+	else if(*(long long*)nullcGetGlobal("hostValue") != 42 || nullcAsyncFutureCount() != 0)
+	{
+		printf("Host future result is incorrect\r\n");
+		result = false;
+	}
+	else if(!nullcInvokePrepared(&taskCount) || nullcGetResultInt() != 0)
+	{
+		printf("Task waiting for a released future should be dropped\r\n");
+		result = false;
+	}
+
+	if(result)
+	{
+		// Futures are kept by each context
+		nullcContext *context = nullcContextCreate();
+
+		if(!nullcContextBuild(context, "import std.async; future f = host_future(); return f.id;") || !nullcRun() || nullcGetResultInt() != 1 || nullcAsyncFutureCount() != 1)
+		{
+			printf("Future creation in a separate context failed: %s\r\n", nullcGetLastError());
+			result = false;
+		}
+
+		nullcContextMakeCurrent(NULL);
+
+		if(nullcAsyncFutureCount() != 0)
+		{
+			printf("Future of a separate context is visible in the default context\r\n");
+			result = false;
+		}
+
+		nullcContextDestroy(context);
+	}
+
+	if(result)
+	{
+		// Pending futures and timers are released when the program is replaced
+		if(!nullcBuild("import std.async; future f = host_future(); future t = sleep(100000); return 1;") || !nullcRun() || nullcAsyncFutureCount() != 2)
+		{
+			printf("Future creation before a rebuild failed: %s\r\n", nullcGetLastError());
+			result = false;
+		}
+		else if(!nullcBuild("import std.async; return async_has_pending();") || !nullcRun() || nullcGetResultInt() != 0 || nullcAsyncFutureCount() != 0)
+		{
+			printf("Futures of the old program are left after a rebuild: %s\r\n", nullcGetLastError());
+			result = false;
+		}
+	}
+
+	close(fds[0]);
+	close(fds[1]);
+
+	return result;
+#else
+	return true;
+#endif
+}
+
+FastVector<char> snapshotTestFile;
+
+int SnapshotTestFileSave(const char* name, const char* data, unsigned size)
+{
+	if(strcmp(name, "snapshot_memory.bin") != 0)
+		return 0;
+
+	snapshotTestFile.clear();
+	snapshotTestFile.push_back(data, size);
+
+	return 1;
+}
+
+const char* SnapshotTestFileLoad(const char* name, unsigned* size)
+{
+	if(strcmp(name, "snapshot_memory.bin") != 0)
+		return Tests::fileLoadFunc(name, size);
+
+	*size = snapshotTestFile.size();
+
+	return snapshotTestFile.data;
+}
+
+void SnapshotTestFileFree(const char* data)
+{
+	if(data != snapshotTestFile.data)
+		Tests::fileFreeFunc(data);
+}
+
+bool RunSnapshotTest()
+{
+	const char *code =
+"class Node{ int value; Node ref next; }\r\n\
+Node ref list;\r\n\
+int[] table = new int[1000];\r\n\
+int ref middle = &table[10];\r\n\
+char[] name = \"snap\" + \"shot\";\r\n\
+auto ref boxed = new int(7);\r\n\
+int ref(int) adder;\r\n\
+int initCount = 0;\r\n\
+int ref counter = &initCount;\r\n\
+{\r\n\
+	for(int i = 0; i < 1000; i++)\r\n\
+		table[i] = i * i;\r\n\
+	for(int i = 0; i < 5; i++)\r\n\
+	{\r\n\
+		Node ref n = new Node;\r\n\
+		n.value = i;\r\n\
+		n.next = list;\r\n\
+		list = n;\r\n\
+	}\r\n\
+	int base = 100;\r\n\
+	int add(int x){ return x + base; }\r\n\
+	adder = add;\r\n\
+	*counter += 1;\r\n\
+}\r\n\
+int check()\r\n\
+{\r\n\
+	int sum = 0;\r\n\
+	for(Node ref n = list; n; n = n.next)\r\n\
+		sum += n.value;\r\n\
+	return sum == 10 && table[999] == 998001 && *middle == 100 && name == \"snapshot\" && int(boxed) == 7 && adder(1) == 101 && initCount == 1;\r\n\
+}\r\n\
+int churn()\r\n\
+{\r\n\
+	for(int i = 0; i < 1000; i++)\r\n\
+		int[] garbage = new int[16384];\r\n\
+	return check();\r\n\
+}";
+
+	if(!nullcBuild(code) || !nullcRun())
+	{
+		printf("Build failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	if(!nullcSaveSnapshot("snapshot_test.bin"))
+	{
+		printf("Snapshot save failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	// Replace the program before restoring it
+	if(!nullcBuild("int check(){ return 0; }") || !nullcRun())
+	{
+		printf("Build failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	if(!nullcLoadSnapshot("snapshot_test.bin"))
+	{
+		printf("Snapshot load failed: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	if(!nullcRunFunction("check") || nullcGetResultInt() != 1)
+	{
+		printf("Restored program state is incorrect: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	// Restored objects are owned by the garbage collector
+	if(!nullcRunFunction("churn") || nullcGetResultInt() != 1)
+	{
+		printf("Restored program state is incorrect after garbage collection: %s\r\n", nullcGetLastError());
+		return false;
+	}
+
+	bool result = true;
+
+	// Snapshot can be loaded into a different context
+	nullcContext *context = nullcContextCreate();
+
+	nullcContextMakeCurrent(context);
+
+	if(!nullcLoadSnapshot("snapshot_test.bin") || !nullcRunFunction("check") || nullcGetResultInt() != 1)
+	{
+		printf("Snapshot load into a new context failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	nullcContextDestroy(context);
+
+	if(FILE *file = fopen("snapshot_test.bin", "wb"))
+	{
+		fprintf(file, "%s", code);
+		fclose(file);
+	}
+
+	if(result && (nullcLoadSnapshot("snapshot_test.bin") || !strstr(nullcGetLastError(), "not a snapshot")))
+	{
+		printf("Loading a file that is not a snapshot should fail\r\n");
+		result = false;
+	}
+
+	remove("snapshot_test.bin");
+
+	// Snapshot is saved and loaded through the host file handlers
+	nullcSetFileWriteHandler(SnapshotTestFileSave);
+	nullcSetFileReadHandler(SnapshotTestFileLoad, SnapshotTestFileFree);
+
+	if(result && (!nullcBuild("int x = 5; int check(){ return x == 5; }") || !nullcRun() || !nullcSaveSnapshot("snapshot_memory.bin")))
+	{
+		printf("Snapshot save through a file handler failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	if(result && (!nullcLoadSnapshot("snapshot_memory.bin") || !nullcRunFunction("check") || nullcGetResultInt() != 1))
+	{
+		printf("Snapshot load through a file handler failed: %s\r\n", nullcGetLastError());
+		result = false;
+	}
+
+	nullcSetFileWriteHandler(NULL);
+	nullcSetFileReadHandler(Tests::fileLoadFunc, Tests::fileFreeFunc);
+
+	snapshotTestFile.reset();
+
+	// Bytecode is not kept for programs linked without snapshots
+	nullcSetEnableSnapshots(0);
+
+	if(result && (!nullcBuild("int x = 5;") || !nullcRun() || nullcSaveSnapshot("snapshot_test.bin") || !strstr(nullcGetLastError(), "snapshots were not enabled")))
+	{
+		printf("Snapshot save should fail when snapshots are disabled\r\n");
+		result = false;
+	}
+
+	return result;
+}
+
+void RunInterfaceTests()
+{
+	if(Tests::messageVerbose)
+		printf("Two bytecode merge test 1\r\n");
+
+	const char *partA1 = "int a = 5;\r\nint c = 8;\r\nint test(int ref a, int b)\r\n{\r\n\treturn *a += b;\r\n}\r\ntest(&a, 4);\r\nint run(){ test(&a, 4); return c; }\r\n";
+	const char *partB1 = "int aa = 15;\r\nint testA(int ref a, int b)\r\n{\r\n\treturn *a += b + 1;\r\n}\r\ntestA(&aa, 5);\r\nvoid runA(){ testA(&aa, 5); }\r\nreturn aa;\r\n";
+
+	{
+		char *bytecodeA, *bytecodeB;
+		bytecodeA = NULL;
+		bytecodeB = NULL;
+
+		for(int t = 0; t < TEST_TARGET_COUNT; t++)
+		{
+			if(!Tests::testExecutor[t])
+				continue;
+			testsCount[t]++;
+			nullcSetExecutor(testTarget[t]);
+
+			nullres good = nullcCompile(partA1);
+			nullcSaveListing(FILE_PATH "asm.txt");
+			if(!good)
+			{
+				if(!Tests::messageVerbose)
+					printf("Two bytecode merge test 1\r\n");
+				printf("Compilation failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+			else
+			{
+				nullcGetBytecode(&bytecodeA);
+			}
+
+			good = nullcCompile(partB1);
+			nullcSaveListing(FILE_PATH "asm.txt");
+			if(!good)
+			{
+				if(!Tests::messageVerbose)
+					printf("Two bytecode merge test 1\r\n");
+				printf("Compilation failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+			else
+			{
+				nullcGetBytecode(&bytecodeB);
+			}
+
+			remove(FILE_PATH "asm.txt");
+
+			nullcClean();
+			if(!nullcLinkCode(bytecodeA))
+			{
+				if(!Tests::messageVerbose)
+					printf("Two bytecode merge test 1\r\n");
+				printf("Compilation failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+			if(!nullcLinkCode(bytecodeB))
+			{
+				if(!Tests::messageVerbose)
+					printf("Two bytecode merge test 1\r\n");
+				printf("Compilation failed: %s\r\n", nullcGetLastError());
+				break;
+			}
+			delete[] bytecodeA;
+			delete[] bytecodeB;
+
+			if(!nullcRunFunction(NULL))
+			{
+				if(!Tests::messageVerbose)
+					printf("Two bytecode merge test 1\r\n");
+				printf("Execution failed: %s\r\n", nullcGetLastError());
+			}
+			else
+			{
+				int* val = (int*)nullcGetGlobal("c");
+				if(*val != 8)
+				{
+					if(!Tests::messageVerbose)
+						printf("Two bytecode merge test 1\r\n");
+					printf("nullcGetGlobal failed\r\n");
+					continue;
+				}
+				int n = 45;
+				nullcSetGlobal("c", &n);
+				if(!nullcRunFunction("run"))
+				{
+					if(!Tests::messageVerbose)
+						printf("Two bytecode merge test 1\r\n");
+					printf("Execution failed: %s\r\n", nullcGetLastError());
+				}
+				else
+				{
+					if(nullcGetResultInt() != n)
+					{
+						if(!Tests::messageVerbose)
+							printf("Two bytecode merge test 1\r\n");
+						printf("nullcSetGlobal failed\r\n");
+						continue;
+					}
+					if(!nullcRunFunction("runA"))
+					{
+						if(!Tests::messageVerbose)
+							printf("Two bytecode merge test 1\r\n");
+						printf("Execution failed: %s\r\n", nullcGetLastError());
+					}
+					else
+					{
+						Tests::varData = (char*)nullcGetVariableData(NULL);
+						Tests::varInfo = nullcDebugVariableInfo(&Tests::variableCount);
+						Tests::symbols = nullcDebugSymbols(NULL);
+
+						if(Tests::varInfo)
+						{
+							bool lastFailed = false;
+							CHECK_INT("a", 0, 13, lastFailed);
+							CHECK_INT("aa", 0, 27, lastFailed);
+							if(!lastFailed)
+								testsPassed[t]++;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	{
+		if(Tests::messageVerbose)
+			printf("Function update test\r\n");
+
+		const char *partA = "int foo(){ return 15; }";
+		const char *partB = "import __last; import std.dynamic; int new_foo(){ return 25; } void foo_update(){ override(foo, new_foo); }\r\n";
+		
+		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
+		(void)x86Passed;
+		for(int t = 0; t < TEST_TARGET_COUNT; t++)
+		{
+			if(!Tests::testExecutor[t])
+				continue;
+			testsCount[t]++;
+			nullcSetExecutor(testTarget[t]);
+
+			char *bytecodeA = NULL, *bytecodeB = NULL;
+
+			nullres good = nullcCompile(partA);
+			if(!good)
+			{
+				printf("Compilation failed: %s\r\n", nullcGetLastError());
+				continue;
+			}else{
+				nullcGetBytecode(&bytecodeA);
+			}
+
+			nullcClean();
+			if(!nullcLinkCode(bytecodeA))
+			{
+				printf("Compilation failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+			delete[] bytecodeA;
+
+			if(!nullcRunFunction(NULL))
+			{
+				printf("Execution failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+			if(!nullcRunFunction("foo"))
+			{
+				printf("Execution failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+			if(nullcGetResultInt() != 15)
+			{
+				printf("original foo failed to return 15\r\n");
+				continue;
+			}
+
+			if(!nullcCompile(partB))
+			{
+				printf("%s", nullcGetLastError());
+				continue;
+			}
+			nullcGetBytecodeNoCache(&bytecodeB);
+			if(!nullcLinkCode(bytecodeB))
+			{
+				delete[] bytecodeB;
+				printf("%s", nullcGetLastError());
+				continue;
+			}
+			delete[] bytecodeB;
+
+			if(!nullcRunFunction("foo_update"))
+			{
+				printf("foo_update Execution failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+
+			if(!nullcRunFunction("foo"))
+			{
+				printf("foo Execution failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+			if(nullcGetResultInt() != 25)
+			{
+				printf("new foo failed to return 25\r\n");
+				continue;
+			}
+			testsPassed[t]++;
+		}
+		if(regVmPassed + 1 != testsPassed[NULLC_REG_VM])
+			printf("REGVM failed test: Function update test\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Function update test\r\n");
+	}
+
+	{
+		if(Tests::messageVerbose)
+			printf("Function update test 2\r\n");
+
+		const char *partA = "int foo(){ return 15; }";
+		const char *partB = "int new_foo(){ return 25; }\r\n";
+
+		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
+		(void)x86Passed;
+		for(int t = 0; t < TEST_TARGET_COUNT; t++)
+		{
+			if(!Tests::testExecutor[t])
+				continue;
+			testsCount[t]++;
+			nullcSetExecutor(testTarget[t]);
+
+			char *bytecodeA = NULL, *bytecodeB = NULL;
+
+			nullres good = nullcCompile(partA);
+			if(!good)
+			{
+				printf("Compilation failed: %s\r\n", nullcGetLastError());
+				continue;
+			}else{
+				nullcGetBytecode(&bytecodeA);
+			}
+
+			nullcClean();
+			if(!nullcLinkCode(bytecodeA))
+			{
+				printf("Compilation failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+			delete[] bytecodeA;
+
+			if(!nullcRunFunction(NULL))
+			{
+				printf("Execution failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+			if(!nullcRunFunction("foo"))
+			{
+				printf("Execution failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+			if(nullcGetResultInt() != 15)
+			{
+				printf("original foo failed to return 15\r\n");
+				continue;
+			}
+
+			if(!nullcCompile(partB))
+			{
+				printf("%s", nullcGetLastError());
+				continue;
+			}
+			nullcGetBytecode(&bytecodeB);
+			if(!nullcLinkCode(bytecodeB))
+			{
+				delete[] bytecodeB;
+				printf("%s", nullcGetLastError());
+				continue;
+			}
+			delete[] bytecodeB;
+
+			NULLCFuncPtr fooOld;
+			NULLCFuncPtr fooNew;
+			if(!nullcGetFunction("foo", &fooOld))
+			{
+				printf("nullcGetFunction(foo) failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+			if(!nullcGetFunction("new_foo", &fooNew))
+			{
+				printf("nullcGetFunction(new_foo) failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+			if(!nullcSetFunction("foo", fooNew))
+			{
+				printf("nullcSetFunction(foo) failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+
+			if(!nullcRunFunction("foo"))
+			{
+				printf("foo Execution failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+			if(nullcGetResultInt() != 25)
+			{
+				printf("new foo failed to return 25\r\n");
+				continue;
+			}
+			testsPassed[t]++;
+			testsCount[t]++;
+			if(!nullcCallFunction(fooOld))
+			{
+				printf("foo Execution failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+			if(nullcGetResultInt() != 25)
+			{
+				printf("new foo failed to return 25\r\n");
+				continue;
+			}
+			testsPassed[t]++;
+		}
+		if(regVmPassed + 2 != testsPassed[NULLC_REG_VM])
+			printf("REGVM failed test: Function update test 2\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 2 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Function update test 2\r\n");
+	}
+
+	{
+		if(Tests::messageVerbose)
+			printf("Value pass through nullcRunFunction\r\n");
+
+		const char *code = "int Char(char x){ return -x*2; } int Short(short x){ return -x*3; } int Int(int x){ return -x*4; } int Long(long x){ return -x*5; } int Float(float x){ return -x*6; } int Double(double x){ return -x*7; } int Ptr(int ref x){ return -*x; }";
+
+		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
+		(void)x86Passed;
+		for(int t = 0; t < TEST_TARGET_COUNT; t++)
+		{
+			if(!Tests::testExecutor[t])
+				continue;
+			testsCount[t]++;
+			nullcSetExecutor(testTarget[t]);
+
+			nullres good = nullcBuild(code);
+			if(!good)
+			{
+				printf("Build failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+#define TEST_CALL(name, arg, expected)\
+			if(!nullcRunFunction(name, arg)){ printf("nullcRunFunction(" name ") failed: %s\r\n", nullcGetLastError()); continue; }\
+			if(nullcGetResultInt() != expected){ printf("nullcGetResultInt failed to return " #expected " result\r\n"); continue; }
+
+			TEST_CALL("Char", 12, -12*2);
+			TEST_CALL("Short", 13, -13*3);
+			TEST_CALL("Int", 14, -14*4);
+			TEST_CALL("Long", 15LL, -15*5LL);
+			TEST_CALL("Float", 4.0f, -4.0f*6.0f);
+			TEST_CALL("Double", 5.0f, -5.0*7.0);
+
+			int ptrTest = 88;
+			TEST_CALL("Ptr", &ptrTest, -88);
+
+			testsPassed[t]++;
+		}
+		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
+			printf("REGVM failed test: Value pass through nullcCallFunction\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Value pass through nullcCallFunction\r\n");
+	}
+	{
+		if(Tests::messageVerbose)
+			printf("Structure pass through nullcRunFunction\r\n");
+
+		const char *code = "int foo(int[] arr){ return arr[0] + arr.size; } int NULLCRef(auto ref x){ return -int(x); } int bar(){ return 127; } int NULLCFunc(int ref() x){ return x(); } int NULLCArray(auto[] arr){ return int(arr[0]); }";
+
+		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
+		(void)x86Passed;
+		for(int t = 0; t < TEST_TARGET_COUNT; t++)
+		{
+			if(!Tests::testExecutor[t])
+				continue;
+			testsCount[t]++;
+			nullcSetExecutor(testTarget[t]);
+
+			nullres good = nullcBuild(code);
+			if(!good)
+			{
+				printf("Build failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+
+			int x = 50;
+			NULLCArray arr = { (char*)&x, 1 };
+			TEST_CALL("foo", arr, 51);
+
+			x = 14;
+			NULLCRef ref = { 4, (char*)&x };
+			TEST_CALL("NULLCRef", ref, -14);
+
+			NULLCFuncPtr fPtr;
+			if(!nullcGetFunction("bar", &fPtr))
+			{
+				printf("Unable to get 'bar' function: %s\r\n", nullcGetLastError());
+				continue;
+			}
+			TEST_CALL("NULLCFunc", fPtr, 127);
+
+			x = 77;
+			NULLCAutoArray autoArr = { 4, (char*)&x, 1 };
+			TEST_CALL("NULLCArray", autoArr, 77);
+			
+			testsPassed[t]++;
+		}
+		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
+			printf("REGVM failed test: Structure pass through nullcCallFunction\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Structure pass through nullcCallFunction\r\n");
+	}
+	{
+		if(Tests::messageVerbose)
+			printf("Independent execution contexts\r\n");
+
+		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
+		(void)x86Passed;
+		for(int t = 0; t < TEST_TARGET_COUNT; t++)
+		{
+			if(!Tests::testExecutor[t])
+				continue;
+			testsCount[t]++;
+			nullcSetExecutor(testTarget[t]);
+
+			if(!RunExecutionContextTest())
+				continue;
+
+			nullres good = nullcBuild("return 3;");
+			if(!good || !nullcRun() || nullcGetResultInt() != 3)
+			{
+				printf("Default context failed: %s\r\n", nullcGetLastError());
+				continue;
+			}
+
+			testsPassed[t]++;
+		}
+		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
+			printf("REGVM failed test: Independent execution contexts\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Independent execution contexts\r\n");
+	}
+	{
+		if(Tests::messageVerbose)
+			printf("Execution contexts on different threads\r\n");
+
+		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
+		(void)x86Passed;
+		for(int t = 0; t < TEST_TARGET_COUNT; t++)
+		{
+			if(!Tests::testExecutor[t])
+				continue;
+			testsCount[t]++;
+			nullcSetExecutor(testTarget[t]);
+
+			if(!RunConcurrentContextTest())
+				continue;
+
+			testsPassed[t]++;
+		}
+		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
+			printf("REGVM failed test: Execution contexts on different threads\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Execution contexts on different threads\r\n");
+	}
+	{
+		if(Tests::messageVerbose)
+			printf("Execution contexts from a program image\r\n");
+
+		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
+		(void)x86Passed;
+		for(int t = 0; t < TEST_TARGET_COUNT; t++)
+		{
+			if(!Tests::testExecutor[t])
+				continue;
+			testsCount[t]++;
+			nullcSetExecutor(testTarget[t]);
+
+			if(!RunProgramImageTest())
+				continue;
+
+			testsPassed[t]++;
+		}
+		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
+			printf("REGVM failed test: Execution contexts from a program image\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Execution contexts from a program image\r\n");
 	}
+	{
+		if(Tests::messageVerbose)
+			printf("Prepared function calls\r\n");
 
-void RunInterfaceTests()
-{
-	if(Tests::messageVerbose)
-		printf("Two bytecode merge test 1\r\n");
+		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
+		(void)x86Passed;
+		for(int t = 0; t < TEST_TARGET_COUNT; t++)
+		{
+			if(!Tests::testExecutor[t])
+				continue;
+			testsCount[t]++;
+			nullcSetExecutor(testTarget[t]);
 
-	const char *partA1 = "int a = 5;\r\nint c = 8;\r\nint test(int ref a, int b)\r\n{\r\n\treturn *a += b;\r\n}\r\ntest(&a, 4);\r\nint run(){ test(&a, 4); return c; }\r\n";
-	const char *partB1 = "int aa = 15;\r\nint testA(int ref a, int b)\r\n{\r\n\treturn *a += b + 1;\r\n}\r\ntestA(&aa, 5);\r\nvoid runA(){ testA(&aa, 5); }\r\nreturn aa;\r\n";
+			if(!RunPreparedCallTest())
+				continue;
 
+			testsPassed[t]++;
+		}
+		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
+			printf("REGVM failed test: Prepared function calls\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Prepared function calls\r\n");
+	}
 	{
-		char *bytecodeA, *bytecodeB;
-		bytecodeA = NULL;
-		bytecodeB = NULL;
+		if(Tests::messageVerbose)
+			printf("Batched prepared function calls\r\n");
 
+		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
+		(void)x86Passed;
 		for(int t = 0; t < TEST_TARGET_COUNT; t++)
 		{
 			if(!Tests::testExecutor[t])
@@ -45,120 +2260,43 @@ void RunInterfaceTests()
 			testsCount[t]++;
 			nullcSetExecutor(testTarget[t]);
 
-			nullres good = nullcCompile(partA1);
-			nullcSaveListing(FILE_PATH "asm.txt");
-			if(!good)
-			{
-				if(!Tests::messageVerbose)
-					printf("Two bytecode merge test 1\r\n");
-				printf("Compilation failed: %s\r\n", nullcGetLastError());
-				continue;
-			}
-			else
-			{
-				nullcGetBytecode(&bytecodeA);
-			}
-
-			good = nullcCompile(partB1);
-			nullcSaveListing(FILE_PATH "asm.txt");
-			if(!good)
-			{
-				if(!Tests::messageVerbose)
-					printf("Two bytecode merge test 1\r\n");
-				printf("Compilation failed: %s\r\n", nullcGetLastError());
+			if(!RunPreparedBatchTest())
 				continue;
-			}
-			else
-			{
-				nullcGetBytecode(&bytecodeB);
-			}
 
-			remove(FILE_PATH "asm.txt");
+			testsPassed[t]++;
+		}
+		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
+			printf("REGVM failed test: Batched prepared function calls\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Batched prepared function calls\r\n");
+	}
+	{
+		if(Tests::messageVerbose)
+			printf("Execution budget\r\n");
 
-			nullcClean();
-			if(!nullcLinkCode(bytecodeA))
-			{
-				if(!Tests::messageVerbose)
-					printf("Two bytecode merge test 1\r\n");
-				printf("Compilation failed: %s\r\n", nullcGetLastError());
+		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
+		(void)x86Passed;
+		for(int t = 0; t < TEST_TARGET_COUNT; t++)
+		{
+			if(!Tests::testExecutor[t])
 				continue;
-			}
-			if(!nullcLinkCode(bytecodeB))
-			{
-				if(!Tests::messageVerbose)
-					printf("Two bytecode merge test 1\r\n");
-				printf("Compilation failed: %s\r\n", nullcGetLastError());
-				break;
-			}
-			delete[] bytecodeA;
-			delete[] bytecodeB;
+			testsCount[t]++;
+			nullcSetExecutor(testTarget[t]);
 
-			if(!nullcRunFunction(NULL))
-			{
-				if(!Tests::messageVerbose)
-					printf("Two bytecode merge test 1\r\n");
-				printf("Execution failed: %s\r\n", nullcGetLastError());
-			}
-			else
-			{
-				int* val = (int*)nullcGetGlobal("c");
-				if(*val != 8)
-				{
-					if(!Tests::messageVerbose)
-						printf("Two bytecode merge test 1\r\n");
-					printf("nullcGetGlobal failed\r\n");
-					continue;
-				}
-				int n = 45;
-				nullcSetGlobal("c", &n);
-				if(!nullcRunFunction("run"))
-				{
-					if(!Tests::messageVerbose)
-						printf("Two bytecode merge test 1\r\n");
-					printf("Execution failed: %s\r\n", nullcGetLastError());
-				}
-				else
-				{
-					if(nullcGetResultInt() != n)
-					{
-						if(!Tests::messageVerbose)
-							printf("Two bytecode merge test 1\r\n");
-						printf("nullcSetGlobal failed\r\n");
-						continue;
-					}
-					if(!nullcRunFunction("runA"))
-					{
-						if(!Tests::messageVerbose)
-							printf("Two bytecode merge test 1\r\n");
-						printf("Execution failed: %s\r\n", nullcGetLastError());
-					}
-					else
-					{
-						Tests::varData = (char*)nullcGetVariableData(NULL);
-						Tests::varInfo = nullcDebugVariableInfo(&Tests::variableCount);
-						Tests::symbols = nullcDebugSymbols(NULL);
+			if(!RunExecutionBudgetTest())
+				continue;
 
-						if(Tests::varInfo)
-						{
-							bool lastFailed = false;
-							CHECK_INT("a", 0, 13, lastFailed);
-							CHECK_INT("aa", 0, 27, lastFailed);
-							if(!lastFailed)
-								testsPassed[t]++;
-						}
-					}
-				}
-			}
+			testsPassed[t]++;
 		}
+		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
+			printf("REGVM failed test: Execution budget\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Execution budget\r\n");
 	}
-
 	{
 		if(Tests::messageVerbose)
-			printf("Function update test\r\n");
+			printf("Persistent module cache\r\n");
 
-		const char *partA = "int foo(){ return 15; }";
-		const char *partB = "import __last; import std.dynamic; int new_foo(){ return 25; } void foo_update(){ override(foo, new_foo); }\r\n";
-		
 		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
 		(void)x86Passed;
 		for(int t = 0; t < TEST_TARGET_COUNT; t++)
@@ -168,85 +2306,111 @@ void RunInterfaceTests()
 			testsCount[t]++;
 			nullcSetExecutor(testTarget[t]);
 
-			char *bytecodeA = NULL, *bytecodeB = NULL;
+			if(!RunModuleCacheTest())
+				continue;
 
-			nullres good = nullcCompile(partA);
-			if(!good)
-			{
-				printf("Compilation failed: %s\r\n", nullcGetLastError());
+			testsPassed[t]++;
+		}
+		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
+			printf("REGVM failed test: Persistent module cache\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Persistent module cache\r\n");
+	}
+	{
+		if(Tests::messageVerbose)
+			printf("Memory-mapped module pack\r\n");
+
+		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
+		(void)x86Passed;
+		for(int t = 0; t < TEST_TARGET_COUNT; t++)
+		{
+			if(!Tests::testExecutor[t])
 				continue;
-			}else{
-				nullcGetBytecode(&bytecodeA);
-			}
+			testsCount[t]++;
+			nullcSetExecutor(testTarget[t]);
 
-			nullcClean();
-			if(!nullcLinkCode(bytecodeA))
-			{
-				printf("Compilation failed: %s\r\n", nullcGetLastError());
+			if(!RunModulePackTest())
 				continue;
-			}
-			delete[] bytecodeA;
 
-			if(!nullcRunFunction(NULL))
-			{
-				printf("Execution failed: %s\r\n", nullcGetLastError());
+			testsPassed[t]++;
+		}
+		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
+			printf("REGVM failed test: Memory-mapped module pack\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Memory-mapped module pack\r\n");
+	}
+	{
+		if(Tests::messageVerbose)
+			printf("Concurrent import build\r\n");
+
+		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
+		(void)x86Passed;
+		for(int t = 0; t < TEST_TARGET_COUNT; t++)
+		{
+			if(!Tests::testExecutor[t])
 				continue;
-			}
-			if(!nullcRunFunction("foo"))
-			{
-				printf("Execution failed: %s\r\n", nullcGetLastError());
+			testsCount[t]++;
+			nullcSetExecutor(testTarget[t]);
+
+			if(!RunModuleBuildThreadsTest())
 				continue;
-			}
-			if(nullcGetResultInt() != 15)
-			{
-				printf("original foo failed to return 15\r\n");
+
+			testsPassed[t]++;
+		}
+		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
+			printf("REGVM failed test: Concurrent import build\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Concurrent import build\r\n");
+	}
+	{
+		if(Tests::messageVerbose)
+			printf("Generic member function instance import\r\n");
+
+		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
+		(void)x86Passed;
+		for(int t = 0; t < TEST_TARGET_COUNT; t++)
+		{
+			if(!Tests::testExecutor[t])
 				continue;
-			}
+			testsCount[t]++;
+			nullcSetExecutor(testTarget[t]);
 
-			if(!nullcCompile(partB))
-			{
-				printf("%s", nullcGetLastError());
+			if(!RunGenericInstanceImportTest())
 				continue;
-			}
-			nullcGetBytecodeNoCache(&bytecodeB);
-			if(!nullcLinkCode(bytecodeB))
-			{
-				delete[] bytecodeB;
-				printf("%s", nullcGetLastError());
+
+			testsPassed[t]++;
+		}
+		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
+			printf("REGVM failed test: Generic member function instance import\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Generic member function instance import\r\n");
+	}
+	{
+		if(Tests::messageVerbose)
+			printf("Generic function instance deduplication\r\n");
+
+		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
+		(void)x86Passed;
+		for(int t = 0; t < TEST_TARGET_COUNT; t++)
+		{
+			if(!Tests::testExecutor[t])
 				continue;
-			}
-			delete[] bytecodeB;
+			testsCount[t]++;
+			nullcSetExecutor(testTarget[t]);
 
-			if(!nullcRunFunction("foo_update"))
-			{
-				printf("foo_update Execution failed: %s\r\n", nullcGetLastError());
+			if(!RunGenericInstanceDeduplicationTest())
 				continue;
-			}
 
-			if(!nullcRunFunction("foo"))
-			{
-				printf("foo Execution failed: %s\r\n", nullcGetLastError());
-				continue;
-			}
-			if(nullcGetResultInt() != 25)
-			{
-				printf("new foo failed to return 25\r\n");
-				continue;
-			}
 			testsPassed[t]++;
 		}
-		if(regVmPassed + 1 != testsPassed[NULLC_REG_VM])
-			printf("REGVM failed test: Function update test\r\n");
+		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
+			printf("REGVM failed test: Generic function instance deduplication\r\n");
 		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
-			printf("X86 failed test: Function update test\r\n");
+			printf("X86 failed test: Generic function instance deduplication\r\n");
 	}
-
 	{
 		if(Tests::messageVerbose)
-			printf("Function update test 2\r\n");
-
-		const char *partA = "int foo(){ return 15; }";
-		const char *partB = "int new_foo(){ return 25; }\r\n";
+			printf("Memory quota\r\n");
 
 		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
 		(void)x86Passed;
@@ -257,108 +2421,65 @@ void RunInterfaceTests()
 			testsCount[t]++;
 			nullcSetExecutor(testTarget[t]);
 
-			char *bytecodeA = NULL, *bytecodeB = NULL;
-
-			nullres good = nullcCompile(partA);
-			if(!good)
-			{
-				printf("Compilation failed: %s\r\n", nullcGetLastError());
+			if(!RunMemoryQuotaTest())
 				continue;
-			}else{
-				nullcGetBytecode(&bytecodeA);
-			}
 
-			nullcClean();
-			if(!nullcLinkCode(bytecodeA))
-			{
-				printf("Compilation failed: %s\r\n", nullcGetLastError());
-				continue;
-			}
-			delete[] bytecodeA;
+			testsPassed[t]++;
+		}
+		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
+			printf("REGVM failed test: Memory quota\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Memory quota\r\n");
+	}
+	{
+		if(Tests::messageVerbose)
+			printf("Analysis cancellation\r\n");
 
-			if(!nullcRunFunction(NULL))
-			{
-				printf("Execution failed: %s\r\n", nullcGetLastError());
-				continue;
-			}
-			if(!nullcRunFunction("foo"))
-			{
-				printf("Execution failed: %s\r\n", nullcGetLastError());
-				continue;
-			}
-			if(nullcGetResultInt() != 15)
-			{
-				printf("original foo failed to return 15\r\n");
+		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
+		(void)x86Passed;
+		for(int t = 0; t < TEST_TARGET_COUNT; t++)
+		{
+			if(!Tests::testExecutor[t])
 				continue;
-			}
+			testsCount[t]++;
+			nullcSetExecutor(testTarget[t]);
 
-			if(!nullcCompile(partB))
-			{
-				printf("%s", nullcGetLastError());
-				continue;
-			}
-			nullcGetBytecode(&bytecodeB);
-			if(!nullcLinkCode(bytecodeB))
-			{
-				delete[] bytecodeB;
-				printf("%s", nullcGetLastError());
+			if(!RunAnalyzeCancellationTest())
 				continue;
-			}
-			delete[] bytecodeB;
 
-			NULLCFuncPtr fooOld;
-			NULLCFuncPtr fooNew;
-			if(!nullcGetFunction("foo", &fooOld))
-			{
-				printf("nullcGetFunction(foo) failed: %s\r\n", nullcGetLastError());
-				continue;
-			}
-			if(!nullcGetFunction("new_foo", &fooNew))
-			{
-				printf("nullcGetFunction(new_foo) failed: %s\r\n", nullcGetLastError());
-				continue;
-			}
-			if(!nullcSetFunction("foo", fooNew))
-			{
-				printf("nullcSetFunction(foo) failed: %s\r\n", nullcGetLastError());
-				continue;
-			}
+			testsPassed[t]++;
+		}
+		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
+			printf("REGVM failed test: Analysis cancellation\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Analysis cancellation\r\n");
+	}
+	{
+		if(Tests::messageVerbose)
+			printf("Compiler memory retention\r\n");
 
-			if(!nullcRunFunction("foo"))
-			{
-				printf("foo Execution failed: %s\r\n", nullcGetLastError());
-				continue;
-			}
-			if(nullcGetResultInt() != 25)
-			{
-				printf("new foo failed to return 25\r\n");
+		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
+		(void)x86Passed;
+		for(int t = 0; t < TEST_TARGET_COUNT; t++)
+		{
+			if(!Tests::testExecutor[t])
 				continue;
-			}
-			testsPassed[t]++;
 			testsCount[t]++;
-			if(!nullcCallFunction(fooOld))
-			{
-				printf("foo Execution failed: %s\r\n", nullcGetLastError());
-				continue;
-			}
-			if(nullcGetResultInt() != 25)
-			{
-				printf("new foo failed to return 25\r\n");
+			nullcSetExecutor(testTarget[t]);
+
+			if(!RunCompilerMemoryRetentionTest())
 				continue;
-			}
+
 			testsPassed[t]++;
 		}
-		if(regVmPassed + 2 != testsPassed[NULLC_REG_VM])
-			printf("REGVM failed test: Function update test 2\r\n");
-		if(Tests::testExecutor[NULLC_X86] && x86Passed + 2 != testsPassed[NULLC_X86])
-			printf("X86 failed test: Function update test 2\r\n");
+		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
+			printf("REGVM failed test: Compiler memory retention\r\n");
+		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
+			printf("X86 failed test: Compiler memory retention\r\n");
 	}
-
 	{
 		if(Tests::messageVerbose)
-			printf("Value pass through nullcRunFunction\r\n");
-
-		const char *code = "int Char(char x){ return -x*2; } int Short(short x){ return -x*3; } int Int(int x){ return -x*4; } int Long(long x){ return -x*5; } int Float(float x){ return -x*6; } int Double(double x){ return -x*7; } int Ptr(int ref x){ return -*x; }";
+			printf("Asynchronous tasks waiting for fds, timers and host futures\r\n");
 
 		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
 		(void)x86Passed;
@@ -369,38 +2490,19 @@ void RunInterfaceTests()
 			testsCount[t]++;
 			nullcSetExecutor(testTarget[t]);
 
-			nullres good = nullcBuild(code);
-			if(!good)
-			{
-				printf("Build failed: %s\r\n", nullcGetLastError());
+			if(!RunAsyncTest())
 				continue;
-			}
-#define TEST_CALL(name, arg, expected)\
-			if(!nullcRunFunction(name, arg)){ printf("nullcRunFunction(" name ") failed: %s\r\n", nullcGetLastError()); continue; }\
-			if(nullcGetResultInt() != expected){ printf("nullcGetResultInt failed to return " #expected " result\r\n"); continue; }
-
-			TEST_CALL("Char", 12, -12*2);
-			TEST_CALL("Short", 13, -13*3);
-			TEST_CALL("Int", 14, -14*4);
-			TEST_CALL("Long", 15LL, -15*5LL);
-			TEST_CALL("Float", 4.0f, -4.0f*6.0f);
-			TEST_CALL("Double", 5.0f, -5.0*7.0);
-
-			int ptrTest = 88;
-			TEST_CALL("Ptr", &ptrTest, -88);
 
 			testsPassed[t]++;
 		}
 		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
-			printf("REGVM failed test: Value pass through nullcCallFunction\r\n");
+			printf("REGVM failed test: Asynchronous tasks waiting for fds, timers and host futures\r\n");
 		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
-			printf("X86 failed test: Value pass through nullcCallFunction\r\n");
+			printf("X86 failed test: Asynchronous tasks waiting for fds, timers and host futures\r\n");
 	}
 	{
 		if(Tests::messageVerbose)
-			printf("Structure pass through nullcRunFunction\r\n");
-
-		const char *code = "int foo(int[] arr){ return arr[0] + arr.size; } int NULLCRef(auto ref x){ return -int(x); } int bar(){ return 127; } int NULLCFunc(int ref() x){ return x(); } int NULLCArray(auto[] arr){ return int(arr[0]); }";
+			printf("Program snapshot save and restore\r\n");
 
 		int regVmPassed = testsPassed[TEST_TYPE_REGVM], x86Passed = testsPassed[TEST_TYPE_X86];
 		(void)x86Passed;
@@ -411,39 +2513,21 @@ void RunInterfaceTests()
 			testsCount[t]++;
 			nullcSetExecutor(testTarget[t]);
 
-			nullres good = nullcBuild(code);
-			if(!good)
-			{
-				printf("Build failed: %s\r\n", nullcGetLastError());
-				continue;
-			}
+			nullcSetEnableSnapshots(1);
 
-			int x = 50;
-			NULLCArray arr = { (char*)&x, 1 };
-			TEST_CALL("foo", arr, 51);
+			bool passed = RunSnapshotTest();
 
-			x = 14;
-			NULLCRef ref = { 4, (char*)&x };
-			TEST_CALL("NULLCRef", ref, -14);
+			nullcSetEnableSnapshots(0);
 
-			NULLCFuncPtr fPtr;
-			if(!nullcGetFunction("bar", &fPtr))
-			{
-				printf("Unable to get 'bar' function: %s\r\n", nullcGetLastError());
+			if(!passed)
 				continue;
-			}
-			TEST_CALL("NULLCFunc", fPtr, 127);
 
-			x = 77;
-			NULLCAutoArray autoArr = { 4, (char*)&x, 1 };
-			TEST_CALL("NULLCArray", autoArr, 77);
-			
 			testsPassed[t]++;
 		}
 		if(regVmPassed + 1 != testsPassed[TEST_TYPE_REGVM])
-			printf("REGVM failed test: Structure pass through nullcCallFunction\r\n");
+			printf("REGVM failed test: Program snapshot save and restore\r\n");
 		if(Tests::testExecutor[NULLC_X86] && x86Passed + 1 != testsPassed[NULLC_X86])
-			printf("X86 failed test: Structure pass through nullcCallFunction\r\n");
+			printf("X86 failed test: Program snapshot save and restore\r\n");
 	}
 
 	const char	*testLongRetrieval = "return 25l;";
@@ -683,10 +2767,119 @@ void RunInterfaceTests()
 	TEST_COMPARES(nullcGetLastError(), "");
 	nullcInit();
 	TEST_COMPARES(nullcGetLastError(), "ERROR: NULLC is already initialized");
+
+	// base module from an earlier initialization is reused
+	nullcSetEnableBaseModuleReuse(1);
+	nullcTerminate();
+	nullcInit();
+	TEST_COMPARE(nullcBuild("int[2] arr; return int(\"40\") + (\"a\" + \"b\").size + arr.size;"), true);
+	TEST_COMPARE(nullcRun(), 1);
+	TEST_COMPARE(nullcGetResultInt(), 45);
+	nullcSetEnableBaseModuleReuse(0);
 	nullcTerminate();
 	TEST_COMPARES(nullcGetLastError(), "");
 }
 
+const char *lexerTestFiles[] =
+{
+	"std/algorithm.nc", "std/async.nc", "std/dynamic.nc", "std/error.nc", "std/event.nc", "std/file.nc", "std/gc.nc", "std/hashmap.nc",
+	"std/io.nc", "std/list.nc", "std/map.nc", "std/math.nc", "std/math_swizzle.nc", "std/memory.nc", "std/random.nc", "std/range.nc",
+	"std/string.nc", "std/stringio.nc", "std/task.nc", "std/time.nc", "std/typeinfo.nc", "std/vector.nc",
+	"ext/pugixml.nc", "img/canvas.nc", "old/list.nc", "old/vector.nc", "win/window.nc", "win/window_ex.nc",
+	"nullc_in_nullc/analyzer.nc", "nullc_in_nullc/arrayview.nc", "nullc_in_nullc/binarycache.nc", "nullc_in_nullc/bytecode.nc",
+	"nullc_in_nullc/common.nc", "nullc_in_nullc/compiler.nc", "nullc_in_nullc/compilercontext.nc", "nullc_in_nullc/errorlocation.nc",
+	"nullc_in_nullc/expressioncontext.nc", "nullc_in_nullc/expressioneval.nc", "nullc_in_nullc/expressiongraph.nc", "nullc_in_nullc/expressiontree.nc",
+	"nullc_in_nullc/lexer.nc", "nullc_in_nullc/nullcdef.nc", "nullc_in_nullc/parsegraph.nc", "nullc_in_nullc/parser.nc",
+	"nullc_in_nullc/parsetree.nc", "nullc_in_nullc/reflist.nc", "nullc_in_nullc/stringutil.nc", "nullc_in_nullc/typetree.nc",
+	"nullc_in_nullc/typetreehelpers.nc", "nullc_in_nullc/vectorview.nc"
+};
+
+const char *lexerTestSnippets[] =
+{
+	"",
+	" \t \t        \t                                       ",
+	"// comment that ends the source without a line break",
+	"/* block /* nested */ \"*/\" comment without an end",
+	"a_very_long_identifier_that_spans_several_sixteen_byte_blocks_0123456789 x",
+	"12345678901234567890123456789012345.123456789012345678901234e-1234567890123 0x1234abcdefABCDEF",
+	"\xc3\xa4\xc3\xb6\xc3\xbc identifier\xe2\x82\xac_with_extended\xff\x80" "bytes",
+	"if in do for ref new case else auto true enum with while break class align yield const false switch return typeof sizeof import noalign default typedef nullptr generic continue operator coroutine namespace extendable",
+	"iff inn d fo reff neww cas elsee aut tru enu withh whil brea clas alig yiel cons fals switc retur typeo sizeo impor noalig defaul typede nullpt generi continu operato coroutin namespac extendabl extendables",
+	"int a = 5;\r\n\t\t// x\r\n/* y\n z */\tint b = a+++a--;\n\"str\\\"ing\" 'c' @ ~ ** **= <<= >>= ^^ ^= |= &=",
+	"\x01\x02\x1f x \x7f y",
+};
+
+struct LexerTestKeyword
+{
+	const char *name;
+	LexemeType type;
+};
+
+// Keywords and their lexeme types, looked up linearly as a reference for the keyword recognizer
+LexerTestKeyword lexerTestKeywords[] =
+{
+	{ "if", lex_if }, { "in", lex_in }, { "do", lex_do }, { "for", lex_for }, { "ref", lex_ref }, { "new", lex_new },
+	{ "case", lex_case }, { "else", lex_else }, { "auto", lex_auto }, { "true", lex_true }, { "enum", lex_enum }, { "with", lex_with },
+	{ "while", lex_while }, { "break", lex_break }, { "class", lex_class }, { "align", lex_align }, { "yield", lex_yield }, { "const", lex_const },
+	{ "false", lex_false }, { "switch", lex_switch }, { "return", lex_return }, { "typeof", lex_typeof }, { "sizeof", lex_sizeof },
+	{ "import", lex_import }, { "noalign", lex_noalign }, { "default", lex_default }, { "typedef", lex_typedef }, { "nullptr", lex_nullptr },
+	{ "generic", lex_generic }, { "continue", lex_continue }, { "operator", lex_operator }, { "coroutine", lex_coroutine },
+	{ "namespace", lex_namespace }, { "extendable", lex_extendable }
+};
+
+bool TestLexerStreams(const char *name, const char *source, unsigned offset)
+{
+	// Place the source at a different alignment to move the block boundaries
+	unsigned length = unsigned(strlen(source));
+
+	char *code = new char[length + offset + 1];
+	memcpy(code + offset, source, length + 1);
+
+	Lexer vectorized(NULL);
+	vectorized.Lexify(code + offset);
+
+	Lexer scalar(NULL);
+	scalar.LexifyScalar(code + offset);
+
+	bool result = true;
+
+	if(vectorized.GetStreamSize() != scalar.GetStreamSize())
+	{
+		printf("Lexer test '%s' (offset %d): lexeme count %d != %d\n", name, offset, vectorized.GetStreamSize(), scalar.GetStreamSize());
+		result = false;
+	}
+
+	for(unsigned i = 0; i < vectorized.GetStreamSize() && result; i++)
+	{
+		Lexeme &lhs = vectorized.GetStreamStart()[i];
+		Lexeme &rhs = scalar.GetStreamStart()[i];
+
+		if(lhs.type != rhs.type || lhs.pos != rhs.pos || lhs.length != rhs.length || lhs.line != rhs.line || lhs.column != rhs.column)
+		{
+			printf("Lexer test '%s' (offset %d): lexeme %d at %d:%d differs\n", name, offset, i, rhs.line + 1, rhs.column + 1);
+			result = false;
+		}
+
+		LexemeType keywordType = lex_string;
+
+		for(unsigned k = 0; k < sizeof(lexerTestKeywords) / sizeof(lexerTestKeywords[0]); k++)
+		{
+			if(strlen(lexerTestKeywords[k].name) == lhs.length && memcmp(lexerTestKeywords[k].name, lhs.pos, lhs.length) == 0)
+				keywordType = lexerTestKeywords[k].type;
+		}
+
+		if((lhs.type == lex_string || lhs.type >= lex_if) && lhs.type != lex_at && lhs.type != keywordType)
+		{
+			printf("Lexer test '%s' (offset %d): '%.*s' at %d:%d has a wrong keyword type\n", name, offset, lhs.length, lhs.pos, lhs.line + 1, lhs.column + 1);
+			result = false;
+		}
+	}
+
+	delete[] code;
+
+	return result;
+}
+
 void RunUtilityTests()
 {
 	{
@@ -750,4 +2943,65 @@ void RunUtilityTests()
 
 		testsPassed[TEST_TYPE_EXTRA]++;
 	}
+
+	{
+		if(Tests::messageVerbose)
+			printf("Lexer vectorized scanning test\r\n");
+
+		testsCount[TEST_TYPE_EXTRA]++;
+
+		bool passed = true;
+
+		for(unsigned i = 0; i < sizeof(lexerTestSnippets) / sizeof(lexerTestSnippets[0]); i++)
+		{
+			for(unsigned offset = 0; offset < 16; offset++)
+				passed &= TestLexerStreams(lexerTestSnippets[i], lexerTestSnippets[i], offset);
+		}
+
+		unsigned filesTested = 0;
+
+		for(unsigned i = 0; i < sizeof(lexerTestFiles) / sizeof(lexerTestFiles[0]); i++)
+		{
+			const char *paths[] = { MODULE_PATH_A, MODULE_PATH_B, MODULE_PATH_C };
+
+			for(unsigned k = 0; k < sizeof(paths) / sizeof(paths[0]); k++)
+			{
+				char path[256];
+				NULLC::SafeSprintf(path, 256, "%s%s", paths[k], lexerTestFiles[i]);
+
+				FILE *file = fopen(path, "rb");
+
+				if(!file)
+					continue;
+
+				fseek(file, 0, SEEK_END);
+				unsigned size = unsigned(ftell(file));
+				fseek(file, 0, SEEK_SET);
+
+				char *source = new char[size + 1];
+				source[fread(source, 1, size, file)] = 0;
+
+				fclose(file);
+
+				passed &= TestLexerStreams(path, source, 0);
+				passed &= TestLexerStreams(path, source, 7);
+
+				delete[] source;
+
+				filesTested++;
+				break;
+			}
+		}
+
+		if(filesTested == 0)
+		{
+			printf("Lexer vectorized scanning test: no source files found\n");
+			passed = false;
+		}
+
+		if(passed)
+			testsPassed[TEST_TYPE_EXTRA]++;
+		else if(!Tests::messageVerbose)
+			printf("Lexer vectorized scanning test\r\n");
+	}
 }
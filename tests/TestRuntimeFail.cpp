@@ -26,6 +26,21 @@ long a = 5, b = 0;\r\n\
 return a % b;";
 TEST_RUNTIME_FAIL("Modulus division by zero handling 2 [failure handling]", testModZeroLong, "ERROR: integer division by zero");
 
+const char	*testTaskWorkerFail =
+"import std.task;\r\n\
+int Inverse(int x){ return 100 / x; }\r\n\
+return parallel_map({ 5, 4, 0, 2 }, Inverse, 2)[0];";
+TEST_RUNTIME_FAIL("std.task worker context error handling [failure handling]", testTaskWorkerFail, "ERROR: worker context failed: ERROR: integer division by zero");
+
+const char	*testTaskWorkerClosure =
+"import std.task;\r\n\
+int Scale(int[] arr, int factor)\r\n\
+{\r\n\
+	return parallel_map(arr, auto(int x){ return x * factor; })[0];\r\n\
+}\r\n\
+return Scale({ 1, 2 }, 3);";
+TEST_RUNTIME_FAIL("std.task worker context closure check [failure handling]", testTaskWorkerClosure, "ERROR: function called on worker contexts can't capture variables");
+
 const char	*testFuncNoReturn = 
 "// Function with no return handling\r\n\
 int test(){ if(0) return 2; } // temporary\r\n\
@@ -14,6 +14,8 @@
 #include "../NULLC/includes/time.h"
 #include "../NULLC/includes/memory.h"
 #include "../NULLC/includes/error.h"
+#include "../NULLC/includes/task.h"
+#include "../NULLC/includes/async.h"
 #include "../NULLC/includes/string.h"
 
 #include "../NULLC/includes/canvas.h"
@@ -48,6 +50,8 @@ void	SpeedTestText(const char* name, const char* text)
 	nullcInitGCModule();
 	nullcInitMemoryModule();
 	nullcInitErrorModule();
+	nullcInitTaskModule();
+	nullcInitAsyncModule();
 	nullcInitStringModule();
 	nullcInitIOModule();
 	nullcInitCanvasModule();
@@ -13,6 +13,8 @@
 #include "../NULLC/includes/time.h"
 #include "../NULLC/includes/memory.h"
 #include "../NULLC/includes/error.h"
+#include "../NULLC/includes/task.h"
+#include "../NULLC/includes/async.h"
 #include "../NULLC/includes/string.h"
 
 #include "../NULLC/includes/canvas.h"
@@ -176,6 +178,8 @@ struct TestRestore : TestQueue
 		nullcInitGCModule();
 		nullcInitMemoryModule();
 		nullcInitErrorModule();
+		nullcInitTaskModule();
+		nullcInitAsyncModule();
 		nullcInitStringModule();
 		nullcInitIOModule();
 		nullcInitCanvasModule();
@@ -19,6 +19,8 @@
 #include "../NULLC/includes/string.h"
 #include "../NULLC/includes/memory.h"
 #include "../NULLC/includes/error.h"
+#include "../NULLC/includes/task.h"
+#include "../NULLC/includes/async.h"
 
 #include "../NULLC/includes/canvas.h"
 #include "../NULLC/includes/window.h"
@@ -32,6 +34,12 @@
 #include "TestParseFail.h"
 #include "TestInterface.h"
 
+#if defined(_WIN32)
+	#include <windows.h>
+#else
+	#include <pthread.h>
+#endif
+
 #if defined(_MSC_VER)
 #pragma warning(disable: 4127 4996)
 #endif
@@ -87,8 +95,29 @@ struct PointerHasher
 MallocAllocatorRef setAllocator;
 SmallDenseMap<uintptr_t, bool, PointerHasher, 1024> activePoiners(&setAllocator);
 
+// Execution contexts on different threads allocate memory at the same time
+#if defined(_WIN32)
+SRWLOCK activePointersLock = SRWLOCK_INIT;
+
+struct ActivePointersLockScope
+{
+	ActivePointersLockScope(){ AcquireSRWLockExclusive(&activePointersLock); }
+	~ActivePointersLockScope(){ ReleaseSRWLockExclusive(&activePointersLock); }
+};
+#else
+pthread_mutex_t activePointersLock = PTHREAD_MUTEX_INITIALIZER;
+
+struct ActivePointersLockScope
+{
+	ActivePointersLockScope(){ pthread_mutex_lock(&activePointersLock); }
+	~ActivePointersLockScope(){ pthread_mutex_unlock(&activePointersLock); }
+};
+#endif
+
 void* testAlloc(int size)
 {
+	ActivePointersLockScope lockScope;
+
 	testTotalMemoryAlloc++;
 	testTotalMemoryRequested += size;
 	testTotalMemoryUsed += size;
@@ -120,6 +149,8 @@ void testDealloc(void* ptr)
 
 	ptr = (char*)ptr - 128;
 
+	ActivePointersLockScope lockScope;
+
 	bool* active = activePoiners.find(uintptr_t(ptr));
 
 	if(!active || !*active)
@@ -260,6 +291,7 @@ int RunTests(bool verbose, const char* (*fileLoadFunc)(const char*, unsigned*),
 
 	nullcInitTypeinfoModule();
 	nullcInitDynamicModule();
+	nullcInitAsyncModule();
 
 	RunInterfaceTests();
 	RunUtilityTests();
@@ -289,6 +321,8 @@ int RunTests(bool verbose, const char* (*fileLoadFunc)(const char*, unsigned*),
 	nullcInitGCModule();
 	nullcInitMemoryModule();
 	nullcInitErrorModule();
+	nullcInitTaskModule();
+	nullcInitAsyncModule();
 	nullcInitStringModule();
 
 	nullcInitIOModule();
@@ -25,6 +25,8 @@
 #include "../../NULLC/includes/gc.h"
 #include "../../NULLC/includes/memory.h"
 #include "../../NULLC/includes/error.h"
+#include "../../NULLC/includes/task.h"
+#include "../../NULLC/includes/async.h"
 
 #include "../../NULLC/includes/window.h"
 #include "../../NULLC/includes/canvas.h"
@@ -613,6 +615,10 @@ bool HandleRequestLaunch(Context& ctx, rapidjson::Document &response, rapidjson:
 		return RespondWithError(ctx, response, "failed to init std.memory module");
 	if(!nullcInitErrorModule())
 		return RespondWithError(ctx, response, "failed to init std.error module");
+	if(!nullcInitTaskModule())
+		return RespondWithError(ctx, response, "failed to init std.task module");
+	if(!nullcInitAsyncModule())
+		return RespondWithError(ctx, response, "failed to init std.async module");
 
 	if(!nullcInitCanvasModule())
 		return RespondWithError(ctx, response, "failed to init img.canvas module");
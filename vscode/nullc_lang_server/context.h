@@ -1,8 +1,14 @@
 #pragma once
 
+#include <condition_variable>
+#include <deque>
 #include <map>
+#include <mutex>
+#include <set>
 #include <string>
 
+#include "../../NULLC/nullc.h"
+
 #include "document.h"
 
 struct Context
@@ -18,6 +24,14 @@ struct Context
 		workspaceConfiguration = false;
 		textDocumentDefinitionLinkSupport = false;
 		textDocumentHierarchicalDocumentSymbolSupport = false;
+
+		lastRevision = 0;
+
+		incomingFinished = false;
+		workerFailed = false;
+		workerFinished = false;
+
+		nullcResetCancellation(&analysisCancellation);
 	}
 
 	bool infoMode;
@@ -36,4 +50,34 @@ struct Context
 	std::string modulePath;
 
 	std::map<std::string, Document> documents;
+
+	// Every change of a document text gets a new revision number
+	unsigned lastRevision;
+
+	// Messages are read on the main thread and handled by the worker thread, documents are analyzed on the analysis thread
+	// State below is guarded by 'incomingLock'
+	std::mutex incomingLock;
+	std::condition_variable incomingReady;
+
+	std::deque<std::string> incomingMessages;
+	bool incomingFinished;
+	bool workerFailed;
+	bool workerFinished;
+
+	// Requests that were cancelled by the client before the worker has handled them
+	std::set<std::string> cancelledRequests;
+
+	// Document texts waiting for the analysis thread, only the latest text of each document is kept
+	std::map<std::string, std::unique_ptr<DocumentAnalysis>> analysisRequests;
+	std::condition_variable analysisReady;
+
+	// Completed analyses that the worker hasn't taken yet
+	std::deque<std::unique_ptr<DocumentAnalysis>> analysisResults;
+
+	// Document that is being analyzed by the analysis thread, analysis is stopped when a newer text of it is requested
+	std::string analysisUri;
+	NULLCCancellation analysisCancellation;
+
+	// Held by the analysis thread while it uses nullc and by the worker while it restarts nullc
+	std::mutex nullcLock;
 };
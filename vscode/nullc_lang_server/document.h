@@ -1,10 +1,40 @@
 #pragma once
 
+#include <memory>
 #include <string>
 
+struct nullcAnalysis;
+
+// Analysis refers to the text it was made from, so the text is kept with it
+struct DocumentAnalysis
+{
+	DocumentAnalysis(const std::string &uri, const std::string &code, unsigned revision, bool debugMode);
+	~DocumentAnalysis();
+
+	DocumentAnalysis(const DocumentAnalysis&) = delete;
+	DocumentAnalysis& operator=(const DocumentAnalysis&) = delete;
+
+	std::string uri;
+	std::string code;
+	unsigned revision = 0;
+
+	// Analysis thread doesn't read the trace level that the worker can change
+	bool debugMode = false;
+
+	bool result = false;
+	nullcAnalysis *analysis = nullptr;
+};
+
 struct Document
 {
 	std::string uri;
 	std::string code;
+	unsigned revision = 0;
 	bool temporary = false;
+
+	// Revision of the text that was last sent to the analysis thread
+	unsigned requestedRevision = 0;
+
+	// Last completed analysis, it can be of an older text
+	std::unique_ptr<DocumentAnalysis> analysis;
 };
@@ -2,6 +2,8 @@
 
 #include <stdio.h>
 
+#include <chrono>
+#include <memory>
 #include <vector>
 
 #include "rapidjson/document.h"
@@ -960,6 +962,7 @@ Document* FindDocument(Context& ctx, rapidjson::Document &response, std::string
 
 				document.uri = documentPath;
 				document.code = code;
+				document.revision = ++ctx.lastRevision;
 				document.temporary = true;
 
 				delete[] code;
@@ -980,9 +983,9 @@ Document* FindDocument(Context& ctx, rapidjson::Document &response, std::string
 
 struct ScopedDocumentImport
 {
-	ScopedDocumentImport(Context& ctx, Document *document): ctx(ctx)
+	ScopedDocumentImport(const std::string &documentUri, bool debugMode): debugMode(debugMode)
 	{
-		std::string uri = UrlDecode(document->uri.c_str());
+		std::string uri = UrlDecode(documentUri.c_str());
 
 		if(uri.find("file:///") == 0)
 		{
@@ -994,7 +997,7 @@ struct ScopedDocumentImport
 
 		if(!documentFolder.empty())
 		{
-			if(ctx.debugMode)
+			if(debugMode)
 				fprintf(stderr, "DEBUG: Adding temporary import path '%s'\n", documentFolder.c_str());
 
 			if(nullcHasImportPath(documentFolder.c_str()))
@@ -1008,18 +1011,147 @@ struct ScopedDocumentImport
 	{
 		if(!documentFolder.empty())
 		{
-			if(ctx.debugMode)
+			if(debugMode)
 				fprintf(stderr, "DEBUG: Removing temporary import path '%s'\n", documentFolder.c_str());
 
 			nullcRemoveImportPath(documentFolder.c_str());
 		}
 	}
 
-	Context& ctx;
+	bool debugMode;
 
 	std::string documentFolder;
 };
 
+DocumentAnalysis::DocumentAnalysis(const std::string &uri, const std::string &code, unsigned revision, bool debugMode): uri(uri), code(code), revision(revision), debugMode(debugMode)
+{
+}
+
+DocumentAnalysis::~DocumentAnalysis()
+{
+	nullcDestroyAnalysis(analysis);
+}
+
+// Analyses refer to the modules held by nullc, they have to be released before nullc is restarted
+void ResetAnalyses(Context& ctx)
+{
+	for(auto &&el : ctx.documents)
+	{
+		el.second.analysis.reset();
+		el.second.requestedRevision = 0;
+	}
+
+	std::lock_guard<std::mutex> lock(ctx.incomingLock);
+
+	ctx.analysisRequests.clear();
+	ctx.analysisResults.clear();
+}
+
+// Analysis thread is stopped while nullc is restarted by the worker
+struct ScopedNullcRestart
+{
+	ScopedNullcRestart(Context& ctx): ctx(ctx)
+	{
+		{
+			std::lock_guard<std::mutex> lock(ctx.incomingLock);
+
+			if(!ctx.analysisUri.empty())
+				nullcRequestCancellation(&ctx.analysisCancellation);
+		}
+
+		ctx.nullcLock.lock();
+
+		ResetAnalyses(ctx);
+	}
+
+	~ScopedNullcRestart()
+	{
+		ctx.nullcLock.unlock();
+	}
+
+	Context& ctx;
+};
+
+// Current text of the document is queued for the analysis thread, analysis of an older text of the same document is stopped
+void RequestAnalysis(Context& ctx, Document &document)
+{
+	if(document.requestedRevision == document.revision)
+		return;
+
+	document.requestedRevision = document.revision;
+
+	std::unique_ptr<DocumentAnalysis> analysis(new DocumentAnalysis(document.uri, document.code, document.revision, ctx.debugMode));
+
+	std::lock_guard<std::mutex> lock(ctx.incomingLock);
+
+	ctx.analysisRequests[document.uri] = std::move(analysis);
+
+	if(ctx.analysisUri == document.uri)
+		nullcRequestCancellation(&ctx.analysisCancellation);
+
+	ctx.analysisReady.notify_one();
+}
+
+// Completed analyses replace older analyses of the documents, diagnostics are published when the analysis is of the current document text
+void AcceptAnalyses(Context& ctx)
+{
+	std::deque<std::unique_ptr<DocumentAnalysis>> analyses;
+
+	{
+		std::lock_guard<std::mutex> lock(ctx.incomingLock);
+
+		analyses.swap(ctx.analysisResults);
+	}
+
+	for(auto &&analysis : analyses)
+	{
+		auto it = ctx.documents.find(analysis->uri);
+
+		if(it == ctx.documents.end())
+			continue;
+
+		Document &document = it->second;
+
+		if(document.analysis && document.analysis->revision > analysis->revision)
+			continue;
+
+		document.analysis = std::move(analysis);
+
+		if(document.analysis->revision == document.revision && !document.temporary)
+			UpdateDiagnostics(ctx, document);
+	}
+}
+
+// Returns the last completed analysis of the document, requests are answered from it while a newer text is analyzed
+DocumentAnalysis* GetAnalysis(Context& ctx, Document *document)
+{
+	AcceptAnalyses(ctx);
+
+	RequestAnalysis(ctx, *document);
+
+	// Only a document that has never been analyzed has to wait for the analysis thread
+	while(!document->analysis)
+	{
+		{
+			std::unique_lock<std::mutex> lock(ctx.incomingLock);
+
+			ctx.incomingReady.wait(lock, [&ctx](){ return !ctx.analysisResults.empty(); });
+		}
+
+		AcceptAnalyses(ctx);
+	}
+
+	if(ctx.debugMode)
+	{
+		if(document->analysis->revision == document->revision)
+			fprintf(stderr, "DEBUG: Using analysis of '%s'\n", document->uri.c_str());
+		else
+			fprintf(stderr, "DEBUG: Using analysis of an older text of '%s'\n", document->uri.c_str());
+	}
+
+	return document->analysis.get();
+}
+
 bool HandleConfigurationResponse(Context& ctx, rapidjson::Value& response)
 {
 	if(!response.IsArray())
@@ -1064,6 +1196,8 @@ bool HandleConfigurationResponse(Context& ctx, rapidjson::Value& response)
 
 			if(!modulePath.empty())
 			{
+				ScopedNullcRestart scopedNullcRestart(ctx);
+
 				if(ctx.nullcInitialized)
 					nullcTerminate();
 
@@ -1096,7 +1230,7 @@ bool HandleConfigurationResponse(Context& ctx, rapidjson::Value& response)
 				}
 
 				for(auto &&el : ctx.documents)
-					UpdateDiagnostics(ctx, el.second);
+					RequestAnalysis(ctx, el.second);
 			}
 		}
 	}
@@ -1142,6 +1276,8 @@ bool HandleInitialize(Context& ctx, rapidjson::Value& arguments, rapidjson::Docu
 
 	if(!ctx.nullcInitialized)
 	{
+		ScopedNullcRestart scopedNullcRestart(ctx);
+
 		if(arguments.HasMember("rootUri") && arguments["rootUri"].IsString())
 		{
 			std::string rootUri = UrlDecode(arguments["rootUri"].GetString());
@@ -1288,11 +1424,9 @@ bool HandleFoldingRange(Context& ctx, rapidjson::Value& arguments, rapidjson::Do
 
 	std::vector<FoldingRange> foldingRanges;
 
-	ScopedDocumentImport scopedDocumentImport(ctx, document);
-
-	nullcAnalyze(document->code.c_str());
+	DocumentAnalysis *analysis = GetAnalysis(ctx, document);
 
-	if(CompilerContext *context = nullcGetCompilerContext())
+	if(CompilerContext *context = nullcGetAnalysisContext(analysis->analysis))
 	{
 		if(context->synModule)
 		{
@@ -1375,8 +1509,6 @@ bool HandleFoldingRange(Context& ctx, rapidjson::Value& arguments, rapidjson::Do
 
 	SendResponse(ctx, response);
 
-	nullcClean();
-
 	return true;
 }
 
@@ -1389,13 +1521,11 @@ bool HandleHover(Context& ctx, rapidjson::Value& arguments, rapidjson::Document
 
 	auto position = Position(arguments["position"]);
 
-	ScopedDocumentImport scopedDocumentImport(ctx, document);
-
-	nullcAnalyze(document->code.c_str());
+	DocumentAnalysis *analysis = GetAnalysis(ctx, document);
 
 	Hover hover;
 
-	if(CompilerContext *context = nullcGetCompilerContext())
+	if(CompilerContext *context = nullcGetAnalysisContext(analysis->analysis))
 	{
 		if(context->exprModule)
 		{
@@ -1459,8 +1589,6 @@ bool HandleHover(Context& ctx, rapidjson::Value& arguments, rapidjson::Document
 
 	SendResponse(ctx, response);
 
-	nullcClean();
-
 	return true;
 }
 
@@ -1471,13 +1599,11 @@ bool HandleDocumentSymbol(Context& ctx, rapidjson::Value& arguments, rapidjson::
 	if(!document)
 		return true;
 
-	ScopedDocumentImport scopedDocumentImport(ctx, document);
-
-	nullcAnalyze(document->code.c_str());
+	DocumentAnalysis *analysis = GetAnalysis(ctx, document);
 
 	std::vector<DocumentSymbol> symbols;
 
-	if(CompilerContext *context = nullcGetCompilerContext())
+	if(CompilerContext *context = nullcGetAnalysisContext(analysis->analysis))
 	{
 		for(unsigned i = 0; i < context->exprCtx.namespaces.size(); i++)
 		{
@@ -1707,8 +1833,6 @@ bool HandleDocumentSymbol(Context& ctx, rapidjson::Value& arguments, rapidjson::
 
 	SendResponse(ctx, response);
 
-	nullcClean();
-
 	return true;
 }
 
@@ -1742,15 +1866,13 @@ bool HandleCompletion(Context& ctx, rapidjson::Value& arguments, rapidjson::Docu
 		CompilerContext *context = nullptr;
 	};
 
-	ScopedDocumentImport scopedDocumentImport(ctx, document);
-
-	nullcAnalyze(document->code.c_str());
+	DocumentAnalysis *analysis = GetAnalysis(ctx, document);
 
 	CompletionList completions;
 
 	Data data(ctx, position, completionContext, completions);
 
-	if(CompilerContext *context = nullcGetCompilerContext())
+	if(CompilerContext *context = nullcGetAnalysisContext(analysis->analysis))
 	{
 		data.context = context;
 
@@ -1975,7 +2097,10 @@ bool HandleCompletion(Context& ctx, rapidjson::Value& arguments, rapidjson::Docu
 						}
 					}
 
-					if(TypeGenericClass *typeGenericClass = getType<TypeGenericClass>(type))
+					TypeGenericClass *typeGenericClass = getType<TypeGenericClass>(type);
+
+					// Body of an imported generic class that wasn't instantiated is parsed here to list its aliases
+					if(typeGenericClass && ParseGenericClassDefinition(data.context->exprCtx, typeGenericClass->proto))
 					{
 						for(SynIdentifier *curr = typeGenericClass->proto->definition->aliases.head; curr; curr = getType<SynIdentifier>(curr->next))
 						{
@@ -2127,8 +2252,6 @@ bool HandleCompletion(Context& ctx, rapidjson::Value& arguments, rapidjson::Docu
 
 	SendResponse(ctx, response);
 
-	nullcClean();
-
 	return true;
 }
 
@@ -2141,13 +2264,11 @@ bool HandleDefinition(Context& ctx, rapidjson::Value& arguments, rapidjson::Docu
 
 	auto position = Position(arguments["position"]);
 
-	ScopedDocumentImport scopedDocumentImport(ctx, document);
-
-	nullcAnalyze(document->code.c_str());
+	DocumentAnalysis *analysis = GetAnalysis(ctx, document);
 
 	std::vector<LocationLink> locations;
 
-	if(CompilerContext *context = nullcGetCompilerContext())
+	if(CompilerContext *context = nullcGetAnalysisContext(analysis->analysis))
 	{
 		if(context->exprModule)
 		{
@@ -2304,8 +2425,6 @@ bool HandleDefinition(Context& ctx, rapidjson::Value& arguments, rapidjson::Docu
 
 	SendResponse(ctx, response);
 
-	nullcClean();
-
 	return true;
 }
 
@@ -2320,13 +2439,11 @@ bool HandleReferences(Context& ctx, rapidjson::Value& arguments, rapidjson::Docu
 
 	//auto includeDeclaration = arguments["includeDeclaration"].GetBool();
 
-	ScopedDocumentImport scopedDocumentImport(ctx, document);
-
-	nullcAnalyze(document->code.c_str());
+	DocumentAnalysis *analysis = GetAnalysis(ctx, document);
 
 	std::vector<Location> locations;
 
-	if(CompilerContext *context = nullcGetCompilerContext())
+	if(CompilerContext *context = nullcGetAnalysisContext(analysis->analysis))
 	{
 		if(context->exprModule)
 		{
@@ -2405,8 +2522,6 @@ bool HandleReferences(Context& ctx, rapidjson::Value& arguments, rapidjson::Docu
 
 	SendResponse(ctx, response);
 
-	nullcClean();
-
 	return true;
 }
 
@@ -2419,13 +2534,11 @@ bool HandleDocumentHighlight(Context& ctx, rapidjson::Value& arguments, rapidjso
 
 	auto position = Position(arguments["position"]);
 
-	ScopedDocumentImport scopedDocumentImport(ctx, document);
-
-	nullcAnalyze(document->code.c_str());
+	DocumentAnalysis *analysis = GetAnalysis(ctx, document);
 
 	std::vector<DocumentHighlight> highlights;
 
-	if(CompilerContext *context = nullcGetCompilerContext())
+	if(CompilerContext *context = nullcGetAnalysisContext(analysis->analysis))
 	{
 		if(context->exprModule)
 		{
@@ -2480,8 +2593,6 @@ bool HandleDocumentHighlight(Context& ctx, rapidjson::Value& arguments, rapidjso
 
 	SendResponse(ctx, response);
 
-	nullcClean();
-
 	return true;
 }
 
@@ -2515,15 +2626,13 @@ bool HandleSignatureHelp(Context& ctx, rapidjson::Value& arguments, rapidjson::D
 		CompilerContext *context = nullptr;
 	};
 
-	ScopedDocumentImport scopedDocumentImport(ctx, document);
-
-	nullcAnalyze(document->code.c_str());
+	DocumentAnalysis *analysis = GetAnalysis(ctx, document);
 
 	SignatureHelp signatureHelp;
 
 	Data data(ctx, position, completionContext, signatureHelp);
 
-	if(CompilerContext *context = nullcGetCompilerContext())
+	if(CompilerContext *context = nullcGetAnalysisContext(analysis->analysis))
 	{
 		data.context = context;
 
@@ -2677,8 +2786,6 @@ bool HandleSignatureHelp(Context& ctx, rapidjson::Value& arguments, rapidjson::D
 
 	SendResponse(ctx, response);
 
-	nullcClean();
-
 	return true;
 }
 
@@ -2699,11 +2806,15 @@ void UpdateDiagnostics(Context& ctx, Document &document)
 	rapidjson::Value diagnostics;
 	diagnostics.SetArray();
 
-	ScopedDocumentImport scopedDocumentImport(ctx, &document);
+	// Diagnostics are published for the analysis of the current document text
+	DocumentAnalysis *analysis = document.analysis.get();
+
+	if(!analysis)
+		return;
 
-	if(!nullcAnalyze(document.code.c_str()))
+	if(!analysis->result)
 	{
-		if(CompilerContext *context = nullcGetCompilerContext())
+		if(CompilerContext *context = nullcGetAnalysisContext(analysis->analysis))
 		{
 			for(auto &&el : context->parseCtx.errorInfo)
 			{
@@ -2792,8 +2903,6 @@ void UpdateDiagnostics(Context& ctx, Document &document)
 	response.AddMember("params", params, response.GetAllocator());
 
 	SendResponse(ctx, response);
-
-	nullcClean();
 }
 
 bool HandleDidOpen(Context& ctx, rapidjson::Value& arguments)
@@ -2815,6 +2924,8 @@ bool HandleDidOpen(Context& ctx, rapidjson::Value& arguments)
 				ctx.modulePath += "Modules/";
 			}
 
+			ScopedNullcRestart scopedNullcRestart(ctx);
+
 			if(ctx.nullcInitialized)
 				nullcTerminate();
 
@@ -2850,8 +2961,10 @@ bool HandleDidOpen(Context& ctx, rapidjson::Value& arguments)
 
 	document.uri = uri;
 	document.code = arguments["textDocument"]["text"].GetString();
+	document.revision = ++ctx.lastRevision;
+	document.temporary = false;
 
-	UpdateDiagnostics(ctx, document);
+	RequestAnalysis(ctx, document);
 
 	return true;
 }
@@ -2941,7 +3054,9 @@ bool HandleDidChange(Context& ctx, rapidjson::Value& arguments)
 		}
 	}
 
-	UpdateDiagnostics(ctx, document);
+	document.revision = ++ctx.lastRevision;
+
+	RequestAnalysis(ctx, document);
 
 	return true;
 }
@@ -2955,6 +3070,13 @@ bool HandleMessage(Context& ctx, unsigned idNumber, const char *idString, const
 	if(ctx.debugMode)
 		fprintf(stderr, "DEBUG: HandleMessage(%s)\n", method);
 
+	{
+		std::lock_guard<std::mutex> lock(ctx.incomingLock);
+
+		if(ctx.cancelledRequests.erase(idString ? std::string(idString) : ToString("%u", idNumber)) != 0)
+			return RespondWithError(ctx, response, method, ErrorCode::RequestCancelled, "request was cancelled");
+	}
+
 	if(strcmp(method, "initialize") == 0)
 		return HandleInitialize(ctx, arguments, response);
 	else if(strcmp(method, "textDocument/foldingRange") == 0)
@@ -2992,6 +3114,165 @@ bool HandleNotification(Context& ctx, const char *method, rapidjson::Value& argu
 	return true;
 }
 
+bool QueueMessage(Context& ctx, const char *message, unsigned length)
+{
+	rapidjson::Document doc;
+
+	// Cancellation of a request is inspected before the request is queued
+	if(!doc.Parse(message, length).HasParseError() && doc.IsObject() && doc.HasMember("method") && doc["method"].IsString() && doc.HasMember("params"))
+	{
+		auto method = doc["method"].GetString();
+		auto &params = doc["params"];
+
+		if(strcmp(method, "$/cancelRequest") == 0 && params.HasMember("id"))
+		{
+			std::lock_guard<std::mutex> lock(ctx.incomingLock);
+
+			if(params["id"].IsUint())
+				ctx.cancelledRequests.insert(ToString("%u", params["id"].GetUint()));
+			else if(params["id"].IsString())
+				ctx.cancelledRequests.insert(params["id"].GetString());
+
+			return !ctx.workerFailed;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(ctx.incomingLock);
+
+	ctx.incomingMessages.push_back(std::string(message, length));
+
+	ctx.incomingReady.notify_one();
+
+	return !ctx.workerFailed;
+}
+
+void FinishMessages(Context& ctx)
+{
+	std::lock_guard<std::mutex> lock(ctx.incomingLock);
+
+	ctx.incomingFinished = true;
+
+	ctx.incomingReady.notify_one();
+}
+
+bool ProcessMessages(Context& ctx)
+{
+	for(;;)
+	{
+		std::string message;
+
+		{
+			std::unique_lock<std::mutex> lock(ctx.incomingLock);
+
+			// When the queue is empty, all requests that the client could cancel have been handled
+			if(ctx.incomingMessages.empty())
+				ctx.cancelledRequests.clear();
+
+			ctx.incomingReady.wait(lock, [&ctx](){ return !ctx.incomingMessages.empty() || !ctx.analysisResults.empty() || ctx.incomingFinished; });
+
+			if(ctx.analysisResults.empty())
+			{
+				if(ctx.incomingMessages.empty())
+				{
+					ctx.workerFinished = true;
+
+					ctx.analysisReady.notify_one();
+
+					return true;
+				}
+
+				message = std::move(ctx.incomingMessages.front());
+				ctx.incomingMessages.pop_front();
+			}
+		}
+
+		if(message.empty())
+		{
+			AcceptAnalyses(ctx);
+			continue;
+		}
+
+		if(!HandleMessage(ctx, &message[0], unsigned(message.length())))
+		{
+			std::lock_guard<std::mutex> lock(ctx.incomingLock);
+
+			ctx.workerFailed = true;
+			ctx.workerFinished = true;
+
+			ctx.analysisReady.notify_one();
+
+			return false;
+		}
+	}
+}
+
+void AnalyzeDocuments(Context& ctx)
+{
+	for(;;)
+	{
+		std::unique_ptr<DocumentAnalysis> analysis;
+
+		{
+			std::unique_lock<std::mutex> lock(ctx.incomingLock);
+
+			ctx.analysisReady.wait(lock, [&ctx](){ return !ctx.analysisRequests.empty() || ctx.workerFinished; });
+
+			if(ctx.workerFinished)
+				return;
+
+			analysis = std::move(ctx.analysisRequests.begin()->second);
+			ctx.analysisRequests.erase(ctx.analysisRequests.begin());
+
+			ctx.analysisUri = analysis->uri;
+			nullcResetCancellation(&ctx.analysisCancellation);
+		}
+
+		std::lock_guard<std::mutex> nullcLock(ctx.nullcLock);
+
+		// Analysis that is made before nullc is initialized has no compiler context, requests waiting for it are answered without results
+		if(ctx.nullcInitialized)
+		{
+			// Whole document text is analyzed again, modules it imports are compiled once and are taken from the binary cache
+			ScopedDocumentImport scopedDocumentImport(analysis->uri, analysis->debugMode);
+
+			nullcSetAnalyzeCancellation(&ctx.analysisCancellation);
+
+			auto start = std::chrono::steady_clock::now();
+
+			analysis->result = nullcCreateAnalysis(analysis->code.c_str(), &analysis->analysis) != 0;
+
+			auto finish = std::chrono::steady_clock::now();
+
+			nullcSetAnalyzeCancellation(nullptr);
+
+			if(analysis->debugMode)
+			{
+				CompilerContext *context = nullcGetAnalysisContext(analysis->analysis);
+
+				fprintf(stderr, "DEBUG: Analyzed '%s' in %.2fms, %u modules imported\n", analysis->uri.c_str(), std::chrono::duration<double, std::milli>(finish - start).count(), context ? context->exprCtx.uniqueDependencies.size() : 0u);
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(ctx.incomingLock);
+
+		ctx.analysisUri.clear();
+
+		// Analysis is released before the worker is able to restart nullc
+		if(nullcIsCancellationRequested(&ctx.analysisCancellation))
+		{
+			if(analysis->debugMode)
+				fprintf(stderr, "DEBUG: Cancelled analysis of '%s'\n", analysis->uri.c_str());
+
+			analysis.reset();
+			continue;
+		}
+
+		ctx.analysisResults.push_back(std::move(analysis));
+
+		ctx.incomingReady.notify_one();
+	}
+}
+
 bool HandleMessage(Context& ctx, char *message, unsigned length)
 {
 	(void)length;
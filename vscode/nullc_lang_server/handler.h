@@ -9,6 +9,11 @@ struct Document;
 
 void UpdateDiagnostics(Context& ctx, Document &document);
 
+bool QueueMessage(Context& ctx, const char *message, unsigned length);
+void FinishMessages(Context& ctx);
+bool ProcessMessages(Context& ctx);
+void AnalyzeDocuments(Context& ctx);
+
 bool HandleMessage(Context& ctx, char *message, unsigned length);
 bool HandleMessage(Context& ctx, unsigned idNumber, const char *idString, const char *method, rapidjson::Value& arguments);
 bool HandleNotification(Context& ctx, const char *method, rapidjson::Value& arguments);
@@ -8,6 +8,7 @@
 
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "../../NULLC/nullc.h"
@@ -60,7 +61,15 @@ int main(int argc, char **argv)
 	_setmode(_fileno(stdout), _O_BINARY);
 #endif
 
-	while(std::cin.get(ch))
+	// Messages are handled on a separate thread, so that new messages can cancel the work that is in progress
+	std::thread worker(ProcessMessages, std::ref(ctx));
+
+	// Documents are analyzed on another thread, so that requests are answered from the last analysis while a newer text is analyzed
+	std::thread analyzer(AnalyzeDocuments, std::ref(ctx));
+
+	int result = 0;
+
+	while(result == 0 && std::cin.get(ch))
 	{
 		// Header field ends with \r\n
 		if(ch == '\r')
@@ -71,7 +80,8 @@ int main(int argc, char **argv)
 			if(ch != '\n')
 			{
 				fprintf(stderr, "ERROR: Expected '\\n' after '\\r' after the header\n");
-				return 1;
+				result = 1;
+				break;
 			}
 
 			// If buffer is empty that means headers have ended and we can read the message
@@ -86,8 +96,8 @@ int main(int argc, char **argv)
 
 				message.back() = 0;
 
-				if(!HandleMessage(ctx, message.data(), expectedLength))
-					return 1;
+				if(!QueueMessage(ctx, message.data(), expectedLength))
+					result = 1;
 
 				expectedLength = 0;
 			}
@@ -102,7 +112,8 @@ int main(int argc, char **argv)
 					if(!pos)
 					{
 						fprintf(stderr, "ERROR: Content-Length is not followed by ': '\n");
-						return 1;
+						result = 1;
+						break;
 					}
 
 					pos += 2;
@@ -129,6 +140,19 @@ int main(int argc, char **argv)
 		}
 	}
 
+	FinishMessages(ctx);
+
+	worker.join();
+	analyzer.join();
+
+	// Document analyses have to be released before nullc is terminated
+	ctx.documents.clear();
+
+	ctx.analysisRequests.clear();
+	ctx.analysisResults.clear();
+
 	if(ctx.nullcInitialized)
 		nullcTerminate();
+
+	return result != 0 || ctx.workerFailed ? 1 : 0;
 }